@@ -0,0 +1,153 @@
+// check_pif_locations.c
+// Randomized check of symbol table locations: ranges must not move any other
+// lexeme, and source_tokenize must give the generator's lexemes, locations
+// and numeric values
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lexer_pif_export.h"
+#include "pif_generator.h"
+#include "source_parser.h"
+
+#define CHECK_MAX_STMTS 40
+
+static uint32_t next_random(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(*state >> 33);
+}
+
+static int is_range(const char *lexeme) {
+    const char *terminal = lexeme_to_terminal(lexeme);
+    return terminal && strcmp(terminal, "RANGE") == 0 && strcmp(terminal, lexeme) != 0;
+}
+
+static size_t put_number(char *out, uint64_t *rng) {
+    unsigned v = next_random(rng) % 40;
+    if (next_random(rng) % 4 == 0) return (size_t)sprintf(out, "%u.%u", v, next_random(rng) % 10);
+    return (size_t)sprintf(out, "%u", v);
+}
+
+// Binds and loops over a small pool of names, numbers, ranges (some with
+// blanks around the dots) and strings, so that buckets collide
+static size_t fill(char *buf, uint64_t *rng) {
+    size_t n = 0;
+    int stmts = 1 + (int)(next_random(rng) % CHECK_MAX_STMTS);
+    for (int s = 0; s < stmts; s++) {
+        n += (size_t)sprintf(buf + n, "bind v%u := ", next_random(rng) % 24);
+        switch (next_random(rng) % 5) {
+        case 0:
+            n += put_number(buf + n, rng);
+            break;
+        case 1:
+        case 2:
+            n += put_number(buf + n, rng);
+            n += (size_t)sprintf(buf + n, next_random(rng) % 3 ? ".." : " .. ");
+            n += put_number(buf + n, rng);
+            break;
+        case 3:
+            n += (size_t)sprintf(buf + n, "v%u + ", next_random(rng) % 24);
+            n += put_number(buf + n, rng);
+            break;
+        default:
+            n += (size_t)sprintf(buf + n, "\"s%u\"", next_random(rng) % 8);
+            break;
+        }
+        n += (size_t)sprintf(buf + n, "\n");
+        if (next_random(rng) % 4 == 0) {
+            n += (size_t)sprintf(buf + n, "each w%u in ", next_random(rng) % 24);
+            n += put_number(buf + n, rng);
+            n += (size_t)sprintf(buf + n, "..");
+            n += put_number(buf + n, rng);
+            n += (size_t)sprintf(buf + n, " do\n  set v%u = w%u\nend\n", next_random(rng) % 24, next_random(rng) % 24);
+        }
+    }
+    return n;
+}
+
+static int same_value(const NumLiteral *a, const NumLiteral *b) {
+    return !a == !b && (!a || memcmp(a, b, sizeof(*a)) == 0);
+}
+
+// Returns failures plus the mismatches found in text
+static long check_source(const char *text, size_t len, long failures, long *entries) {
+    SymbolTable st, src_st;
+    NumTable nums, src_nums;
+    st_init(&st, 16);
+    st_init(&src_st, 16);
+    num_table_init(&nums);
+    num_table_init(&src_nums);
+    PIFEntry *gen = NULL, *ref = NULL, *src = NULL;
+    int gen_count = 0, ref_count = 0, src_count = 0;
+    PIFMap tokens;
+    const char **lexemes = NULL;
+
+    if (generate_pif_from_string(text, &gen, &gen_count, &st, &nums) < 0 ||
+        source_tokenize(text, len, &src_st, &src_nums, &tokens) < 0 ||
+        source_tokens_to_entries(&tokens, &src, &src_count) < 0 ||
+        !(lexemes = malloc(sizeof(*lexemes) * (gen_count + 1)))) {
+        fprintf(stderr, "Error: cannot tokenize\n");
+        failures++;
+        goto done;
+    }
+
+    // Reference: the same lexemes with the ranges left out, as before ranges
+    // had symbol table entries
+    for (int i = 0; i < gen_count; i++) lexemes[i] = is_range(gen[i].lexeme) ? NULL : gen[i].lexeme;
+    if (generate_pif_from_tokens(lexemes, gen_count, &ref, &ref_count, NULL, NULL) < 0) {
+        failures++;
+        goto done;
+    }
+    int j = 0;
+    for (int i = 0; i < gen_count; i++) {
+        if (!lexemes[i]) continue;
+        const PIFEntry *r = &ref[j++];
+        if ((strcmp(gen[i].lexeme, r->lexeme) != 0 || gen[i].bucket != r->bucket || gen[i].pos != r->pos) &&
+            failures++ < 10) {
+            fprintf(stderr, "Mismatch: entry %d '%s' at %d,%d, without ranges %d,%d\n",
+                    i, gen[i].lexeme, gen[i].bucket, gen[i].pos, r->bucket, r->pos);
+        }
+    }
+
+    if (src_count != gen_count && failures++ < 10) {
+        fprintf(stderr, "Mismatch: source_tokenize gives %d tokens, the generator %d\n", src_count, gen_count);
+    }
+    for (int i = 0; i < gen_count && i < src_count; i++) {
+        const PIFEntry *g = &gen[i], *s = &src[i];
+        if ((strcmp(g->lexeme, s->lexeme) != 0 || g->bucket != s->bucket || g->pos != s->pos ||
+             !same_value(num_table_get(&nums, g->bucket, g->pos), num_table_get(&src_nums, s->bucket, s->pos))) &&
+            failures++ < 10) {
+            fprintf(stderr, "Mismatch: entry %d '%s' at %d,%d, source_tokenize '%s' at %d,%d\n",
+                    i, g->lexeme, g->bucket, g->pos, s->lexeme, s->bucket, s->pos);
+        }
+    }
+    *entries += gen_count;
+    pif_map_close(&tokens);
+
+done:
+    free(lexemes);
+    free(gen);
+    free(ref);
+    free(src);
+    num_table_free(&nums);
+    num_table_free(&src_nums);
+    st_free(&st);
+    st_free(&src_st);
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc >= 2 ? atol(argv[1]) : 2000;
+    uint64_t rng = argc >= 3 ? strtoull(argv[2], NULL, 10) : 12345;
+    long failures = 0, entries = 0;
+    // Each statement is at most 80 bytes
+    static char buf[CHECK_MAX_STMTS * 80 + 1];
+    for (long it = 0; it < iterations; it++) {
+        size_t n = fill(buf, &rng);
+        failures = check_source(buf, n, failures, &entries);
+    }
+    printf("%ld sources, %ld entries: locations %s\n", iterations, entries,
+           failures ? "MISMATCH" : "unmoved by ranges, source_tokenize agrees");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,256 @@
+// check_regex_dfa.c
+// Randomized agreement check of regex_to_dfa: the identifier and number
+// patterns against identifier.fa and number.fa, and random expressions against
+// a reference matcher that tracks the set of match ends
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dfa.h"
+#include "regex_dfa.h"
+
+#define CHECK_MAX_TEXT 31           // match ends fit a 32-bit mask
+#define CHECK_MAX_REGEX 512
+
+static uint32_t next_random(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(*state >> 33);
+}
+
+// Random expression over {a, b, c}, kept as a tree for the reference matcher
+typedef enum { EX_BYTE, EX_CLASS, EX_ANY, EX_EMPTY, EX_CAT, EX_ALT, EX_REPEAT } ExKind;
+
+typedef struct Ex {
+    ExKind kind;
+    char byte;                  // EX_BYTE
+    char lo, hi;                // EX_CLASS [lo-hi]
+    int min, max;               // EX_REPEAT, max -1 = unbounded
+    struct Ex *a, *b;
+} Ex;
+
+static Ex *random_ex(uint64_t *rng, int depth) {
+    Ex *e = calloc(1, sizeof(Ex));
+    if (!e) exit(1);
+    int pick = depth <= 0 ? (int)(next_random(rng) % 4) : (int)(next_random(rng) % 10);
+    if (pick == 0 || pick == 4) {
+        e->kind = EX_BYTE;
+        e->byte = (char)('a' + next_random(rng) % 3);
+    } else if (pick == 1) {
+        e->kind = EX_CLASS;
+        e->lo = (char)('a' + next_random(rng) % 3);
+        e->hi = (char)(e->lo + next_random(rng) % ('c' - e->lo + 1));
+    } else if (pick == 2) {
+        e->kind = EX_ANY;
+    } else if (pick == 3) {
+        e->kind = EX_EMPTY;
+    } else if (pick <= 6) {
+        e->kind = EX_CAT;
+    } else if (pick == 7) {
+        e->kind = EX_ALT;
+    } else {
+        e->kind = EX_REPEAT;
+        static const int bounds[][2] = { { 0, -1 }, { 1, -1 }, { 0, 1 }, { 2, 2 }, { 1, 3 }, { 2, -1 } };
+        int k = (int)(next_random(rng) % 6);
+        e->min = bounds[k][0];
+        e->max = bounds[k][1];
+    }
+    if (e->kind == EX_CAT || e->kind == EX_ALT || e->kind == EX_REPEAT) e->a = random_ex(rng, depth - 1);
+    if (e->kind == EX_CAT || e->kind == EX_ALT) e->b = random_ex(rng, depth - 1);
+    return e;
+}
+
+static void free_ex(Ex *e) {
+    if (!e) return;
+    free_ex(e->a);
+    free_ex(e->b);
+    free(e);
+}
+
+static void put(char *out, size_t *len, const char *s) {
+    size_t n = strlen(s);
+    if (*len + n < CHECK_MAX_REGEX) memcpy(out + *len, s, n + 1);
+    *len += n;
+}
+
+// Every operand is grouped, so the text needs no precedence rules
+static void print_ex(const Ex *e, char *out, size_t *len) {
+    char tmp[16];
+    switch (e->kind) {
+    case EX_BYTE:
+        tmp[0] = e->byte;
+        tmp[1] = '\0';
+        put(out, len, tmp);
+        break;
+    case EX_CLASS:
+        snprintf(tmp, sizeof(tmp), "[%c-%c]", e->lo, e->hi);
+        put(out, len, tmp);
+        break;
+    case EX_ANY:
+        put(out, len, ".");
+        break;
+    case EX_EMPTY:
+        put(out, len, "()");
+        break;
+    case EX_CAT:
+    case EX_ALT:
+        put(out, len, "(");
+        print_ex(e->a, out, len);
+        put(out, len, e->kind == EX_CAT ? ")(" : "|");
+        print_ex(e->b, out, len);
+        put(out, len, ")");
+        break;
+    case EX_REPEAT:
+        put(out, len, "(");
+        print_ex(e->a, out, len);
+        if (e->min == 0 && e->max == -1) snprintf(tmp, sizeof(tmp), ")*");
+        else if (e->min == 1 && e->max == -1) snprintf(tmp, sizeof(tmp), ")+");
+        else if (e->min == 0 && e->max == 1) snprintf(tmp, sizeof(tmp), ")?");
+        else if (e->max == -1) snprintf(tmp, sizeof(tmp), "){%d,}", e->min);
+        else snprintf(tmp, sizeof(tmp), "){%d,%d}", e->min, e->max);
+        put(out, len, tmp);
+        break;
+    }
+}
+
+// Ends of the matches of e that start at the positions in starts (bit i = offset i)
+static uint32_t match_ends(const Ex *e, const char *s, int n, uint32_t starts) {
+    uint32_t ends = 0;
+    switch (e->kind) {
+    case EX_BYTE:
+    case EX_CLASS:
+    case EX_ANY:
+        for (int i = 0; i < n; i++) {
+            if (!(starts >> i & 1)) continue;
+            char c = s[i];
+            int ok = e->kind == EX_ANY ? c != '\n' : e->kind == EX_BYTE ? c == e->byte : c >= e->lo && c <= e->hi;
+            if (ok) ends |= 1u << (i + 1);
+        }
+        return ends;
+    case EX_EMPTY:
+        return starts;
+    case EX_CAT:
+        return match_ends(e->b, s, n, match_ends(e->a, s, n, starts));
+    case EX_ALT:
+        return match_ends(e->a, s, n, starts) | match_ends(e->b, s, n, starts);
+    case EX_REPEAT: {
+        uint32_t cur = starts;
+        for (int k = 0; k < e->min; k++) cur = match_ends(e->a, s, n, cur);
+        ends = cur;
+        for (int k = e->min; e->max < 0 || k < e->max; k++) {
+            cur = match_ends(e->a, s, n, cur);
+            if ((ends | cur) == ends) break;
+            ends |= cur;
+        }
+        return ends;
+    }
+    }
+    return 0;
+}
+
+static int highest_bit(uint32_t m) {
+    int i = -1;
+    while (m) {
+        m >>= 1;
+        i++;
+    }
+    return i;
+}
+
+static void random_text(char *s, int n, const char *alphabet, uint64_t *rng) {
+    size_t k = strlen(alphabet);
+    for (int i = 0; i < n; i++) s[i] = alphabet[next_random(rng) % k];
+    s[n] = '\0';
+}
+
+// regex_to_dfa(re) against a .fa file on random texts
+static long check_against_fa(const char *re, const char *fa, const char *alphabet, long iterations, uint64_t *rng) {
+    DFA from_regex, from_file;
+    if (regex_to_dfa(re, &from_regex, NULL, NULL) != 0) {
+        fprintf(stderr, "Error: cannot compile %s\n", re);
+        return 1;
+    }
+    if (dfa_load(fa, &from_file) != 0) {
+        printf("%s not found, skipped\n", fa);
+        dfa_free(&from_regex);
+        return 0;
+    }
+    long failures = 0;
+    char text[CHECK_MAX_TEXT + 1];
+    for (long it = 0; it < iterations; it++) {
+        random_text(text, (int)(next_random(rng) % (CHECK_MAX_TEXT + 1)), alphabet, rng);
+        int expected = dfa_longest(&from_file, text);
+        int got = dfa_longest(&from_regex, text);
+        if (got != expected && failures++ < 10) {
+            fprintf(stderr, "Mismatch: %s on \"%s\": %d, %s says %d\n", re, text, got, fa, expected);
+        }
+    }
+    printf("%s vs %s: %s\n", re, fa, failures ? "MISMATCH" : "agree");
+    dfa_free(&from_regex);
+    dfa_free(&from_file);
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc >= 2 ? atol(argv[1]) : 20000;
+    uint64_t rng = argc >= 3 ? strtoull(argv[2], NULL, 10) : 12345;
+    long failures = 0;
+
+    failures += check_against_fa("[A-Za-z_][A-Za-z0-9_]*", "identifier.fa", "aZ_09.-+ ", iterations * 10, &rng);
+    failures += check_against_fa("[0-9]+(\\.[0-9]+)?", "number.fa", "0159..a ", iterations * 10, &rng);
+
+    // Random expressions: the DFA's longest match against the reference
+    long compiled = 0;
+    for (long it = 0; it < iterations; it++) {
+        Ex *e = random_ex(&rng, 1 + (int)(next_random(&rng) % 5));
+        char re[CHECK_MAX_REGEX];
+        size_t len = 0;
+        re[0] = '\0';
+        print_ex(e, re, &len);
+        DFA d;
+        if (len >= CHECK_MAX_REGEX || regex_to_dfa(re, &d, NULL, NULL) != 0) {
+            free_ex(e);
+            continue;
+        }
+        compiled++;
+        for (int t = 0; t < 8; t++) {
+            char text[CHECK_MAX_TEXT + 1];
+            int n = (int)(next_random(&rng) % (CHECK_MAX_TEXT + 1));
+            random_text(text, n, "abcd", &rng);
+            int expected = highest_bit(match_ends(e, text, n, 1u));
+            if (expected < 0) expected = 0;
+            int got = dfa_longest(&d, text);
+            if (got != expected && failures++ < 10) {
+                fprintf(stderr, "Mismatch: %s on \"%s\": %d, expected %d\n", re, text, got, expected);
+            }
+        }
+        dfa_free(&d);
+        free_ex(e);
+    }
+    printf("%ld random expressions x 8 texts: %s\n", compiled, failures ? "MISMATCH" : "agree");
+
+    // Nesting: REGEX_MAX_DEPTH groups compile, one more is a syntax error at its '('
+    long nest_failures = 0;
+    char *re = malloc(2 * (REGEX_MAX_DEPTH + 1) + 2);
+    if (!re) return 1;
+    for (int extra = 0; extra <= 1; extra++) {
+        size_t k = REGEX_MAX_DEPTH + (size_t)extra;
+        memset(re, '(', k);
+        re[k] = 'a';
+        memset(re + k + 1, ')', k);
+        re[2 * k + 1] = '\0';
+        DFA d;
+        int err_pos = -1;
+        int rc = regex_to_dfa(re, &d, NULL, &err_pos);
+        if (rc == 0) dfa_free(&d);
+        int ok = extra ? rc == -2 && err_pos == REGEX_MAX_DEPTH : rc == 0;
+        if (!ok) {
+            nest_failures++;
+            fprintf(stderr, "Mismatch: %zu nested groups: rc %d, error offset %d\n", k, rc, err_pos);
+        }
+    }
+    free(re);
+    printf("Nesting limit of %d groups: %s\n", REGEX_MAX_DEPTH, nest_failures ? "MISMATCH" : "ok");
+    failures += nest_failures;
+    return failures ? 1 : 0;
+}
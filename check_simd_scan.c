@@ -0,0 +1,76 @@
+// check_simd_scan.c
+// Randomized agreement check of the simd_scan run finders: scalar, SSE2 and
+// AVX2 kernels against a byte-by-byte walk of simd_scan_in_run
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simd_scan.h"
+
+#define CHECK_MAX_LEN 200
+
+// Bytes near the edges of every run class, so runs end at varied offsets
+static const unsigned char POOL[] = {
+    'a', 'z', 'A', 'Z', 'q', '0', '9', '5', '_', ' ', '\t', '\v', '\f', '\r', '\n',
+    '"', '\\', '/', '@', '[', '`', '{', 0x00, 0x7F, 0x80, 0xBF, 0xC2, 0xC3, 0xCE,
+    0xE2, 0xE3, 0xE4, 0xEF, 0xF0, 0xFF
+};
+
+static uint32_t next_random(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(*state >> 33);
+}
+
+// Mostly runs of one class, with a stray byte from the pool now and then
+static void fill(unsigned char *buf, int n, uint64_t *rng) {
+    ScanRunKind kind = (ScanRunKind)(1 + next_random(rng) % (SCAN_RUN_KINDS - 1));
+    for (int i = 0; i < n; i++) {
+        unsigned char c;
+        if (next_random(rng) % 8 == 0) {
+            c = POOL[next_random(rng) % sizeof(POOL)];
+        } else {
+            do c = (unsigned char)next_random(rng); while (!simd_scan_in_run(kind, c));
+        }
+        buf[i] = c;
+    }
+}
+
+static const char *reference_run(ScanRunKind kind, const char *p, const char *end) {
+    while (p < end && simd_scan_in_run(kind, (unsigned char)*p)) p++;
+    return p;
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc >= 2 ? atol(argv[1]) : 200000;
+    uint64_t rng = argc >= 3 ? strtoull(argv[2], NULL, 10) : 12345;
+    SimdLevel best = simd_scan_level();
+    printf("Levels checked: scalar");
+    for (int l = SIMD_LEVEL_SSE2; l <= (int)best; l++) printf(", %s", simd_scan_level_name((SimdLevel)l));
+    printf("\n");
+
+    unsigned char buf[CHECK_MAX_LEN + 32];
+    long failures = 0;
+    for (long it = 0; it < iterations; it++) {
+        int n = (int)(next_random(&rng) % CHECK_MAX_LEN);
+        int skew = (int)(next_random(&rng) % 32);        // unaligned starts
+        fill(buf + skew, n, &rng);
+        const char *p = (const char *)buf + skew;
+        const char *end = p + n;
+        for (int k = 1; k < SCAN_RUN_KINDS; k++) {
+            const char *expected = reference_run((ScanRunKind)k, p, end);
+            for (int l = SIMD_LEVEL_SCALAR; l <= (int)best; l++) {
+                simd_scan_set_level((SimdLevel)l);
+                const char *got = simd_scan_run((ScanRunKind)k, p, end);
+                if (got != expected && failures++ < 10) {
+                    fprintf(stderr, "Mismatch: kind %d, %s, length %d: run of %d bytes, expected %d\n",
+                            k, simd_scan_level_name((SimdLevel)l), n, (int)(got - p), (int)(expected - p));
+                }
+            }
+            simd_scan_set_level(best);
+        }
+    }
+    printf("%ld buffers x %d run kinds: %s\n", iterations, SCAN_RUN_KINDS - 1,
+           failures ? "MISMATCH" : "all levels agree");
+    return failures ? 1 : 0;
+}
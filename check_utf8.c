@@ -0,0 +1,201 @@
+// check_utf8.c
+// Randomized agreement check of the UTF-8 paths: simd_utf8_validate at every
+// level against a decoding validator, the mixed lead bytes against
+// dfa_utf8_letter, and the UTF-8 scanner's identifiers against dfa_longest_utf8
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dfa.h"
+#include "lexer_pif_export.h"
+#include "regex_dfa.h"
+#include "scanner_dfa.h"
+#include "simd_scan.h"
+
+#define CHECK_MAX_LEN 300
+#define CHECK_MAX_IDENT 64              // well under SCAN_MAX_WORD
+
+static uint32_t next_random(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(*state >> 33);
+}
+
+static size_t encode(uint32_t cp, unsigned char *out) {
+    if (cp < 0x80) {
+        out[0] = (unsigned char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (unsigned char)(0xC0 | cp >> 6);
+        out[1] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (unsigned char)(0xE0 | cp >> 12);
+        out[1] = (unsigned char)(0x80 | (cp >> 6 & 0x3F));
+        out[2] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (unsigned char)(0xF0 | cp >> 18);
+    out[1] = (unsigned char)(0x80 | (cp >> 12 & 0x3F));
+    out[2] = (unsigned char)(0x80 | (cp >> 6 & 0x3F));
+    out[3] = (unsigned char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Decodes by the lead byte's length and rejects what the code point rules out
+// (overlong, surrogate, above U+10FFFF), instead of table 3-7's byte ranges
+static const unsigned char *reference_validate(const unsigned char *p, const unsigned char *end) {
+    static const uint32_t min_cp[] = { 0, 0, 0x80, 0x800, 0x10000 };
+    while (p < end) {
+        unsigned char c = *p;
+        size_t n = c < 0x80 ? 1 : c < 0xC0 ? 0 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : c < 0xF8 ? 4 : 0;
+        if (n == 0 || (size_t)(end - p) < n) return p;
+        uint32_t cp = n == 1 ? c : c & (0x7F >> n);
+        for (size_t i = 1; i < n; i++) {
+            if ((p[i] & 0xC0) != 0x80) return p;
+            cp = cp << 6 | (p[i] & 0x3F);
+        }
+        if (cp < min_cp[n] || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) return p;
+        p += n;
+    }
+    return end;
+}
+
+static uint32_t random_code_point(uint64_t *rng) {
+    static const uint32_t edges[] = {
+        0x7F, 0x80, 0xAA, 0xBF, 0xC0, 0xD7, 0xF7, 0x7FF, 0x800, 0x1FFF, 0x2000, 0x206F, 0x2070,
+        0x27FF, 0x2800, 0x3003, 0x3004, 0x4E2D, 0xD7FF, 0xE000, 0xFEFF, 0xFFEF, 0xFFFF, 0x10000,
+        0x1F600, 0x10FFFF
+    };
+    switch (next_random(rng) % 4) {
+    case 0:
+        return edges[next_random(rng) % (sizeof(edges) / sizeof(edges[0]))];
+    case 1:
+        return 0x80 + next_random(rng) % 0x780;
+    case 2:
+        return 0x800 + next_random(rng) % 0xF800;
+    default:
+        return 0x10000 + next_random(rng) % 0x100000;
+    }
+}
+
+// Mostly well-formed text; some buffers get a byte mutated or a sequence cut
+static size_t fill(unsigned char *buf, size_t cap, uint64_t *rng) {
+    size_t n = 0;
+    size_t target = next_random(rng) % cap;
+    while (n + 4 <= target) {
+        if (next_random(rng) % 3 == 0) {
+            buf[n++] = (unsigned char)(' ' + next_random(rng) % 95);
+        } else {
+            uint32_t cp = random_code_point(rng);
+            if (cp >= 0xD800 && cp <= 0xDFFF) cp = 0xE000;
+            n += encode(cp, buf + n);
+        }
+    }
+    int damage = (int)(next_random(rng) % 4);
+    if (n && damage == 1) buf[next_random(rng) % n] = (unsigned char)next_random(rng);
+    if (n && damage == 2) n -= next_random(rng) % (n < 3 ? n : 3);
+    return n;
+}
+
+static long check_validate(long iterations, uint64_t *rng) {
+    SimdLevel best = simd_scan_level();
+    unsigned char buf[CHECK_MAX_LEN + 32];
+    long failures = 0;
+    for (long it = 0; it < iterations; it++) {
+        size_t skew = next_random(rng) % 32;            // unaligned starts
+        size_t n = fill(buf + skew, CHECK_MAX_LEN, rng);
+        const char *p = (const char *)buf + skew;
+        const char *expected = (const char *)reference_validate(buf + skew, buf + skew + n);
+        for (int l = SIMD_LEVEL_SCALAR; l <= (int)best; l++) {
+            simd_scan_set_level((SimdLevel)l);
+            const char *got = simd_utf8_validate(p, p + n);
+            if (got != expected && failures++ < 10) {
+                fprintf(stderr, "Mismatch: simd_utf8_validate, %s, length %zu: invalid at %d, expected %d\n",
+                        simd_scan_level_name((SimdLevel)l), n, (int)(got - p), (int)(expected - p));
+            }
+        }
+        simd_scan_set_level(best);
+    }
+    printf("%ld buffers: simd_utf8_validate %s\n", iterations, failures ? "MISMATCH" : "agrees at all levels");
+    return failures;
+}
+
+// Every code point that is not a letter must start with a mixed lead byte
+static long check_mixed_leads(void) {
+    long failures = 0;
+    for (uint32_t cp = 0x80; cp <= 0x10FFFF; cp++) {
+        if (cp >= 0xD800 && cp <= 0xDFFF) continue;
+        unsigned char s[4];
+        encode(cp, s);
+        if (!dfa_utf8_letter(cp) && !simd_utf8_mixed_lead(s[0]) && failures++ < 10) {
+            fprintf(stderr, "Mismatch: U+%04X is not a letter but its lead byte 0x%02X is not mixed\n",
+                    (unsigned)cp, s[0]);
+        }
+    }
+    printf("Non-letter code points: %s\n", failures ? "MISMATCH" : "all behind mixed leads");
+    return failures;
+}
+
+// A non-ASCII letter, then identifier bytes, letters, non-letters, punctuation
+// and the odd invalid byte; the scanner's first token is the identifier
+static long check_identifiers(long iterations, uint64_t *rng) {
+    const ScannerDFA *sd = scanner_dfa_default_utf8();
+    DFA ident;
+    if (!sd || (dfa_load("identifier.fa", &ident) != 0 &&
+                regex_to_dfa("[A-Za-z_][A-Za-z0-9_]*", &ident, NULL, NULL) != 0)) {
+        fprintf(stderr, "Error: cannot build the UTF-8 scanner\n");
+        return 1;
+    }
+    long failures = 0;
+    unsigned char buf[CHECK_MAX_IDENT + 8];
+    for (long it = 0; it < iterations; it++) {
+        uint32_t cp;
+        do cp = random_code_point(rng); while (!dfa_utf8_letter(cp) || (cp >= 0xD800 && cp <= 0xDFFF));
+        size_t n = encode(cp, buf);
+        while (n + 4 <= CHECK_MAX_IDENT && next_random(rng) % 12) {
+            int pick = (int)(next_random(rng) % 10);
+            if (pick < 4) {
+                static const char ascii[] = "aZ_09";
+                buf[n++] = (unsigned char)ascii[next_random(rng) % 5];
+            } else if (pick < 8) {
+                uint32_t c = random_code_point(rng);
+                if (c >= 0xD800 && c <= 0xDFFF) c = 0xE000;
+                n += encode(c, buf + n);
+            } else if (pick == 8) {
+                static const char punct[] = " .(+\"";
+                buf[n++] = (unsigned char)punct[next_random(rng) % 5];
+            } else {
+                buf[n++] = (unsigned char)(0x80 + next_random(rng) % 0x80);
+            }
+        }
+        buf[n] = '\0';
+        const char *p = (const char *)buf;
+        const char *valid_end = p;
+        ScanToken tok;
+        int expected = dfa_longest_utf8(&ident, p);
+        int ok = scanner_dfa_next_utf8(sd, &p, (const char *)buf + n, &valid_end, &tok);
+        int got = ok && tok.tag == LT_IDENTIFIER && tok.start == (const char *)buf ? (int)tok.length : -1;
+        if (got != expected && failures++ < 10) {
+            fprintf(stderr, "Mismatch: identifier of %d bytes, dfa_longest_utf8 says %d:", got, expected);
+            for (size_t i = 0; i < n; i++) fprintf(stderr, " %02X", buf[i]);
+            fprintf(stderr, "\n");
+        }
+    }
+    dfa_free(&ident);
+    printf("%ld identifiers: scanner_dfa_next_utf8 %s\n", iterations,
+           failures ? "MISMATCH" : "agrees with dfa_longest_utf8");
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc >= 2 ? atol(argv[1]) : 100000;
+    uint64_t rng = argc >= 3 ? strtoull(argv[2], NULL, 10) : 12345;
+    long failures = 0;
+    failures += check_validate(iterations, &rng);
+    failures += check_mixed_leads();
+    failures += check_identifiers(iterations, &rng);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,257 @@
+// classifier_bench.c
+// Micro-benchmark of the perfect-hash lexeme classifier against the previous
+// strcasecmp chain; --generate re-derives the hash multipliers and slot table
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "lexer_pif_export.h"
+#include "pif_reader.h"
+
+#ifdef _WIN32
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#endif
+
+// Previous if-chain classifier, kept verbatim as the baseline
+static const char *legacy_lexeme_to_terminal(const char *lexeme) {
+    if (!lexeme) return NULL;
+    
+    // Keywords (exact match, case-insensitive)
+    if (strcasecmp(lexeme, "bind") == 0) return "BIND";
+    if (strcasecmp(lexeme, "set") == 0) return "SET";
+    if (strcasecmp(lexeme, "def") == 0) return "DEF";
+    if (strcasecmp(lexeme, "yield") == 0) return "YIELD";
+    if (strcasecmp(lexeme, "when") == 0) return "WHEN";
+    if (strcasecmp(lexeme, "otherwise") == 0) return "OTHERWISE";
+    if (strcasecmp(lexeme, "each") == 0) return "EACH";
+    if (strcasecmp(lexeme, "in") == 0) return "IN";
+    if (strcasecmp(lexeme, "do") == 0) return "DO";
+    if (strcasecmp(lexeme, "end") == 0) return "END";
+    if (strcasecmp(lexeme, "and") == 0) return "AND";
+    if (strcasecmp(lexeme, "or") == 0) return "OR";
+    if (strcasecmp(lexeme, "not") == 0) return "NOT";
+    if (strcasecmp(lexeme, "asc") == 0) return "ASC";
+    if (strcasecmp(lexeme, "desc") == 0) return "DESC";
+
+    // Accept common token-label synonyms produced by some lexers (e.g., 'lparen','colon')
+    if (strcasecmp(lexeme, "lparen") == 0) return "LPAREN";
+    if (strcasecmp(lexeme, "rparen") == 0) return "RPAREN";
+    if (strcasecmp(lexeme, "lbracket") == 0) return "LBRACKET";
+    if (strcasecmp(lexeme, "rbracket") == 0) return "RBRACKET";
+    if (strcasecmp(lexeme, "colon") == 0) return "ASSIGN"; /* 'colon' often represents ':=' */
+    if (strcasecmp(lexeme, "arrow") == 0) return "LAMBDA"; /* 'arrow' -> '->' */
+    if (strcasecmp(lexeme, "plus") == 0) return "PLUS";
+    if (strcasecmp(lexeme, "minus") == 0) return "MINUS";
+    if (strcasecmp(lexeme, "mul") == 0) return "MUL";
+    if (strcasecmp(lexeme, "div") == 0) return "DIV";
+    if (strcasecmp(lexeme, "percent") == 0) return "MOD";
+    if (strcasecmp(lexeme, "comma") == 0) return "COMMA";
+    
+    // Stage keywords
+    if (strcasecmp(lexeme, "apply") == 0) return "APPLY";
+    if (strcasecmp(lexeme, "keep") == 0) return "KEEP";
+    if (strcasecmp(lexeme, "order") == 0) return "ORDER";
+    if (strcasecmp(lexeme, "dedupe") == 0) return "DEDUPE";
+    if (strcasecmp(lexeme, "take") == 0) return "TAKE";
+    if (strcasecmp(lexeme, "skip") == 0) return "SKIP";
+    if (strcasecmp(lexeme, "concat") == 0) return "CONCAT";
+    if (strcasecmp(lexeme, "joinstr") == 0) return "JOINSTR";
+    if (strcasecmp(lexeme, "total") == 0) return "TOTAL";
+    if (strcasecmp(lexeme, "count") == 0) return "COUNT";
+    if (strcasecmp(lexeme, "avg") == 0) return "AVG";
+    
+    // Literals
+    if (strcasecmp(lexeme, "true") == 0) return "BOOL_LIT";
+    if (strcasecmp(lexeme, "false") == 0) return "BOOL_LIT";
+    if (strcasecmp(lexeme, "none") == 0) return "NONE";
+    
+    // Operators (exact match)
+    if (strcmp(lexeme, ":=") == 0) return "ASSIGN";
+    if (strcmp(lexeme, "->") == 0) return "LAMBDA";
+    if (strcmp(lexeme, "|>") == 0) return "PIPELINE";
+    if (strcmp(lexeme, "**") == 0) return "POW";
+    if (strcmp(lexeme, ">=") == 0) return "GE";
+    if (strcmp(lexeme, "<=") == 0) return "LE";
+    if (strcmp(lexeme, "==") == 0) return "EQ";
+    if (strcmp(lexeme, "!=") == 0) return "NE";
+    if (strcmp(lexeme, "..<") == 0) return "RANGE_DOT_LT";
+    if (strcmp(lexeme, "..") == 0) return "RANGE_DOT";
+    if (strcmp(lexeme, "+") == 0) return "PLUS";
+    if (strcmp(lexeme, "-") == 0) return "MINUS";
+    if (strcmp(lexeme, "*") == 0) return "MUL";
+    if (strcmp(lexeme, "/") == 0) return "DIV";
+    if (strcmp(lexeme, "%") == 0) return "MOD";
+    if (strcmp(lexeme, "<") == 0) return "LT";
+    if (strcmp(lexeme, ">") == 0) return "GT";
+    if (strcmp(lexeme, "=") == 0) return "UPDATE";
+    
+    // Separators
+    if (strcmp(lexeme, "(") == 0) return "LPAREN";
+    if (strcmp(lexeme, ")") == 0) return "RPAREN";
+    if (strcmp(lexeme, "[") == 0) return "LBRACKET";
+    if (strcmp(lexeme, "]") == 0) return "RBRACKET";
+    if (strcmp(lexeme, ",") == 0) return "COMMA";
+    
+    // Newline
+    if (strcmp(lexeme, "\n") == 0 || strcmp(lexeme, "\r\n") == 0) return "NL";
+    // Also accept the literal token name "NL" (used by PIF generator)
+    if (strcasecmp(lexeme, "NL") == 0) return "NL";
+    
+    // String literals (quoted)
+    if (lexeme[0] == '"' && lexeme[strlen(lexeme)-1] == '"') return "STRING";
+    
+    // Number literals (check if it's a number)
+    int is_number = 1;
+    int has_dot = 0;
+    for (int i = 0; lexeme[i]; i++) {
+        if (lexeme[i] == '.') {
+            if (has_dot) { is_number = 0; break; }
+            has_dot = 1;
+        } else if (!isdigit((unsigned char)lexeme[i])) {
+            is_number = 0;
+            break;
+        }
+    }
+    if (is_number && strlen(lexeme) > 0) return "NUMBER";
+
+    // Range literal format: digits..digits (merged by PIF generator)
+    if (strstr(lexeme, "..") != NULL) {
+        int ok = 1; // ensure both sides are numbers
+        char *s = malloc(strlen(lexeme) + 1);
+        strcpy(s, lexeme);
+        char *dot = strstr(s, "..");
+        if (!dot) { free(s); }
+        else {
+            *dot = '\0';
+            char *left = s;
+            char *right = dot + 2;
+            // validate left
+            for (int i = 0; left[i]; i++) if (!isdigit((unsigned char)left[i]) && left[i] != '.') ok = 0;
+            for (int i = 0; right[i]; i++) if (!isdigit((unsigned char)right[i]) && right[i] != '.') ok = 0;
+            free(s);
+            if (ok) return "RANGE";
+        }
+    }
+    
+    // Identifiers (everything else that's alphanumeric/underscore)
+    int is_identifier = 1;
+    for (int i = 0; lexeme[i]; i++) {
+        if (!isalnum((unsigned char)lexeme[i]) && lexeme[i] != '_') {
+            is_identifier = 0;
+            break;
+        }
+    }
+    if (is_identifier && strlen(lexeme) > 0) {
+        // Check if it's not a keyword (already checked above)
+        return "IDENTIFIER";
+    }
+    
+    // Unknown token
+    return NULL;
+}
+
+// Find multipliers that place every keyword in its own slot and print the table
+static int generate(void) {
+    unsigned char slots[LEXEME_HASH_SIZE];
+    for (int a = 1; a < 64; a++) {
+        for (int b = 1; b < 64; b++) {
+            for (int c = 1; c < 64; c++) {
+                memset(slots, 255, sizeof(slots));
+                int ok = 1;
+                for (int k = 0; k < LEXEME_KEYWORD_COUNT && ok; k++) {
+                    const LexemeKeyword *kw = &lexeme_keywords[k];
+                    unsigned char c0 = (unsigned char)kw->key[0];
+                    unsigned char c1 = kw->len > 1 ? (unsigned char)kw->key[1] : c0;
+                    unsigned char cl = (unsigned char)kw->key[kw->len - 1];
+                    unsigned h = LEXEME_HASH(c0, c1, cl, kw->len, a, b, c);
+                    if (slots[h] != 255) ok = 0; else slots[h] = (unsigned char)k;
+                }
+                if (!ok) continue;
+                printf("#define LEXEME_HASH_A %d\n#define LEXEME_HASH_B %d\n#define LEXEME_HASH_C %d\n\n", a, b, c);
+                printf("static const unsigned char keyword_slots[LEXEME_HASH_SIZE] = {\n");
+                for (int i = 0; i < LEXEME_HASH_SIZE; i++) {
+                    printf("%s%3d,%s", i % 16 == 0 ? "    " : " ", slots[i], i % 16 == 15 ? "\n" : "");
+                }
+                printf("};\n");
+                return 0;
+            }
+        }
+    }
+    fprintf(stderr, "No collision-free multipliers below 64; grow LEXEME_HASH_SIZE\n");
+    return 1;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--generate") == 0) return generate();
+
+    const char *pif_file = argc > 1 ? argv[1] : "programB_right.pif";
+    int iterations = argc > 2 ? atoi(argv[2]) : 200;
+
+    PIFEntry *entries = NULL;
+    int count = 0;
+    if (read_pif_from_file(pif_file, &entries, &count) <= 0) {
+        fprintf(stderr, "Usage: %s [--generate] [pif_file] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    // Both classifiers must agree on the corpus and on every keyword in either case
+    int mismatches = 0;
+    for (int i = 0; i < count + 2 * LEXEME_KEYWORD_COUNT; i++) {
+        char upper[16];
+        const char *lex;
+        if (i < count) {
+            lex = entries[i].lexeme;
+        } else if (i < count + LEXEME_KEYWORD_COUNT) {
+            lex = lexeme_keywords[i - count].key;
+        } else {
+            const char *key = lexeme_keywords[i - count - LEXEME_KEYWORD_COUNT].key;
+            size_t n = strlen(key);
+            for (size_t k = 0; k <= n; k++) upper[k] = (char)toupper((unsigned char)key[k]);
+            lex = upper;
+        }
+        const char *a = legacy_lexeme_to_terminal(lex);
+        const char *b = lexeme_to_terminal(lex);
+        if ((a == NULL) != (b == NULL) || (a && strcmp(a, b) != 0)) {
+            fprintf(stderr, "mismatch for '%s': %s vs %s\n", lex, a ? a : "NULL", b ? b : "NULL");
+            mismatches++;
+        }
+    }
+
+    size_t *lengths = malloc(sizeof(size_t) * (size_t)(count > 0 ? count : 1));
+    for (int i = 0; i < count; i++) lengths[i] = strlen(entries[i].lexeme);
+
+    volatile size_t sink = 0;
+    double t0 = now_ms();
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < count; i++) sink += (size_t)legacy_lexeme_to_terminal(entries[i].lexeme);
+    }
+    double t1 = now_ms();
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < count; i++) sink += (size_t)lexeme_to_terminal(entries[i].lexeme);
+    }
+    double t2 = now_ms();
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < count; i++) sink += (size_t)lexeme_terminal_id(entries[i].lexeme, lengths[i]);
+    }
+    double t3 = now_ms();
+
+    double n = (double)count * iterations;
+    printf("%d lexemes x %d iterations, %d mismatches\n", count, iterations, mismatches);
+    printf("legacy chain:        %8.2f ns/lexeme\n", (t1 - t0) * 1e6 / n);
+    printf("lexeme_to_terminal:  %8.2f ns/lexeme\n", (t2 - t1) * 1e6 / n);
+    printf("lexeme_terminal_id:  %8.2f ns/lexeme\n", (t3 - t2) * 1e6 / n);
+
+    free(lengths);
+    free_pif_entries(entries, count);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+// compiled_grammar.c
+// Integer-indexed grammar tables for the fast parsing engines
+
+#include "compiled_grammar.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int is_epsilon_symbol(const char *s) {
+    return strcmp(s, "epsilon") == 0 || strcmp(s, "ε") == 0;
+}
+
+int cg_init(CompiledGrammar *cg, int **table, StrList *nonterms, StrList *terms, ProdList *prods) {
+    memset(cg, 0, sizeof(*cg));
+    cg->table = table;
+    cg->nonterms = nonterms;
+    cg->terms = terms;
+    cg->prods = prods;
+    cg->nt_count = nonterms->count;
+    cg->t_count = terms->count;
+    cg->dollar = sl_index(terms, "$");
+    cg->prod_count = prods->count;
+    for (int id = 0; id < LT_NUM_TERMINALS; id++) {
+        cg->lexeme_columns[id] = sl_index(terms, lexeme_terminal_names[id]);
+    }
+
+    cg->prod_lhs = malloc(sizeof(int) * (prods->count + 1));
+    cg->prod_len = malloc(sizeof(int) * (prods->count + 1));
+    cg->prod_terms = malloc(sizeof(int) * (prods->count + 1));
+    cg->prod_rhs = calloc(prods->count + 1, sizeof(int*));
+    if (!cg->prod_lhs || !cg->prod_len || !cg->prod_terms || !cg->prod_rhs) {
+        cg_free(cg);
+        return -1;
+    }
+
+    for (int p = 0; p < prods->count; p++) {
+        Production *prod = &prods->items[p];
+        cg->prod_lhs[p] = prod->lhs;
+        cg->prod_rhs[p] = malloc(sizeof(int) * (prod->rhs_len + 1));
+        if (!cg->prod_rhs[p]) {
+            // Rows not reached yet are still NULL from calloc
+            cg_free(cg);
+            return -1;
+        }
+        cg->prod_len[p] = 0;
+        cg->prod_terms[p] = 0;
+        for (int k = 0; k < prod->rhs_len; k++) {
+            if (is_epsilon_symbol(prod->rhs[k])) continue;
+            int sym = cg_symbol_id(cg, prod->rhs[k]);
+            if (sym < 0) {
+                fprintf(stderr, "compiled grammar: unknown symbol '%s' in production %d\n", prod->rhs[k], p);
+                cg_free(cg);
+                return -1;
+            }
+            cg->prod_rhs[p][cg->prod_len[p]++] = sym;
+            if (cg_is_terminal(cg, sym)) cg->prod_terms[p]++;
+        }
+    }
+    return 0;
+}
+
+void cg_free(CompiledGrammar *cg) {
+    if (cg->prod_rhs) {
+        for (int p = 0; p < cg->prod_count; p++) free(cg->prod_rhs[p]);
+    }
+    free(cg->prod_rhs);
+    free(cg->prod_lhs);
+    free(cg->prod_len);
+    free(cg->prod_terms);
+    cg->prod_rhs = NULL;
+    cg->prod_lhs = NULL;
+    cg->prod_len = NULL;
+    cg->prod_terms = NULL;
+}
+
+int cg_symbol_id(const CompiledGrammar *cg, const char *name) {
+    int nt = sl_index(cg->nonterms, name);
+    if (nt != -1) return nt;
+    int t = sl_index(cg->terms, name);
+    if (t != -1) return cg->nt_count + t;
+    return -1;
+}
+
+int cg_lexeme_column(const CompiledGrammar *cg, const char *lexeme, size_t len, int bucket) {
+    int id = lexeme_terminal_id(lexeme, len);
+    if (id >= 0) return cg->lexeme_columns[id];
+    if (len > 0 && lexeme[0] == '"') return cg->lexeme_columns[LT_STRING];
+    if (len > 0 && lexeme[0] >= '0' && lexeme[0] <= '9') return cg->lexeme_columns[LT_NUMBER];
+    if (bucket != -1) return cg->lexeme_columns[LT_IDENTIFIER];
+
+    // Last resort: the lexeme may itself be a terminal name
+    char name[256];
+    if (len >= sizeof(name)) return -1;
+    memcpy(name, lexeme, len);
+    name[len] = '\0';
+    return sl_index(cg->terms, name);
+}
+
+void cg_pif_terminals(const CompiledGrammar *cg, PIFEntry *entries, int count, int *out) {
+    for (int i = 0; i < count; i++) {
+        out[i] = cg_lexeme_column(cg, entries[i].lexeme, strlen(entries[i].lexeme), entries[i].bucket);
+    }
+}
+
+void cg_pif_map_terminals(const CompiledGrammar *cg, PIFMap *map) {
+    for (int i = 0; i < map->count; i++) {
+        PIFSlice *slice = &map->entries[i];
+        slice->terminal = (int16_t)cg_lexeme_column(cg, map->data + slice->offset, slice->length, slice->bucket);
+    }
+}
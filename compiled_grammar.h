@@ -0,0 +1,60 @@
+// compiled_grammar.h
+// Integer-indexed view of a loaded grammar and its LL(1) table, shared by the
+// fast parsing engines (lazy trees, incremental reparsing, ...)
+
+#ifndef COMPILED_GRAMMAR_H
+#define COMPILED_GRAMMAR_H
+
+#include "first_follow.h"
+#include "parse_table.h"
+#include "pif_reader.h"
+#include "pif_map.h"
+#include "lexer_pif_export.h"
+
+// Symbol ids follow the parse table row layout:
+//   0 .. nt_count-1                   nonterminals
+//   nt_count .. nt_count+t_count-1    terminals (column = id - nt_count)
+typedef struct {
+    int **table;            // borrowed parse table
+    StrList *nonterms;      // borrowed
+    StrList *terms;         // borrowed
+    ProdList *prods;        // borrowed
+
+    int nt_count;
+    int t_count;
+    int dollar;             // terminal column of "$" (or -1)
+
+    int prod_count;
+    int *prod_lhs;          // nonterminal id of each production
+    int *prod_len;          // RHS length (0 for epsilon productions)
+    int **prod_rhs;         // RHS symbol ids
+    int *prod_terms;        // number of terminals on each RHS
+
+    int lexeme_columns[LT_NUM_TERMINALS];   // classifier terminal id -> column (-1 if absent)
+} CompiledGrammar;
+
+// Build integer tables from the string grammar. Returns 0 on success.
+int cg_init(CompiledGrammar *cg, int **table, StrList *nonterms, StrList *terms, ProdList *prods);
+void cg_free(CompiledGrammar *cg);
+
+// Symbol id of a grammar symbol name, or -1 if unknown
+int cg_symbol_id(const CompiledGrammar *cg, const char *name);
+
+static inline int cg_is_terminal(const CompiledGrammar *cg, int sym) { return sym >= cg->nt_count; }
+
+static inline const char *cg_symbol_name(const CompiledGrammar *cg, int sym) {
+    return sym < cg->nt_count ? cg->nonterms->items[sym] : cg->terms->items[sym - cg->nt_count];
+}
+
+// Terminal column of one lexeme (len bytes, bucket from its PIF entry), classified
+// like pif_entry_terminal without building the terminal name. -1 if unknown.
+int cg_lexeme_column(const CompiledGrammar *cg, const char *lexeme, size_t len, int bucket);
+
+// Map PIF entries to terminal columns (same classification as the tree parser).
+// out must hold count entries; unknown tokens are stored as -1.
+void cg_pif_terminals(const CompiledGrammar *cg, PIFEntry *entries, int count, int *out);
+
+// Same classification for a mapped PIF, stored in each slice's terminal field
+void cg_pif_map_terminals(const CompiledGrammar *cg, PIFMap *map);
+
+#endif // COMPILED_GRAMMAR_H
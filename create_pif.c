@@ -24,7 +24,7 @@ int main(int argc, char *argv[]) {
     int pif_count = 0;
     
     printf("Generating PIF from %d lexemes...\n", lexeme_count);
-    int result = generate_pif_from_tokens(lexemes, lexeme_count, &pif_entries, &pif_count, NULL);
+    int result = generate_pif_from_tokens(lexemes, lexeme_count, &pif_entries, &pif_count, NULL, NULL);
     
     if (result < 0 || pif_count == 0) {
         fprintf(stderr, "Error: Failed to generate PIF\n");
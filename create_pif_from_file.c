@@ -39,7 +39,7 @@ int main(int argc, char *argv[]) {
     PIFEntry *pif_entries = NULL;
     int pif_count = 0;
 
-    int res = generate_pif_from_string(buffer, &pif_entries, &pif_count, NULL);
+    int res = generate_pif_from_string(buffer, &pif_entries, &pif_count, NULL, NULL);
     free(buffer);
 
     if (res < 0 || pif_count == 0) {
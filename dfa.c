@@ -1,78 +1,532 @@
 #include "dfa.h"
+#include "simd_scan.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
-static void dfa_init(DFA* d){
-    d->nstates = 0; d->start = 0;
-    memset(d->finals, 0, sizeof(d->finals));
-    for (int i=0;i<DFA_MAX_STATES;i++)
-        for (int c=0;c<DFA_ALPHA;c++) d->trans[i][c] = -1;
+static uint32_t column_hash(const int* trans, int nrows, int c){
+    uint32_t h = 2166136261u;
+    for (int s=0;s<nrows;s++) h = (h ^ (uint32_t)trans[(size_t)s*DFA_ALPHA + c]) * 16777619u;
+    return h;
 }
 
-static int parse_ints(const char* s, int out[], int max){
-    int n=0; const char* p=s;
-    while (*p && n<max){
+static int same_column(const int* trans, int nrows, int a, int b){
+    for (int s=0;s<nrows;s++)
+        if (trans[(size_t)s*DFA_ALPHA + a] != trans[(size_t)s*DFA_ALPHA + b]) return 0;
+    return 1;
+}
+
+// Largest run class on which row s stays in s; string bodies contain UTF-8
+// identifier runs, which contain identifier runs, which contain digit runs
+int dfa_row_run(const int* trans, int s){
+    static const ScanRunKind kinds[] = { SCAN_RUN_STRING, SCAN_RUN_IDENT_UTF8, SCAN_RUN_IDENT, SCAN_RUN_DIGIT, SCAN_RUN_BLANK };
+    const int* row = trans + (size_t)s*DFA_ALPHA;
+    for (size_t k=0;k<sizeof(kinds)/sizeof(kinds[0]);k++){
+        int c = 0;
+        while (c < DFA_ALPHA && (row[c] == s || !simd_scan_in_run(kinds[k], (unsigned char)c))) ++c;
+        if (c == DFA_ALPHA) return kinds[k];
+    }
+    return SCAN_RUN_NONE;
+}
+
+int dfa_table_build(DFATable* t, int nrows, const int* trans){
+    memset(t, 0, sizeof(*t));
+    if (nrows < 1 || nrows > DFA_MAX_STATES + 1) return -1;
+
+    // Bytes with identical columns share a class; rep[k] is the first byte of class k
+    uint32_t hash[DFA_ALPHA];
+    int rep[DFA_ALPHA];
+    for (int c=0;c<DFA_ALPHA;c++){
+        hash[c] = column_hash(trans, nrows, c);
+        int k = 0;
+        while (k < t->nclasses && !(hash[rep[k]] == hash[c] && same_column(trans, nrows, rep[k], c))) ++k;
+        if (k == t->nclasses) rep[t->nclasses++] = c;
+        t->classes[c] = (uint8_t)k;
+    }
+
+    while ((1 << t->shift) < t->nclasses) ++t->shift;
+    size_t n = (size_t)nrows << t->shift;
+    if (n <= 0x100) t->trans8 = calloc(n, 1);
+    else if (n <= 0x10000) t->trans16 = calloc(n, sizeof(uint16_t));
+    else t->trans32 = calloc(n, sizeof(uint32_t));
+    t->accel = malloc((size_t)nrows);
+    if ((!t->trans8 && !t->trans16 && !t->trans32) || !t->accel){
+        dfa_table_free(t);
+        return -1;
+    }
+    t->nrows = nrows;
+    t->accel[0] = SCAN_RUN_NONE;
+    t->accel_off = n;
+    for (int s=nrows-1;s>0;s--){
+        t->accel[s] = (uint8_t)dfa_row_run(trans, s);
+        if (t->accel[s]) t->accel_off = (size_t)s << t->shift;
+    }
+    for (int s=0;s<nrows;s++)
+        for (int k=0;k<t->nclasses;k++){
+            int to = trans[(size_t)s*DFA_ALPHA + rep[k]];
+            if (to < 0 || to >= nrows) to = 0;
+            size_t i = ((size_t)s << t->shift) | (size_t)k;
+            size_t off = (size_t)to << t->shift;
+            if (t->trans8) t->trans8[i] = (uint8_t)off;
+            else if (t->trans16) t->trans16[i] = (uint16_t)off;
+            else t->trans32[i] = (uint32_t)off;
+        }
+    return 0;
+}
+
+void dfa_table_free(DFATable* t){
+    free(t->trans8);
+    free(t->trans16);
+    free(t->trans32);
+    free(t->accel);
+    memset(t, 0, sizeof(*t));
+}
+
+int dfa_build(DFA* d, int nstates, int start, const uint8_t* finals, const int* trans){
+    memset(d, 0, sizeof(*d));
+    if (nstates < 1 || start < 1 || start > nstates) return -1;
+    d->finals = malloc((size_t)nstates + 1);
+    if (!d->finals || dfa_table_build(&d->table, nstates + 1, trans) != 0){
+        dfa_free(d);
+        return -1;
+    }
+    memcpy(d->finals, finals, (size_t)nstates + 1);
+    d->finals[0] = 0;
+    d->nstates = nstates;
+    d->start = start;
+    return 0;
+}
+
+void dfa_free(DFA* d){
+    free(d->finals);
+    dfa_table_free(&d->table);
+    memset(d, 0, sizeof(*d));
+}
+
+// Dense tables while reading a .fa file; rows grow with the highest state seen
+typedef struct {
+    int nstates;
+    int cap;
+    int* trans;
+    uint8_t* finals;
+} DenseDFA;
+
+static int dense_reserve(DenseDFA* g, int nstates){
+    if (nstates > DFA_MAX_STATES) return -1;
+    if (nstates <= g->nstates) return 0;
+    if (nstates >= g->cap){
+        int cap = g->cap ? g->cap : 64;
+        while (cap <= nstates) cap *= 2;
+        int* trans = realloc(g->trans, sizeof(int) * DFA_ALPHA * (size_t)cap);
+        if (!trans) return -1;
+        g->trans = trans;
+        uint8_t* finals = realloc(g->finals, (size_t)cap);
+        if (!finals) return -1;
+        g->finals = finals;
+        if (g->cap == 0){
+            memset(g->trans, 0, sizeof(int) * DFA_ALPHA);
+            g->finals[0] = 0;
+        }
+        g->cap = cap;
+    }
+    memset(g->trans + (size_t)(g->nstates + 1) * DFA_ALPHA, 0,
+           sizeof(int) * DFA_ALPHA * (size_t)(nstates - g->nstates));
+    memset(g->finals + g->nstates + 1, 0, (size_t)(nstates - g->nstates));
+    g->nstates = nstates;
+    return 0;
+}
+
+// One line of any length; NULL at end of file
+static char* read_line(FILE* f, char** buf, size_t* cap){
+    size_t len = 0;
+    for (;;){
+        if (len + 2 > *cap){
+            size_t grown_cap = *cap ? *cap * 2 : 256;
+            char* grown = realloc(*buf, grown_cap);
+            if (!grown) return NULL;
+            *buf = grown; *cap = grown_cap;
+        }
+        if (!fgets(*buf + len, (int)(*cap - len), f)) return len ? *buf : NULL;
+        len += strlen(*buf + len);
+        if (len > 0 && (*buf)[len-1] == '\n') return *buf;
+    }
+}
+
+// Comma/blank separated state numbers; those in range are marked final
+static int parse_finals(const char* s, DenseDFA* g){
+    const char* p=s;
+    while (*p){
         while (*p && (isspace((unsigned char)*p) || *p==',')) ++p;
         if (!*p) break;
-        int v=0; while (*p && isdigit((unsigned char)*p)) { v = 10*v + (*p-'0'); ++p; }
-        out[n++] = v;
-        while (*p && (isspace((unsigned char)*p) || *p==',')) ++p;
+        long v=0; int digits=0;
+        while (*p && isdigit((unsigned char)*p)) { if (v <= DFA_MAX_STATES) v = 10*v + (*p-'0'); ++p; ++digits; }
+        if (!digits) { ++p; continue; }
+        if (v>0 && v<=DFA_MAX_STATES){
+            if (dense_reserve(g, (int)v) != 0) return -1;
+            g->finals[v] = 1;
+        }
     }
-    return n;
+    return 0;
+}
+
+static int hex_digit(char c){
+    if (c>='0' && c<='9') return c-'0';
+    if (c>='a' && c<='f') return c-'a'+10;
+    if (c>='A' && c<='F') return c-'A'+10;
+    return -1;
 }
 
 int dfa_load(const char* path, DFA* d){
-    dfa_init(d);
+    memset(d, 0, sizeof(*d));
     FILE* f = fopen(path, "r"); if (!f) return -1;
-    char line[256];
-    int seen_start=0, seen_finals=0;
+    DenseDFA g; memset(&g, 0, sizeof(g));
+    char* line = NULL; size_t cap = 0;
+    int seen_start=0, seen_finals=0, start=1, failed=0;
 
-    while (fgets(line, sizeof(line), f)) {
+    while (!failed && read_line(f, &line, &cap)) {
         if (line[0]=='#' || isspace((unsigned char)line[0])) continue;
 
         if (strncmp(line,"start:",6)==0) {
             int v=0; sscanf(line+6,"%d",&v);
-            d->start = v-1; if (d->start<0) d->start=0; seen_start=1;
-            if (d->nstates < v) d->nstates = v;
+            start = v; if (start<1) start=1; seen_start=1;
+            if (dense_reserve(&g, start) != 0) failed=1;
         }
         else if (strncmp(line,"finals:",7)==0) {
-            int tmp[128]; int n = parse_ints(line+7, tmp, 128);
-            for (int i=0;i<n;i++) if (tmp[i]>0 && tmp[i]<=DFA_MAX_STATES){
-                d->finals[tmp[i]-1] = 1;
-                if (d->nstates < tmp[i]) d->nstates = tmp[i];
-            }
+            if (parse_finals(line+7, &g) != 0) failed=1;
             seen_finals=1;
         }
         else if (strncmp(line,"transitions:",12)==0) {
         }
         else {
-            int from=0, to=0; char sym=0;
-            if (sscanf(line,"%d %c %d",&from,&sym,&to)==3) {
-                if (from>0 && from<=DFA_MAX_STATES && to>0 && to<=DFA_MAX_STATES) {
-                    d->trans[from-1][(unsigned char)sym] = to-1;
-                    if (d->nstates < from) d->nstates = from;
-                    if (d->nstates < to)   d->nstates = to;
-                }
+            int from=0, to=0, sym=-1, n=0;
+            if (sscanf(line,"%d %n",&from,&n)==1 && line[n]) {
+                // One byte, or \xHH for blanks and other bytes a line cannot show
+                const char* p = line+n;
+                int hi = p[0]=='\\' && p[1]=='x' ? hex_digit(p[2]) : -1;
+                int lo = hi >= 0 ? hex_digit(p[3]) : -1;
+                if (lo >= 0) { sym = hi*16 + lo; p += 4; }
+                else sym = (unsigned char)*p++;
+                if (sscanf(p,"%d",&to)!=1) sym = -1;
+            }
+            if (sym>=0 && from>0 && from<=DFA_MAX_STATES && to>0 && to<=DFA_MAX_STATES) {
+                if (dense_reserve(&g, from > to ? from : to) != 0) { failed=1; break; }
+                g.trans[(size_t)from*DFA_ALPHA + sym] = to;
             }
         }
     }
     fclose(f);
-    if (!seen_start || !seen_finals) return -2;
-    return 0;
+    free(line);
+    int rc = 0;
+    if (failed) rc = -1;
+    else if (!seen_start || !seen_finals) rc = -2;
+    else if (dfa_build(d, g.nstates, start, g.finals, g.trans) != 0) rc = -1;
+    free(g.trans);
+    free(g.finals);
+    return rc;
+}
+
+int dfa_save(const char* path, const DFA* d){
+    FILE* f = fopen(path, "w"); if (!f) return -1;
+    fprintf(f, "start: %d\nfinals:", d->start);
+    const char* sep = " ";
+    for (int s=1;s<=d->nstates;s++)
+        if (d->finals[s]) { fprintf(f, "%s%d", sep, s); sep = ","; }
+    fprintf(f, "\ntransitions:\n");
+    for (int s=1;s<=d->nstates;s++)
+        for (int c=0;c<DFA_ALPHA;c++){
+            int to = dfa_next(d, s, (unsigned char)c);
+            if (!to) continue;
+            if (c > ' ' && c < 0x7f) fprintf(f, "%d %c %d\n", s, c, to);
+            else fprintf(f, "%d \\x%02X %d\n", s, c, to);
+        }
+    int bad = ferror(f);
+    if (fclose(f) != 0) bad = 1;
+    return bad ? -1 : 0;
 }
 
+// Walk row offsets up to limit, one loop per entry width; ACCEPT runs after each
+// move into a live row and STOP is tested after it
+#define DFA_WALK(TRANS, STOP, ACCEPT) \
+    while (q < limit){ \
+        off = (TRANS)[off | classes[(unsigned char)*q++]]; \
+        if (!off) break; \
+        ACCEPT \
+        if (STOP) break; \
+    }
+
+#define DFA_WALK_WIDTH(T, STOP, ACCEPT) \
+    if ((T)->trans8) { DFA_WALK((T)->trans8, STOP, ACCEPT) } \
+    else if ((T)->trans16) { DFA_WALK((T)->trans16, STOP, ACCEPT) } \
+    else if ((T)->trans32) { DFA_WALK((T)->trans32, STOP, ACCEPT) }
+
+#define DFA_ACCEPT_FINAL if (finals[off >> shift]) last_accept = (int)(q - s);
+
+// Prefixes up to DFA_PLAIN_BYTES are walked plainly; past that, rows from
+// accel_off on skip the rest of their run with simd_scan_run, which leaves the
+// state as it is
+#define DFA_PLAIN_BYTES 8
+
 int dfa_longest(const DFA* d, const char* s){
+    const uint8_t* classes = d->table.classes;
+    const uint8_t* finals = d->finals;
+    int shift = d->table.shift;
+    size_t accel_off = d->table.accel_off;
+    size_t off = (size_t)d->start << shift;
+    const char* q = s;
+    const char* end = s + strlen(s);
+    const char* limit = end - s > DFA_PLAIN_BYTES ? s + DFA_PLAIN_BYTES : end;
+    int last_accept=0;
+    DFA_WALK_WIDTH(&d->table, 0, DFA_ACCEPT_FINAL)
+    limit = end;
+    while (off && q < end){
+        if (off >= accel_off){
+            q = simd_scan_run((ScanRunKind)d->table.accel[off >> shift], q, end);
+            DFA_ACCEPT_FINAL
+        }
+        DFA_WALK_WIDTH(&d->table, off >= accel_off, DFA_ACCEPT_FINAL)
+    }
+    return last_accept;
+}
+
+// Inclusive ranges, in order (see dfa.h)
+static const uint32_t UTF8_NON_LETTERS[][2] = {
+    { 0x0080, 0x00A9 }, { 0x00AB, 0x00B4 }, { 0x00B6, 0x00B9 }, { 0x00BB, 0x00BF },
+    { 0x00D7, 0x00D7 }, { 0x00F7, 0x00F7 },
+    { 0x2000, 0x206F }, { 0x2190, 0x27FF }, { 0x3000, 0x3003 },
+    { 0xFEFF, 0xFEFF }, { 0xFFF0, 0xFFFF }
+};
+
+int dfa_utf8_letter(uint32_t cp){
+    if (cp < 0x80) return 0;
+    for (size_t i=0;i<sizeof(UTF8_NON_LETTERS)/sizeof(UTF8_NON_LETTERS[0]);i++){
+        if (cp < UTF8_NON_LETTERS[i][0]) return 1;
+        if (cp <= UTF8_NON_LETTERS[i][1]) return 0;
+    }
+    return 1;
+}
+
+int dfa_longest_utf8(const DFA* d, const char* s){
+    const char* q = s;
+    const char* end = s + strlen(s);
     int state = d->start;
-    int i=0, last_accept=-1;
-    while (s[i]) {
-        int c = (unsigned char)s[i];
-        if (c>=DFA_ALPHA) break;
-        int nx = d->trans[state][c];
-        if (nx == -1) break;
-        state = nx;
-        ++i;
-        if (d->finals[state]) last_accept = i;
-    }
-    return (last_accept<0) ? 0 :last_accept;
+    int last_accept = 0;
+    while (state && q < end){
+        unsigned char c = (unsigned char)*q;
+        size_t n = 1;
+        if (c >= 0x80){
+            n = simd_utf8_sequence(q, end);
+            if (!n) break;
+            const unsigned char* u = (const unsigned char*)q;
+            uint32_t cp = n == 2 ? (uint32_t)(u[0] & 0x1F) : n == 3 ? (uint32_t)(u[0] & 0x0F) : (uint32_t)(u[0] & 0x07);
+            for (size_t i=1;i<n;i++) cp = (cp << 6) | (u[i] & 0x3F);
+            if (!dfa_utf8_letter(cp)) break;
+            c = 'a';
+        }
+        state = dfa_next(d, state, c);
+        q += n;
+        if (state && d->finals[state]) last_accept = (int)(q - s);
+    }
+    return last_accept;
+}
+
+static uint32_t tuple_hash(const int* t, int n){
+    uint32_t h = 2166136261u;
+    for (int i=0;i<n;i++) h = (h ^ (uint32_t)t[i]) * 16777619u;
+    return h;
+}
+
+// Tuples of component states, numbered in discovery order
+typedef struct {
+    int n;                      // components
+    int count;
+    int cap;
+    int* tuples;                // count x n
+    int* slots;                 // open addressing: tuple id or -1
+    int nslots;
+} TupleSet;
+
+static int tuple_rehash(TupleSet* ts, int nslots){
+    int* slots = malloc(sizeof(int) * (size_t)nslots);
+    if (!slots) return -1;
+    for (int i=0;i<nslots;i++) slots[i] = -1;
+    for (int k=0;k<ts->count;k++){
+        uint32_t h = tuple_hash(ts->tuples + (size_t)k*ts->n, ts->n) & (uint32_t)(nslots-1);
+        while (slots[h] >= 0) h = (h+1) & (uint32_t)(nslots-1);
+        slots[h] = k;
+    }
+    free(ts->slots);
+    ts->slots = slots;
+    ts->nslots = nslots;
+    return 0;
+}
+
+// Id of tuple t, added if new; -1 on allocation failure or past DFA_MAX_STATES
+static int tuple_id(TupleSet* ts, const int* t){
+    size_t bytes = sizeof(int) * (size_t)ts->n;
+    uint32_t mask = (uint32_t)(ts->nslots-1);
+    uint32_t h = tuple_hash(t, ts->n) & mask;
+    while (ts->slots[h] >= 0){
+        if (memcmp(ts->tuples + (size_t)ts->slots[h]*ts->n, t, bytes) == 0) return ts->slots[h];
+        h = (h+1) & mask;
+    }
+    if (ts->count > DFA_MAX_STATES) return -1;
+    if (ts->count == ts->cap){
+        int cap = ts->cap ? ts->cap*2 : 64;
+        int* tuples = realloc(ts->tuples, bytes * (size_t)cap);
+        if (!tuples) return -1;
+        ts->tuples = tuples;
+        ts->cap = cap;
+    }
+    int id = ts->count++;
+    memcpy(ts->tuples + (size_t)id*ts->n, t, bytes);
+    ts->slots[h] = id;
+    if (ts->count*2 > ts->nslots && tuple_rehash(ts, ts->nslots*2) != 0) return -1;
+    return id;
+}
+
+int dfa_product_build(DFAProduct* p, const DFA* const* parts, int nparts){
+    memset(p, 0, sizeof(*p));
+    if (nparts < 1 || nparts > DFA_PRODUCT_MAX) return -1;
+
+    // Bytes that share a class in every component move the product alike;
+    // rep[k] is the first byte of combined class k
+    int rep[DFA_ALPHA], cls[DFA_ALPHA], ncls = 0;
+    for (int c=0;c<DFA_ALPHA;c++){
+        int k = 0;
+        for (;k<ncls;k++){
+            int i = 0;
+            while (i < nparts && parts[i]->table.classes[rep[k]] == parts[i]->table.classes[c]) ++i;
+            if (i == nparts) break;
+        }
+        if (k == ncls) rep[ncls++] = c;
+        cls[c] = k;
+    }
+
+    TupleSet ts; memset(&ts, 0, sizeof(ts));
+    ts.n = nparts;
+    int* step = NULL;           // count x ncls target ids
+    size_t step_cap = 0;
+    int* dense = NULL;
+    int* order = NULL;
+    uint32_t* accept = NULL;
+    int t[DFA_PRODUCT_MAX];
+    int rc = -1;
+
+    // Id 0 is the tuple of dead states, id 1 the start
+    if (tuple_rehash(&ts, 128) != 0) goto done;
+    for (int i=0;i<nparts;i++) t[i] = 0;
+    if (tuple_id(&ts, t) != 0) goto done;
+    for (int i=0;i<nparts;i++) t[i] = parts[i]->start;
+    if (tuple_id(&ts, t) != 1) goto done;
+
+    // The tuple array doubles as the worklist
+    for (int s=1;s<ts.count;s++){
+        if ((size_t)(s+1)*ncls > step_cap){
+            size_t cap = step_cap ? step_cap*2 : (size_t)64*ncls;
+            int* grown = realloc(step, sizeof(int) * cap);
+            if (!grown) goto done;
+            step = grown;
+            step_cap = cap;
+        }
+        for (int k=0;k<ncls;k++){
+            for (int i=0;i<nparts;i++) t[i] = dfa_next(parts[i], ts.tuples[(size_t)s*nparts + i], (unsigned char)rep[k]);
+            int to = tuple_id(&ts, t);
+            if (to < 0) goto done;
+            step[(size_t)s*ncls + k] = to;
+        }
+    }
+
+    int rows = ts.count;
+    dense = calloc((size_t)rows * DFA_ALPHA, sizeof(int));
+    order = malloc(sizeof(int) * (size_t)rows);
+    accept = calloc((size_t)rows, sizeof(uint32_t));
+    if (!dense || !order || !accept) goto done;
+    for (int s=1;s<rows;s++)
+        for (int c=0;c<DFA_ALPHA;c++) dense[(size_t)s*DFA_ALPHA + c] = step[(size_t)s*ncls + cls[c]];
+
+    // Rows with a run class last, so the walk finds them by offset
+    int next = 1;
+    order[0] = 0;
+    for (int pass=0;pass<2;pass++)
+        for (int s=1;s<rows;s++)
+            if ((dfa_row_run(dense, s) != SCAN_RUN_NONE) == pass) order[s] = next++;
+    for (int s=1;s<rows;s++){
+        for (int i=0;i<nparts;i++)
+            if (parts[i]->finals[ts.tuples[(size_t)s*nparts + i]]) accept[order[s]] |= 1u << i;
+        for (int k=0;k<ncls;k++) step[(size_t)s*ncls + k] = order[step[(size_t)s*ncls + k]];
+    }
+    memset(dense, 0, sizeof(int) * (size_t)rows * DFA_ALPHA);
+    for (int s=1;s<rows;s++)
+        for (int c=0;c<DFA_ALPHA;c++) dense[(size_t)order[s]*DFA_ALPHA + c] = step[(size_t)s*ncls + cls[c]];
+    if (dfa_table_build(&p->table, rows, dense) != 0) goto done;
+
+    p->nparts = nparts;
+    p->nstates = rows - 1;
+    p->start = order[1];
+    p->accept = accept;
+    accept = NULL;
+    rc = 0;
+done:
+    free(ts.tuples);
+    free(ts.slots);
+    free(step);
+    free(dense);
+    free(order);
+    free(accept);
+    return rc;
+}
+
+void dfa_product_free(DFAProduct* p){
+    free(p->accept);
+    dfa_table_free(&p->table);
+    memset(p, 0, sizeof(*p));
+}
+
+static inline void mark_accepts(int* longest, uint32_t m, int len){
+    for (int i=0; m; i++, m >>= 1) if (m & 1) longest[i] = len;
+}
+
+// Masks repeat along a token, so a walk only notes where the current mask was
+// last seen and hands the lengths out when the mask changes
+#define DFA_ACCEPT_MASK \
+    if (accept[off >> shift]){ \
+        if (accept[off >> shift] != run_mask){ \
+            mark_accepts(longest, run_mask, run_len); \
+            run_mask = accept[off >> shift]; \
+        } \
+        run_len = (int)(q - s); \
+    }
+
+// The walk of dfa_longest, with ACCEPT run in each live row
+#define DFA_PRODUCT_WALK(ACCEPT) \
+    DFA_WALK_WIDTH(&p->table, 0, ACCEPT) \
+    limit = end; \
+    while (off && q < end){ \
+        if (off >= accel_off){ \
+            q = simd_scan_run((ScanRunKind)p->table.accel[off >> shift], q, end); \
+            ACCEPT \
+        } \
+        DFA_WALK_WIDTH(&p->table, off >= accel_off, ACCEPT) \
+    }
+
+uint32_t dfa_product_longest(const DFAProduct* p, const char* s, size_t n, int* longest){
+    const uint8_t* classes = p->table.classes;
+    const uint32_t* accept = p->accept;
+    int shift = p->table.shift;
+    size_t accel_off = p->table.accel_off;
+    size_t off = (size_t)p->start << shift;
+    const char* q = s;
+    const char* end = s + n;
+    const char* limit = n > DFA_PLAIN_BYTES ? s + DFA_PLAIN_BYTES : end;
+    if (!longest){
+        DFA_PRODUCT_WALK()
+    } else {
+        uint32_t run_mask = 0;
+        int run_len = 0;
+        for (int i=0;i<p->nparts;i++) longest[i] = 0;
+        DFA_PRODUCT_WALK(DFA_ACCEPT_MASK)
+        mark_accepts(longest, run_mask, run_len);
+    }
+    return off && q == end ? accept[off >> shift] : 0;
 }
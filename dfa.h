@@ -1,17 +1,105 @@
 #ifndef DFA_H
 #define DFA_H
 
-#define DFA_MAX_STATES 64
-#define DFA_ALPHA 128
+#include <stddef.h>
+#include <stdint.h>
 
+#define DFA_ALPHA 256
+#define DFA_MAX_STATES (1 << 20)
+
+// Transition table compressed by byte equivalence classes: bytes that move
+// every state alike share a class, and each row holds one entry per class,
+// padded to a power of two. An entry is the offset of the target row
+// (state << shift), so the next offset is trans[offset | classes[byte]] with no
+// multiply in the loop. Row 0 is the dead state, so a zero entry means "no
+// move". Entries are the narrowest of 8, 16 or 32 bits that holds every offset.
+// Rows that loop to themselves on a whole run class (simd_scan.h) record it in
+// accel, so walkers can skip the run with one vector scan; numbering those rows
+// last lets a walk find them by comparing the offset with accel_off.
+typedef struct {
+    int nrows;                  // states + the dead row
+    int nclasses;
+    int shift;                  // row width 1 << shift >= nclasses
+    uint8_t classes[DFA_ALPHA]; // byte -> class
+    uint8_t *trans8;            // nrows << shift entries; exactly one is set
+    uint16_t *trans16;
+    uint32_t *trans32;
+    uint8_t *accel;             // nrows ScanRunKind values, SCAN_RUN_NONE = step bytewise
+    size_t accel_off;           // offset of the first row with a run, nrows << shift if none
+} DFATable;
+
+// States are numbered 1..nstates, as in the .fa files
 typedef struct {
     int nstates;
     int start;
-    unsigned char finals[DFA_MAX_STATES];
-    int trans[DFA_MAX_STATES][DFA_ALPHA];
+    uint8_t *finals;            // nstates + 1 flags, finals[0] = 0
+    DFATable table;
 } DFA;
 
+// Build the table from a dense one: trans[s * DFA_ALPHA + c] is the target
+// row of row s on byte c (0 = none), for rows 0..nrows-1
+int  dfa_table_build(DFATable* t, int nrows, const int* trans);
+void dfa_table_free(DFATable* t);
+
+// Run class (ScanRunKind) on which row s of such a dense table stays in s
+int  dfa_row_run(const int* trans, int s);
+
+// Offset of the row reached from row offset off on byte c, 0 if none
+static inline size_t dfa_table_step(const DFATable* t, size_t off, unsigned char c){
+    size_t i = off | t->classes[c];
+    return t->trans8 ? t->trans8[i] : t->trans16 ? t->trans16[i] : t->trans32[i];
+}
+
+// Build a DFA from dense transitions in the same numbering (trans has
+// (nstates + 1) x DFA_ALPHA entries, 0 = no move; finals has nstates + 1)
+int  dfa_build(DFA* d, int nstates, int start, const uint8_t* finals, const int* trans);
 int  dfa_load(const char* path, DFA* d);
+void dfa_free(DFA* d);
+
+// Write d as a .fa file that dfa_load reads back: printable bytes as themselves,
+// blanks and other bytes as \xHH
+int  dfa_save(const char* path, const DFA* d);
+
+// Next state from s on byte c, 0 if none
+static inline int dfa_next(const DFA* d, int s, unsigned char c){
+    return (int)(dfa_table_step(&d->table, (size_t)s << d->table.shift, c) >> d->table.shift);
+}
+
 int  dfa_longest(const DFA* d, const char* s);
 
+// UTF-8 identifiers take every code point from U+0080 up as a letter except
+// C1 controls, Latin-1 punctuation and symbols (U+0080-U+00BF but ª µ º, and
+// × ÷), General Punctuation (U+2000-U+206F), arrows, operators, box drawing and
+// other symbols (U+2190-U+27FF), U+3000-U+3003, the BOM and Specials. These are
+// blocks rather than Unicode letter categories, so the tables stay small; all of
+// them start with a simd_utf8_mixed_lead byte.
+int  dfa_utf8_letter(uint32_t cp);
+
+// dfa_longest in UTF-8 mode: a whole letter (dfa_utf8_letter) moves d like 'a';
+// an invalid sequence or another non-ASCII character ends the match
+int  dfa_longest_utf8(const DFA* d, const char* s);
+
+// Several DFAs run in lockstep: a state is the tuple of component states, and
+// accept[s] has bit i set when component i accepts in s. The tuple of dead
+// states is row 0; rows with a run class come last, as in scanner_dfa.c
+#define DFA_PRODUCT_MAX 32
+
+typedef struct {
+    int nparts;
+    int nstates;
+    int start;
+    uint32_t* accept;           // nstates + 1 masks, accept[0] = 0
+    DFATable table;
+} DFAProduct;
+
+// Returns 0 on success, -1 on allocation failure, more than DFA_MAX_STATES
+// reachable tuples, or nparts outside 1..DFA_PRODUCT_MAX
+int  dfa_product_build(DFAProduct* p, const DFA* const* parts, int nparts);
+void dfa_product_free(DFAProduct* p);
+
+// One pass over s[0..n): longest[i] receives the longest prefix component i
+// accepts (0 if none), as dfa_longest would. Returns the mask of components that
+// accept all n bytes; longest may be NULL when that is all the caller needs.
+uint32_t dfa_product_longest(const DFAProduct* p, const char* s, size_t n, int* longest);
+
 #endif
@@ -0,0 +1,228 @@
+// fa_codegen.c
+// Compile a .fa automaton into a direct-coded C scanner: one label per state,
+// range checks or a switch on the input byte, and goto transitions
+
+#include "dfa.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// States with more byte ranges than this dispatch through a switch
+#define MAX_RANGE_CHECKS 6
+
+// Cases per line in a switch
+#define CASES_PER_LINE 8
+
+typedef struct {
+    int lo, hi;             // bytes lo..hi all move to target
+    int target;
+} ByteRange;
+
+static int byte_ranges(const DFA *d, int s, ByteRange *out) {
+    int n = 0;
+    for (int c = 0; c < DFA_ALPHA; c++) {
+        int to = dfa_next(d, s, (unsigned char)c);
+        if (!to) continue;
+        if (n > 0 && out[n - 1].hi == c - 1 && out[n - 1].target == to) {
+            out[n - 1].hi = c;
+        } else {
+            out[n].lo = out[n].hi = c;
+            out[n].target = to;
+            n++;
+        }
+    }
+    return n;
+}
+
+static void put_byte(FILE *f, int c) {
+    if (c == '\'' || c == '\\') fprintf(f, "'\\%c'", c);
+    else if (c > ' ' && c < 0x7f) fprintf(f, "'%c'", c);
+    else fprintf(f, "0x%02X", c);
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash && (!slash || backslash > slash)) slash = backslash;
+    return slash ? slash + 1 : path;
+}
+
+// States reachable from the start, breadth first; order[0] is the start
+static int reachable_states(const DFA *d, int *order, char *seen) {
+    int count = 0;
+    order[count++] = d->start;
+    seen[d->start] = 1;
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < DFA_ALPHA; c++) {
+            int to = dfa_next(d, order[i], (unsigned char)c);
+            if (to && !seen[to]) {
+                seen[to] = 1;
+                order[count++] = to;
+            }
+        }
+    }
+    return count;
+}
+
+static void write_state(FILE *f, const DFA *d, int s, const char *referenced, ByteRange *ranges) {
+    int n = byte_ranges(d, s, ranges);
+    if (referenced[s]) fprintf(f, "s%d:\n", s);
+    if (d->finals[s]) fprintf(f, "    last = p;\n");
+    if (n == 0) {
+        fprintf(f, "    return (int)(last - base);\n");
+        return;
+    }
+    fprintf(f, "    if (p == end) return (int)(last - base);\n");
+    fprintf(f, "    c = *p++;\n");
+    if (n <= MAX_RANGE_CHECKS) {
+        for (int i = 0; i < n; i++) {
+            fprintf(f, "    if (");
+            if (ranges[i].lo == ranges[i].hi) {
+                fprintf(f, "c == ");
+                put_byte(f, ranges[i].lo);
+            } else {
+                fprintf(f, "c >= ");
+                put_byte(f, ranges[i].lo);
+                fprintf(f, " && c <= ");
+                put_byte(f, ranges[i].hi);
+            }
+            fprintf(f, ") goto s%d;\n", ranges[i].target);
+        }
+        fprintf(f, "    return (int)(last - base);\n");
+        return;
+    }
+
+    // One group of cases per target, in order of each target's first byte
+    fprintf(f, "    switch (c) {\n");
+    for (int i = 0; i < n; i++) {
+        int target = ranges[i].target;
+        int first = 1;
+        for (int j = 0; j < i && first; j++) first = ranges[j].target != target;
+        if (!first) continue;
+        int on_line = 0;
+        for (int j = i; j < n; j++) {
+            if (ranges[j].target != target) continue;
+            for (int c = ranges[j].lo; c <= ranges[j].hi; c++) {
+                fprintf(f, on_line == 0 ? "    case " : " case ");
+                put_byte(f, c);
+                fprintf(f, ":");
+                if (++on_line == CASES_PER_LINE) {
+                    fprintf(f, "\n");
+                    on_line = 0;
+                }
+            }
+        }
+        if (on_line) fprintf(f, "\n");
+        fprintf(f, "        goto s%d;\n", target);
+    }
+    fprintf(f, "    default:\n        return (int)(last - base);\n    }\n");
+}
+
+static int write_header(const char *path, const char *fa_file, const char *func) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    const char *name = base_name(path);
+    char guard[256];
+    size_t len = 0;
+    for (const char *p = name; *p && len + 1 < sizeof(guard); p++) {
+        guard[len++] = isalnum((unsigned char)*p) ? (char)toupper((unsigned char)*p) : '_';
+    }
+    guard[len] = '\0';
+    fprintf(f, "// %s\n// Generated by fa_codegen from %s; do not edit\n\n", name, base_name(fa_file));
+    fprintf(f, "#ifndef %s\n#define %s\n\n#include <stddef.h>\n\n", guard, guard);
+    fprintf(f, "// Longest prefix of text[0..n) that %s accepts, 0 if none\n", base_name(fa_file));
+    fprintf(f, "int %s(const char *text, size_t n);\n\n#endif // %s\n", func, guard);
+    int bad = ferror(f);
+    if (fclose(f) != 0) bad = 1;
+    return bad ? -1 : 0;
+}
+
+static int write_source(const char *path, const char *header, const char *fa_file, const char *func,
+                        const DFA *d) {
+    int *order = malloc(sizeof(int) * ((size_t)d->nstates + 1));
+    char *seen = calloc((size_t)d->nstates + 1, 1);
+    char *referenced = calloc((size_t)d->nstates + 1, 1);
+    ByteRange *ranges = malloc(sizeof(ByteRange) * DFA_ALPHA);
+    FILE *f = order && seen && referenced && ranges ? fopen(path, "w") : NULL;
+    if (!f) {
+        free(order); free(seen); free(referenced); free(ranges);
+        return -1;
+    }
+    int count = reachable_states(d, order, seen);
+    int moves = 0;
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < DFA_ALPHA; c++) {
+            int to = dfa_next(d, order[i], (unsigned char)c);
+            if (to) referenced[to] = 1;
+            moves |= to != 0;
+        }
+    }
+
+    fprintf(f, "// %s\n// Generated by fa_codegen from %s; do not edit\n\n", base_name(path), base_name(fa_file));
+    fprintf(f, "#include \"%s\"\n\n", base_name(header));
+    fprintf(f, "int %s(const char *text, size_t n) {\n", func);
+    fprintf(f, "    const unsigned char *base = (const unsigned char *)text;\n");
+    fprintf(f, "    const unsigned char *p = base;\n");
+    fprintf(f, "    const unsigned char *end = base + n;\n");
+    fprintf(f, "    const unsigned char *last = base;\n");
+    if (moves) fprintf(f, "    unsigned c;\n");
+    else fprintf(f, "    (void)end;\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(f, "\n");
+        write_state(f, d, order[i], referenced, ranges);
+    }
+    fprintf(f, "}\n");
+
+    free(order); free(seen); free(referenced); free(ranges);
+    int bad = ferror(f);
+    if (fclose(f) != 0) bad = 1;
+    return bad ? -1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <input.fa> <function_name> <output.c>\n", argv[0]);
+        fprintf(stderr, "  also writes the matching .h next to output.c\n");
+        return 1;
+    }
+    const char *fa_file = argv[1];
+    const char *func = argv[2];
+    const char *output_file = argv[3];
+    if (!isalpha((unsigned char)func[0]) && func[0] != '_') {
+        fprintf(stderr, "Error: '%s' is not a C identifier\n", func);
+        return 1;
+    }
+    for (const char *p = func; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '_') {
+            fprintf(stderr, "Error: '%s' is not a C identifier\n", func);
+            return 1;
+        }
+    }
+    size_t len = strlen(output_file);
+    if (len < 3 || strcmp(output_file + len - 2, ".c") != 0) {
+        fprintf(stderr, "Error: output file must end in .c\n");
+        return 1;
+    }
+    char *header = malloc(len + 1);
+    if (!header) return 1;
+    memcpy(header, output_file, len + 1);
+    header[len - 1] = 'h';
+
+    DFA d;
+    if (dfa_load(fa_file, &d) != 0) {
+        fprintf(stderr, "Error: cannot load %s\n", fa_file);
+        free(header);
+        return 1;
+    }
+    int rc = 0;
+    if (write_header(header, fa_file, func) != 0 || write_source(output_file, header, fa_file, func, &d) != 0) {
+        fprintf(stderr, "Error: failed to write %s / %s\n", output_file, header);
+        rc = 1;
+    } else {
+        printf("Wrote %s and %s (%d states)\n", output_file, header, d.nstates);
+    }
+    dfa_free(&d);
+    free(header);
+    return rc;
+}
@@ -0,0 +1,331 @@
+// flowcalc_pipeline.c
+// Lex and parse a FlowCalc source in one process: the flex lexer runs on its own
+// thread and hands token records to the LL(1) parser through an SPSC ring.
+// The source is memory-mapped and scanned in place by flex.
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "flowcalc.tab.h"
+#include "st.h"
+#include "dfa.h"
+#include "first_follow.h"
+#include "parse_table.h"
+#include "pif_reader.h"
+#include "lexer_pif_export.h"
+#include "source_map.h"
+#include "compiled_grammar.h"
+#include "lazy_tree.h"
+#include "parse_tree.h"
+#include "token_ring.h"
+
+#define PIPELINE_RING_SIZE 4096
+
+// The bison parser (flowcalc.tab.c) is not linked, so the lexer's yylval lives here
+YYSTYPE yylval;
+
+extern int yylex(void);
+extern void init_lexer(SymbolTable *st, DFA *id_dfa, DFA *num_dfa);
+
+// Lexer side: every PIF entry becomes a classified record pushed to the ring
+typedef struct {
+    const CompiledGrammar *cg;
+    TokenRing *ring;
+} LexerOutput;
+
+// Parser side of the ring: received entries are kept for tree materialization
+typedef struct {
+    const CompiledGrammar *cg;
+    TokenRing *ring;
+    PIFEntry *entries;
+    int count;
+    int capacity;
+    int done;
+} RingTokens;
+
+static double now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void append_entry(PIFEntry **entries, int *count, int *capacity, const PIFEntry *e) {
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 1024;
+        *entries = realloc(*entries, sizeof(PIFEntry) * (*capacity));
+    }
+    (*entries)[(*count)++] = *e;
+}
+
+static void emit_record(LexerOutput *lo, const char *lexeme, int bucket, int pos, int terminal) {
+    TokenRecord rec;
+    size_t len = strlen(lexeme);
+    if (len > sizeof(rec.entry.lexeme) - 1) len = sizeof(rec.entry.lexeme) - 1;
+    memcpy(rec.entry.lexeme, lexeme, len);
+    rec.entry.lexeme[len] = '\0';
+    rec.entry.bucket = bucket;
+    rec.entry.pos = pos;
+    rec.terminal = terminal;
+    token_ring_push(lo->ring, &rec);
+}
+
+static void lexer_sink(const char *lexeme, int bucket, int pos, void *ctx) {
+    LexerOutput *lo = ctx;
+    emit_record(lo, lexeme, bucket, pos, cg_lexeme_column(lo->cg, lexeme, strlen(lexeme), bucket));
+}
+
+// Drive yylex to the end of input; the PIF entries come out of pif_add
+static void lex_all(void) {
+    int tok;
+    while ((tok = yylex()) > 0) {
+        if (tok == IDENTIFIER || tok == NUMBER || tok == STRING) {
+            free(yylval.string_val);
+        }
+    }
+}
+
+static void *run_lexer(void *arg) {
+    LexerOutput *lo = arg;
+    set_pif_sink(lexer_sink, lo);
+    lex_all();
+    if (lexer_error_count() > 0) {
+        // Stop the parser at the offending position instead of accepting a prefix
+        emit_record(lo, "<lexical error>", -1, -1, -1);
+    }
+    emit_record(lo, "$", -1, -1, TOKEN_RING_EOF);
+    set_pif_sink(NULL, NULL);
+    return NULL;
+}
+
+static int next_ring_token(void *ctx) {
+    RingTokens *rt = ctx;
+    if (rt->done) return rt->cg->dollar;
+    TokenRecord rec;
+    token_ring_pop(rt->ring, &rec);
+    if (rec.terminal == TOKEN_RING_EOF) {
+        rt->done = 1;
+        return rt->cg->dollar;
+    }
+    append_entry(&rt->entries, &rt->count, &rt->capacity, &rec.entry);
+    return rec.terminal;
+}
+
+int main(int argc, char *argv[]) {
+    const char *positional[3] = { NULL, NULL, NULL };
+    int npos = 0;
+    int sequential = 0;
+    int values = 0;
+    const char *symbols_file = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sequential") == 0) {
+            sequential = 1;
+        } else if (strcmp(argv[i], "--values") == 0) {
+            values = 1;
+        } else if (strcmp(argv[i], "--symbols") == 0 && i + 1 < argc) {
+            symbols_file = argv[++i];
+        } else if (npos < 3) {
+            positional[npos++] = argv[i];
+        }
+    }
+    if (npos < 2) {
+        fprintf(stderr, "Usage: %s [--sequential] [--values] [--symbols file] <grammar_file> <source.flowcalc> [output_file]\n", argv[0]);
+        fprintf(stderr, "  Lexes on one thread and parses on another, with no intermediate PIF file\n");
+        fprintf(stderr, "  --sequential: lex the whole source into the lexer's PIF, then parse it (for comparison)\n");
+        fprintf(stderr, "  --values: add a Value column with the parsed value of each number\n");
+        fprintf(stderr, "  --symbols: start from this symbol table snapshot and save it back with the new lexemes\n");
+        return 1;
+    }
+    const char *grammar_file = positional[0];
+    const char *source_file = positional[1];
+    const char *output_file = positional[2];
+
+    // Load grammar and build the parse table
+    StrList nonterms, terms;
+    ProdList prods;
+    sl_init(&nonterms);
+    sl_init(&terms);
+    pl_init(&prods);
+
+    printf("Loading grammar from %s...\n", grammar_file);
+    load_grammar(grammar_file, &nonterms, &terms, &prods);
+    if (nonterms.count == 0 || terms.count == 0 || prods.count == 0) {
+        fprintf(stderr, "Error: Failed to load grammar\n");
+        return 1;
+    }
+    if (sl_index(&terms, "$") == -1) {
+        sl_add(&terms, "$");
+    }
+
+    FirstTable first;
+    first.sets = malloc(sizeof(StrList) * nonterms.count);
+    for (int i = 0; i < nonterms.count; i++) {
+        sl_init(&first.sets[i]);
+    }
+    compute_first(&nonterms, &terms, &prods, &first);
+
+    FollowTable follow;
+    follow.sets = malloc(sizeof(StrList) * nonterms.count);
+    for (int i = 0; i < nonterms.count; i++) {
+        sl_init(&follow.sets[i]);
+    }
+    compute_follow(&nonterms, &terms, &prods, &first, &follow);
+
+    int **table = build_parse_table(&nonterms, &terms, &prods, &first, &follow);
+    if (!table) {
+        fprintf(stderr, "Error: Failed to build parse table\n");
+        return 1;
+    }
+
+    CompiledGrammar cg;
+    if (cg_init(&cg, table, &nonterms, &terms, &prods) != 0) {
+        fprintf(stderr, "Error: Failed to compile grammar\n");
+        return 1;
+    }
+
+    // Lexer setup, as in the bison driver, but scanning the mapped source in place
+    SourceMap source;
+    if (source_map_open(&source, source_file) != 0) {
+        perror("open source");
+        return 1;
+    }
+    DFA ID, NUM;
+    if (dfa_load("identifier.fa", &ID) != 0 || dfa_load("number.fa", &NUM) != 0) {
+        fprintf(stderr, "cannot load identifier.fa / number.fa\n");
+        dfa_free(&ID);
+        source_map_close(&source);
+        return 1;
+    }
+    SymbolTable ST;
+    int snapshot_count = symbols_file ? st_load(&ST, symbols_file) : -1;
+    if (snapshot_count >= 0) {
+        printf("Loaded %d symbols from %s\n", snapshot_count, symbols_file);
+    } else {
+        st_init(&ST, 199);
+    }
+    // Numeric literal values, by the index of ST
+    NumTable NUMS;
+    num_table_init(&NUMS);
+    init_lexer(&ST, &ID, &NUM);
+    if (values) lexer_set_num_table(&NUMS);
+    if (lexer_scan_buffer(source.data, source.size) != 0) {
+        fprintf(stderr, "Error: flex rejected the source buffer\n");
+        source_map_close(&source);
+        return 1;
+    }
+
+    LazyTree lt;
+    ParseResult result;
+    PIFEntry *entries = NULL;
+    int count = 0;
+    double start = now_ms();
+
+    if (sequential) {
+        // The lexer's own PIF buffer is handed to the parser as is
+        printf("Lexing %s, then parsing...\n", source_file);
+        lex_all();
+        entries = lexer_take_pif(&count);
+        result = lazy_tree_parse(&lt, &cg, entries, count, "stmt");
+        if (lexer_error_count() > 0) result = PARSE_ERROR;
+    } else {
+        printf("Lexing and parsing %s on two threads...\n", source_file);
+        TokenRing ring;
+        if (token_ring_init(&ring, PIPELINE_RING_SIZE) != 0) {
+            fprintf(stderr, "Error: Failed to allocate token ring\n");
+            return 1;
+        }
+        LexerOutput lo = { &cg, &ring };
+        pthread_t lexer;
+        if (pthread_create(&lexer, NULL, run_lexer, &lo) != 0) {
+            fprintf(stderr, "Error: Failed to start lexer thread\n");
+            return 1;
+        }
+        RingTokens rt = { &cg, &ring, NULL, 0, 0, 0 };
+        result = lazy_tree_parse_stream(&lt, &cg, next_ring_token, &rt, "stmt");
+        // A failed parse stops early; drain so the lexer can finish
+        while (!rt.done) next_ring_token(&rt);
+        pthread_join(lexer, NULL);
+        token_ring_free(&ring);
+        entries = rt.entries;
+        count = rt.count;
+        lt.pif_entries = entries;
+        lt.pif_count = count;
+    }
+    double elapsed = now_ms() - start;
+    lexer_end_scan();
+    source_map_close(&source);
+    printf("%d tokens, %d derivation steps in %.2f ms\n", count, lt.step_count, elapsed);
+
+    FILE *out = stdout;
+    if (output_file) {
+        out = fopen(output_file, "w");
+        if (!out) {
+            fprintf(stderr, "Error: Failed to open output file %s\n", output_file);
+            out = stdout;
+        }
+    }
+
+    if (result == PARSE_ACCEPT) {
+        fprintf(out, "Sequence accepted\n\n");
+        fprintf(out, "Parse Tree (Father/Sibling Relations):\n");
+        fprintf(out, "========================================\n\n");
+        ParseTreeNode *tree = lazy_tree_materialize(&lt, 0);
+        if (tree) {
+            if (values) {
+                tree_print_table_values(tree, &NUMS, out);
+            } else {
+                tree_print_table(tree, out);
+            }
+            tree_node_free(tree);
+        } else {
+            fprintf(out, "Error: Parse tree is NULL\n");
+        }
+    } else {
+        const char *error = lt.error_location ? lt.error_location : "lexical error";
+        fprintf(out, "Sequence not accepted\n");
+        fprintf(out, "Syntax error at: %s\n", error);
+        fprintf(stderr, "Parse failed. Error: %s\n", error);
+    }
+
+    if (out != stdout) {
+        fclose(out);
+        printf("Parse tree table written to %s\n", output_file);
+    }
+
+    if (symbols_file && ST.size != snapshot_count) {
+        if (st_save(&ST, symbols_file) == 0) {
+            printf("Saved %d symbols to %s\n", ST.size, symbols_file);
+        } else {
+            fprintf(stderr, "Error: Failed to save symbols to %s\n", symbols_file);
+        }
+    }
+
+    // Cleanup
+    lazy_tree_free(&lt);
+    free(entries);
+    num_table_free(&NUMS);
+    st_free(&ST);
+    dfa_free(&ID);
+    dfa_free(&NUM);
+    cg_free(&cg);
+    for (int i = 0; i < nonterms.count + terms.count; i++) {
+        free(table[i]);
+    }
+    free(table);
+    for (int i = 0; i < nonterms.count; i++) {
+        sl_free(&first.sets[i]);
+        sl_free(&follow.sets[i]);
+    }
+    free(first.sets);
+    free(follow.sets);
+    sl_free(&nonterms);
+    sl_free(&terms);
+    pl_free(&prods);
+
+    return result == PARSE_ACCEPT ? 0 : 1;
+}
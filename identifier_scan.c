@@ -0,0 +1,29 @@
+// identifier_scan.c
+// Generated by fa_codegen from identifier.fa; do not edit
+
+#include "identifier_scan.h"
+
+int identifier_longest(const char *text, size_t n) {
+    const unsigned char *base = (const unsigned char *)text;
+    const unsigned char *p = base;
+    const unsigned char *end = base + n;
+    const unsigned char *last = base;
+    unsigned c;
+
+    if (p == end) return (int)(last - base);
+    c = *p++;
+    if (c >= 'A' && c <= 'Z') goto s2;
+    if (c == '_') goto s2;
+    if (c >= 'a' && c <= 'z') goto s2;
+    return (int)(last - base);
+
+s2:
+    last = p;
+    if (p == end) return (int)(last - base);
+    c = *p++;
+    if (c >= '0' && c <= '9') goto s2;
+    if (c >= 'A' && c <= 'Z') goto s2;
+    if (c == '_') goto s2;
+    if (c >= 'a' && c <= 'z') goto s2;
+    return (int)(last - base);
+}
@@ -0,0 +1,12 @@
+// identifier_scan.h
+// Generated by fa_codegen from identifier.fa; do not edit
+
+#ifndef IDENTIFIER_SCAN_H
+#define IDENTIFIER_SCAN_H
+
+#include <stddef.h>
+
+// Longest prefix of text[0..n) that identifier.fa accepts, 0 if none
+int identifier_longest(const char *text, size_t n);
+
+#endif // IDENTIFIER_SCAN_H
@@ -0,0 +1,300 @@
+// incremental_parser.c
+// Incremental reparsing: re-run the table-driven parser only where an edit can
+// change the parse and splice unaffected old subtrees into the new tree
+
+#include "incremental_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Stack entry; sym == -1 marks the end of node's subtree
+typedef struct {
+    int sym;
+    ParseTreeNode *node;        // node in the new tree
+    int father_start;           // absolute first token of the father (own start for markers)
+    ParseTreeNode *old;         // aligned old node (only left of the edit) or NULL
+} IncEntry;
+
+// Descent path into the old tree, used to find old nodes right of the edit
+typedef struct {
+    ParseTreeNode *node;
+    int start;
+} OldPath;
+
+typedef struct {
+    const CompiledGrammar *cg;
+    PIFEntry *entries;
+    int count;
+    int cached_index;
+    int cached_col;
+
+    OldPath *path;
+    int path_len;
+    int path_cap;
+} IncContext;
+
+// Terminal column of new token i ($ at the end), classified on demand
+static int token_column(IncContext *ctx, int i) {
+    if (i >= ctx->count) return ctx->cg->dollar;
+    if (i != ctx->cached_index) {
+        ctx->cached_index = i;
+        PIFEntry *entry = &ctx->entries[i];
+        ctx->cached_col = cg_lexeme_column(ctx->cg, entry->lexeme, strlen(entry->lexeme), entry->bucket);
+    }
+    return ctx->cached_col;
+}
+
+// Old node with the given symbol starting at old token q, or NULL.
+// Lookups arrive in non-decreasing q, so the path acts as a finger.
+static ParseTreeNode *find_old_node(IncContext *ctx, const char *symbol, int q) {
+    while (ctx->path_len > 0) {
+        OldPath *top = &ctx->path[ctx->path_len - 1];
+        if (q >= top->start && q < top->start + top->node->token_len) break;
+        ctx->path_len--;
+    }
+    if (ctx->path_len == 0) return NULL;
+
+    for (;;) {
+        OldPath *top = &ctx->path[ctx->path_len - 1];
+        if (top->start == q && strcmp(top->node->symbol, symbol) == 0) return top->node;
+
+        ParseTreeNode *next = NULL;
+        int next_start = 0;
+        for (ParseTreeNode *c = top->node->child; c; c = c->sibling) {
+            int cs = top->start + c->token_offset;
+            if (q >= cs && q < cs + c->token_len) {
+                next = c;
+                next_start = cs;
+                break;
+            }
+        }
+        if (!next) return NULL;
+
+        if (ctx->path_len == ctx->path_cap) {
+            ctx->path_cap *= 2;
+            ctx->path = realloc(ctx->path, sizeof(OldPath) * ctx->path_cap);
+        }
+        ctx->path[ctx->path_len].node = next;
+        ctx->path[ctx->path_len].start = next_start;
+        ctx->path_len++;
+    }
+}
+
+// Detach node from its father in the old tree
+static void unlink_node(ParseTreeNode *node) {
+    ParseTreeNode *father = node->father;
+    if (father) {
+        if (father->child == node) {
+            father->child = node->sibling;
+        } else {
+            ParseTreeNode *prev = father->child;
+            while (prev && prev->sibling != node) prev = prev->sibling;
+            if (prev) prev->sibling = node->sibling;
+        }
+    }
+    node->father = NULL;
+    node->sibling = NULL;
+}
+
+// Move the contents of old into the already-linked placeholder node
+static void adopt_subtree(ParseTreeNode *node, ParseTreeNode *old) {
+    node->production_index = old->production_index;
+    node->token_len = old->token_len;
+    node->child = old->child;
+    for (ParseTreeNode *c = node->child; c; c = c->sibling) c->father = node;
+    old->child = NULL;
+    unlink_node(old);
+    tree_node_free(old);
+}
+
+static char *make_error(const CompiledGrammar *cg, int sym, int la, const char *msg) {
+    char *err = malloc(512);
+    if (msg) {
+        snprintf(err, 512, "%s", msg);
+    } else {
+        snprintf(err, 512, "Parse error: no action for stack='%s', input='%s'",
+                 sym >= 0 ? cg_symbol_name(cg, sym) : "NULL",
+                 la >= 0 ? cg->terms->items[la] : "<unknown token>");
+    }
+    return err;
+}
+
+static int same_entry(const PIFEntry *a, const PIFEntry *b) {
+    return a->bucket == b->bucket && a->pos == b->pos && strcmp(a->lexeme, b->lexeme) == 0;
+}
+
+ParseTreeOutput ll1_reparse_incremental(const CompiledGrammar *cg, ParseTreeNode *old_tree,
+                                        PIFEntry *old_entries, int old_count,
+                                        PIFEntry *new_entries, int new_count,
+                                        PIFEdit edit, IncrementalStats *stats) {
+    ParseTreeOutput output;
+    output.result = PARSE_ERROR;
+    output.tree = NULL;
+    output.error_location = NULL;
+
+    IncrementalStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    if (edit.start < 0 || edit.start > edit.old_end || edit.old_end > old_count ||
+        edit.start > edit.new_end || edit.new_end > new_count ||
+        old_count - edit.old_end != new_count - edit.new_end ||
+        (edit.old_end < old_count && !same_entry(&old_entries[edit.old_end], &new_entries[edit.new_end]))) {
+        output.error_location = make_error(cg, -1, -1, "Edit range does not match the PIF arrays");
+        tree_node_free(old_tree);
+        return output;
+    }
+    int delta = edit.new_end - edit.old_end;
+
+    IncContext ctx;
+    ctx.cg = cg;
+    ctx.entries = new_entries;
+    ctx.count = new_count;
+    ctx.cached_index = -1;
+    ctx.cached_col = -1;
+    ctx.path_cap = 64;
+    ctx.path = malloc(sizeof(OldPath) * ctx.path_cap);
+    ctx.path_len = 0;
+    if (old_tree) {
+        ctx.path[0].node = old_tree;
+        ctx.path[0].start = old_tree->token_offset;
+        ctx.path_len = 1;
+    }
+
+    int max_rhs = 1;
+    for (int p = 0; p < cg->prod_count; p++) if (cg->prod_len[p] > max_rhs) max_rhs = cg->prod_len[p];
+    ParseTreeNode **kids = malloc(sizeof(ParseTreeNode*) * max_rhs);
+    ParseTreeNode **old_kids = malloc(sizeof(ParseTreeNode*) * max_rhs);
+
+    int stack_cap = 256;
+    IncEntry *stack = malloc(sizeof(IncEntry) * stack_cap);
+    int sp = 0;
+    ParseTreeNode *root = tree_node_create(cg_symbol_name(cg, 0), 0);
+    stack[sp++] = (IncEntry){ cg->nt_count + cg->dollar, NULL, 0, NULL };
+    stack[sp++] = (IncEntry){ 0, root, 0, old_tree };
+
+    int cursor = 0;
+    int accepted = 0;
+    while (sp > 0) {
+        IncEntry e = stack[sp - 1];
+
+        if (e.sym == -1) {
+            e.node->token_len = cursor - e.father_start;
+            sp--;
+            continue;
+        }
+
+        int la = token_column(&ctx, cursor);
+        if (la < 0) {
+            output.error_location = make_error(cg, e.sym, la, NULL);
+            break;
+        }
+
+        if (!cg_is_terminal(cg, e.sym)) {
+            ParseTreeNode *node = e.node;
+            node->token_offset = cursor - e.father_start;
+
+            // Reuse: wholly left of the edit (lookahead included) or right of it
+            ParseTreeNode *old = NULL;
+            if (cursor < edit.start) {
+                if (e.old && e.old->token_len > 0 && cursor + e.old->token_len < edit.start) old = e.old;
+            } else if (cursor >= edit.new_end) {
+                old = find_old_node(&ctx, node->symbol, cursor - delta);
+                if (old && old->token_len == 0) old = NULL;
+            }
+            if (old && old != old_tree) {
+                // The adopted shell is freed, so drop it from the descent path
+                if (ctx.path_len > 0 && ctx.path[ctx.path_len - 1].node == old) ctx.path_len--;
+                adopt_subtree(node, old);
+                cursor += node->token_len;
+                stats->reused_subtrees++;
+                stats->reused_tokens += node->token_len;
+                sp--;
+                continue;
+            }
+
+            int v = cg->table[e.sym][la];
+            if (v < 0 || v >= cg->prod_count || (cg->prod_len[v] == 1 && cg->prod_rhs[v][0] == e.sym)) {
+                output.error_location = make_error(cg, e.sym, la, NULL);
+                break;
+            }
+            node->production_index = v;
+            stats->expansions++;
+
+            int len = cg->prod_len[v];
+            if (sp + len + 1 > stack_cap) {
+                while (sp + len + 1 > stack_cap) stack_cap *= 2;
+                stack = realloc(stack, sizeof(IncEntry) * stack_cap);
+            }
+            sp--;
+            stack[sp++] = (IncEntry){ -1, node, cursor, NULL };
+
+            // Old children stay aligned while the same production is applied left of the edit
+            ParseTreeNode *old_child = (e.old && cursor < edit.start && e.old->production_index == v) ? e.old->child : NULL;
+            ParseTreeNode *last = NULL;
+            for (int k = 0; k < len; k++) {
+                int sym = cg->prod_rhs[v][k];
+                kids[k] = tree_node_create(cg_symbol_name(cg, sym), cg_is_terminal(cg, sym));
+                kids[k]->father = node;
+                if (last) last->sibling = kids[k]; else node->child = kids[k];
+                last = kids[k];
+                old_kids[k] = old_child;
+                if (old_child) old_child = old_child->sibling;
+            }
+            for (int k = len - 1; k >= 0; k--) {
+                stack[sp++] = (IncEntry){ cg->prod_rhs[v][k], kids[k], cursor, old_kids[k] };
+            }
+        } else {
+            int v = cg->table[e.sym][la];
+            if (v == PT_POP) {
+                ParseTreeNode *leaf = e.node;
+                if (leaf && cursor < new_count) {
+                    PIFEntry *entry = &new_entries[cursor];
+                    leaf->lexeme = malloc(strlen(entry->lexeme) + 1);
+                    strcpy(leaf->lexeme, entry->lexeme);
+                    leaf->bucket = entry->bucket;
+                    leaf->pos = entry->pos;
+                    leaf->token_offset = cursor - e.father_start;
+                    leaf->token_len = 1;
+                }
+                cursor++;
+                stats->tokens_parsed++;
+                sp--;
+            } else if (v == PT_ACCEPT) {
+                accepted = 1;
+                break;
+            } else {
+                output.error_location = make_error(cg, e.sym, la, NULL);
+                break;
+            }
+        }
+    }
+
+    if (accepted && cursor == new_count) {
+        output.result = PARSE_ACCEPT;
+        output.tree = root;
+    } else {
+        if (!output.error_location) output.error_location = make_error(cg, -1, -1, "Input not fully consumed");
+        tree_node_free(root);
+    }
+    tree_node_free(old_tree);
+
+    free(stack);
+    free(kids);
+    free(old_kids);
+    free(ctx.path);
+    return output;
+}
+
+PIFEdit pif_diff_range(PIFEntry *old_entries, int old_count, PIFEntry *new_entries, int new_count) {
+    PIFEdit edit;
+    int prefix = 0;
+    while (prefix < old_count && prefix < new_count && same_entry(&old_entries[prefix], &new_entries[prefix])) prefix++;
+    int suffix = 0;
+    while (suffix < old_count - prefix && suffix < new_count - prefix &&
+           same_entry(&old_entries[old_count - 1 - suffix], &new_entries[new_count - 1 - suffix])) suffix++;
+    edit.start = prefix;
+    edit.old_end = old_count - suffix;
+    edit.new_end = new_count - suffix;
+    return edit;
+}
@@ -0,0 +1,41 @@
+// incremental_parser.h
+// Incremental LL(1) reparsing with subtree reuse after PIF edits
+
+#ifndef INCREMENTAL_PARSER_H
+#define INCREMENTAL_PARSER_H
+
+#include "compiled_grammar.h"
+#include "parser_tree.h"
+
+// Edited token range: old entries [start, old_end) were replaced by new
+// entries [start, new_end). Entries outside the range must be identical.
+typedef struct {
+    int start;
+    int old_end;
+    int new_end;
+} PIFEdit;
+
+typedef struct {
+    int reused_subtrees;    // old subtrees moved into the new tree
+    int reused_tokens;      // tokens covered by reused subtrees
+    int expansions;         // productions applied by the table-driven parser
+    int tokens_parsed;      // tokens popped by the table-driven parser
+} IncrementalStats;
+
+// Reparse after an edit. old_tree must carry token spans (every tree returned by
+// ll1_parse_with_tree does) and is consumed: reusable subtrees are moved into the
+// result and the rest is freed. A subtree is reused when its LL(1) parse cannot
+// change: it lies wholly before the edit (including its lookahead token) or
+// starts after it. The statement list is right-recursive, so every statement
+// before the edit still costs one list expansion and finding the first one after
+// it descends the old list: the work grows with the statement count as well as
+// with the edit. stats may be NULL.
+ParseTreeOutput ll1_reparse_incremental(const CompiledGrammar *cg, ParseTreeNode *old_tree,
+                                        PIFEntry *old_entries, int old_count,
+                                        PIFEntry *new_entries, int new_count,
+                                        PIFEdit edit, IncrementalStats *stats);
+
+// Compute the smallest edit range between two PIF arrays (common prefix/suffix)
+PIFEdit pif_diff_range(PIFEntry *old_entries, int old_count, PIFEntry *new_entries, int new_count);
+
+#endif // INCREMENTAL_PARSER_H
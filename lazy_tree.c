@@ -0,0 +1,288 @@
+// lazy_tree.c
+// Derivation-only LL(1) parsing with on-demand subtree materialization
+
+#include "lazy_tree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void add_mark(LazyMark **marks, int *count, int *cap, int step, int token) {
+    if (*count == *cap) {
+        *cap = *cap ? *cap * 2 : 64;
+        *marks = realloc(*marks, sizeof(LazyMark) * (*cap));
+    }
+    (*marks)[*count].step = step;
+    (*marks)[*count].token = token;
+    (*count)++;
+}
+
+// Append one expansion step (production p, adv tokens consumed since the previous step)
+static void record_step(LazyTree *lt, int p, int adv, int cursor) {
+    if (lt->step_count == lt->step_cap) {
+        lt->step_cap = lt->step_cap ? lt->step_cap * 2 : 1024;
+        lt->prods = realloc(lt->prods, (size_t)lt->step_cap * lt->prod_width);
+        lt->advance = realloc(lt->advance, (size_t)lt->step_cap);
+    }
+    int s = lt->step_count++;
+    if (lt->prod_width == 1) {
+        lt->prods[s] = (unsigned char)p;
+    } else {
+        lt->prods[2 * s] = (unsigned char)(p & 0xFF);
+        lt->prods[2 * s + 1] = (unsigned char)((p >> 8) & 0xFF);
+    }
+    lt->advance[s] = (unsigned char)(adv < 255 ? adv : 255);
+    if (s % LAZY_CHECKPOINT_INTERVAL == 0 || adv >= 255) {
+        add_mark(&lt->checkpoints, &lt->checkpoint_count, &lt->checkpoint_cap, s, cursor);
+    }
+}
+
+static void set_error(LazyTree *lt, const CompiledGrammar *cg, int top, int la) {
+    free(lt->error_location);
+    lt->error_location = malloc(512);
+    snprintf(lt->error_location, 512, "Parse error: no action for stack='%s', input='%s'",
+             top >= 0 ? cg_symbol_name(cg, top) : "NULL",
+             la >= 0 ? cg->terms->items[la] : "<unknown token>");
+}
+
+void lazy_tree_begin(LazyTree *lt, const CompiledGrammar *cg, const char *stmt_symbol) {
+    memset(lt, 0, sizeof(*lt));
+    lt->cg = cg;
+    lt->prod_width = cg->prod_count <= 256 ? 1 : 2;
+    lt->stmt_symbol = stmt_symbol ? sl_index(cg->nonterms, stmt_symbol) : -1;
+}
+
+void lazy_tree_add_step(LazyTree *lt, int production, int cursor) {
+    record_step(lt, production, cursor - lt->last_cursor, cursor);
+    lt->last_cursor = cursor;
+    if (lt->cg->prod_lhs[production] == lt->stmt_symbol) {
+        add_mark(&lt->stmts, &lt->stmt_count, &lt->stmt_cap, lt->step_count - 1, cursor);
+    }
+}
+
+// Predictive parse loop from nonterminal start; next_token is called once per consumed terminal
+static ParseResult parse_derivation(LazyTree *lt, int start, LazyTokenFn next_token, void *ctx) {
+    const CompiledGrammar *cg = lt->cg;
+    if (cg->nt_count == 0 || cg->dollar < 0) {
+        lt->error_location = malloc(64);
+        strcpy(lt->error_location, "grammar has no start symbol or no $");
+        return PARSE_ERROR;
+    }
+
+    // beta = S$, top of stack at the end of the array
+    int stack_cap = 256;
+    int *stack = malloc(sizeof(int) * stack_cap);
+    int sp = 0;
+    stack[sp++] = cg->nt_count + cg->dollar;
+    stack[sp++] = start;
+
+    int cursor = 0;
+    int idle_steps = 0;
+    int idle_limit = cg->nt_count * 64 + 1024;
+    int la = next_token(ctx);
+    ParseResult result = PARSE_ERROR;
+
+    while (sp > 0) {
+        int top = stack[sp - 1];
+        if (la < 0) {
+            set_error(lt, cg, top, la);
+            break;
+        }
+        int v = cg->table[top][la];
+
+        if (!cg_is_terminal(cg, top)) {
+            if (v < 0 || v >= cg->prod_count ||
+                (cg->prod_len[v] == 1 && cg->prod_rhs[v][0] == top) ||
+                ++idle_steps > idle_limit) {
+                set_error(lt, cg, top, la);
+                break;
+            }
+            lazy_tree_add_step(lt, v, cursor);
+
+            sp--;
+            int len = cg->prod_len[v];
+            if (sp + len > stack_cap) {
+                while (sp + len > stack_cap) stack_cap *= 2;
+                stack = realloc(stack, sizeof(int) * stack_cap);
+            }
+            for (int k = len - 1; k >= 0; k--) stack[sp++] = cg->prod_rhs[v][k];
+        } else if (v == PT_POP) {
+            sp--;
+            cursor++;
+            la = next_token(ctx);
+            idle_steps = 0;
+        } else if (v == PT_ACCEPT) {
+            result = PARSE_ACCEPT;
+            break;
+        } else {
+            set_error(lt, cg, top, la);
+            break;
+        }
+    }
+
+    free(stack);
+    return result;
+}
+
+typedef struct {
+    const int *input;
+    int pos;
+} ArrayTokens;
+
+static int next_array_token(void *ctx) {
+    ArrayTokens *tokens = ctx;
+    return tokens->input[tokens->pos++];
+}
+
+ParseResult lazy_tree_parse(LazyTree *lt, const CompiledGrammar *cg,
+                            PIFEntry *pif_entries, int pif_count, const char *stmt_symbol) {
+    return lazy_tree_parse_from(lt, cg, NULL, pif_entries, pif_count, stmt_symbol);
+}
+
+ParseResult lazy_tree_parse_from(LazyTree *lt, const CompiledGrammar *cg, const char *start_symbol,
+                                 PIFEntry *pif_entries, int pif_count, const char *stmt_symbol) {
+    lazy_tree_begin(lt, cg, stmt_symbol);
+    lt->pif_entries = pif_entries;
+    lt->pif_count = pif_count;
+
+    int start = start_symbol ? sl_index(cg->nonterms, start_symbol) : 0;
+    if (start < 0) {
+        lt->error_location = malloc(512);
+        snprintf(lt->error_location, 512, "unknown start symbol '%s'", start_symbol);
+        return PARSE_ERROR;
+    }
+
+    // alpha = w$ as terminal columns
+    int *input = malloc(sizeof(int) * (pif_count + 1));
+    cg_pif_terminals(cg, pif_entries, pif_count, input);
+    input[pif_count] = cg->dollar;
+
+    ArrayTokens tokens = { input, 0 };
+    ParseResult result = parse_derivation(lt, start, next_array_token, &tokens);
+    free(input);
+    return result;
+}
+
+ParseResult lazy_tree_parse_stream(LazyTree *lt, const CompiledGrammar *cg,
+                                   LazyTokenFn next_token, void *ctx, const char *stmt_symbol) {
+    lazy_tree_begin(lt, cg, stmt_symbol);
+    return parse_derivation(lt, 0, next_token, ctx);
+}
+
+int lazy_tree_production(const LazyTree *lt, int step) {
+    if (step < 0 || step >= lt->step_count) return -1;
+    if (lt->prod_width == 1) return lt->prods[step];
+    return lt->prods[2 * step] | (lt->prods[2 * step + 1] << 8);
+}
+
+int lazy_tree_cursor(const LazyTree *lt, int step) {
+    if (step < 0 || step >= lt->step_count || lt->checkpoint_count == 0) return -1;
+
+    // last checkpoint at or before step
+    int lo = 0, hi = lt->checkpoint_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (lt->checkpoints[mid].step <= step) lo = mid; else hi = mid - 1;
+    }
+    int token = lt->checkpoints[lo].token;
+    for (int s = lt->checkpoints[lo].step + 1; s <= step; s++) token += lt->advance[s];
+    return token;
+}
+
+// Node whose right-hand side is being expanded
+typedef struct {
+    ParseTreeNode *node;
+    int production;
+    int next;
+} ExpandFrame;
+
+// Iterative: right-recursive statement lists make the tree as deep as the
+// program is long
+static ParseTreeNode *build_subtree(const LazyTree *lt, int *step, int *token) {
+    const CompiledGrammar *cg = lt->cg;
+    int p = lazy_tree_production(lt, *step);
+    if (p < 0) return NULL;
+    (*step)++;
+
+    ParseTreeNode *root = tree_node_create(cg_symbol_name(cg, cg->prod_lhs[p]), 0);
+    root->production_index = p;
+
+    int cap = 256, fp = 0;
+    ExpandFrame *frames = malloc(sizeof(ExpandFrame) * cap);
+    frames[fp++] = (ExpandFrame){ root, p, 0 };
+    while (fp > 0) {
+        ExpandFrame *f = &frames[fp - 1];
+        if (f->next == cg->prod_len[f->production]) {
+            fp--;
+            continue;
+        }
+        int sym = cg->prod_rhs[f->production][f->next++];
+        ParseTreeNode *child;
+        if (cg_is_terminal(cg, sym)) {
+            child = tree_node_create(cg_symbol_name(cg, sym), 1);
+            if (*token < lt->pif_count) {
+                PIFEntry *entry = &lt->pif_entries[*token];
+                child->lexeme = malloc(strlen(entry->lexeme) + 1);
+                strcpy(child->lexeme, entry->lexeme);
+                child->bucket = entry->bucket;
+                child->pos = entry->pos;
+            }
+            (*token)++;
+            tree_node_add_child(f->node, child);
+            continue;
+        }
+        int q = lazy_tree_production(lt, *step);
+        if (q < 0) {
+            free(frames);
+            tree_node_free(root);
+            return NULL;
+        }
+        (*step)++;
+        child = tree_node_create(cg_symbol_name(cg, cg->prod_lhs[q]), 0);
+        child->production_index = q;
+        tree_node_add_child(f->node, child);
+        if (fp == cap) {
+            cap *= 2;
+            frames = realloc(frames, sizeof(ExpandFrame) * cap);
+        }
+        frames[fp++] = (ExpandFrame){ child, q, 0 };
+    }
+    free(frames);
+    return root;
+}
+
+ParseTreeNode *lazy_tree_materialize(const LazyTree *lt, int step) {
+    int token = lazy_tree_cursor(lt, step);
+    if (token < 0) return NULL;
+    int start = token;
+    ParseTreeNode *node = build_subtree(lt, &step, &token);
+    tree_compute_spans(node, start);
+    return node;
+}
+
+ParseTreeNode *lazy_tree_statement(const LazyTree *lt, int k) {
+    if (k < 0 || k >= lt->stmt_count) return NULL;
+    int step = lt->stmts[k].step;
+    int token = lt->stmts[k].token;
+    ParseTreeNode *node = build_subtree(lt, &step, &token);
+    tree_compute_spans(node, lt->stmts[k].token);
+    return node;
+}
+
+size_t lazy_tree_bytes(const LazyTree *lt) {
+    return (size_t)lt->step_count * (lt->prod_width + 1) +
+           sizeof(LazyMark) * (size_t)(lt->checkpoint_count + lt->stmt_count);
+}
+
+void lazy_tree_free(LazyTree *lt) {
+    free(lt->prods);
+    free(lt->advance);
+    free(lt->checkpoints);
+    free(lt->stmts);
+    free(lt->error_location);
+    lt->prods = NULL;
+    lt->advance = NULL;
+    lt->checkpoints = NULL;
+    lt->stmts = NULL;
+    lt->error_location = NULL;
+    lt->step_count = lt->checkpoint_count = lt->stmt_count = 0;
+}
@@ -0,0 +1,90 @@
+// lazy_tree.h
+// Lazy parse trees: record only the leftmost derivation (pi) plus token cursor
+// positions, and materialize ParseTreeNode subtrees on demand
+
+#ifndef LAZY_TREE_H
+#define LAZY_TREE_H
+
+#include "compiled_grammar.h"
+#include "parser.h"
+#include "parse_tree.h"
+
+// A full cursor checkpoint is stored every LAZY_CHECKPOINT_INTERVAL steps
+#define LAZY_CHECKPOINT_INTERVAL 64
+
+// (derivation step, token cursor) pair
+typedef struct {
+    int step;
+    int token;
+} LazyMark;
+
+typedef struct {
+    const CompiledGrammar *cg;  // borrowed
+    PIFEntry *pif_entries;      // borrowed, needed to fill terminal leaves
+    int pif_count;
+
+    // Production sequence pi, one entry per expansion step
+    int step_count;
+    int step_cap;
+    int prod_width;             // bytes per production index (1 or 2)
+    unsigned char *prods;
+    unsigned char *advance;     // tokens consumed since previous step (255 = use checkpoint)
+
+    LazyMark *checkpoints;      // sorted by step
+    int checkpoint_count;
+    int checkpoint_cap;
+
+    LazyMark *stmts;            // expansions of the statement symbol
+    int stmt_count;
+    int stmt_cap;
+    int stmt_symbol;            // nonterminal id or -1
+    int last_cursor;            // cursor of the last recorded step
+
+    char *error_location;
+} LazyTree;
+
+// Parse the PIF recording only the derivation. stmt_symbol names the
+// nonterminal whose expansions are indexed (e.g. "stmt"); may be NULL.
+ParseResult lazy_tree_parse(LazyTree *lt, const CompiledGrammar *cg,
+                            PIFEntry *pif_entries, int pif_count, const char *stmt_symbol);
+
+// Same, starting from the nonterminal named start_symbol instead of the grammar's
+// start symbol (NULL for the start symbol), e.g. "stmt" for a single statement
+ParseResult lazy_tree_parse_from(LazyTree *lt, const CompiledGrammar *cg, const char *start_symbol,
+                                 PIFEntry *pif_entries, int pif_count, const char *stmt_symbol);
+
+// Token source for lazy_tree_parse_stream: returns the terminal column of the
+// next token, cg->dollar at end of input, or -1 for an unknown token
+typedef int (*LazyTokenFn)(void *ctx);
+
+// Same as lazy_tree_parse, but tokens are pulled one at a time as the parse
+// advances. The PIF entries are not known up front: set pif_entries/pif_count
+// once the stream has ended and before materializing.
+ParseResult lazy_tree_parse_stream(LazyTree *lt, const CompiledGrammar *cg,
+                                   LazyTokenFn next_token, void *ctx, const char *stmt_symbol);
+
+// Record a derivation that is already known (e.g. decoded) instead of parsing:
+// lazy_tree_begin, then one lazy_tree_add_step per expansion, in leftmost order,
+// with the index of the first token not yet consumed
+void lazy_tree_begin(LazyTree *lt, const CompiledGrammar *cg, const char *stmt_symbol);
+void lazy_tree_add_step(LazyTree *lt, int production, int cursor);
+
+// Production applied at a derivation step
+int lazy_tree_production(const LazyTree *lt, int step);
+
+// Token cursor (index of the first PIF entry not yet consumed) at a step
+int lazy_tree_cursor(const LazyTree *lt, int step);
+
+// Rebuild the subtree rooted at the nonterminal expanded at step.
+// Step 0 yields the whole tree. Caller frees with tree_node_free.
+ParseTreeNode *lazy_tree_materialize(const LazyTree *lt, int step);
+
+// Rebuild the k-th indexed statement
+ParseTreeNode *lazy_tree_statement(const LazyTree *lt, int k);
+
+// Bytes held by the recorded derivation and indexes
+size_t lazy_tree_bytes(const LazyTree *lt);
+
+void lazy_tree_free(LazyTree *lt);
+
+#endif // LAZY_TREE_H
@@ -575,6 +575,7 @@ char *yytext;
 #include "flowcalc.tab.h"
 #include "st.h"
 #include "dfa.h"
+#include "lexer_pif_export.h"
 
 /* Ensure fileno prototype is visible */
 extern int fileno(FILE *);
@@ -604,24 +605,48 @@ static char *strdup_local(const char *s) {
 #endif
 
 #define UNUSED_LOC -1
-typedef struct { char lexeme[256]; int bucket; int pos; } PIFEntry;
-#define PIF_MAX 4096
-static PIFEntry PIF[PIF_MAX];
+/* Growable PIF, handed to the parser by lexer_take_pif */
+static PIFEntry *PIF = NULL;
 static int PIF_len = 0;
+static int PIF_cap = 0;
 
 static int lineNumber = 1;
 static SymbolTable *ST_PTR = NULL;
-static DFA *ID_PTR = NULL;
-static DFA *NUM_PTR = NULL;
+/* NUMBER values by ST_PTR index, in the caller's table (lexer_set_num_table) */
+static NumTable *LEX_NUMS = NULL;
+/* identifier.fa and number.fa run as one product automaton (dfa.h); a machine's
+   bit is set in the mask when it accepts the whole token */
+static DFAProduct LEX_DFAS;
+static uint32_t LEX_ID_MASK = 0;
+static uint32_t LEX_NUM_MASK = 0;
+static int lexErrors = 0;
+
+/* Optional per-entry callback: when set, pif_add forwards entries here instead of storing them */
+static PifSink PIF_SINK = NULL;
+static void *PIF_SINK_CTX = NULL;
 
 static void pif_add(const char* lex, int bucket, int pos) {
-    if (PIF_len < PIF_MAX) {
-        strncpy(PIF[PIF_len].lexeme, lex, 255);
-        PIF[PIF_len].lexeme[255] = '\0';
-        PIF[PIF_len].bucket = bucket;
-        PIF[PIF_len].pos = pos;
-        PIF_len++;
+    if (PIF_SINK) {
+        PIF_SINK(lex, bucket, pos, PIF_SINK_CTX);
+        return;
     }
+    if (PIF_len == PIF_cap) {
+        int cap = PIF_cap ? PIF_cap * 2 : 1024;
+        PIFEntry *grown = (PIFEntry*)realloc(PIF, sizeof(PIFEntry) * cap);
+        if (!grown) {
+            // A dropped entry must fail the parse, see lexer_error_count
+            lexErrors++;
+            fprintf(stderr, "Lexical error at line %d: out of memory for the PIF\n", lineNumber);
+            return;
+        }
+        PIF = grown;
+        PIF_cap = cap;
+    }
+    strncpy(PIF[PIF_len].lexeme, lex, 255);
+    PIF[PIF_len].lexeme[255] = '\0';
+    PIF[PIF_len].bucket = bucket;
+    PIF[PIF_len].pos = pos;
+    PIF_len++;
 }
 
 static void add_to_st_and_pif(const char* yy) {
@@ -629,12 +654,19 @@ static void add_to_st_and_pif(const char* yy) {
     int idx = st_put(ST_PTR, yy);
     int b=-1,p=-1;
     if (st_get_location_by_index(ST_PTR, idx, &b, &p) != 0) { b = UNUSED_LOC; p = UNUSED_LOC; }
+    if (LEX_NUMS && b != UNUSED_LOC && yy[0] >= '0' && yy[0] <= '9') num_table_put(LEX_NUMS, idx, b, p, yy, strlen(yy));
     pif_add(yy, b, p);
 }
 
+/* One pass over the token for both machines */
+static uint32_t lex_dfa_accepts(void) {
+    if (!LEX_DFAS.nparts) return 0;
+    return dfa_product_longest(&LEX_DFAS, yytext, (size_t)yyleng, NULL);
+}
+
 extern YYSTYPE yylval;
-#line 636 "lex.yy.c"
-#line 637 "lex.yy.c"
+#line 661 "lex.yy.c"
+#line 662 "lex.yy.c"
 
 #define INITIAL 0
 
@@ -851,10 +883,10 @@ YY_DECL
 		}
 
 	{
-#line 80 "flowcalc.l"
+#line 105 "flowcalc.l"
 
 
-#line 857 "lex.yy.c"
+#line 882 "lex.yy.c"
 
 	while ( /*CONSTCOND*/1 )		/* loops until end-of-file is reached */
 		{
@@ -923,281 +955,277 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 82 "flowcalc.l"
+#line 107 "flowcalc.l"
 { pif_add("bind", UNUSED_LOC, UNUSED_LOC); return BIND; }
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 83 "flowcalc.l"
+#line 108 "flowcalc.l"
 { pif_add("set", UNUSED_LOC, UNUSED_LOC); return SET; }
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 84 "flowcalc.l"
+#line 109 "flowcalc.l"
 { pif_add("def", UNUSED_LOC, UNUSED_LOC); return DEF; }
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 85 "flowcalc.l"
+#line 110 "flowcalc.l"
 { pif_add("yield", UNUSED_LOC, UNUSED_LOC); return YIELD; }
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 86 "flowcalc.l"
+#line 111 "flowcalc.l"
 { pif_add("when", UNUSED_LOC, UNUSED_LOC); return WHEN; }
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 87 "flowcalc.l"
+#line 112 "flowcalc.l"
 { pif_add("otherwise", UNUSED_LOC, UNUSED_LOC); return OTHERWISE; }
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 88 "flowcalc.l"
+#line 113 "flowcalc.l"
 { pif_add("each", UNUSED_LOC, UNUSED_LOC); return EACH; }
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 89 "flowcalc.l"
+#line 114 "flowcalc.l"
 { pif_add("in", UNUSED_LOC, UNUSED_LOC); return IN; }
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 90 "flowcalc.l"
+#line 115 "flowcalc.l"
 { pif_add("do", UNUSED_LOC, UNUSED_LOC); return DO; }
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 91 "flowcalc.l"
+#line 116 "flowcalc.l"
 { pif_add("end", UNUSED_LOC, UNUSED_LOC); return END; }
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 92 "flowcalc.l"
+#line 117 "flowcalc.l"
 { pif_add("and", UNUSED_LOC, UNUSED_LOC); return AND; }
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 93 "flowcalc.l"
+#line 118 "flowcalc.l"
 { pif_add("or", UNUSED_LOC, UNUSED_LOC); return OR; }
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 94 "flowcalc.l"
+#line 119 "flowcalc.l"
 { pif_add("not", UNUSED_LOC, UNUSED_LOC); return NOT; }
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 95 "flowcalc.l"
+#line 120 "flowcalc.l"
 { pif_add("asc", UNUSED_LOC, UNUSED_LOC); return ASC; }
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 96 "flowcalc.l"
+#line 121 "flowcalc.l"
 { pif_add("desc", UNUSED_LOC, UNUSED_LOC); return DESC; }
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 98 "flowcalc.l"
+#line 123 "flowcalc.l"
 { pif_add("apply", UNUSED_LOC, UNUSED_LOC); return APPLY; }
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 99 "flowcalc.l"
+#line 124 "flowcalc.l"
 { pif_add("keep", UNUSED_LOC, UNUSED_LOC); return KEEP; }
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 100 "flowcalc.l"
+#line 125 "flowcalc.l"
 { pif_add("order", UNUSED_LOC, UNUSED_LOC); return ORDER; }
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 101 "flowcalc.l"
+#line 126 "flowcalc.l"
 { pif_add("dedupe", UNUSED_LOC, UNUSED_LOC); return DEDUPE; }
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 102 "flowcalc.l"
+#line 127 "flowcalc.l"
 { pif_add("take", UNUSED_LOC, UNUSED_LOC); return TAKE; }
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 103 "flowcalc.l"
+#line 128 "flowcalc.l"
 { pif_add("skip", UNUSED_LOC, UNUSED_LOC); return SKIP; }
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 104 "flowcalc.l"
+#line 129 "flowcalc.l"
 { pif_add("concat", UNUSED_LOC, UNUSED_LOC); return CONCAT; }
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 105 "flowcalc.l"
+#line 130 "flowcalc.l"
 { pif_add("joinstr", UNUSED_LOC, UNUSED_LOC); return JOINSTR; }
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 106 "flowcalc.l"
+#line 131 "flowcalc.l"
 { pif_add("total", UNUSED_LOC, UNUSED_LOC); return TOTAL; }
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 107 "flowcalc.l"
+#line 132 "flowcalc.l"
 { pif_add("count", UNUSED_LOC, UNUSED_LOC); return COUNT; }
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 108 "flowcalc.l"
+#line 133 "flowcalc.l"
 { pif_add("avg", UNUSED_LOC, UNUSED_LOC); return AVG; }
 	YY_BREAK
 case 27:
 YY_RULE_SETUP
-#line 110 "flowcalc.l"
+#line 135 "flowcalc.l"
 { pif_add("true", UNUSED_LOC, UNUSED_LOC); yylval.bool_val = 1; return BOOL_LIT; }
 	YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 111 "flowcalc.l"
+#line 136 "flowcalc.l"
 { pif_add("false", UNUSED_LOC, UNUSED_LOC); yylval.bool_val = 0; return BOOL_LIT; }
 	YY_BREAK
 case 29:
 YY_RULE_SETUP
-#line 112 "flowcalc.l"
+#line 137 "flowcalc.l"
 { pif_add("none", UNUSED_LOC, UNUSED_LOC); return NONE; }
 	YY_BREAK
 case 30:
 YY_RULE_SETUP
-#line 114 "flowcalc.l"
+#line 139 "flowcalc.l"
 { pif_add(":=", UNUSED_LOC, UNUSED_LOC); return ASSIGN; }
 	YY_BREAK
 case 31:
 YY_RULE_SETUP
-#line 115 "flowcalc.l"
+#line 140 "flowcalc.l"
 { pif_add("->", UNUSED_LOC, UNUSED_LOC); return LAMBDA; }
 	YY_BREAK
 case 32:
 YY_RULE_SETUP
-#line 116 "flowcalc.l"
+#line 141 "flowcalc.l"
 { pif_add("|>", UNUSED_LOC, UNUSED_LOC); return PIPELINE; }
 	YY_BREAK
 case 33:
 YY_RULE_SETUP
-#line 117 "flowcalc.l"
+#line 142 "flowcalc.l"
 { pif_add("**", UNUSED_LOC, UNUSED_LOC); return POW; }
 	YY_BREAK
 case 34:
 YY_RULE_SETUP
-#line 118 "flowcalc.l"
+#line 143 "flowcalc.l"
 { pif_add(">=", UNUSED_LOC, UNUSED_LOC); return GE; }
 	YY_BREAK
 case 35:
 YY_RULE_SETUP
-#line 119 "flowcalc.l"
+#line 144 "flowcalc.l"
 { pif_add("<=", UNUSED_LOC, UNUSED_LOC); return LE; }
 	YY_BREAK
 case 36:
 YY_RULE_SETUP
-#line 120 "flowcalc.l"
+#line 145 "flowcalc.l"
 { pif_add("==", UNUSED_LOC, UNUSED_LOC); return EQ; }
 	YY_BREAK
 case 37:
 YY_RULE_SETUP
-#line 121 "flowcalc.l"
+#line 146 "flowcalc.l"
 { pif_add("!=", UNUSED_LOC, UNUSED_LOC); return NE; }
 	YY_BREAK
 case 38:
 YY_RULE_SETUP
-#line 122 "flowcalc.l"
+#line 147 "flowcalc.l"
 { pif_add("..<", UNUSED_LOC, UNUSED_LOC); return RANGE_DOT_LT; }
 	YY_BREAK
 case 39:
 YY_RULE_SETUP
-#line 123 "flowcalc.l"
+#line 148 "flowcalc.l"
 { pif_add("..", UNUSED_LOC, UNUSED_LOC); return RANGE_DOT; }
 	YY_BREAK
 case 40:
 YY_RULE_SETUP
-#line 125 "flowcalc.l"
+#line 150 "flowcalc.l"
 { pif_add("+", UNUSED_LOC, UNUSED_LOC); return PLUS; }
 	YY_BREAK
 case 41:
 YY_RULE_SETUP
-#line 126 "flowcalc.l"
+#line 151 "flowcalc.l"
 { pif_add("-", UNUSED_LOC, UNUSED_LOC); return MINUS; }
 	YY_BREAK
 case 42:
 YY_RULE_SETUP
-#line 127 "flowcalc.l"
+#line 152 "flowcalc.l"
 { pif_add("*", UNUSED_LOC, UNUSED_LOC); return MUL; }
 	YY_BREAK
 case 43:
 YY_RULE_SETUP
-#line 128 "flowcalc.l"
+#line 153 "flowcalc.l"
 { pif_add("/", UNUSED_LOC, UNUSED_LOC); return DIV; }
 	YY_BREAK
 case 44:
 YY_RULE_SETUP
-#line 129 "flowcalc.l"
+#line 154 "flowcalc.l"
 { pif_add("%", UNUSED_LOC, UNUSED_LOC); return MOD; }
 	YY_BREAK
 case 45:
 YY_RULE_SETUP
-#line 130 "flowcalc.l"
+#line 155 "flowcalc.l"
 { pif_add("<", UNUSED_LOC, UNUSED_LOC); return LT; }
 	YY_BREAK
 case 46:
 YY_RULE_SETUP
-#line 131 "flowcalc.l"
+#line 156 "flowcalc.l"
 { pif_add(">", UNUSED_LOC, UNUSED_LOC); return GT; }
 	YY_BREAK
 case 47:
 YY_RULE_SETUP
-#line 132 "flowcalc.l"
+#line 157 "flowcalc.l"
 { pif_add("=", UNUSED_LOC, UNUSED_LOC); return UPDATE; }
 	YY_BREAK
 case 48:
 YY_RULE_SETUP
-#line 133 "flowcalc.l"
+#line 158 "flowcalc.l"
 { pif_add("(", UNUSED_LOC, UNUSED_LOC); return LPAREN; }
 	YY_BREAK
 case 49:
 YY_RULE_SETUP
-#line 134 "flowcalc.l"
+#line 159 "flowcalc.l"
 { pif_add(")", UNUSED_LOC, UNUSED_LOC); return RPAREN; }
 	YY_BREAK
 case 50:
 YY_RULE_SETUP
-#line 135 "flowcalc.l"
+#line 160 "flowcalc.l"
 { pif_add("[", UNUSED_LOC, UNUSED_LOC); return LBRACKET; }
 	YY_BREAK
 case 51:
 YY_RULE_SETUP
-#line 136 "flowcalc.l"
+#line 161 "flowcalc.l"
 { pif_add("]", UNUSED_LOC, UNUSED_LOC); return RBRACKET; }
 	YY_BREAK
 case 52:
 YY_RULE_SETUP
-#line 137 "flowcalc.l"
+#line 162 "flowcalc.l"
 { pif_add(",", UNUSED_LOC, UNUSED_LOC); return COMMA; }
 	YY_BREAK
 case 53:
 YY_RULE_SETUP
-#line 139 "flowcalc.l"
+#line 164 "flowcalc.l"
 { 
-                    if (ID_PTR && NUM_PTR) {
-                        int Li = dfa_longest(ID_PTR, yytext);
-                        int Ln = dfa_longest(NUM_PTR, yytext);
-                        int len = strlen(yytext);
-                        if (Li == len && Li >= Ln) {
-                            add_to_st_and_pif(yytext);
-                            yylval.string_val = strdup(yytext);
-                            return IDENTIFIER;
-                        } else if (Ln == len) {
-                            add_to_st_and_pif(yytext);
-                            yylval.string_val = strdup(yytext);
-                            return NUMBER;
-                        }
+                    uint32_t accepts = lex_dfa_accepts();
+                    if (accepts & LEX_ID_MASK) {
+                        add_to_st_and_pif(yytext);
+                        yylval.string_val = strdup(yytext);
+                        return IDENTIFIER;
+                    } else if (accepts & LEX_NUM_MASK) {
+                        add_to_st_and_pif(yytext);
+                        yylval.string_val = strdup(yytext);
+                        return NUMBER;
                     }
                     
                     if ((yytext[0] >= 'a' && yytext[0] <= 'z') || 
@@ -1207,22 +1235,18 @@ YY_RULE_SETUP
                         yylval.string_val = strdup(yytext);
                         return IDENTIFIER;
                     }
-                    fprintf(stderr, "Lexical error at line %d: illegal token '%s'\n", lineNumber, yytext);
+                    lexErrors++; fprintf(stderr, "Lexical error at line %d: illegal token '%s'\n", lineNumber, yytext);
                     return 0;
                 }
 	YY_BREAK
 case 54:
 YY_RULE_SETUP
-#line 165 "flowcalc.l"
+#line 186 "flowcalc.l"
 { 
-                    if (NUM_PTR) {
-                        int Ln = dfa_longest(NUM_PTR, yytext);
-                        int len = strlen(yytext);
-                        if (Ln == len) {
-                            add_to_st_and_pif(yytext);
-                            yylval.string_val = strdup(yytext);
-                            return NUMBER;
-                        }
+                    if (lex_dfa_accepts() & LEX_NUM_MASK) {
+                        add_to_st_and_pif(yytext);
+                        yylval.string_val = strdup(yytext);
+                        return NUMBER;
                     }
                     
                     int valid = 1;
@@ -1237,14 +1261,14 @@ YY_RULE_SETUP
                         yylval.string_val = strdup(yytext);
                         return NUMBER;
                     }
-                    fprintf(stderr, "Lexical error at line %d: illegal number '%s'\n", lineNumber, yytext);
+                    lexErrors++; fprintf(stderr, "Lexical error at line %d: illegal number '%s'\n", lineNumber, yytext);
                     return 0;
                 }
 	YY_BREAK
 case 55:
 /* rule 55 can match eol */
 YY_RULE_SETUP
-#line 191 "flowcalc.l"
+#line 208 "flowcalc.l"
 { 
                     add_to_st_and_pif(yytext);
                     yylval.string_val = strdup(yytext);
@@ -1253,31 +1277,31 @@ YY_RULE_SETUP
 	YY_BREAK
 case 56:
 YY_RULE_SETUP
-#line 197 "flowcalc.l"
+#line 214 "flowcalc.l"
 { /* skip comment */ }
 	YY_BREAK
 case 57:
 /* rule 57 can match eol */
 YY_RULE_SETUP
-#line 198 "flowcalc.l"
-{ lineNumber++; return NL; }
+#line 215 "flowcalc.l"
+{ lineNumber++; pif_add("NL", UNUSED_LOC, UNUSED_LOC); return NL; }
 	YY_BREAK
 case 58:
 YY_RULE_SETUP
-#line 199 "flowcalc.l"
+#line 216 "flowcalc.l"
 { /* skip whitespace */ }
 	YY_BREAK
 case 59:
 YY_RULE_SETUP
-#line 201 "flowcalc.l"
-{ fprintf(stderr, "Lexical error at line %d: illegal token '%s'\n", lineNumber, yytext); return 0; }
+#line 218 "flowcalc.l"
+{ lexErrors++; fprintf(stderr, "Lexical error at line %d: illegal token '%s'\n", lineNumber, yytext); return 0; }
 	YY_BREAK
 case 60:
 YY_RULE_SETUP
-#line 203 "flowcalc.l"
+#line 220 "flowcalc.l"
 ECHO;
 	YY_BREAK
-#line 1280 "lex.yy.c"
+#line 1297 "lex.yy.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -2294,15 +2318,61 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 203 "flowcalc.l"
+#line 220 "flowcalc.l"
 
 
 void init_lexer(SymbolTable *st, DFA *id_dfa, DFA *num_dfa) {
     ST_PTR = st;
-    ID_PTR = id_dfa;
-    NUM_PTR = num_dfa;
+    const DFA *parts[2];
+    int nparts = 0;
+    dfa_product_free(&LEX_DFAS);
+    LEX_ID_MASK = LEX_NUM_MASK = 0;
+    if (id_dfa) { LEX_ID_MASK = 1u << nparts; parts[nparts++] = id_dfa; }
+    if (num_dfa) { LEX_NUM_MASK = 1u << nparts; parts[nparts++] = num_dfa; }
+    if (nparts && dfa_product_build(&LEX_DFAS, parts, nparts) != 0) {
+        fprintf(stderr, "Warning: could not combine the identifier and number DFAs\n");
+    }
+    LEX_NUMS = NULL;
     PIF_len = 0;
     lineNumber = 1;
+    lexErrors = 0;
+}
+
+void lexer_set_num_table(NumTable *nums) {
+    LEX_NUMS = nums;
+}
+
+void set_pif_sink(PifSink sink, void *ctx) {
+    PIF_SINK = sink;
+    PIF_SINK_CTX = ctx;
+}
+
+int lexer_error_count(void) {
+    return lexErrors;
+}
+
+PIFEntry *lexer_take_pif(int *count) {
+    PIFEntry *entries = PIF;
+    *count = PIF_len;
+    PIF = NULL;
+    PIF_len = 0;
+    PIF_cap = 0;
+    return entries;
+}
+
+static YY_BUFFER_STATE SCAN_BUFFER = NULL;
+
+void lexer_end_scan(void) {
+    if (SCAN_BUFFER) {
+        yy_delete_buffer(SCAN_BUFFER);
+        SCAN_BUFFER = NULL;
+    }
+}
+
+int lexer_scan_buffer(char *base, size_t size) {
+    lexer_end_scan();
+    SCAN_BUFFER = yy_scan_buffer(base, size + 2);
+    return SCAN_BUFFER ? 0 : -1;
 }
 
 void dump_pif(void) {
@@ -2,156 +2,168 @@
 // Map lexemes to terminal names for parser
 
 #include "lexer_pif_export.h"
+#include "simd_scan.h"
 #include <string.h>
-#include <ctype.h>
-#include <stdlib.h>
 
-// Case-insensitive string comparison (Windows compatibility)
-#ifdef _WIN32
-#include <string.h>
-#define strcasecmp _stricmp
-#else
-#include <strings.h>  // For strcasecmp on Unix
-#endif
+const char *const lexeme_terminal_names[LT_NUM_TERMINALS] = {
+    "BIND", "SET", "DEF", "YIELD", "WHEN", "OTHERWISE", "EACH", "IN", "DO", "END", "AND",
+    "OR", "NOT", "ASC", "DESC", "LPAREN", "RPAREN", "LBRACKET", "RBRACKET", "ASSIGN",
+    "LAMBDA", "PLUS", "MINUS", "MUL", "DIV", "MOD", "COMMA", "APPLY", "KEEP", "ORDER",
+    "DEDUPE", "TAKE", "SKIP", "CONCAT", "JOINSTR", "TOTAL", "COUNT", "AVG", "BOOL_LIT",
+    "NONE", "PIPELINE", "POW", "GE", "LE", "EQ", "NE", "RANGE_DOT_LT", "RANGE_DOT", "LT",
+    "GT", "UPDATE", "NL", "STRING", "NUMBER", "RANGE", "IDENTIFIER"
+};
 
-// Map lexeme (lowercase string) to terminal name (uppercase)
-const char *lexeme_to_terminal(const char *lexeme) {
-    if (!lexeme) return NULL;
-    
-    // Keywords (exact match, case-insensitive)
-    if (strcasecmp(lexeme, "bind") == 0) return "BIND";
-    if (strcasecmp(lexeme, "set") == 0) return "SET";
-    if (strcasecmp(lexeme, "def") == 0) return "DEF";
-    if (strcasecmp(lexeme, "yield") == 0) return "YIELD";
-    if (strcasecmp(lexeme, "when") == 0) return "WHEN";
-    if (strcasecmp(lexeme, "otherwise") == 0) return "OTHERWISE";
-    if (strcasecmp(lexeme, "each") == 0) return "EACH";
-    if (strcasecmp(lexeme, "in") == 0) return "IN";
-    if (strcasecmp(lexeme, "do") == 0) return "DO";
-    if (strcasecmp(lexeme, "end") == 0) return "END";
-    if (strcasecmp(lexeme, "and") == 0) return "AND";
-    if (strcasecmp(lexeme, "or") == 0) return "OR";
-    if (strcasecmp(lexeme, "not") == 0) return "NOT";
-    if (strcasecmp(lexeme, "asc") == 0) return "ASC";
-    if (strcasecmp(lexeme, "desc") == 0) return "DESC";
+// Keyword comparisons are case-insensitive (operators contain no letters)
+const LexemeKeyword lexeme_keywords[LEXEME_KEYWORD_COUNT] = {
+    { "bind", 4, LT_BIND },
+    { "set", 3, LT_SET },
+    { "def", 3, LT_DEF },
+    { "yield", 5, LT_YIELD },
+    { "when", 4, LT_WHEN },
+    { "otherwise", 9, LT_OTHERWISE },
+    { "each", 4, LT_EACH },
+    { "in", 2, LT_IN },
+    { "do", 2, LT_DO },
+    { "end", 3, LT_END },
+    { "and", 3, LT_AND },
+    { "or", 2, LT_OR },
+    { "not", 3, LT_NOT },
+    { "asc", 3, LT_ASC },
+    { "desc", 4, LT_DESC },
+    { "lparen", 6, LT_LPAREN },
+    { "rparen", 6, LT_RPAREN },
+    { "lbracket", 8, LT_LBRACKET },
+    { "rbracket", 8, LT_RBRACKET },
+    { "colon", 5, LT_ASSIGN },
+    { "arrow", 5, LT_LAMBDA },
+    { "plus", 4, LT_PLUS },
+    { "minus", 5, LT_MINUS },
+    { "mul", 3, LT_MUL },
+    { "div", 3, LT_DIV },
+    { "percent", 7, LT_MOD },
+    { "comma", 5, LT_COMMA },
+    { "apply", 5, LT_APPLY },
+    { "keep", 4, LT_KEEP },
+    { "order", 5, LT_ORDER },
+    { "dedupe", 6, LT_DEDUPE },
+    { "take", 4, LT_TAKE },
+    { "skip", 4, LT_SKIP },
+    { "concat", 6, LT_CONCAT },
+    { "joinstr", 7, LT_JOINSTR },
+    { "total", 5, LT_TOTAL },
+    { "count", 5, LT_COUNT },
+    { "avg", 3, LT_AVG },
+    { "true", 4, LT_BOOL_LIT },
+    { "false", 5, LT_BOOL_LIT },
+    { "none", 4, LT_NONE },
+    { ":=", 2, LT_ASSIGN },
+    { "->", 2, LT_LAMBDA },
+    { "|>", 2, LT_PIPELINE },
+    { "**", 2, LT_POW },
+    { ">=", 2, LT_GE },
+    { "<=", 2, LT_LE },
+    { "==", 2, LT_EQ },
+    { "!=", 2, LT_NE },
+    { "..<", 3, LT_RANGE_DOT_LT },
+    { "..", 2, LT_RANGE_DOT },
+    { "+", 1, LT_PLUS },
+    { "-", 1, LT_MINUS },
+    { "*", 1, LT_MUL },
+    { "/", 1, LT_DIV },
+    { "%", 1, LT_MOD },
+    { "<", 1, LT_LT },
+    { ">", 1, LT_GT },
+    { "=", 1, LT_UPDATE },
+    { "(", 1, LT_LPAREN },
+    { ")", 1, LT_RPAREN },
+    { "[", 1, LT_LBRACKET },
+    { "]", 1, LT_RBRACKET },
+    { ",", 1, LT_COMMA },
+    { "\r\n", 2, LT_NL },
+    { "nl", 2, LT_NL },
+    { "\n", 1, LT_NL },
+};
 
-    // Accept common token-label synonyms produced by some lexers (e.g., 'lparen','colon')
-    if (strcasecmp(lexeme, "lparen") == 0) return "LPAREN";
-    if (strcasecmp(lexeme, "rparen") == 0) return "RPAREN";
-    if (strcasecmp(lexeme, "lbracket") == 0) return "LBRACKET";
-    if (strcasecmp(lexeme, "rbracket") == 0) return "RBRACKET";
-    if (strcasecmp(lexeme, "colon") == 0) return "ASSIGN"; /* 'colon' often represents ':=' */
-    if (strcasecmp(lexeme, "arrow") == 0) return "LAMBDA"; /* 'arrow' -> '->' */
-    if (strcasecmp(lexeme, "plus") == 0) return "PLUS";
-    if (strcasecmp(lexeme, "minus") == 0) return "MINUS";
-    if (strcasecmp(lexeme, "mul") == 0) return "MUL";
-    if (strcasecmp(lexeme, "div") == 0) return "DIV";
-    if (strcasecmp(lexeme, "percent") == 0) return "MOD";
-    if (strcasecmp(lexeme, "comma") == 0) return "COMMA";
-    
-    // Stage keywords
-    if (strcasecmp(lexeme, "apply") == 0) return "APPLY";
-    if (strcasecmp(lexeme, "keep") == 0) return "KEEP";
-    if (strcasecmp(lexeme, "order") == 0) return "ORDER";
-    if (strcasecmp(lexeme, "dedupe") == 0) return "DEDUPE";
-    if (strcasecmp(lexeme, "take") == 0) return "TAKE";
-    if (strcasecmp(lexeme, "skip") == 0) return "SKIP";
-    if (strcasecmp(lexeme, "concat") == 0) return "CONCAT";
-    if (strcasecmp(lexeme, "joinstr") == 0) return "JOINSTR";
-    if (strcasecmp(lexeme, "total") == 0) return "TOTAL";
-    if (strcasecmp(lexeme, "count") == 0) return "COUNT";
-    if (strcasecmp(lexeme, "avg") == 0) return "AVG";
-    
-    // Literals
-    if (strcasecmp(lexeme, "true") == 0) return "BOOL_LIT";
-    if (strcasecmp(lexeme, "false") == 0) return "BOOL_LIT";
-    if (strcasecmp(lexeme, "none") == 0) return "NONE";
-    
-    // Operators (exact match)
-    if (strcmp(lexeme, ":=") == 0) return "ASSIGN";
-    if (strcmp(lexeme, "->") == 0) return "LAMBDA";
-    if (strcmp(lexeme, "|>") == 0) return "PIPELINE";
-    if (strcmp(lexeme, "**") == 0) return "POW";
-    if (strcmp(lexeme, ">=") == 0) return "GE";
-    if (strcmp(lexeme, "<=") == 0) return "LE";
-    if (strcmp(lexeme, "==") == 0) return "EQ";
-    if (strcmp(lexeme, "!=") == 0) return "NE";
-    if (strcmp(lexeme, "..<") == 0) return "RANGE_DOT_LT";
-    if (strcmp(lexeme, "..") == 0) return "RANGE_DOT";
-    if (strcmp(lexeme, "+") == 0) return "PLUS";
-    if (strcmp(lexeme, "-") == 0) return "MINUS";
-    if (strcmp(lexeme, "*") == 0) return "MUL";
-    if (strcmp(lexeme, "/") == 0) return "DIV";
-    if (strcmp(lexeme, "%") == 0) return "MOD";
-    if (strcmp(lexeme, "<") == 0) return "LT";
-    if (strcmp(lexeme, ">") == 0) return "GT";
-    if (strcmp(lexeme, "=") == 0) return "UPDATE";
-    
-    // Separators
-    if (strcmp(lexeme, "(") == 0) return "LPAREN";
-    if (strcmp(lexeme, ")") == 0) return "RPAREN";
-    if (strcmp(lexeme, "[") == 0) return "LBRACKET";
-    if (strcmp(lexeme, "]") == 0) return "RBRACKET";
-    if (strcmp(lexeme, ",") == 0) return "COMMA";
-    
-    // Newline
-    if (strcmp(lexeme, "\n") == 0 || strcmp(lexeme, "\r\n") == 0) return "NL";
-    // Also accept the literal token name "NL" (used by PIF generator)
-    if (strcasecmp(lexeme, "NL") == 0) return "NL";
-    
-    // String literals (quoted)
-    if (lexeme[0] == '"' && lexeme[strlen(lexeme)-1] == '"') return "STRING";
-    
-    // Number literals (check if it's a number)
-    int is_number = 1;
-    int has_dot = 0;
-    for (int i = 0; lexeme[i]; i++) {
-        if (lexeme[i] == '.') {
-            if (has_dot) { is_number = 0; break; }
-            has_dot = 1;
-        } else if (!isdigit((unsigned char)lexeme[i])) {
-            is_number = 0;
-            break;
-        }
-    }
-    if (is_number && strlen(lexeme) > 0) return "NUMBER";
+// Slot -> index into lexeme_keywords (255 = empty), generated for the multipliers above
+static const unsigned char keyword_slots[LEXEME_HASH_SIZE] = {
+     17, 255, 255, 255, 255,  28, 255, 255, 255, 255, 255, 255, 255, 255,  60, 255,
+      9, 255,  62, 255, 255, 255, 255, 255,  27,  25, 255, 255, 255, 255,  18,  12,
+    255, 255,  52, 255,   1, 255, 255, 255,  65, 255, 255, 255, 255,  56, 255, 255,
+    255, 255, 255, 255, 255, 255,  23, 255, 255,  32,  30,  39, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  35,
+     26, 255, 255,  53,  44, 255, 255, 255, 255, 255, 255, 255, 255,  24, 255, 255,
+    255, 255, 255,  42,  41, 255, 255, 255,  50, 255, 255, 255,   3, 255,  46, 255,
+    255, 255,  58,  47, 255,   2,  19, 255,  45, 255, 255, 255, 255, 255,  40, 255,
+     31, 255, 255, 255, 255, 255, 255, 255,  61, 255, 255, 255, 255, 255, 255,   7,
+    255, 255,   5,  34, 255, 255, 255, 255,  51, 255, 255, 255, 255, 255, 255, 255,
+     20, 255,  38, 255, 255, 255,  15, 255, 255, 255, 255, 255,  54,  11, 255, 255,
+     29, 255, 255,  66, 255, 255,   8,  57, 255, 255, 255, 255,  14, 255, 255, 255,
+    255, 255, 255,  64,  16, 255,  37, 255,  13,  59, 255,   4, 255,  49, 255, 255,
+    255, 255,  22, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  63, 255, 255,
+    255, 255, 255, 255, 255, 255,  21,  48, 255, 255,  36,  33, 255, 255,  43,   6,
+    255, 255, 255, 255, 255, 255, 255, 255,   0, 255,  55, 255,  10, 255, 255, 255,
+};
 
-    // Range literal format: digits..digits (merged by PIF generator)
-    if (strstr(lexeme, "..") != NULL) {
-        int ok = 1; // ensure both sides are numbers
-        char *s = malloc(strlen(lexeme) + 1);
-        strcpy(s, lexeme);
-        char *dot = strstr(s, "..");
-        if (!dot) { free(s); }
-        else {
-            *dot = '\0';
-            char *left = s;
-            char *right = dot + 2;
-            // validate left
-            for (int i = 0; left[i]; i++) if (!isdigit((unsigned char)left[i]) && left[i] != '.') ok = 0;
-            for (int i = 0; right[i]; i++) if (!isdigit((unsigned char)right[i]) && right[i] != '.') ok = 0;
-            free(s);
-            if (ok) return "RANGE";
-        }
+static inline unsigned char fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : (unsigned char)c;
+}
+
+static inline int is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static inline int is_word_char(char c) {
+    return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+int lexeme_terminal_id(const char *lexeme, size_t len) {
+    if (len == 0) return -1;
+
+    // Keywords and operators
+    unsigned char c0 = fold(lexeme[0]);
+    unsigned char c1 = len > 1 ? fold(lexeme[1]) : c0;
+    unsigned char cl = fold(lexeme[len - 1]);
+    unsigned char slot = keyword_slots[LEXEME_HASH(c0, c1, cl, len, LEXEME_HASH_A, LEXEME_HASH_B, LEXEME_HASH_C)];
+    if (slot != 255 && lexeme_keywords[slot].len == len) {
+        const char *key = lexeme_keywords[slot].key;
+        size_t i = 0;
+        while (i < len && fold(lexeme[i]) == (unsigned char)key[i]) i++;
+        if (i == len) return lexeme_keywords[slot].terminal;
     }
-    
-    // Identifiers (everything else that's alphanumeric/underscore)
-    int is_identifier = 1;
-    for (int i = 0; lexeme[i]; i++) {
-        if (!isalnum((unsigned char)lexeme[i]) && lexeme[i] != '_') {
-            is_identifier = 0;
-            break;
+
+    // String literals (quoted)
+    if (c0 == '"' && cl == '"') return LT_STRING;
+
+    // Numbers (digits with at most one dot), ranges (digits and dots containing ".."),
+    // identifiers (alphanumeric/underscore, UTF-8 letters)
+    int dots = 0, adjacent_dots = 0, digits_only = 1, word = 1;
+    for (size_t i = 0; i < len; i++) {
+        char c = lexeme[i];
+        if (c == '.') {
+            dots++;
+            if (i > 0 && lexeme[i - 1] == '.') adjacent_dots = 1;
+            word = 0;
+        } else if ((unsigned char)c >= 0x80) {
+            // A UTF-8 letter, which the scanner keeps in identifiers, if well formed
+            size_t n = simd_utf8_sequence(lexeme + i, lexeme + len);
+            digits_only = 0;
+            if (n == 0) word = 0;
+            else i += n - 1;
+        } else if (!is_digit(c)) {
+            digits_only = 0;
+            if (!is_word_char(c)) word = 0;
         }
     }
-    if (is_identifier && strlen(lexeme) > 0) {
-        // Check if it's not a keyword (already checked above)
-        return "IDENTIFIER";
-    }
-    
+    if (digits_only && dots <= 1) return LT_NUMBER;
+    if (digits_only && adjacent_dots) return LT_RANGE;
+    if (word) return LT_IDENTIFIER;
+
     // Unknown token
-    return NULL;
+    return -1;
 }
 
-// Note: lexer_get_pif would need to be implemented in the lexer file itself
-// since PIF is static. For now, we'll use dump_pif output or add export function to lexer.
-
+// Map lexeme (lowercase string) to terminal name (uppercase)
+const char *lexeme_to_terminal(const char *lexeme) {
+    if (!lexeme) return NULL;
+    int id = lexeme_terminal_id(lexeme, strlen(lexeme));
+    return id < 0 ? NULL : lexeme_terminal_names[id];
+}
@@ -4,11 +4,72 @@
 #ifndef LEXER_PIF_EXPORT_H
 #define LEXER_PIF_EXPORT_H
 
+#include <stddef.h>
 #include "pif_reader.h"  // Use PIFEntry from here
+#include "num_literal.h"
+
+// Terminal ids returned by lexeme_terminal_id; lexeme_terminal_names[id] is the grammar name
+typedef enum {
+    LT_BIND, LT_SET, LT_DEF, LT_YIELD, LT_WHEN, LT_OTHERWISE, LT_EACH, LT_IN, LT_DO,
+    LT_END, LT_AND, LT_OR, LT_NOT, LT_ASC, LT_DESC, LT_LPAREN, LT_RPAREN, LT_LBRACKET,
+    LT_RBRACKET, LT_ASSIGN, LT_LAMBDA, LT_PLUS, LT_MINUS, LT_MUL, LT_DIV, LT_MOD, LT_COMMA,
+    LT_APPLY, LT_KEEP, LT_ORDER, LT_DEDUPE, LT_TAKE, LT_SKIP, LT_CONCAT, LT_JOINSTR,
+    LT_TOTAL, LT_COUNT, LT_AVG, LT_BOOL_LIT, LT_NONE, LT_PIPELINE, LT_POW, LT_GE, LT_LE,
+    LT_EQ, LT_NE, LT_RANGE_DOT_LT, LT_RANGE_DOT, LT_LT, LT_GT, LT_UPDATE, LT_NL, LT_STRING,
+    LT_NUMBER, LT_RANGE, LT_IDENTIFIER,
+    LT_NUM_TERMINALS
+} LexemeTerminal;
+
+extern const char *const lexeme_terminal_names[LT_NUM_TERMINALS];
+
+// Keywords, operators and token-label synonyms, stored lowercase
+typedef struct {
+    const char *key;
+    unsigned char len;
+    unsigned char terminal;     // LexemeTerminal
+} LexemeKeyword;
+
+#define LEXEME_KEYWORD_COUNT 67
+extern const LexemeKeyword lexeme_keywords[LEXEME_KEYWORD_COUNT];
+
+// Perfect hash of a keyword from its lowercase first, second (or first) and last
+// characters and its length. The multipliers were found by classifier_bench --generate.
+#define LEXEME_HASH_SIZE 256
+#define LEXEME_HASH_A 5
+#define LEXEME_HASH_B 2
+#define LEXEME_HASH_C 62
+#define LEXEME_HASH(c0, c1, cl, len, a, b, c) \
+    (((unsigned)(c0) * (a) + (unsigned)(c1) * (b) + (unsigned)(cl) * (c) + (unsigned)(len)) & (LEXEME_HASH_SIZE - 1))
+
+// Classify a lexeme of len bytes (no NUL needed): keyword/operator lookup through the
+// perfect hash, then string, number, range and identifier shapes. Returns -1 if unknown.
+int lexeme_terminal_id(const char *lexeme, size_t len);
 
 // Map lexeme to terminal name (for grammar terminals)
 // Returns terminal name or NULL if not found
 const char *lexeme_to_terminal(const char *lexeme);
 
-#endif // LEXER_PIF_EXPORT_H
+// Exported by the flex lexer (flowcalc.l / lex.yy.c); only programs linking it may call these
 
+// Receives every PIF entry instead of the lexer's buffer while installed
+typedef void (*PifSink)(const char *lexeme, int bucket, int pos, void *ctx);
+void set_pif_sink(PifSink sink, void *ctx);
+
+// Table that receives the NUMBER values, by the index of init_lexer's symbol
+// table; call after init_lexer, which clears it. NULL stops the parsing.
+void lexer_set_num_table(NumTable *nums);
+
+// Hand the lexer's PIF buffer to the caller (free with free_pif_entries); the
+// lexer starts a new one. The entries are this header's PIFEntry, so the parser
+// can use them as they are.
+PIFEntry *lexer_take_pif(int *count);
+
+// Scan size bytes at base instead of yyin. base[size] and base[size+1] must be
+// NUL and the buffer writable, since flex terminates yytext in place (see source_map.h).
+int lexer_scan_buffer(char *base, size_t size);
+void lexer_end_scan(void);
+
+// Lexical errors reported since init_lexer
+int lexer_error_count(void);
+
+#endif // LEXER_PIF_EXPORT_H
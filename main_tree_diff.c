@@ -0,0 +1,133 @@
+// main_tree_diff.c
+// Statement-level structural diff of two PIF files parsed with the same grammar
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "first_follow.h"
+#include "parse_table.h"
+#include "pif_reader.h"
+#include "compiled_grammar.h"
+#include "lazy_tree.h"
+#include "tree_dag.h"
+#include "tree_diff.h"
+
+// Parse one PIF into a hash-consed DAG; returns 0 on success
+static int parse_to_dag(const CompiledGrammar *cg, const char *pif_file,
+                        PIFEntry **entries, int *count, TreeDag *dag) {
+    printf("Reading PIF from %s...\n", pif_file);
+    if (read_pif_from_file(pif_file, entries, count) < 0 || *count == 0) {
+        fprintf(stderr, "Error: Failed to read PIF file '%s'\n", pif_file);
+        return -1;
+    }
+
+    LazyTree lt;
+    if (lazy_tree_parse(&lt, cg, *entries, *count, "stmt") != PARSE_ACCEPT) {
+        fprintf(stderr, "Parse of %s failed. Error: %s\n", pif_file,
+                lt.error_location ? lt.error_location : "unknown");
+        lazy_tree_free(&lt);
+        return -1;
+    }
+    tree_dag_build(dag, &lt);
+    lazy_tree_free(&lt);
+    printf("Parsed %s: %d entries, %d unique nodes\n", pif_file, *count, dag->node_count);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <grammar_file> <old_pif> <new_pif> [output_file]\n", argv[0]);
+        fprintf(stderr, "  Reports inserted, deleted and changed statements between two parses\n");
+        return 1;
+    }
+    const char *grammar_file = argv[1];
+    const char *output_file = argc > 4 ? argv[4] : NULL;
+
+    // Load grammar and build the parse table
+    StrList nonterms, terms;
+    ProdList prods;
+    sl_init(&nonterms);
+    sl_init(&terms);
+    pl_init(&prods);
+
+    printf("Loading grammar from %s...\n", grammar_file);
+    load_grammar(grammar_file, &nonterms, &terms, &prods);
+    if (nonterms.count == 0 || terms.count == 0 || prods.count == 0) {
+        fprintf(stderr, "Error: Failed to load grammar\n");
+        return 1;
+    }
+    if (sl_index(&terms, "$") == -1) {
+        sl_add(&terms, "$");
+    }
+
+    FirstTable first;
+    first.sets = malloc(sizeof(StrList) * nonterms.count);
+    for (int i = 0; i < nonterms.count; i++) {
+        sl_init(&first.sets[i]);
+    }
+    compute_first(&nonterms, &terms, &prods, &first);
+
+    FollowTable follow;
+    follow.sets = malloc(sizeof(StrList) * nonterms.count);
+    for (int i = 0; i < nonterms.count; i++) {
+        sl_init(&follow.sets[i]);
+    }
+    compute_follow(&nonterms, &terms, &prods, &first, &follow);
+
+    int **table = build_parse_table(&nonterms, &terms, &prods, &first, &follow);
+    if (!table) {
+        fprintf(stderr, "Error: Failed to build parse table\n");
+        return 1;
+    }
+
+    CompiledGrammar cg;
+    if (cg_init(&cg, table, &nonterms, &terms, &prods) != 0) {
+        fprintf(stderr, "Error: Failed to compile grammar\n");
+        return 1;
+    }
+
+    PIFEntry *old_entries = NULL, *new_entries = NULL;
+    int old_count = 0, new_count = 0;
+    TreeDag old_dag, new_dag;
+    memset(&old_dag, 0, sizeof(old_dag));
+    memset(&new_dag, 0, sizeof(new_dag));
+    int status = 2;
+
+    if (parse_to_dag(&cg, argv[2], &old_entries, &old_count, &old_dag) == 0 &&
+        parse_to_dag(&cg, argv[3], &new_entries, &new_count, &new_dag) == 0) {
+        TreeDiff diff;
+        if (tree_diff(&diff, &old_dag, &new_dag, "stmt") != 0) {
+            fprintf(stderr, "Error: grammar has no 'stmt' symbol\n");
+        } else {
+            FILE *out = stdout;
+            if (output_file) {
+                out = fopen(output_file, "w");
+                if (!out) {
+                    fprintf(stderr, "Error: Failed to open output file %s\n", output_file);
+                    out = stdout;
+                }
+            }
+            tree_diff_print(&diff, old_entries, new_entries, out);
+            if (out != stdout) {
+                fclose(out);
+                printf("Diff written to %s\n", output_file);
+            }
+            // Exit status follows diff(1): 0 identical, 1 different, 2 trouble
+            status = diff.count > 0 ? 1 : 0;
+            tree_diff_free(&diff);
+        }
+    }
+
+    // Cleanup
+    tree_dag_free(&old_dag);
+    tree_dag_free(&new_dag);
+    free_pif_entries(old_entries, old_count);
+    free_pif_entries(new_entries, new_count);
+    cg_free(&cg);
+    for (int i = 0; i < nonterms.count + terms.count; i++) {
+        free(table[i]);
+    }
+    free(table);
+
+    return status;
+}
@@ -5,19 +5,268 @@
 #include "parse_table.h"
 #include "parser_tree.h"
 #include "pif_reader.h"
+#include "compiled_grammar.h"
+#include "lazy_tree.h"
+#include "tree_index.h"
+#include "incremental_parser.h"
+#include "tree_dag.h"
+#include "source_parser.h"
+#include "stmt_index.h"
+
+// Read a whole file into memory; returns NULL on error
+static char *read_text_file(const char *filename, size_t *len) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)size, f) != (size_t)size) {
+        free(text);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    text[size] = '\0';
+    *len = (size_t)size;
+    return text;
+}
+
+// Answer --query SYMBOL or --query ANCESTOR/SYMBOL using the node index
+static void run_index_query(ParseTreeNode *root, int **table, StrList *nonterms, StrList *terms,
+                            ProdList *prods, const char *query, FILE *out) {
+    CompiledGrammar cg;
+    if (cg_init(&cg, table, nonterms, terms, prods) != 0) return;
+    TreeIndex idx;
+    if (tree_index_build(&idx, root, &cg) != 0) {
+        cg_free(&cg);
+        return;
+    }
+    
+    char buf[256];
+    strncpy(buf, query, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    char *slash = strchr(buf, '/');
+    const char *symbol = buf;
+    const char *ancestor = NULL;
+    if (slash) {
+        *slash = '\0';
+        ancestor = buf;
+        symbol = slash + 1;
+    }
+    
+    int sym = cg_symbol_id(&cg, symbol);
+    int anc = ancestor ? cg_symbol_id(&cg, ancestor) : -1;
+    if (sym < 0 || (ancestor && anc < 0)) {
+        fprintf(out, "\nQuery %s: unknown symbol\n", query);
+    } else {
+        int count = 0;
+        const int *ids = NULL;
+        int *nested = NULL;
+        if (ancestor) {
+            count = tree_index_find_nested(&idx, sym, anc, NULL, 0);
+            nested = malloc(sizeof(int) * (count > 0 ? count : 1));
+            tree_index_find_nested(&idx, sym, anc, nested, count);
+            ids = nested;
+        } else {
+            ids = tree_index_symbol(&idx, sym, &count);
+        }
+        fprintf(out, "\nQuery %s: %d node(s)\n", query, count);
+        for (int i = 0; i < count; i++) {
+            fprintf(out, "%d%s", ids[i], (i + 1 < count) ? " " : "\n");
+        }
+        free(nested);
+    }
+    
+    tree_index_free(&idx);
+    cg_free(&cg);
+}
+
+// Parse top-level statements first..last of a text PIF from `stmt`, reading only
+// their bytes through the statement index (built next to the PIF when missing or stale)
+static int run_statement_range(int **table, StrList *nonterms, StrList *terms, ProdList *prods,
+                               const char *pif_file, const char *index_file, const char *spec,
+                               const char *output_file) {
+    char *end;
+    unsigned long first = strtoul(spec, &end, 10);
+    unsigned long last = first;
+    if (end != spec && *end == '-') last = strtoul(end + 1, &end, 10);
+    if (end == spec || *end != '\0' || last < first || last > 0xFFFFFFFFul) {
+        fprintf(stderr, "Error: --stmt expects K or K-M, got '%s'\n", spec);
+        return 1;
+    }
+
+    char *default_path = index_file ? NULL : stmt_index_path(pif_file);
+    const char *path = index_file ? index_file : default_path;
+    StmtIndex idx;
+    if (stmt_index_open(&idx, path, pif_file) != 0) {
+        printf("Indexing statements of %s into %s...\n", pif_file, path);
+        if (stmt_index_build(pif_file, path) < 0 || stmt_index_open(&idx, path, pif_file) != 0) {
+            fprintf(stderr, "Error: Failed to build statement index %s%s\n", path,
+                    index_file ? "" : " (use --index to write it elsewhere)");
+            free(default_path);
+            return 1;
+        }
+    }
+    printf("Statement index: %u statements, %llu entries\n",
+           (unsigned)idx.stmt_count, (unsigned long long)idx.token_count);
+    free(default_path);
+
+    StmtRange r_first, r_last;
+    if (stmt_index_get(&idx, (uint32_t)first, &r_first) != 0 ||
+        stmt_index_get(&idx, (uint32_t)last, &r_last) != 0) {
+        fprintf(stderr, "Error: statement %lu is out of range\n", last);
+        stmt_index_close(&idx);
+        return 1;
+    }
+
+    // Only the bytes of the requested statements are read
+    PIFMap tokens;
+    if (stmt_index_read(pif_file, r_first.offset, r_last.offset + r_last.length - r_first.offset, &tokens) < 0) {
+        fprintf(stderr, "Error: Failed to read statements from '%s'\n", pif_file);
+        stmt_index_close(&idx);
+        return 1;
+    }
+    PIFEntry *entries = NULL;
+    int count = 0;
+    pif_map_to_entries(&tokens, &entries, &count);
+    pif_map_close(&tokens);
+
+    CompiledGrammar cg;
+    if (cg_init(&cg, table, nonterms, terms, prods) != 0) {
+        fprintf(stderr, "Error: Failed to compile grammar\n");
+        stmt_index_close(&idx);
+        free_pif_entries(entries, count);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (output_file) {
+        out = fopen(output_file, "w");
+        if (!out) {
+            fprintf(stderr, "Error: Failed to open output file %s\n", output_file);
+            out = stdout;
+        }
+    }
+
+    int status = 0;
+    for (unsigned long k = first; k <= last; k++) {
+        StmtRange r;
+        stmt_index_get(&idx, (uint32_t)k, &r);
+        uint64_t begin = r.first_token - r_first.first_token;
+        if (begin + r.token_count > (uint64_t)count) {
+            fprintf(stderr, "Error: statement index %s does not match '%s'\n", path, pif_file);
+            status = 1;
+            break;
+        }
+        fprintf(out, "Statement %lu (entries %llu-%llu, byte offset %llu)\n", k,
+                (unsigned long long)r.first_token,
+                (unsigned long long)(r.first_token + r.token_count - 1),
+                (unsigned long long)r.offset);
+
+        LazyTree lt;
+        ParseResult result = lazy_tree_parse_from(&lt, &cg, "stmt", entries + begin,
+                                                  (int)r.token_count, NULL);
+        if (result == PARSE_ACCEPT) {
+            fprintf(out, "Sequence accepted\n\n");
+            fprintf(out, "Parse Tree (Father/Sibling Relations):\n");
+            fprintf(out, "========================================\n\n");
+            ParseTreeNode *tree = lazy_tree_materialize(&lt, 0);
+            if (tree) {
+                tree_print_table(tree, out);
+                tree_node_free(tree);
+            } else {
+                fprintf(out, "Error: Parse tree is NULL\n");
+            }
+        } else {
+            const char *error = lt.error_location ? lt.error_location : "unknown location";
+            fprintf(out, "Sequence not accepted\n");
+            fprintf(out, "Syntax error at: %s\n", error);
+            fprintf(stderr, "Parse of statement %lu failed. Error: %s\n", k, error);
+            status = 1;
+        }
+        fprintf(out, "\n");
+        lazy_tree_free(&lt);
+    }
+
+    if (out != stdout) {
+        fclose(out);
+        printf("Parse tree tables written to %s\n", output_file);
+    }
+    stmt_index_close(&idx);
+    cg_free(&cg);
+    free_pif_entries(entries, count);
+    return status;
+}
 
 int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        fprintf(stderr, "Usage: %s <grammar_file> <pif_file> [output_file]\n", argv[0]);
+    // Split options from positional arguments
+    const char *positional[3] = { NULL, NULL, NULL };
+    int npos = 0;
+    int lazy = 0;
+    int hashcons = 0;
+    int source = 0;
+    int values = 0;
+    const char *query = NULL;
+    const char *reparse_file = NULL;
+    const char *stmt_spec = NULL;
+    const char *index_file = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lazy") == 0) {
+            lazy = 1;
+        } else if (strcmp(argv[i], "--hashcons") == 0) {
+            hashcons = 1;
+        } else if (strcmp(argv[i], "--source") == 0) {
+            source = 1;
+        } else if (strcmp(argv[i], "--values") == 0) {
+            values = 1;
+        } else if (strcmp(argv[i], "--query") == 0 && i + 1 < argc) {
+            query = argv[++i];
+        } else if (strcmp(argv[i], "--reparse") == 0 && i + 1 < argc) {
+            reparse_file = argv[++i];
+        } else if (strcmp(argv[i], "--stmt") == 0 && i + 1 < argc) {
+            stmt_spec = argv[++i];
+        } else if (strcmp(argv[i], "--index") == 0 && i + 1 < argc) {
+            index_file = argv[++i];
+        } else if (npos < 3) {
+            positional[npos++] = argv[i];
+        }
+    }
+    
+    if (npos < 2) {
+        fprintf(stderr, "Usage: %s [--lazy | --hashcons] [--source [--values]] [--query SYMBOL|ANCESTOR/SYMBOL] [--reparse edited_pif] [--stmt K[-M] [--index index_file]] <grammar_file> <pif_file> [output_file]\n", argv[0]);
         fprintf(stderr, "  grammar_file: LL(1) grammar file\n");
         fprintf(stderr, "  pif_file: PIF (Program Internal Form) file\n");
         fprintf(stderr, "  output_file: (optional) output file for parse tree table\n");
+        fprintf(stderr, "  --lazy: record only the derivation and materialize the tree on demand\n");
+        fprintf(stderr, "  --hashcons: share identical subtrees (DAG) and export the expanded table (no --query or --reparse)\n");
+        fprintf(stderr, "  --source: pif_file is FlowCalc source text, tokenized while parsing\n");
+        fprintf(stderr, "  --values: with --source, add a Value column with the parsed value of each number and range\n");
+        fprintf(stderr, "  --query: list node indices for a symbol (optionally under an ancestor symbol)\n");
+        fprintf(stderr, "  --reparse: incrementally reparse an edited version of the PIF and print its tree\n");
+        fprintf(stderr, "  --stmt: parse only top-level statement K (or K to M, from 0) of a text PIF, from stmt,\n");
+        fprintf(stderr, "          seeking through the statement index. The index is written next to the PIF as\n");
+        fprintf(stderr, "          pif_file.idx unless --index is given, and rebuilt when the PIF changes\n");
+        return 1;
+    }
+    
+    if (stmt_spec && source) {
+        fprintf(stderr, "Error: --stmt reads a text PIF and cannot be combined with --source\n");
+        return 1;
+    }
+    if (hashcons && (reparse_file || query)) {
+        fprintf(stderr, "Error: --hashcons builds no tree to %s and cannot be combined with %s\n",
+                reparse_file ? "reuse" : "query", reparse_file ? "--reparse" : "--query");
+        return 1;
+    }
+    if (values && (!source || hashcons || reparse_file)) {
+        fprintf(stderr, "Error: --values prints the values parsed by --source and cannot be combined with --hashcons or --reparse\n");
         return 1;
     }
     
-    const char *grammar_file = argv[1];
-    const char *pif_file = argv[2];
-    const char *output_file = (argc >= 4) ? argv[3] : NULL;
+    const char *grammar_file = positional[0];
+    const char *pif_file = positional[1];
+    const char *output_file = positional[2];
     
     // Load grammar
     StrList nonterms, terms;
@@ -66,12 +315,68 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    // Read PIF
-    printf("Reading PIF from %s...\n", pif_file);
+    if (stmt_spec) {
+        int status = run_statement_range(table, &nonterms, &terms, &prods, pif_file,
+                                         index_file, stmt_spec, output_file);
+        for (int i = 0; i < nonterms.count + terms.count; i++) {
+            free(table[i]);
+        }
+        free(table);
+        for (int i = 0; i < nonterms.count; i++) {
+            sl_free(&first.sets[i]);
+            sl_free(&follow.sets[i]);
+        }
+        free(first.sets);
+        free(follow.sets);
+        sl_free(&nonterms);
+        sl_free(&terms);
+        pl_free(&prods);
+        return status;
+    }
+    
     PIFEntry *pif_entries = NULL;
     int pif_count = 0;
+    ParseTreeOutput parse_output;
+    CompiledGrammar fast_cg;    // kept alive while the DAG refers to it
+    TreeDag dag;
+    memset(&dag, 0, sizeof(dag));
+    dag.root = -1;
+    LazyTree lt;
+    SymbolTable source_st;      // --source: the leaves' locations and values
+    NumTable nums;
+    num_table_init(&nums);
     
-    int result = read_pif_from_file(pif_file, &pif_entries, &pif_count);
+    if (source) {
+        // Tokenize and parse in one pass; PIF entries are only expanded for output
+        printf("Tokenizing and parsing %s...\n", pif_file);
+        size_t text_len = 0;
+        char *text = read_text_file(pif_file, &text_len);
+        if (!text) {
+            fprintf(stderr, "Error: Failed to read source file '%s'\n", pif_file);
+            return 1;
+        }
+        if (cg_init(&fast_cg, table, &nonterms, &terms, &prods) != 0) {
+            fprintf(stderr, "Error: Failed to compile grammar\n");
+            return 1;
+        }
+        PIFMap tokens;
+        st_init(&source_st, 16);    // the generator's capacity, for the same locations
+        parse_output.result = parse_source(text, text_len, &fast_cg, &source_st, values ? &nums : NULL,
+                                           "stmt", &lt, &tokens);
+        source_tokens_to_entries(&tokens, &pif_entries, &pif_count);
+        pif_map_close(&tokens);
+        free(text);
+        lt.pif_entries = pif_entries;
+        lt.pif_count = pif_count;
+        printf("Source tokenized: %d entries\n", pif_count);
+    }
+    
+    // Read PIF
+    int result = 0;
+    if (!source) {
+        printf("Reading PIF from %s...\n", pif_file);
+        result = read_pif_from_file(pif_file, &pif_entries, &pif_count);
+    }
     if (result < 0) {
         fprintf(stderr, "Error: Failed to read PIF file '%s'\n", pif_file);
         fprintf(stderr, "Make sure the file exists and is in the correct format.\n");
@@ -83,21 +388,80 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    if (pif_count == 0) {
+    if (pif_count == 0 && !source) {
         fprintf(stderr, "Warning: PIF file contains no entries\n");
         return 1;
     }
     
-    printf("PIF loaded: %d entries\n", pif_count);
+    if (!source) printf("PIF loaded: %d entries\n", pif_count);
     
     // Convert PIF to input string (for compatibility, though we'll use PIF directly)
     // Actually, we'll pass PIF entries directly to the parser
     const char *input = ""; // Not used, parser uses PIF directly
     
-    // Parse with tree building
-    printf("Parsing with tree building...\n");
-    ParseTreeOutput parse_output = ll1_parse_with_tree(input, table, &nonterms, &terms, &prods, 
-                                                        pif_entries, pif_count);
+    if (lazy || hashcons || source) {
+        // Record the derivation only, then materialize the tree from step 0
+        // (or intern it bottom-up into a DAG of shared subtrees)
+        if (!source) {
+            printf("Parsing with %s...\n", hashcons ? "hash-consed subtrees" : "lazy tree materialization");
+            if (cg_init(&fast_cg, table, &nonterms, &terms, &prods) != 0) {
+                fprintf(stderr, "Error: Failed to compile grammar\n");
+                return 1;
+            }
+            parse_output.result = lazy_tree_parse(&lt, &fast_cg, pif_entries, pif_count, "stmt");
+        }
+        parse_output.tree = NULL;
+        parse_output.error_location = NULL;
+        if (parse_output.result == PARSE_ACCEPT) {
+            printf("Derivation recorded: %d steps, %d statements, %zu bytes\n",
+                   lt.step_count, lt.stmt_count, lazy_tree_bytes(&lt));
+            if (hashcons) {
+                tree_dag_build(&dag, &lt);
+                printf("DAG: %d unique nodes for %d tree nodes\n",
+                       dag.node_count, dag.root >= 0 ? dag.nodes[dag.root].size : 0);
+            } else {
+                parse_output.tree = lazy_tree_materialize(&lt, 0);
+            }
+        } else if (lt.error_location) {
+            parse_output.error_location = malloc(strlen(lt.error_location) + 1);
+            strcpy(parse_output.error_location, lt.error_location);
+        }
+        lazy_tree_free(&lt);
+        if (!dag.cg) cg_free(&fast_cg);
+    } else {
+        // Parse with tree building
+        printf("Parsing with tree building...\n");
+        parse_output = ll1_parse_with_tree(input, table, &nonterms, &terms, &prods, 
+                                           pif_entries, pif_count);
+    }
+    
+    // Incremental reparse of an edited PIF, reusing the tree just built
+    PIFEntry *new_entries = NULL;
+    int new_count = 0;
+    if (reparse_file && parse_output.result == PARSE_ACCEPT) {
+        if (read_pif_from_file(reparse_file, &new_entries, &new_count) < 0) {
+            fprintf(stderr, "Error: Failed to read PIF file '%s'\n", reparse_file);
+            return 1;
+        }
+        CompiledGrammar cg;
+        if (cg_init(&cg, table, &nonterms, &terms, &prods) != 0) {
+            fprintf(stderr, "Error: Failed to compile grammar\n");
+            return 1;
+        }
+        PIFEdit edit = pif_diff_range(pif_entries, pif_count, new_entries, new_count);
+        printf("Reparsing %s: edit [%d,%d) -> [%d,%d)\n", reparse_file,
+               edit.start, edit.old_end, edit.start, edit.new_end);
+        IncrementalStats stats;
+        ParseTreeOutput reparsed = ll1_reparse_incremental(&cg, parse_output.tree,
+                                                           pif_entries, pif_count,
+                                                           new_entries, new_count, edit, &stats);
+        printf("Reused %d subtrees (%d tokens), parsed %d tokens with %d expansions\n",
+               stats.reused_subtrees, stats.reused_tokens, stats.tokens_parsed, stats.expansions);
+        parse_output.tree = NULL;
+        free_parse_tree_output(&parse_output);
+        parse_output = reparsed;
+        cg_free(&cg);
+    }
     
     // Open output file or use stdout
     FILE *out = stdout;
@@ -116,7 +480,16 @@ int main(int argc, char *argv[]) {
         fprintf(out, "========================================\n\n");
         
         if (parse_output.tree) {
-            tree_print_table(parse_output.tree, out);
+            if (values) {
+                tree_print_table_values(parse_output.tree, &nums, out);
+            } else {
+                tree_print_table(parse_output.tree, out);
+            }
+            if (query) {
+                run_index_query(parse_output.tree, table, &nonterms, &terms, &prods, query, out);
+            }
+        } else if (dag.root >= 0) {
+            tree_dag_print_table(&dag, out);
         } else {
             fprintf(out, "Error: Parse tree is NULL\n");
         }
@@ -138,7 +511,14 @@ int main(int argc, char *argv[]) {
     
     // Cleanup
     free_parse_tree_output(&parse_output);
+    if (dag.cg) {
+        tree_dag_free(&dag);
+        cg_free(&fast_cg);
+    }
     free_pif_entries(pif_entries, pif_count);
+    free_pif_entries(new_entries, new_count);
+    if (source) st_free(&source_st);
+    num_table_free(&nums);
     
     // Free parse table
     for (int i = 0; i < nonterms.count + terms.count; i++) {
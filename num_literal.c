@@ -0,0 +1,224 @@
+// num_literal.c
+// Numeric literal parsing and the per-index value table
+
+#include "num_literal.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_TABLE_MIN 64
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Digits past the int64 range and fractions go through strtod, which needs a
+// terminated copy; the lexeme itself may be a slice of a larger buffer
+static double to_double(const char *text, size_t len) {
+    char small[64];
+    char *buf = len < sizeof(small) ? small : malloc(len + 1);
+    if (!buf) return 0.0;
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    double d = strtod(buf, NULL);
+    if (buf != small) free(buf);
+    return d;
+}
+
+// DIGIT+ ('.' DIGIT+)?
+static int parse_number(const char *text, size_t len, NumValue *out) {
+    size_t i = 0;
+    uint64_t v = 0;
+    int overflow = 0;
+    while (i < len && is_digit(text[i])) {
+        unsigned d = (unsigned)(text[i] - '0');
+        if (v > (UINT64_C(0x7FFFFFFFFFFFFFFF) - d) / 10) overflow = 1;
+        v = v * 10 + d;
+        i++;
+    }
+    if (i == 0) return -1;
+    size_t int_len = i;
+    if (i < len) {
+        if (text[i] != '.') return -1;
+        i++;
+        if (i == len) return -1;
+        while (i < len && is_digit(text[i])) i++;
+        if (i != len) return -1;
+    }
+    if (int_len == len && !overflow) {
+        out->is_real = 0;
+        out->i = (int64_t)v;
+    } else {
+        out->is_real = 1;
+        out->d = to_double(text, len);
+    }
+    return 0;
+}
+
+int num_literal_parse(const char *text, size_t len, NumLiteral *out) {
+    memset(out, 0, sizeof(*out));
+    if (len == 0 || !is_digit(text[0])) return -1;
+    const char *dots = NULL;
+    for (size_t i = 0; i + 1 < len; i++) {
+        if (text[i] == '.' && text[i + 1] == '.') {
+            dots = text + i;
+            break;
+        }
+    }
+    if (dots) {
+        size_t lo_len = (size_t)(dots - text);
+        if (parse_number(text, lo_len, &out->value) != 0 ||
+            parse_number(dots + 2, len - lo_len - 2, &out->hi) != 0) {
+            memset(out, 0, sizeof(*out));
+            return -1;
+        }
+        out->kind = NUM_RANGE;
+        return 0;
+    }
+    if (parse_number(text, len, &out->value) != 0) {
+        memset(out, 0, sizeof(*out));
+        return -1;
+    }
+    out->kind = out->value.is_real ? NUM_REAL : NUM_INT;
+    return 0;
+}
+
+int num_literal_range(const NumLiteral *lo, const NumLiteral *hi, NumLiteral *out) {
+    memset(out, 0, sizeof(*out));
+    if ((lo->kind != NUM_INT && lo->kind != NUM_REAL) || (hi->kind != NUM_INT && hi->kind != NUM_REAL)) return -1;
+    out->kind = NUM_RANGE;
+    out->value = lo->value;
+    out->hi = hi->value;
+    return 0;
+}
+
+// Writes into a 32-byte buffer: an int64 or a %.17g double always fits
+static void format_value(const NumValue *v, char *buf) {
+    if (!v->is_real) {
+        snprintf(buf, 32, "%lld", (long long)v->i);
+        return;
+    }
+    for (int digits = 15; digits <= 17; digits++) {
+        snprintf(buf, 32, "%.*g", digits, v->d);
+        if (strtod(buf, NULL) == v->d) return;
+    }
+}
+
+int num_literal_format(const NumLiteral *v, char *buf, size_t size) {
+    char lo[32], hi[32];
+    if (v->kind == NUM_NONE) return snprintf(buf, size, "-");
+    format_value(&v->value, lo);
+    if (v->kind != NUM_RANGE) return snprintf(buf, size, "%s", lo);
+    format_value(&v->hi, hi);
+    return snprintf(buf, size, "%s..%s", lo, hi);
+}
+
+void num_table_init(NumTable *t) {
+    memset(t, 0, sizeof(*t));
+}
+
+void num_table_free(NumTable *t) {
+    free(t->values);
+    free(t->keys);
+    free(t->indices);
+    memset(t, 0, sizeof(*t));
+}
+
+// Locations are non-negative; the +1 keeps 0 free as the empty key
+static uint64_t location_key(int bucket, int pos) {
+    return ((uint64_t)(uint32_t)bucket << 32 | (uint32_t)pos) + 1;
+}
+
+static int key_slot(const NumTable *t, uint64_t key) {
+    uint64_t h = key * UINT64_C(0x9E3779B97F4A7C15);
+    int s = (int)(h >> 32) & (t->nslots - 1);
+    while (t->keys[s] != 0 && t->keys[s] != key) s = (s + 1) & (t->nslots - 1);
+    return s;
+}
+
+static int grow_keys(NumTable *t) {
+    int nslots = t->nslots ? t->nslots * 2 : NUM_TABLE_MIN * 2;
+    NumTable grown = *t;
+    grown.keys = calloc((size_t)nslots, sizeof(uint64_t));
+    grown.indices = malloc(sizeof(int) * (size_t)nslots);
+    if (!grown.keys || !grown.indices) {
+        free(grown.keys);
+        free(grown.indices);
+        return -1;
+    }
+    grown.nslots = nslots;
+    for (int i = 0; i < t->nslots; i++) {
+        if (t->keys[i] == 0) continue;
+        int s = key_slot(&grown, t->keys[i]);
+        grown.keys[s] = t->keys[i];
+        grown.indices[s] = t->indices[i];
+    }
+    free(t->keys);
+    free(t->indices);
+    *t = grown;
+    return 0;
+}
+
+static NumLiteral *value_slot(NumTable *t, int index) {
+    if (index < 0) return NULL;
+    if (index >= t->capacity) {
+        int capacity = t->capacity ? t->capacity : NUM_TABLE_MIN;
+        while (capacity <= index) {
+            if (capacity > INT_MAX / 2) return NULL;
+            capacity *= 2;
+        }
+        NumLiteral *grown = realloc(t->values, sizeof(NumLiteral) * (size_t)capacity);
+        if (!grown) return NULL;
+        memset(grown + t->capacity, 0, sizeof(NumLiteral) * (size_t)(capacity - t->capacity));
+        t->values = grown;
+        t->capacity = capacity;
+    }
+    return &t->values[index];
+}
+
+const NumLiteral *num_table_at(const NumTable *t, int index) {
+    if (index < 0 || index >= t->capacity || t->values[index].kind == NUM_NONE) return NULL;
+    return &t->values[index];
+}
+
+const NumLiteral *num_table_get(const NumTable *t, int bucket, int pos) {
+    if (bucket < 0 || pos < 0 || t->count == 0) return NULL;
+    int s = key_slot(t, location_key(bucket, pos));
+    return t->keys[s] ? num_table_at(t, t->indices[s]) : NULL;
+}
+
+// Records (bucket,pos) -> index once the value is in place; NULL if it cannot
+static const NumLiteral *add_location(NumTable *t, int index, int bucket, int pos) {
+    if (bucket < 0 || pos < 0) return NULL;
+    if ((t->count + 1) * 4 > t->nslots * 3 && grow_keys(t) != 0) return NULL;
+    uint64_t key = location_key(bucket, pos);
+    int s = key_slot(t, key);
+    if (t->keys[s] == 0) {
+        t->keys[s] = key;
+        t->count++;
+    }
+    t->indices[s] = index;
+    return &t->values[index];
+}
+
+const NumLiteral *num_table_put(NumTable *t, int index, int bucket, int pos, const char *lexeme, size_t len) {
+    const NumLiteral *have = num_table_at(t, index);
+    if (have) return have;
+    NumLiteral *v = value_slot(t, index);
+    if (!v || num_literal_parse(lexeme, len, v) != 0) return NULL;
+    const NumLiteral *stored = add_location(t, index, bucket, pos);
+    if (!stored) v->kind = NUM_NONE;
+    return stored;
+}
+
+const NumLiteral *num_table_set(NumTable *t, int index, int bucket, int pos, const NumLiteral *value) {
+    const NumLiteral *have = num_table_at(t, index);
+    if (have) return have;
+    NumLiteral *v = value_slot(t, index);
+    if (!v || value->kind == NUM_NONE) return NULL;
+    *v = *value;
+    const NumLiteral *stored = add_location(t, index, bucket, pos);
+    if (!stored) v->kind = NUM_NONE;
+    return stored;
+}
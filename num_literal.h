@@ -0,0 +1,74 @@
+// num_literal.h
+// NUMBER and RANGE lexemes parsed once into typed values, so consumers of the
+// PIF and of parse trees never read the digits again
+
+#ifndef NUM_LITERAL_H
+#define NUM_LITERAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    NUM_NONE = 0,           // not a numeric literal (keywords, identifiers, strings)
+    NUM_INT,
+    NUM_REAL,
+    NUM_RANGE               // a..b; value is the low bound, hi the high one
+} NumKind;
+
+typedef struct {
+    int is_real;            // 1 for a fraction, or digits beyond the int64 range
+    union {
+        int64_t i;
+        double d;
+    };
+} NumValue;
+
+typedef struct {
+    NumKind kind;
+    NumValue value;
+    NumValue hi;
+} NumLiteral;
+
+// Parses text[0..len): DIGIT+ ('.' DIGIT+)?, or two of those joined by "..".
+// Returns 0 on success; otherwise -1 and out->kind is NUM_NONE.
+int num_literal_parse(const char *text, size_t len, NumLiteral *out);
+
+// Builds the RANGE lo..hi from two parsed bounds (NUM_INT or NUM_REAL), so a
+// range assembled from NUMBER '..' NUMBER tokens needs no text. Returns 0 on
+// success; otherwise -1 and out->kind is NUM_NONE.
+int num_literal_range(const NumLiteral *lo, const NumLiteral *hi, NumLiteral *out);
+
+// Writes the value as text ("12", "0.5", "1..20"), reals in the fewest digits
+// that read back to the same double. Returns what snprintf returns.
+int num_literal_format(const NumLiteral *v, char *buf, size_t size);
+
+// Values of the numeric literals of one symbol table, by symbol table index. The
+// table is owned next to the symbol table whose indices it uses; PIF entries and
+// tree leaves carry only their (bucket,pos) location and find the value through
+// num_table_get.
+typedef struct {
+    NumLiteral *values;     // by index, NUM_NONE where nothing was stored
+    int capacity;
+    uint64_t *keys;         // open addressing on (bucket,pos); 0 is an empty slot
+    int *indices;           // index of the value per key slot
+    int nslots;             // power of two
+    int count;              // locations stored
+} NumTable;
+
+void num_table_init(NumTable *t);
+void num_table_free(NumTable *t);
+
+// Value stored at index, or NULL
+const NumLiteral *num_table_at(const NumTable *t, int index);
+
+// Value of the literal at (bucket,pos), or NULL
+const NumLiteral *num_table_get(const NumTable *t, int bucket, int pos);
+
+// Value of the lexeme at index and (bucket,pos); the lexeme is parsed only if
+// the index has no value yet. NULL if it is not numeric or on allocation failure.
+const NumLiteral *num_table_put(NumTable *t, int index, int bucket, int pos, const char *lexeme, size_t len);
+
+// Same with a value parsed elsewhere; an index that has a value keeps it
+const NumLiteral *num_table_set(NumTable *t, int index, int bucket, int pos, const NumLiteral *value);
+
+#endif // NUM_LITERAL_H
@@ -0,0 +1,38 @@
+// number_scan.c
+// Generated by fa_codegen from number.fa; do not edit
+
+#include "number_scan.h"
+
+int number_longest(const char *text, size_t n) {
+    const unsigned char *base = (const unsigned char *)text;
+    const unsigned char *p = base;
+    const unsigned char *end = base + n;
+    const unsigned char *last = base;
+    unsigned c;
+
+    if (p == end) return (int)(last - base);
+    c = *p++;
+    if (c >= '0' && c <= '9') goto s2;
+    return (int)(last - base);
+
+s2:
+    last = p;
+    if (p == end) return (int)(last - base);
+    c = *p++;
+    if (c == '.') goto s3;
+    if (c >= '0' && c <= '9') goto s2;
+    return (int)(last - base);
+
+s3:
+    if (p == end) return (int)(last - base);
+    c = *p++;
+    if (c >= '0' && c <= '9') goto s4;
+    return (int)(last - base);
+
+s4:
+    last = p;
+    if (p == end) return (int)(last - base);
+    c = *p++;
+    if (c >= '0' && c <= '9') goto s4;
+    return (int)(last - base);
+}
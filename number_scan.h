@@ -0,0 +1,12 @@
+// number_scan.h
+// Generated by fa_codegen from number.fa; do not edit
+
+#ifndef NUMBER_SCAN_H
+#define NUMBER_SCAN_H
+
+#include <stddef.h>
+
+// Longest prefix of text[0..n) that number.fa accepts, 0 if none
+int number_longest(const char *text, size_t n);
+
+#endif // NUMBER_SCAN_H
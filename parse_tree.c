@@ -20,22 +20,31 @@ ParseTreeNode *tree_node_create(const char *symbol, int is_terminal) {
     node->bucket = -1;
     node->pos = -1;
     
+    node->token_offset = 0;
+    node->token_len = 0;
+    
     return node;
 }
 
+// Iterative: a child's subtree is spliced in after its siblings, so the
+// pending nodes form one list linked through sibling
 void tree_node_free(ParseTreeNode *node) {
     if (!node) return;
-    
-    ParseTreeNode *child = node->child;
-    while (child) {
-        ParseTreeNode *next = child->sibling;
-        tree_node_free(child);
-        child = next;
+    node->sibling = NULL;
+    while (node) {
+        ParseTreeNode *next = node->sibling;
+        ParseTreeNode *child = node->child;
+        if (child) {
+            ParseTreeNode *last = child;
+            while (last->sibling) last = last->sibling;
+            last->sibling = next;
+            next = child;
+        }
+        free(node->symbol);
+        if (node->lexeme) free(node->lexeme);
+        free(node);
+        node = next;
     }
-    
-    free(node->symbol);
-    if (node->lexeme) free(node->lexeme);
-    free(node);
 }
 
 void tree_node_add_child(ParseTreeNode *parent, ParseTreeNode *child) {
@@ -54,61 +63,84 @@ void tree_node_add_child(ParseTreeNode *parent, ParseTreeNode *child) {
     }
 }
 
-// Helper: collect all nodes in pre-order
-static void collect_nodes(ParseTreeNode *node, ParseTreeNode **nodes, int *count, int max) {
-    if (!node || *count >= max) return;
-    
-    nodes[(*count)++] = node;
-    
-    ParseTreeNode *child = node->child;
-    while (child) {
-        collect_nodes(child, nodes, count, max);
-        child = child->sibling;
+// Helper: all nodes in pre-order with their father's index; returns the count
+static int collect_nodes(ParseTreeNode *root, ParseTreeNode ***nodes_out, int **fathers_out) {
+    int cap = 1024, count = 0;
+    ParseTreeNode **nodes = malloc(sizeof(ParseTreeNode*) * cap);
+    int *fathers = malloc(sizeof(int) * cap);
+
+    // Pending subtrees: the next node to visit and its father's index
+    int stack_cap = 256, sp = 0;
+    ParseTreeNode **stack = malloc(sizeof(ParseTreeNode*) * stack_cap);
+    int *stack_father = malloc(sizeof(int) * stack_cap);
+    stack[sp] = root;
+    stack_father[sp++] = -1;
+    while (sp > 0) {
+        sp--;
+        ParseTreeNode *node = stack[sp];
+        int father = stack_father[sp];
+        if (count == cap) {
+            cap *= 2;
+            nodes = realloc(nodes, sizeof(ParseTreeNode*) * cap);
+            fathers = realloc(fathers, sizeof(int) * cap);
+        }
+        int idx = count++;
+        nodes[idx] = node;
+        fathers[idx] = father;
+
+        // Children pushed last to first, so the first is visited next
+        int n = 0;
+        for (ParseTreeNode *child = node->child; child; child = child->sibling) n++;
+        if (sp + n > stack_cap) {
+            while (sp + n > stack_cap) stack_cap *= 2;
+            stack = realloc(stack, sizeof(ParseTreeNode*) * stack_cap);
+            stack_father = realloc(stack_father, sizeof(int) * stack_cap);
+        }
+        int k = sp + n;
+        for (ParseTreeNode *child = node->child; child; child = child->sibling) {
+            k--;
+            stack[k] = child;
+            stack_father[k] = idx;
+        }
+        sp += n;
     }
+    free(stack);
+    free(stack_father);
+    *nodes_out = nodes;
+    *fathers_out = fathers;
+    return count;
 }
 
 void tree_print_table(ParseTreeNode *root, FILE *out) {
+    tree_print_table_values(root, NULL, out);
+}
+
+void tree_print_table_values(ParseTreeNode *root, const NumTable *nums, FILE *out) {
     if (!root) return;
     
     // Collect all nodes
-    ParseTreeNode **nodes = malloc(sizeof(ParseTreeNode*) * 10000);
-    int node_count = 0;
-    collect_nodes(root, nodes, &node_count, 10000);
+    ParseTreeNode **nodes;
+    int *fathers;
+    int node_count = collect_nodes(root, &nodes, &fathers);
+
+    // Subtree sizes: in pre-order a node's next sibling follows its subtree
+    int *sizes = malloc(sizeof(int) * node_count);
+    for (int i = 0; i < node_count; i++) sizes[i] = 1;
+    for (int i = node_count - 1; i > 0; i--) sizes[fathers[i]] += sizes[i];
     
-    fprintf(out, "Index | Symbol | Type | Production | Father | Sibling | Lexeme | ST Location\n");
-    fprintf(out, "------|--------|------|------------|--------|---------|--------|------------\n");
+    fprintf(out, "Index | Symbol | Type | Production | Father | Sibling | Lexeme | ST Location%s\n",
+            nums ? " | Value" : "");
+    fprintf(out, "------|--------|------|------------|--------|---------|--------|------------%s\n",
+            nums ? "|------" : "");
     
     // Print each node
     for (int i = 0; i < node_count; i++) {
         ParseTreeNode *node = nodes[i];
-        
-        // Find node index
-        int node_idx = i;
-        
-        // Find father index
-        int father_idx = -1;
-        if (node->father) {
-            for (int j = 0; j < node_count; j++) {
-                if (nodes[j] == node->father) {
-                    father_idx = j;
-                    break;
-                }
-            }
-        }
-        
-        // Find sibling index
-        int sibling_idx = -1;
-        if (node->sibling) {
-            for (int j = 0; j < node_count; j++) {
-                if (nodes[j] == node->sibling) {
-                    sibling_idx = j;
-                    break;
-                }
-            }
-        }
+        int father_idx = fathers[i];
+        int sibling_idx = node->sibling && i > 0 ? i + sizes[i] : -1;
         
         fprintf(out, "%5d | %-6s | %-4s | %10d | %6d | %7d | %-6s | ",
-                node_idx,
+                i,
                 node->symbol,
                 node->is_terminal ? "TERM" : "NTERM",
                 node->production_index,
@@ -121,12 +153,61 @@ void tree_print_table(ParseTreeNode *root, FILE *out) {
         } else {
             fprintf(out, "-");
         }
+        if (nums) {
+            const NumLiteral *value = num_table_get(nums, node->bucket, node->pos);
+            char text[80];
+            if (value) num_literal_format(value, text, sizeof(text));
+            fprintf(out, " | %s", value ? text : "-");
+        }
         fprintf(out, "\n");
     }
     
+    free(sizes);
+    free(fathers);
     free(nodes);
 }
 
+// Terminals consume one token each, nonterminals cover their children. Iterative
+// pre-order walk: a node's offset is known on the way down, its length once
+// the walk climbs back out of its subtree.
+int tree_compute_spans(ParseTreeNode *root, int start) {
+    if (!root) return start;
+    int cursor = start;
+    ParseTreeNode *node = root;
+    int father_start = 0;
+    for (;;) {
+        node->token_offset = cursor - father_start;
+        if (node->is_terminal) {
+            cursor++;
+            node->token_len = 1;
+        } else if (node->child) {
+            father_start = cursor;
+            node = node->child;
+            continue;
+        } else {
+            node->token_len = 0;
+        }
+        // Climb until a node has a next sibling, closing finished subtrees
+        while (node != root && !node->sibling) {
+            node = node->father;
+            father_start -= node->token_offset;
+            node->token_len = cursor - (father_start + node->token_offset);
+        }
+        if (node == root) break;
+        node = node->sibling;
+    }
+    return cursor;
+}
+
+int tree_node_token_start(ParseTreeNode *node) {
+    int start = 0;
+    while (node) {
+        start += node->token_offset;
+        node = node->father;
+    }
+    return start;
+}
+
 int tree_get_node_index(ParseTreeNode *root, ParseTreeNode *node, int *counter) {
     if (!root || !node || !counter) return -1;
     
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "num_literal.h"
 
 // Parse tree node
 typedef struct ParseTreeNode {
@@ -23,6 +24,11 @@ typedef struct ParseTreeNode {
     char *lexeme;           // Original lexeme from PIF
     int bucket;             // Symbol table bucket
     int pos;                // Symbol table position
+    
+    // Token span (PIF indices). The offset is relative to the father's first
+    // token (absolute for the root), so whole subtrees can be moved unchanged.
+    int token_offset;
+    int token_len;
 } ParseTreeNode;
 
 // Create a new parse tree node
@@ -37,6 +43,17 @@ void tree_node_add_child(ParseTreeNode *parent, ParseTreeNode *child);
 // Print parse tree as table (father/sibling relations)
 void tree_print_table(ParseTreeNode *root, FILE *out);
 
+// Same table with a Value column: the value nums holds for each leaf's ST
+// location (see num_table_get), or "-"
+void tree_print_table_values(ParseTreeNode *root, const NumTable *nums, FILE *out);
+
+// Fill token_offset/token_len for a tree whose first token is PIF index start.
+// Returns the index one past the last token covered.
+int tree_compute_spans(ParseTreeNode *root, int start);
+
+// Absolute index of the first token covered by node (walks up to the root)
+int tree_node_token_start(ParseTreeNode *node);
+
 // Get node index in a linearized tree (for table output)
 int tree_get_node_index(ParseTreeNode *root, ParseTreeNode *node, int *counter);
 
@@ -41,43 +41,44 @@ static void add_token_allow_dup(StrList *s, const char *str) {
 
 
 
+// Classify a single PIF entry as a grammar terminal name
+const char *pif_entry_terminal(const PIFEntry *entry) {
+    // 1. Try exact keyword match first (e.g., "bind", "apply", "+", "->")
+    const char *terminal = lexeme_to_terminal(entry->lexeme);
+    if (terminal) return terminal;
+    
+    // 2. If no keyword match, check for literals based on structure
+    const char *lexeme = entry->lexeme;
+    
+    if (lexeme[0] == '"') {
+        // It starts with a quote -> It is a STRING literal
+        return "STRING";
+    } 
+    else if (isdigit((unsigned char)lexeme[0])) {
+        // It starts with a digit -> It is a NUMBER
+        return "NUMBER";
+    } 
+    else if (strcmp(lexeme, "true") == 0 || strcmp(lexeme, "false") == 0) {
+        // It is a boolean -> BOOL_LIT
+        return "BOOL_LIT";
+    }
+    else if (entry->bucket != -1) {
+        // If it has a symbol table entry (bucket != -1) and isn't a keyword -> IDENTIFIER
+        return "IDENTIFIER";
+    }
+    
+    // Fallback: This will likely cause a parse error, but it's the last resort
+    // (e.g. for terminals like "NL" if they aren't caught by lexeme_to_terminal)
+    return lexeme;
+}
+
 // Helper: split input string into tokens from PIF
 static StrList split_input_from_pif(PIFEntry *pif_entries, int pif_count, StrList *terms) {
     StrList tokens;
     sl_init(&tokens);
     
     for (int i = 0; i < pif_count; i++) {
-        // 1. Try exact keyword match first (e.g., "bind", "apply", "+", "->")
-        const char *terminal = lexeme_to_terminal(pif_entries[i].lexeme);
-        
-        if (terminal) {
-            add_token_allow_dup(&tokens, terminal);
-        } else {
-            // 2. If no keyword match, check for literals based on structure
-            const char *lexeme = pif_entries[i].lexeme;
-            
-            if (lexeme[0] == '"') {
-                // It starts with a quote -> It is a STRING literal
-                add_token_allow_dup(&tokens, "STRING");
-            } 
-            else if (isdigit(lexeme[0])) {
-                // It starts with a digit -> It is a NUMBER
-                add_token_allow_dup(&tokens, "NUMBER");
-            } 
-            else if (strcmp(lexeme, "true") == 0 || strcmp(lexeme, "false") == 0) {
-                // It is a boolean -> BOOL_LIT
-                add_token_allow_dup(&tokens, "BOOL_LIT");
-            }
-            else if (pif_entries[i].bucket != -1) {
-                // If it has a symbol table entry (bucket != -1) and isn't a keyword -> IDENTIFIER
-                add_token_allow_dup(&tokens, "IDENTIFIER");
-            }
-            else {
-                // Fallback: This will likely cause a parse error, but it's the last resort
-                // (e.g. for terminals like "NL" if they aren't caught by lexeme_to_terminal)
-                add_token_allow_dup(&tokens, lexeme);
-            }
-        }
+        add_token_allow_dup(&tokens, pif_entry_terminal(&pif_entries[i]));
     }
     
     return tokens;
@@ -492,6 +493,7 @@ ParseTreeOutput ll1_parse_with_tree(const char *input, int **table,
         output.result = PARSE_ACCEPT;
         // Root node is tracked separately
         output.tree = config.root;
+        tree_compute_spans(output.tree, 0);
     } else {
         output.result = PARSE_ERROR;
         // Only set error_location if it wasn't already set (to preserve detailed error message)
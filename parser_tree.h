@@ -17,6 +17,9 @@ ParseTreeOutput ll1_parse_with_tree(const char *input, int **table,
                                      StrList *nonterms, StrList *terms, 
                                      ProdList *prods, PIFEntry *pif_entries, int pif_count);
 
+// Classify a PIF entry as a grammar terminal name (keywords, literals, IDENTIFIER)
+const char *pif_entry_terminal(const PIFEntry *entry);
+
 // Free parse tree output
 void free_parse_tree_output(ParseTreeOutput *output);
 
@@ -0,0 +1,52 @@
+// pif_convert.c
+// Convert PIF files between the text and binary formats
+
+#include "pif_generator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]) {
+    int to_binary = -1;     // -1: opposite of the input format
+    int argi = 1;
+    if (argi < argc && strcmp(argv[argi], "--to-binary") == 0) { to_binary = 1; argi++; }
+    else if (argi < argc && strcmp(argv[argi], "--to-text") == 0) { to_binary = 0; argi++; }
+
+    if (argc - argi != 2) {
+        fprintf(stderr, "Usage: %s [--to-binary | --to-text] <input_pif> <output_pif>\n", argv[0]);
+        fprintf(stderr, "  Without an option, text input is written as binary and binary input as text\n");
+        return 1;
+    }
+    const char *input_file = argv[argi];
+    const char *output_file = argv[argi + 1];
+
+    if (to_binary == -1) {
+        FILE *f = fopen(input_file, "rb");
+        char magic[4] = { 0 };
+        if (f) {
+            if (fread(magic, 1, 4, f) != 4) magic[0] = '\0';
+            fclose(f);
+        }
+        to_binary = memcmp(magic, PIF_BINARY_MAGIC, 4) != 0;
+    }
+
+    // read_pif_from_file accepts either format
+    PIFEntry *pif_entries = NULL;
+    int pif_count = 0;
+    if (read_pif_from_file(input_file, &pif_entries, &pif_count) < 0) {
+        fprintf(stderr, "Error: failed to read PIF from %s\n", input_file);
+        return 1;
+    }
+
+    int res = to_binary ? write_pif_binary_to_file(output_file, pif_entries, pif_count)
+                        : write_pif_to_file(output_file, pif_entries, pif_count);
+    if (res != 0) {
+        fprintf(stderr, "Error: failed to write PIF to %s\n", output_file);
+        free_pif_entries(pif_entries, pif_count);
+        return 1;
+    }
+
+    printf("Wrote %d entries to %s (%s)\n", pif_count, output_file, to_binary ? "binary" : "text");
+    free_pif_entries(pif_entries, pif_count);
+    return 0;
+}
@@ -4,10 +4,12 @@
 #include "pif_reader.h"
 #include "st.h"
 #include "lexer_pif_export.h"
+#include "scanner_dfa.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 
 
 #define UNUSED_LOC -1
@@ -68,11 +70,40 @@ static int needs_symbol_table(const char *lexeme) {
     return 0;
 }
 
-// Generate PIF from lexeme list using Symbol Table
-// Returns number of PIF entries generated, or -1 on error
-int generate_pif_from_tokens(const char **tokens, int token_count, 
-                              PIFEntry **pif_entries, int *pif_count,
-                              SymbolTable *st) {
+// A merged "a..b" range, entered in the symbol table after every other lexeme
+static int is_range(const char *lexeme) {
+    const char *terminal = lexeme_to_terminal(lexeme);
+    return terminal && strcmp(terminal, "RANGE") == 0 && strcmp(terminal, lexeme) != 0;
+}
+
+// Digits and dots only: the operands of a NUMBER '..' NUMBER range
+static int is_numeric(const char *lexeme) {
+    for (int k = 0; lexeme[k]; k++) {
+        if (!isdigit((unsigned char)lexeme[k]) && lexeme[k] != '.') return 0;
+    }
+    return 1;
+}
+
+// Value of a merged range: its two bounds are parsed and joined, the "a..b"
+// text itself is never parsed
+static void put_range(NumTable *nums, int idx, int bucket, int pos, const char *lexeme, size_t lo_len) {
+    NumLiteral lo, hi, range;
+    if (num_table_at(nums, idx)) return;
+    if (num_literal_parse(lexeme, lo_len, &lo) == 0 &&
+        num_literal_parse(lexeme + lo_len + 2, strlen(lexeme + lo_len + 2), &hi) == 0 &&
+        num_literal_range(&lo, &hi, &range) == 0) {
+        num_table_set(nums, idx, bucket, pos, &range);
+    }
+}
+
+// PIF entries for tokens[0..token_count). nums, if not NULL, receives the value
+// of every numeric literal the first time its symbol table index appears;
+// range_split[i], if given and nonzero, is the length of the low bound of a
+// range merged by generate_pif_from_string. Ranges are put in the symbol table
+// in a second pass, so they never move the location of another lexeme.
+static int generate_entries(const char **tokens, const size_t *range_split, int token_count,
+                            PIFEntry **pif_entries, int *pif_count,
+                            SymbolTable *st, NumTable *nums) {
     if (!tokens || !pif_entries || !pif_count) return -1;
     
     *pif_entries = NULL;
@@ -102,6 +133,8 @@ int generate_pif_from_tokens(const char **tokens, int token_count,
             if (st_get_location_by_index(st, idx, &bucket, &pos) != 0) {
                 bucket = UNUSED_LOC;
                 pos = UNUSED_LOC;
+            } else if (nums && isdigit((unsigned char)lexeme[0])) {
+                num_table_put(nums, idx, bucket, pos, lexeme, strlen(lexeme));
             }
         }
         
@@ -117,6 +150,23 @@ int generate_pif_from_tokens(const char **tokens, int token_count,
         (*pif_entries)[*pif_count].pos = pos;
         (*pif_count)++;
     }
+
+    int entry = 0;
+    for (int i = 0; i < token_count; i++) {
+        const char *lexeme = tokens[i];
+        if (!lexeme) continue;
+        PIFEntry *e = &(*pif_entries)[entry++];
+        if (e->bucket != UNUSED_LOC || !isdigit((unsigned char)lexeme[0]) || !is_range(lexeme)) continue;
+        int idx = st_put(st, lexeme);
+        if (st_get_location_by_index(st, idx, &e->bucket, &e->pos) != 0) {
+            e->bucket = UNUSED_LOC;
+            e->pos = UNUSED_LOC;
+        } else if (nums) {
+            const char *dots = strstr(lexeme, "..");
+            size_t lo_len = range_split && range_split[i] ? range_split[i] : (size_t)(dots - lexeme);
+            if (dots) put_range(nums, idx, e->bucket, e->pos, lexeme, lo_len);
+        }
+    }
     
     // Cleanup local symbol table if used
     if (use_local_st) {
@@ -126,107 +176,96 @@ int generate_pif_from_tokens(const char **tokens, int token_count,
     return *pif_count;
 }
 
+// Generate PIF from lexeme list using Symbol Table
+// Returns number of PIF entries generated, or -1 on error
+int generate_pif_from_tokens(const char **tokens, int token_count, 
+                              PIFEntry **pif_entries, int *pif_count,
+                              SymbolTable *st, NumTable *nums) {
+    return generate_entries(tokens, NULL, token_count, pif_entries, pif_count, st, nums);
+}
+
 // Generate PIF from input string (tokenizes and builds symbol table)
 int generate_pif_from_string(const char *input, PIFEntry **pif_entries, int *pif_count,
-                              SymbolTable *st) {
+                              SymbolTable *st, NumTable *nums) {
     if (!input || !pif_entries || !pif_count) return -1;
 
-    // Improved tokenizer: splits identifiers, numbers, strings, and operators
-    const char *tokens[4096];
+    // Longest-match tokenizer over the combined scanner DFA (scanner_dfa.h), in
+    // UTF-8 mode so identifiers may contain non-ASCII letters
+    const ScannerDFA *scanner = scanner_dfa_default_utf8();
+    if (!scanner) return -1;
+    int token_cap = 1024;
+    char **tokens = malloc(sizeof(char *) * token_cap);
     int token_count = 0;
+    int failed = !tokens;
 
     const char *p = input;
-
-    while (*p && token_count < 4096) {
-        // Whitespace handling: treat newlines as explicit NL tokens (grammar expects NL between statements)
-        if (isspace((unsigned char)*p)) {
-            if (*p == '\n') { tokens[token_count++] = strdup("NL"); p++; continue; }
-            if (*p == '\r') { if (p[1] == '\n') { tokens[token_count++] = strdup("NL"); p += 2; continue; } p++; continue; }
-            p++; continue;
+    const char *end = input + strlen(input);
+    const char *valid_end = input;
+    ScanToken tok;
+    while (!failed && scanner_dfa_next_utf8(scanner, &p, end, &valid_end, &tok)) {
+        // Newlines are explicit NL tokens (grammar expects NL between statements)
+        if (tok.tag == LT_NL && (*tok.start == '\n' || *tok.start == '\r')) {
+            tok.start = "NL";
+            tok.length = 2;
         }
-
-        // Identifiers / keywords (letters or underscore)
-        if (isalpha((unsigned char)*p) || *p == '_') {
-            char buf[256]; int n = 0;
-            while ((*p) && (isalnum((unsigned char)*p) || *p == '_') && n < (int)sizeof(buf)-1) {
-                buf[n++] = *p++; }
-            buf[n] = '\0'; tokens[token_count++] = strdup(buf); continue;
-        }
-
-        // Numbers: digits with optional single dot (decimal). Stop at '..' sequence (range)
-        if (isdigit((unsigned char)*p)) {
-            char buf[256]; int n = 0; int has_dot = 0;
-            while (*p && n < (int)sizeof(buf)-1) {
-                if (*p == '.') {
-                    if (p[1] == '.') break; // range operator starts here
-                    if (has_dot) break; // second dot -> stop
-                    has_dot = 1; buf[n++] = *p++; continue;
-                }
-                if (!isdigit((unsigned char)*p)) break;
-                buf[n++] = *p++;
+        if (token_count == token_cap) {
+            char **grown = token_cap <= INT32_MAX / 2 ? realloc(tokens, sizeof(char *) * token_cap * 2) : NULL;
+            if (!grown) {
+                failed = 1;
+                break;
             }
-            buf[n] = '\0'; tokens[token_count++] = strdup(buf); continue;
-        }
-
-        // Strings quoted with double quotes
-        if (*p == '"') {
-            char buf[512]; int n = 0; buf[n++] = *p++;
-            while (*p && n < (int)sizeof(buf)-1) {
-                buf[n++] = *p; if (*p == '"') { p++; break; } p++; }
-            buf[n] = '\0'; tokens[token_count++] = strdup(buf); continue;
+            tokens = grown;
+            token_cap *= 2;
         }
-
-        // Multi-char operators
-        if (p[0] == '.' && p[1] == '.' && p[2] == '<') { tokens[token_count++] = strdup("..<"); p += 3; continue; }
-        if (p[0] == ':' && p[1] == '=') { tokens[token_count++] = strdup(":="); p += 2; continue; }
-        if (p[0] == '-' && p[1] == '>') { tokens[token_count++] = strdup("->"); p += 2; continue; }
-        if (p[0] == '|' && p[1] == '>') { tokens[token_count++] = strdup("|>"); p += 2; continue; }
-        if (p[0] == '*' && p[1] == '*') { tokens[token_count++] = strdup("**"); p += 2; continue; }
-        if (p[0] == '>' && p[1] == '=') { tokens[token_count++] = strdup(">="); p += 2; continue; }
-        if (p[0] == '<' && p[1] == '=') { tokens[token_count++] = strdup("<="); p += 2; continue; }
-        if (p[0] == '=' && p[1] == '=') { tokens[token_count++] = strdup("=="); p += 2; continue; }
-        if (p[0] == '!' && p[1] == '=') { tokens[token_count++] = strdup("!="); p += 2; continue; }
-        if (p[0] == '.' && p[1] == '.') { tokens[token_count++] = strdup(".."); p += 2; continue; }
-
-        // Single-char tokens / operators
-        char single[2] = { *p, '\0' };
-        // Accept parentheses, brackets, commas, plus/minus etc.
-        if (strchr("()[],+-*/%<>:=|", *p)) {
-            tokens[token_count++] = strdup(single);
-            p++; continue;
+        char *lexeme = malloc(tok.length + 1);
+        if (!lexeme) {
+            failed = 1;
+            break;
         }
+        memcpy(lexeme, tok.start, tok.length);
+        lexeme[tok.length] = '\0';
+        tokens[token_count++] = lexeme;
+    }
 
-        // Unknown char: treat it as one-char token and continue
-        tokens[token_count++] = strdup(single);
-        p++;
-    }
-
-    // Post-process tokens: merge NUMBER '..' NUMBER into a single RANGE token (e.g., "1..20")
-    const char *merged[4096]; int mcount = 0;
-    for (int i = 0; i < token_count; ) {
-        if (i + 2 < token_count && tokens[i] && tokens[i+1] && tokens[i+2]) {
-            // check if pattern number .. number
-            int is_num1 = 1, is_num2 = 1;
-            for (int k = 0; tokens[i][k]; k++) if (!isdigit((unsigned char)tokens[i][k]) && tokens[i][k] != '.') { is_num1 = 0; break; }
-            if (strcmp(tokens[i+1], "..") == 0) {
-                for (int k = 0; tokens[i+2][k]; k++) if (!isdigit((unsigned char)tokens[i+2][k]) && tokens[i+2][k] != '.') { is_num2 = 0; break; }
-                if (is_num1 && is_num2) {
-                    char *r = malloc(strlen(tokens[i]) + strlen(tokens[i+2]) + 3);
-                    sprintf(r, "%s..%s", tokens[i], tokens[i+2]);
-                    merged[mcount++] = r;
-                    i += 3; continue;
-                }
+    // Post-process tokens: merge NUMBER '..' NUMBER into a single RANGE token (e.g., "1..20").
+    // merged takes over the token strings, so it never has more entries than tokens.
+    // range_split keeps where the bounds meet, so a range's value comes from its bounds.
+    size_t slots = token_count > 0 ? (size_t)token_count : 1;
+    const char **merged = failed ? NULL : malloc(sizeof(char *) * slots);
+    size_t *range_split = failed ? NULL : calloc(slots, sizeof(size_t));
+    int mcount = 0;
+    if (!merged || !range_split) failed = 1;
+    for (int i = 0; !failed && i < token_count; ) {
+        if (i + 2 < token_count && is_numeric(tokens[i]) && strcmp(tokens[i+1], "..") == 0 && is_numeric(tokens[i+2])) {
+            size_t lo_len = strlen(tokens[i]), hi_len = strlen(tokens[i+2]);
+            char *r = realloc(tokens[i], lo_len + hi_len + 3);
+            if (!r) {
+                failed = 1;
+                break;
             }
+            memcpy(r + lo_len, "..", 2);
+            memcpy(r + lo_len + 2, tokens[i+2], hi_len + 1);
+            range_split[mcount] = lo_len;
+            free(tokens[i+1]);
+            free(tokens[i+2]);
+            tokens[i] = tokens[i+1] = tokens[i+2] = NULL;
+            merged[mcount++] = r;
+            i += 3;
+            continue;
         }
-        merged[mcount++] = strdup(tokens[i]);
+        merged[mcount++] = tokens[i];
+        tokens[i] = NULL;
         i++;
     }
 
-    int result = generate_pif_from_tokens(merged, mcount, pif_entries, pif_count, st);
+    int result = failed ? -1 : generate_entries(merged, range_split, mcount, pif_entries, pif_count, st, nums);
 
-    // Free duplicated tokens
-    for (int i = 0; i < token_count; i++) free((void*)tokens[i]);
+    // Tokens not moved into merged are still owned here
+    for (int i = 0; i < token_count; i++) free(tokens[i]);
     for (int i = 0; i < mcount; i++) free((void*)merged[i]);
+    free(tokens);
+    free(merged);
+    free(range_split);
 
     return result;
 }
@@ -253,3 +292,139 @@ int write_pif_to_file(const char *filename, PIFEntry *pif_entries, int pif_count
     return 0;
 }
 
+// Growable byte buffer for the binary writer
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+    int failed;             // an allocation failed; the contents are incomplete
+} ByteBuf;
+
+static void buf_put(ByteBuf *b, const void *src, size_t n) {
+    if (b->failed) return;
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap;
+        while (b->len + n > cap) cap = cap ? cap * 2 : 4096;
+        unsigned char *grown = realloc(b->data, cap);
+        if (!grown) {
+            b->failed = 1;
+            return;
+        }
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, src, n);
+    b->len += n;
+}
+
+static void buf_varint(ByteBuf *b, unsigned int v) {
+    unsigned char out[5];
+    int n = 0;
+    while (v >= 0x80) {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    buf_put(b, out, n);
+}
+
+static void buf_u32(ByteBuf *b, unsigned int v) {
+    unsigned char out[4] = { v & 0xFF, (v >> 8) & 0xFF, (v >> 16) & 0xFF, (v >> 24) & 0xFF };
+    buf_put(b, out, 4);
+}
+
+static unsigned int zigzag(int v) {
+    return ((unsigned int)v << 1) ^ (unsigned int)(v >> 31);
+}
+
+static unsigned int entry_hash(const PIFEntry *e, int literal) {
+    unsigned int h = 2166136261u;
+    for (const char *p = e->lexeme; *p; p++) h = (h ^ (unsigned char)*p) * 16777619u;
+    if (literal) h = ((h ^ (unsigned int)e->bucket) * 16777619u ^ (unsigned int)e->pos) * 16777619u;
+    return h;
+}
+
+int write_pif_binary_to_file(const char *filename, PIFEntry *pif_entries, int pif_count) {
+    if (!filename || !pif_entries || pif_count < 0 || pif_count > INT32_MAX / 4) return -1;
+
+    // Intern table of first occurrences: slot holds an entry index, ids[] its token/literal id
+    int slot_cap = 1024;
+    while (slot_cap < pif_count * 2) slot_cap *= 2;
+    int *slots = malloc(sizeof(int) * slot_cap);
+    int *ids = malloc(sizeof(int) * (pif_count > 0 ? pif_count : 1));
+    if (!slots || !ids) {
+        free(slots);
+        free(ids);
+        return -1;
+    }
+    for (int i = 0; i < slot_cap; i++) slots[i] = -1;
+
+    ByteBuf tokens = { NULL, 0, 0, 0 }, literals = { NULL, 0, 0, 0 }, stream = { NULL, 0, 0, 0 };
+    int token_count = 0, literal_count = 0;
+
+    // Pass 1: number distinct tokens and literals (literal ids stored as -(id + 1))
+    for (int i = 0; i < pif_count; i++) {
+        PIFEntry *e = &pif_entries[i];
+        int literal = e->bucket != UNUSED_LOC;
+        unsigned int s = entry_hash(e, literal) & (slot_cap - 1);
+        while (slots[s] != -1) {
+            PIFEntry *f = &pif_entries[slots[s]];
+            int f_literal = f->bucket != UNUSED_LOC;
+            if (f_literal == literal && strcmp(f->lexeme, e->lexeme) == 0 &&
+                (!literal || (f->bucket == e->bucket && f->pos == e->pos))) break;
+            s = (s + 1) & (slot_cap - 1);
+        }
+        if (slots[s] != -1) {
+            ids[i] = ids[slots[s]];
+            continue;
+        }
+        slots[s] = i;
+        if (literal) {
+            ids[i] = -(++literal_count);
+            buf_varint(&literals, zigzag(e->bucket));
+            buf_varint(&literals, zigzag(e->pos));
+            buf_put(&literals, e->lexeme, strlen(e->lexeme) + 1);
+        } else {
+            ids[i] = token_count++;
+            buf_put(&tokens, e->lexeme, strlen(e->lexeme) + 1);
+        }
+    }
+
+    // Pass 2: the entry stream, literals numbered after the tokens
+    for (int i = 0; i < pif_count; i++) {
+        buf_varint(&stream, ids[i] >= 0 ? (unsigned int)ids[i] : (unsigned int)(token_count - ids[i] - 1));
+    }
+
+    ByteBuf header = { NULL, 0, 0, 0 };
+    unsigned char version[4] = { PIF_BINARY_VERSION & 0xFF, PIF_BINARY_VERSION >> 8, 0, 0 };
+    buf_put(&header, PIF_BINARY_MAGIC, 4);
+    buf_put(&header, version, 4);
+    buf_u32(&header, (unsigned int)pif_count);
+    buf_u32(&header, (unsigned int)token_count);
+    buf_u32(&header, (unsigned int)literal_count);
+    buf_u32(&header, (unsigned int)tokens.len);
+    buf_u32(&header, (unsigned int)literals.len);
+    buf_u32(&header, (unsigned int)stream.len);
+
+    // Section sizes are u32 in the header: refuse rather than write a corrupt one
+    int fits = !header.failed && !tokens.failed && !literals.failed && !stream.failed &&
+               tokens.len <= UINT32_MAX && literals.len <= UINT32_MAX && stream.len <= UINT32_MAX;
+
+    int result = -1;
+    FILE *f = fits ? fopen(filename, "wb") : NULL;
+    if (f) {
+        int ok = fwrite(header.data, 1, header.len, f) == header.len &&
+                 (tokens.len == 0 || fwrite(tokens.data, 1, tokens.len, f) == tokens.len) &&
+                 (literals.len == 0 || fwrite(literals.data, 1, literals.len, f) == literals.len) &&
+                 (stream.len == 0 || fwrite(stream.data, 1, stream.len, f) == stream.len);
+        if (fclose(f) == 0 && ok) result = 0;
+    }
+
+    free(header.data);
+    free(tokens.data);
+    free(literals.data);
+    free(stream.data);
+    free(slots);
+    free(ids);
+    return result;
+}
@@ -6,19 +6,25 @@
 
 #include "pif_reader.h"
 #include "st.h"
+#include "num_literal.h"
 
 // Generate PIF from token list using Symbol Table
-// If st is NULL, creates a local symbol table
+// If st is NULL, creates a local symbol table. Ranges enter it after every
+// other lexeme, so they never move another lexeme's location. If nums is not
+// NULL, NUMBER and RANGE values are parsed into it, once per symbol table index.
 int generate_pif_from_tokens(const char **tokens, int token_count, 
                               PIFEntry **pif_entries, int *pif_count,
-                              SymbolTable *st);
+                              SymbolTable *st, NumTable *nums);
 
 // Generate PIF from input string (simple tokenizer)
 int generate_pif_from_string(const char *input, PIFEntry **pif_entries, int *pif_count,
-                              SymbolTable *st);
+                              SymbolTable *st, NumTable *nums);
 
 // Write PIF to file in the format expected by the parser
 int write_pif_to_file(const char *filename, PIFEntry *pif_entries, int pif_count);
 
+// Write PIF in the binary format described in pif_reader.h
+int write_pif_binary_to_file(const char *filename, PIFEntry *pif_entries, int pif_count);
+
 #endif // PIF_GENERATOR_H
 
@@ -0,0 +1,332 @@
+// pif_map.c
+// Memory-mapped PIF reader with a hand-written line scanner
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "pif_map.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Same character class as the %s / %d conversions of the old sscanf reader
+static inline int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static int line_contains(const char *p, const char *end, const char *pat, size_t len) {
+    while ((size_t)(end - p) >= len) {
+        const char *hit = memchr(p, pat[0], (size_t)(end - p) - len + 1);
+        if (!hit) return 0;
+        if (memcmp(hit, pat, len) == 0) return 1;
+        p = hit + 1;
+    }
+    return 0;
+}
+
+// Parse an optionally signed decimal after optional blanks (like %d)
+static int scan_int(const char **p, const char *end, int *out) {
+    const char *s = *p;
+    while (s < end && is_space(*s)) s++;
+    int neg = 0;
+    if (s < end && (*s == '-' || *s == '+')) {
+        neg = (*s == '-');
+        s++;
+    }
+    if (s >= end || *s < '0' || *s > '9') return 0;
+    long v = 0;
+    while (s < end && *s >= '0' && *s <= '9') {
+        if (v < 0x7FFFFFFF) v = v * 10 + (*s - '0');
+        s++;
+    }
+    *out = (int)(neg ? -v : v);
+    *p = s;
+    return 1;
+}
+
+static int add_slice(PIFMap *map, const PIFSlice *slice) {
+    if (map->count == map->capacity) {
+        if (map->capacity > INT_MAX / 2) return -1;
+        int capacity = map->capacity ? map->capacity * 2 : 1024;
+        PIFSlice *grown = realloc(map->entries, sizeof(PIFSlice) * (size_t)capacity);
+        if (!grown) return -1;
+        map->entries = grown;
+        map->capacity = capacity;
+    }
+    map->entries[map->count++] = *slice;
+    return 0;
+}
+
+// One entry per line: "lexeme bucket,pos" or "lexeme -1"; header/footer lines are skipped.
+// Returns 0, or -1 for a lexeme too long for a slice or out of memory.
+static int scan_entries(PIFMap *map) {
+    const char *base = map->data;
+    const char *p = base;
+    const char *end = base + map->size;
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        const char *line = p;
+        p = eol + 1;
+
+        if (line_contains(line, eol, "~~~~", 4) || line_contains(line, eol, "End PIF", 7)) continue;
+
+        const char *s = line;
+        while (s < eol && is_space(*s)) s++;
+        if (s == eol) continue;
+        const char *lex = s;
+        while (s < eol && !is_space(*s)) s++;
+
+        if ((uint64_t)(s - lex) > UINT32_MAX) return -1;
+        PIFSlice slice;
+        slice.offset = (uint64_t)(lex - base);
+        slice.length = (uint32_t)(s - lex);
+        slice.terminal = -1;
+        slice.bucket = -1;
+        slice.pos = -1;
+
+        int bucket, pos;
+        if (scan_int(&s, eol, &bucket) && s < eol && *s == ',') {
+            s++;
+            if (scan_int(&s, eol, &pos)) {
+                slice.bucket = bucket;
+                slice.pos = pos;
+            }
+        }
+        if (add_slice(map, &slice) != 0) return -1;
+    }
+    return 0;
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// LEB128 varint; returns 0 if it runs past end or past 32 bits
+static int get_varint(const unsigned char **p, const unsigned char *end, uint32_t *out) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+        unsigned char c = *(*p)++;
+        v |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            *out = v;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// Slice of the next NUL-terminated string of a section; 0 if unterminated
+static int get_string(const unsigned char *base, const unsigned char **p, const unsigned char *end,
+                      PIFSlice *slice) {
+    const unsigned char *nul = memchr(*p, '\0', (size_t)(end - *p));
+    if (!nul || (uint64_t)(nul - *p) > UINT32_MAX) return 0;
+    slice->offset = (uint64_t)(*p - base);
+    slice->length = (uint32_t)(nul - *p);
+    *p = nul + 1;
+    return 1;
+}
+
+// Binary PIF (layout in pif_reader.h): the token and literal strings stay in
+// the mapping and each entry becomes a slice of one of them. Every count is
+// checked against the bytes that would hold it before anything is allocated.
+static int decode_binary(PIFMap *map) {
+    const unsigned char *data = (const unsigned char *)map->data;
+    size_t size = map->size;
+    if (size < PIF_BINARY_HEADER_SIZE || memcmp(data, PIF_BINARY_MAGIC, 4) != 0) return -1;
+    if ((data[4] | (data[5] << 8)) != PIF_BINARY_VERSION) return -1;
+
+    uint32_t entry_count = get_u32(data + 8);
+    uint32_t token_count = get_u32(data + 12);
+    uint32_t literal_count = get_u32(data + 16);
+    uint32_t token_bytes = get_u32(data + 20);
+    uint32_t literal_bytes = get_u32(data + 24);
+    uint32_t stream_bytes = get_u32(data + 28);
+    size_t body = size - PIF_BINARY_HEADER_SIZE;
+    // Strings take at least their NUL and stream ids at least one byte each
+    if (token_bytes > body || literal_bytes > body - token_bytes ||
+        stream_bytes > body - token_bytes - literal_bytes ||
+        token_count > token_bytes || literal_count > literal_bytes ||
+        entry_count > stream_bytes || entry_count > INT_MAX) return -1;
+#if SIZE_MAX < UINT64_MAX
+    // Only a 32-bit size_t can overflow on the slice arrays below
+    if ((uint64_t)entry_count * sizeof(PIFSlice) > SIZE_MAX ||
+        ((uint64_t)token_count + literal_count + 1) * sizeof(PIFSlice) > SIZE_MAX) return -1;
+#endif
+
+    const unsigned char *p = data + PIF_BINARY_HEADER_SIZE;
+    const unsigned char *tokens_end = p + token_bytes;
+    const unsigned char *literals_end = tokens_end + literal_bytes;
+    const unsigned char *stream_end = literals_end + stream_bytes;
+
+    PIFSlice *ids = malloc(sizeof(PIFSlice) * ((size_t)token_count + literal_count + 1));
+    map->entries = malloc(sizeof(PIFSlice) * (entry_count > 0 ? (size_t)entry_count : 1));
+    map->capacity = (int)entry_count;
+    int ok = ids && map->entries;
+
+    for (uint32_t i = 0; ok && i < token_count; i++) {
+        PIFSlice *s = &ids[i];
+        ok = get_string(data, &p, tokens_end, s);
+        s->terminal = -1;
+        s->bucket = -1;
+        s->pos = -1;
+    }
+    p = tokens_end;
+    for (uint32_t i = 0; ok && i < literal_count; i++) {
+        PIFSlice *s = &ids[token_count + i];
+        uint32_t bucket = 0, pos = 0;
+        ok = get_varint(&p, literals_end, &bucket) && get_varint(&p, literals_end, &pos) &&
+             get_string(data, &p, literals_end, s);
+        s->terminal = -1;
+        s->bucket = unzigzag(bucket);
+        s->pos = unzigzag(pos);
+    }
+    p = literals_end;
+    for (uint32_t i = 0; ok && i < entry_count; i++) {
+        uint32_t id;
+        ok = get_varint(&p, stream_end, &id) && (id < token_count || id - token_count < literal_count);
+        if (ok) map->entries[map->count++] = ids[id];
+    }
+    free(ids);
+    return ok ? 0 : -1;
+}
+
+int pif_map_from_binary(PIFMap *map, const unsigned char *data, size_t size) {
+    memset(map, 0, sizeof(*map));
+    map->data = (const char *)data;
+    map->size = size;
+    if (decode_binary(map) != 0) {
+        pif_map_close(map);
+        return -1;
+    }
+    return map->count;
+}
+
+int pif_map_from_buffer(PIFMap *map, const char *data, size_t size) {
+    memset(map, 0, sizeof(*map));
+    map->data = data;
+    map->size = size;
+    if (scan_entries(map) != 0) {
+        pif_map_close(map);
+        return -1;
+    }
+    return map->count;
+}
+
+int pif_map_open(PIFMap *map, const char *filename) {
+    memset(map, 0, sizeof(*map));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return -1;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || (unsigned long long)size.QuadPart > SIZE_MAX) {
+        CloseHandle(file);
+        return -1;
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return -1;
+    }
+    const char *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return -1;
+    }
+    map->file_handle = file;
+    map->mapping_handle = mapping;
+    map->size = (size_t)size.QuadPart;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (unsigned long long)st.st_size > SIZE_MAX) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    const char *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+    map->size = (size_t)st.st_size;
+#endif
+
+    map->data = data;
+    map->mapped = 1;
+    int binary = map->size >= 4 && memcmp(data, PIF_BINARY_MAGIC, 4) == 0;
+    if ((binary ? decode_binary(map) : scan_entries(map)) != 0) {
+        pif_map_close(map);
+        return -1;
+    }
+    return map->count;
+}
+
+size_t pif_map_lexeme(const PIFMap *map, int i, char *buf, size_t size) {
+    const PIFSlice *slice = &map->entries[i];
+    size_t n = slice->length < size ? slice->length : size - 1;
+    memcpy(buf, map->data + slice->offset, n);
+    buf[n] = '\0';
+    return slice->length;
+}
+
+int pif_map_to_entries(const PIFMap *map, PIFEntry **entries, int *count) {
+    int capacity = map->count > 0 ? map->count : 1;
+    *entries = malloc(sizeof(PIFEntry) * capacity);
+    *count = 0;
+    if (!*entries) return -1;
+
+    for (int i = 0; i < map->count; i++) {
+        PIFEntry *e = &(*entries)[i];
+        pif_map_lexeme(map, i, e->lexeme, sizeof(e->lexeme));
+        e->bucket = map->entries[i].bucket;
+        e->pos = map->entries[i].pos;
+    }
+    *count = map->count;
+    return *count;
+}
+
+size_t pif_map_bytes(const PIFMap *map) {
+    return sizeof(PIFSlice) * (size_t)map->count;
+}
+
+void pif_map_close(PIFMap *map) {
+    if (map->mapped && map->data) {
+#ifdef _WIN32
+        UnmapViewOfFile(map->data);
+        CloseHandle(map->mapping_handle);
+        CloseHandle(map->file_handle);
+#else
+        munmap((void *)map->data, map->size);
+#endif
+    } else if (map->owned) {
+        free((void *)map->data);
+    }
+    free(map->entries);
+    memset(map, 0, sizeof(*map));
+}
@@ -0,0 +1,59 @@
+// pif_map.h
+// Zero-copy PIF reader: the file is memory-mapped and every entry is a compact
+// slice into the mapping instead of a fixed 256-byte lexeme buffer
+
+#ifndef PIF_MAP_H
+#define PIF_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pif_reader.h"
+
+// 24 bytes per token (PIFEntry is 264). Offsets are 64-bit, so mapped files
+// may exceed 4 GiB.
+typedef struct {
+    uint64_t offset;        // first byte of the lexeme in PIFMap.data
+    uint32_t length;        // lexeme length in bytes
+    int16_t terminal;       // terminal column, -1 until resolved (cg_pif_map_terminals)
+    int32_t bucket;         // symbol table location, -1 for keywords/operators
+    int32_t pos;
+} PIFSlice;
+
+typedef struct {
+    const char *data;       // mapped file (or borrowed string); not NUL-terminated
+    size_t size;
+    PIFSlice *entries;
+    int count;
+    int capacity;
+    int mapped;             // 1 if data must be unmapped on close
+    int owned;              // 1 if data was malloc'd and must be freed on close
+#ifdef _WIN32
+    void *file_handle;
+    void *mapping_handle;
+#endif
+} PIFMap;
+
+// Map a PIF file, text or binary, and index its entries. Returns the entry count,
+// or -1 on error (including a lexeme longer than UINT32_MAX bytes, more than
+// INT_MAX entries, or a binary header that does not match the file).
+int pif_map_open(PIFMap *map, const char *filename);
+
+// Index a PIF held in memory; the buffer is borrowed and must outlive the map
+int pif_map_from_buffer(PIFMap *map, const char *data, size_t size);
+
+// Same for a binary PIF: slices point at the strings inside data
+int pif_map_from_binary(PIFMap *map, const unsigned char *data, size_t size);
+
+// Copy the lexeme of entry i into buf as a C string (truncated to size-1 bytes).
+// Returns the full lexeme length.
+size_t pif_map_lexeme(const PIFMap *map, int i, char *buf, size_t size);
+
+// Compatibility adapter: expand the slices into PIFEntry records
+int pif_map_to_entries(const PIFMap *map, PIFEntry **entries, int *count);
+
+// Bytes used by the entry index (excluding the mapping itself)
+size_t pif_map_bytes(const PIFMap *map);
+
+void pif_map_close(PIFMap *map);
+
+#endif // PIF_MAP_H
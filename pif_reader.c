@@ -3,112 +3,54 @@
 
 #include "pif_reader.h"
 #include "lexer_pif_export.h"
+#include "pif_map.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
+// Every reader goes through the zero-copy map (text or binary) and expands its slices
 int read_pif_from_file(const char *filename, PIFEntry **entries, int *count) {
-    FILE *f = fopen(filename, "r");
-    if (!f) return -1;
-    
     *entries = NULL;
     *count = 0;
-    int capacity = 1024;
-    *entries = malloc(sizeof(PIFEntry) * capacity);
-    
-    char line[512];
-    while (fgets(line, sizeof(line), f)) {
-        // Skip empty lines and header/footer
-        if (strstr(line, "~~~~") || strstr(line, "End PIF")) continue;
-        
-        // Parse line: lexeme bucket,pos or lexeme -1
-        char lexeme[256];
-        int bucket = -1, pos = -1;
-        
-        if (sscanf(line, "%255s %d,%d", lexeme, &bucket, &pos) == 3) {
-            // Format: lexeme bucket,pos
-        } else if (sscanf(line, "%255s %d", lexeme, &bucket) == 2 && bucket == -1) {
-            // Format: lexeme -1
-            pos = -1;
-        } else {
-            // Try just lexeme
-            if (sscanf(line, "%255s", lexeme) == 1) {
-                bucket = -1;
-                pos = -1;
-            } else {
-                continue; // Skip malformed lines
-            }
-        }
-        
-        if (*count >= capacity) {
-            capacity *= 2;
-            *entries = realloc(*entries, sizeof(PIFEntry) * capacity);
-        }
-        
-        strncpy((*entries)[*count].lexeme, lexeme, 255);
-        (*entries)[*count].lexeme[255] = '\0';
-        (*entries)[*count].bucket = bucket;
-        (*entries)[*count].pos = pos;
-        (*count)++;
-    }
-    
-    fclose(f);
-    return *count;
+    PIFMap map;
+    if (pif_map_open(&map, filename) < 0) return -1;
+    int result = pif_map_to_entries(&map, entries, count);
+    pif_map_close(&map);
+    return result;
 }
 
 int read_pif_from_string(const char *pif_str, PIFEntry **entries, int *count) {
     *entries = NULL;
     *count = 0;
-    int capacity = 1024;
-    *entries = malloc(sizeof(PIFEntry) * capacity);
-    
-    const char *p = pif_str;
-    char line[512];
-    
-    while (*p) {
-        // Read a line
-        int i = 0;
-        while (*p && *p != '\n' && i < sizeof(line) - 1) {
-            line[i++] = *p++;
-        }
-        line[i] = '\0';
-        if (*p == '\n') p++;
-        
-        // Skip empty lines and header/footer
-        if (strstr(line, "~~~~") || strstr(line, "End PIF") || strlen(line) == 0) continue;
-        
-        // Parse line
-        char lexeme[256];
-        int bucket = -1, pos = -1;
-        
-        if (sscanf(line, "%255s %d,%d", lexeme, &bucket, &pos) == 3) {
-            // Format: lexeme bucket,pos
-        } else if (sscanf(line, "%255s %d", lexeme, &bucket) == 2 && bucket == -1) {
-            // Format: lexeme -1
-            pos = -1;
-        } else {
-            if (sscanf(line, "%255s", lexeme) == 1) {
-                bucket = -1;
-                pos = -1;
-            } else {
-                continue;
-            }
-        }
-        
-        if (*count >= capacity) {
-            capacity *= 2;
-            *entries = realloc(*entries, sizeof(PIFEntry) * capacity);
-        }
-        
-        strncpy((*entries)[*count].lexeme, lexeme, 255);
-        (*entries)[*count].lexeme[255] = '\0';
-        (*entries)[*count].bucket = bucket;
-        (*entries)[*count].pos = pos;
-        (*count)++;
+    PIFMap map;
+    if (pif_map_from_buffer(&map, pif_str, strlen(pif_str)) < 0) return -1;
+    int result = pif_map_to_entries(&map, entries, count);
+    pif_map_close(&map);
+    return result;
+}
+
+int read_pif_binary_from_buffer(const unsigned char *data, size_t size, PIFEntry **entries, int *count) {
+    *entries = NULL;
+    *count = 0;
+    PIFMap map;
+    if (pif_map_from_binary(&map, data, size) < 0) return -1;
+    int result = pif_map_to_entries(&map, entries, count);
+    pif_map_close(&map);
+    return result;
+}
+
+int read_pif_binary_from_file(const char *filename, PIFEntry **entries, int *count) {
+    *entries = NULL;
+    *count = 0;
+    PIFMap map;
+    if (pif_map_open(&map, filename) < 0) return -1;
+    int result = -1;
+    if (map.size >= 4 && memcmp(map.data, PIF_BINARY_MAGIC, 4) == 0) {
+        result = pif_map_to_entries(&map, entries, count);
     }
-    
-    return *count;
+    pif_map_close(&map);
+    return result;
 }
 
 StrList pif_to_token_list(PIFEntry *entries, int count, StrList *terms) {
@@ -4,6 +4,7 @@
 #ifndef PIF_READER_H
 #define PIF_READER_H
 
+#include <stddef.h>
 #include "first_follow.h"
 
 // PIF entry structure
@@ -20,6 +21,28 @@ int read_pif_from_file(const char *filename, PIFEntry **entries, int *count);
 // Read PIF from string (same format)
 int read_pif_from_string(const char *pif_str, PIFEntry **entries, int *count);
 
+// Binary PIF (little endian):
+//   header   "PIFB", u16 version, u16 flags, then u32 entry_count, token_count,
+//            literal_count, token_bytes, literal_bytes, stream_bytes
+//   tokens   token_count NUL-terminated lexemes of entries without a symbol
+//            table location (keywords, operators, NL)
+//   literals literal_count records: zigzag varint bucket, zigzag varint pos,
+//            NUL-terminated lexeme (one record per distinct location)
+//   stream   one varint per entry: id < token_count is a token, otherwise
+//            id - token_count is a literal
+#define PIF_BINARY_MAGIC "PIFB"
+#define PIF_BINARY_VERSION 1
+#define PIF_BINARY_HEADER_SIZE 32
+
+// Read a binary PIF. Returns number of entries read, or -1 on error.
+// read_pif_from_file detects the format itself, so most callers need not use this.
+// The file is mapped, not read into memory; pif_map_open gives the same entries
+// as 24-byte slices into the mapping without expanding them to PIFEntry.
+int read_pif_binary_from_file(const char *filename, PIFEntry **entries, int *count);
+
+// Same, from a buffer holding the whole file
+int read_pif_binary_from_buffer(const unsigned char *data, size_t size, PIFEntry **entries, int *count);
+
 // Convert PIF entries to token list for parser
 StrList pif_to_token_list(PIFEntry *entries, int count, StrList *terms);
 
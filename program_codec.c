@@ -0,0 +1,672 @@
+// program_codec.c
+// Derivation-replay encoder/decoder with an adaptive binary range coder
+
+#include "program_codec.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RC_TOP (1u << 24)
+#define PROB_BITS 11
+#define PROB_ONE (1u << PROB_BITS)
+#define PROB_MOVE 5
+#define PROB_INIT (PROB_ONE / 2)
+
+#define RECENT 8                // move-to-front window per terminal
+#define RANK_BITS 3             // ranks 1..RECENT-1 as 0..RECENT-2, RECENT = miss
+#define UINT_BITS 34            // unary length contexts for values up to 2^32
+#define BYTE_CONTEXTS 4         // previous byte: none, letter, digit, other
+#define MAX_LEXEME 255          // PIFEntry.lexeme holds 255 bytes
+
+typedef uint16_t Prob;
+
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+} ByteBuf;
+
+static void buf_put(ByteBuf *b, unsigned char c) {
+    if (b->len == b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 4096;
+        b->data = realloc(b->data, b->cap);
+    }
+    b->data[b->len++] = c;
+}
+
+static void put_u16(unsigned char *p, unsigned v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ---- Range coder (LZMA style, 11-bit probabilities) ----
+
+typedef struct {
+    uint64_t low;
+    uint32_t range;
+    unsigned char cache;
+    uint64_t cache_size;
+    ByteBuf *out;
+} RangeEncoder;
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    uint32_t range;
+    uint32_t code;
+    int overrun;
+} RangeDecoder;
+
+static void rc_shift_low(RangeEncoder *rc) {
+    if ((uint32_t)rc->low < 0xFF000000u || (rc->low >> 32) != 0) {
+        unsigned char carry = (unsigned char)(rc->low >> 32);
+        unsigned char temp = rc->cache;
+        do {
+            buf_put(rc->out, (unsigned char)(temp + carry));
+            temp = 0xFF;
+        } while (--rc->cache_size != 0);
+        rc->cache = (unsigned char)(rc->low >> 24);
+    }
+    rc->cache_size++;
+    rc->low = (rc->low & 0x00FFFFFFu) << 8;
+}
+
+static void rc_encode_bit(RangeEncoder *rc, Prob *p, int bit) {
+    uint32_t bound = (rc->range >> PROB_BITS) * *p;
+    if (!bit) {
+        rc->range = bound;
+        *p += (PROB_ONE - *p) >> PROB_MOVE;
+    } else {
+        rc->low += bound;
+        rc->range -= bound;
+        *p -= *p >> PROB_MOVE;
+    }
+    while (rc->range < RC_TOP) {
+        rc->range <<= 8;
+        rc_shift_low(rc);
+    }
+}
+
+static void rc_encode_direct(RangeEncoder *rc, uint32_t value, int bits) {
+    while (bits-- > 0) {
+        rc->range >>= 1;
+        if ((value >> bits) & 1) rc->low += rc->range;
+        while (rc->range < RC_TOP) {
+            rc->range <<= 8;
+            rc_shift_low(rc);
+        }
+    }
+}
+
+static void rc_flush(RangeEncoder *rc) {
+    for (int i = 0; i < 5; i++) rc_shift_low(rc);
+}
+
+static unsigned char rc_next_byte(RangeDecoder *rd) {
+    if (rd->p < rd->end) return *rd->p++;
+    rd->overrun = 1;
+    return 0;
+}
+
+static void rd_init(RangeDecoder *rd, const unsigned char *p, const unsigned char *end) {
+    rd->p = p;
+    rd->end = end;
+    rd->range = 0xFFFFFFFFu;
+    rd->code = 0;
+    rd->overrun = 0;
+    for (int i = 0; i < 5; i++) rd->code = (rd->code << 8) | rc_next_byte(rd);
+}
+
+static int rc_decode_bit(RangeDecoder *rd, Prob *p) {
+    uint32_t bound = (rd->range >> PROB_BITS) * *p;
+    int bit;
+    if (rd->code < bound) {
+        rd->range = bound;
+        *p += (PROB_ONE - *p) >> PROB_MOVE;
+        bit = 0;
+    } else {
+        rd->code -= bound;
+        rd->range -= bound;
+        *p -= *p >> PROB_MOVE;
+        bit = 1;
+    }
+    while (rd->range < RC_TOP) {
+        rd->range <<= 8;
+        rd->code = (rd->code << 8) | rc_next_byte(rd);
+    }
+    return bit;
+}
+
+static uint32_t rc_decode_direct(RangeDecoder *rd, int bits) {
+    uint32_t v = 0;
+    while (bits-- > 0) {
+        rd->range >>= 1;
+        int bit = rd->code >= rd->range;
+        if (bit) rd->code -= rd->range;
+        v = (v << 1) | (uint32_t)bit;
+        while (rd->range < RC_TOP) {
+            rd->range <<= 8;
+            rd->code = (rd->code << 8) | rc_next_byte(rd);
+        }
+    }
+    return v;
+}
+
+// ---- Models ----
+
+static void probs_init(Prob *p, size_t n) {
+    for (size_t i = 0; i < n; i++) p[i] = PROB_INIT;
+}
+
+// Bit tree over bits-bit symbols, MSB first
+static void tree_encode(RangeEncoder *rc, Prob *tree, int bits, unsigned symbol) {
+    unsigned m = 1;
+    for (int i = bits - 1; i >= 0; i--) {
+        int bit = (symbol >> i) & 1;
+        rc_encode_bit(rc, &tree[m], bit);
+        m = (m << 1) | (unsigned)bit;
+    }
+}
+
+static unsigned tree_decode(RangeDecoder *rd, Prob *tree, int bits) {
+    unsigned m = 1;
+    for (int i = 0; i < bits; i++) m = (m << 1) | (unsigned)rc_decode_bit(rd, &tree[m]);
+    return m - (1u << bits);
+}
+
+// Unsigned integers: adaptive unary bit length of v+1, then the remaining bits
+typedef struct {
+    Prob len[UINT_BITS];
+} UIntModel;
+
+static void uint_encode(RangeEncoder *rc, UIntModel *m, uint32_t v) {
+    uint64_t x = (uint64_t)v + 1;
+    int n = 0;
+    while ((x >> n) > 1) n++;
+    for (int i = 0; i < n; i++) rc_encode_bit(rc, &m->len[i], 1);
+    rc_encode_bit(rc, &m->len[n], 0);
+    rc_encode_direct(rc, (uint32_t)(x & ((1ull << n) - 1)), n);
+}
+
+static int uint_decode(RangeDecoder *rd, UIntModel *m, uint32_t *v) {
+    int n = 0;
+    while (rc_decode_bit(rd, &m->len[n])) {
+        if (++n >= UINT_BITS - 1) return -1;
+    }
+    uint64_t x = (1ull << n) | rc_decode_direct(rd, n);
+    if (x - 1 > 0xFFFFFFFFull) return -1;
+    *v = (uint32_t)(x - 1);
+    return 0;
+}
+
+static uint32_t zigzag(int v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int unzigzag(uint32_t v) {
+    return (int)(v >> 1) ^ -(int)(v & 1);
+}
+
+// Distinct (lexeme, bucket, pos) of one terminal
+typedef struct {
+    uint32_t offset;        // into the string pool
+    int length;
+    int bucket;
+    int pos;
+    int terminal;
+    int slot;               // index in the terminal's dictionary
+} Literal;
+
+typedef struct {
+    int *dict;              // literal ids in order of first use
+    int count;
+    int cap;
+    int recent[RECENT];     // literal ids, most recent first
+    int recent_count;
+    Prob repeat;            // same entry as last time
+    Prob rank[1 << RANK_BITS];
+    Prob is_new;
+    UIntModel index;
+} TerminalModel;
+
+typedef struct {
+    int *viable;            // productions in this nonterminal's table row
+    int count;
+    int bits;
+    Prob *tree;
+} ChoiceModel;
+
+typedef struct {
+    const CompiledGrammar *cg;
+    ChoiceModel *choices;   // per nonterminal
+    TerminalModel *terms;   // per terminal column
+    UIntModel lex_len;
+    UIntModel bucket;
+    UIntModel pos;
+    Prob bytes[BYTE_CONTEXTS][256];
+
+    Literal *literals;
+    int literal_count;
+    int literal_cap;
+    char *pool;
+    size_t pool_len;
+    size_t pool_cap;
+
+    int *lookup;            // encoder: open-addressing table of literal ids (-1 empty)
+    size_t lookup_mask;
+} CodecModels;
+
+static int compare_ints(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+static int models_init(CodecModels *m, const CompiledGrammar *cg, int with_lookup) {
+    memset(m, 0, sizeof(*m));
+    m->cg = cg;
+    m->choices = calloc(cg->nt_count > 0 ? cg->nt_count : 1, sizeof(ChoiceModel));
+    m->terms = calloc(cg->t_count > 0 ? cg->t_count : 1, sizeof(TerminalModel));
+    if (!m->choices || !m->terms) return -1;
+
+    for (int nt = 0; nt < cg->nt_count; nt++) {
+        ChoiceModel *c = &m->choices[nt];
+        c->viable = malloc(sizeof(int) * (cg->t_count > 0 ? cg->t_count : 1));
+        for (int col = 0; col < cg->t_count; col++) {
+            int v = cg->table[nt][col];
+            if (v < 0 || v >= cg->prod_count) continue;
+            int seen = 0;
+            for (int k = 0; k < c->count; k++) seen |= c->viable[k] == v;
+            if (!seen) c->viable[c->count++] = v;
+        }
+        qsort(c->viable, c->count, sizeof(int), compare_ints);
+        while ((1 << c->bits) < c->count) c->bits++;
+        c->tree = malloc(sizeof(Prob) << c->bits);
+        probs_init(c->tree, (size_t)1 << c->bits);
+    }
+    for (int t = 0; t < cg->t_count; t++) {
+        TerminalModel *tm = &m->terms[t];
+        tm->repeat = PROB_INIT;
+        probs_init(tm->rank, 1 << RANK_BITS);
+        tm->is_new = PROB_INIT;
+        probs_init(tm->index.len, UINT_BITS);
+    }
+    probs_init(m->lex_len.len, UINT_BITS);
+    probs_init(m->bucket.len, UINT_BITS);
+    probs_init(m->pos.len, UINT_BITS);
+    probs_init(&m->bytes[0][0], BYTE_CONTEXTS * 256);
+
+    if (with_lookup) {
+        m->lookup_mask = 1023;
+        m->lookup = malloc(sizeof(int) * (m->lookup_mask + 1));
+        memset(m->lookup, -1, sizeof(int) * (m->lookup_mask + 1));
+    }
+    return 0;
+}
+
+static void models_free(CodecModels *m) {
+    if (m->choices) {
+        for (int nt = 0; nt < m->cg->nt_count; nt++) {
+            free(m->choices[nt].viable);
+            free(m->choices[nt].tree);
+        }
+    }
+    if (m->terms) {
+        for (int t = 0; t < m->cg->t_count; t++) free(m->terms[t].dict);
+    }
+    free(m->choices);
+    free(m->terms);
+    free(m->literals);
+    free(m->pool);
+    free(m->lookup);
+}
+
+static uint64_t literal_hash(const char *lex, size_t len, int bucket, int pos, int terminal) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)lex[i];
+        h *= 1099511628211ull;
+    }
+    h ^= (uint64_t)(uint32_t)bucket * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)(uint32_t)pos * 0xC2B2AE3D27D4EB4Full;
+    h ^= (uint64_t)(uint32_t)terminal * 0x165667B19E3779F9ull;
+    return h ^ (h >> 29);
+}
+
+static int add_literal(CodecModels *m, int terminal, const char *lex, int len, int bucket, int pos) {
+    if (m->literal_count == m->literal_cap) {
+        m->literal_cap = m->literal_cap ? m->literal_cap * 2 : 256;
+        m->literals = realloc(m->literals, sizeof(Literal) * m->literal_cap);
+    }
+    if (m->pool_len + (size_t)len > m->pool_cap) {
+        while (m->pool_len + (size_t)len > m->pool_cap) m->pool_cap = m->pool_cap ? m->pool_cap * 2 : 4096;
+        m->pool = realloc(m->pool, m->pool_cap);
+    }
+    if (len > 0) memcpy(m->pool + m->pool_len, lex, (size_t)len);
+
+    TerminalModel *tm = &m->terms[terminal];
+    if (tm->count == tm->cap) {
+        tm->cap = tm->cap ? tm->cap * 2 : 16;
+        tm->dict = realloc(tm->dict, sizeof(int) * tm->cap);
+    }
+    int id = m->literal_count++;
+    Literal *lit = &m->literals[id];
+    lit->offset = (uint32_t)m->pool_len;
+    lit->length = len;
+    lit->bucket = bucket;
+    lit->pos = pos;
+    lit->terminal = terminal;
+    lit->slot = tm->count;
+    tm->dict[tm->count++] = id;
+    m->pool_len += (size_t)len;
+    return id;
+}
+
+static void lookup_insert(CodecModels *m, int id, uint64_t h) {
+    size_t i = h & m->lookup_mask;
+    while (m->lookup[i] >= 0) i = (i + 1) & m->lookup_mask;
+    m->lookup[i] = id;
+}
+
+// Encoder side: literal id of a token, -1 if not seen yet
+static int find_literal(CodecModels *m, int terminal, const char *lex, int len, int bucket, int pos, uint64_t h) {
+    for (size_t i = h & m->lookup_mask; m->lookup[i] >= 0; i = (i + 1) & m->lookup_mask) {
+        const Literal *lit = &m->literals[m->lookup[i]];
+        if (lit->terminal == terminal && lit->length == len && lit->bucket == bucket &&
+            lit->pos == pos && memcmp(m->pool + lit->offset, lex, (size_t)len) == 0) {
+            return m->lookup[i];
+        }
+    }
+    return -1;
+}
+
+static void grow_lookup(CodecModels *m) {
+    if ((size_t)m->literal_count * 2 <= m->lookup_mask + 1) return;
+    m->lookup_mask = m->lookup_mask * 2 + 1;
+    m->lookup = realloc(m->lookup, sizeof(int) * (m->lookup_mask + 1));
+    memset(m->lookup, -1, sizeof(int) * (m->lookup_mask + 1));
+    for (int id = 0; id < m->literal_count; id++) {
+        const Literal *lit = &m->literals[id];
+        lookup_insert(m, id, literal_hash(m->pool + lit->offset, (size_t)lit->length,
+                                          lit->bucket, lit->pos, lit->terminal));
+    }
+}
+
+static int recent_rank(const TerminalModel *tm, int id) {
+    for (int r = 0; r < tm->recent_count; r++) {
+        if (tm->recent[r] == id) return r;
+    }
+    return RECENT;
+}
+
+static void recent_touch(TerminalModel *tm, int id, int rank) {
+    if (rank == RECENT) {
+        rank = tm->recent_count < RECENT ? tm->recent_count++ : RECENT - 1;
+    }
+    memmove(tm->recent + 1, tm->recent, sizeof(int) * (size_t)rank);
+    tm->recent[0] = id;
+}
+
+static int byte_context(int prev) {
+    if (prev < 0) return 0;
+    if ((prev >= 'a' && prev <= 'z') || (prev >= 'A' && prev <= 'Z') || prev == '_') return 1;
+    if (prev >= '0' && prev <= '9') return 2;
+    return 3;
+}
+
+uint32_t program_grammar_hash(const CompiledGrammar *cg) {
+    uint64_t h = 1469598103934665603ull;
+#define MIX(v) do { h ^= (uint32_t)(v); h *= 1099511628211ull; } while (0)
+    MIX(cg->nt_count);
+    MIX(cg->t_count);
+    MIX(cg->prod_count);
+    for (int p = 0; p < cg->prod_count; p++) {
+        MIX(cg->prod_lhs[p]);
+        MIX(cg->prod_len[p]);
+        for (int k = 0; k < cg->prod_len[p]; k++) MIX(cg->prod_rhs[p][k]);
+    }
+    for (int t = 0; t < cg->t_count; t++) {
+        for (const char *s = cg->terms->items[t]; *s; s++) MIX((unsigned char)*s);
+        MIX(0);
+    }
+#undef MIX
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static void encode_token(RangeEncoder *rc, CodecModels *m, int terminal, const PIFEntry *e) {
+    TerminalModel *tm = &m->terms[terminal];
+    int len = (int)strlen(e->lexeme);
+    uint64_t h = literal_hash(e->lexeme, (size_t)len, e->bucket, e->pos, terminal);
+    int id = find_literal(m, terminal, e->lexeme, len, e->bucket, e->pos, h);
+    int rank = id >= 0 ? recent_rank(tm, id) : RECENT;
+
+    rc_encode_bit(rc, &tm->repeat, rank != 0);
+    if (rank != 0) tree_encode(rc, tm->rank, RANK_BITS, (unsigned)(rank - 1));
+    if (rank == RECENT) {
+        rc_encode_bit(rc, &tm->is_new, id < 0);
+        if (id >= 0) {
+            uint_encode(rc, &tm->index, (uint32_t)m->literals[id].slot);
+        } else {
+            uint_encode(rc, &m->lex_len, (uint32_t)len);
+            int prev = -1;
+            for (int i = 0; i < len; i++) {
+                unsigned char c = (unsigned char)e->lexeme[i];
+                tree_encode(rc, m->bytes[byte_context(prev)], 8, c);
+                prev = c;
+            }
+            uint_encode(rc, &m->bucket, zigzag(e->bucket));
+            uint_encode(rc, &m->pos, zigzag(e->pos));
+            id = add_literal(m, terminal, e->lexeme, len, e->bucket, e->pos);
+            lookup_insert(m, id, h);
+            grow_lookup(m);
+        }
+    }
+    recent_touch(tm, id, rank);
+}
+
+static int decode_token(RangeDecoder *rd, CodecModels *m, int terminal, PIFSlice *slice) {
+    TerminalModel *tm = &m->terms[terminal];
+    int rank = rc_decode_bit(rd, &tm->repeat) ? (int)tree_decode(rd, tm->rank, RANK_BITS) + 1 : 0;
+    int id;
+    if (rank < RECENT) {
+        if (rank >= tm->recent_count) return -1;
+        id = tm->recent[rank];
+    } else {
+        if (!rc_decode_bit(rd, &tm->is_new)) {
+            uint32_t slot;
+            if (uint_decode(rd, &tm->index, &slot) != 0 || slot >= (uint32_t)tm->count) return -1;
+            id = tm->dict[slot];
+        } else {
+            uint32_t len, bucket, pos;
+            if (uint_decode(rd, &m->lex_len, &len) != 0 || len > MAX_LEXEME) return -1;
+            char lex[MAX_LEXEME];
+            int prev = -1;
+            for (uint32_t i = 0; i < len; i++) {
+                lex[i] = (char)tree_decode(rd, m->bytes[byte_context(prev)], 8);
+                prev = (unsigned char)lex[i];
+            }
+            if (uint_decode(rd, &m->bucket, &bucket) != 0 || uint_decode(rd, &m->pos, &pos) != 0) return -1;
+            id = add_literal(m, terminal, lex, (int)len, unzigzag(bucket), unzigzag(pos));
+        }
+    }
+    recent_touch(tm, id, rank);
+
+    const Literal *lit = &m->literals[id];
+    slice->offset = lit->offset;
+    slice->length = (uint32_t)lit->length;
+    slice->terminal = (int16_t)terminal;
+    slice->bucket = lit->bucket;
+    slice->pos = lit->pos;
+    return 0;
+}
+
+// Position of production p in its nonterminal's viable list
+static int choice_index(const ChoiceModel *c, int p) {
+    for (int k = 0; k < c->count; k++) {
+        if (c->viable[k] == p) return k;
+    }
+    return -1;
+}
+
+int program_encode(const CompiledGrammar *cg, const LazyTree *lt,
+                   const PIFEntry *entries, int count,
+                   unsigned char **out, size_t *out_size) {
+    *out = NULL;
+    *out_size = 0;
+    if (cg->nt_count == 0 || cg->dollar < 0) return -1;
+
+    CodecModels m;
+    if (models_init(&m, cg, 1) != 0) {
+        models_free(&m);
+        return -1;
+    }
+    ByteBuf buf = { NULL, 0, 0 };
+    for (int i = 0; i < PROGRAM_CODEC_HEADER_SIZE; i++) buf_put(&buf, 0);
+    RangeEncoder rc = { 0, 0xFFFFFFFFu, 0, 1, &buf };
+
+    // Replay the leftmost derivation exactly as the parser built it
+    int stack_cap = 256;
+    int *stack = malloc(sizeof(int) * stack_cap);
+    int sp = 0;
+    int end_symbol = cg->nt_count + cg->dollar;
+    stack[sp++] = end_symbol;
+    stack[sp++] = 0;
+    int step = 0, cursor = 0, status = 0;
+
+    while (sp > 0 && stack[sp - 1] != end_symbol) {
+        int top = stack[--sp];
+        if (cg_is_terminal(cg, top)) {
+            if (cursor >= count) { status = -1; break; }
+            encode_token(&rc, &m, top - cg->nt_count, &entries[cursor++]);
+            continue;
+        }
+        int p = lazy_tree_production(lt, step++);
+        const ChoiceModel *c = &m.choices[top];
+        int k = p >= 0 && cg->prod_lhs[p] == top ? choice_index(c, p) : -1;
+        if (k < 0) { status = -1; break; }
+        if (c->count > 1) tree_encode(&rc, m.choices[top].tree, c->bits, (unsigned)k);
+
+        int len = cg->prod_len[p];
+        if (sp + len > stack_cap) {
+            while (sp + len > stack_cap) stack_cap *= 2;
+            stack = realloc(stack, sizeof(int) * stack_cap);
+        }
+        for (int j = len - 1; j >= 0; j--) stack[sp++] = cg->prod_rhs[p][j];
+    }
+    if (step != lt->step_count || cursor != count) status = -1;
+    free(stack);
+    models_free(&m);
+
+    if (status != 0) {
+        free(buf.data);
+        return -1;
+    }
+    rc_flush(&rc);
+
+    memcpy(buf.data, PROGRAM_CODEC_MAGIC, 4);
+    put_u16(buf.data + 4, PROGRAM_CODEC_VERSION);
+    put_u16(buf.data + 6, 0);
+    put_u32(buf.data + 8, (uint32_t)count);
+    put_u32(buf.data + 12, (uint32_t)step);
+    put_u32(buf.data + 16, program_grammar_hash(cg));
+    *out = buf.data;
+    *out_size = buf.len;
+    return 0;
+}
+
+int program_decode(const CompiledGrammar *cg, const unsigned char *data, size_t size,
+                   PIFMap *tokens, LazyTree *lt, const char *stmt_symbol) {
+    memset(tokens, 0, sizeof(*tokens));
+    if (lt) lazy_tree_begin(lt, cg, stmt_symbol);
+    if (size < PROGRAM_CODEC_HEADER_SIZE || memcmp(data, PROGRAM_CODEC_MAGIC, 4) != 0) return -1;
+    if ((data[4] | (data[5] << 8)) != PROGRAM_CODEC_VERSION) return -1;
+    uint32_t entry_count = get_u32(data + 8);
+    uint32_t step_count = get_u32(data + 12);
+    if (get_u32(data + 16) != program_grammar_hash(cg)) return -1;
+    if (cg->nt_count == 0 || cg->dollar < 0 || entry_count > 0x7FFFFFFFu || step_count > 0x7FFFFFFFu) return -1;
+
+    CodecModels m;
+    if (models_init(&m, cg, 0) != 0) {
+        models_free(&m);
+        return -1;
+    }
+    // Every token costs at least one adaptive bit, which never codes in less
+    // than 1/46 of an output bit, so the header cannot promise more than this
+    size_t payload = size - PROGRAM_CODEC_HEADER_SIZE;
+    if ((uint64_t)entry_count > (uint64_t)payload * 8 * 64 + 64) {
+        models_free(&m);
+        return -1;
+    }
+    PIFSlice *out = malloc(sizeof(PIFSlice) * (entry_count > 0 ? entry_count : 1));
+    if (!out) {
+        free(out);
+        models_free(&m);
+        return -1;
+    }
+    RangeDecoder rd;
+    rd_init(&rd, data + PROGRAM_CODEC_HEADER_SIZE, data + size);
+
+    int stack_cap = 256;
+    int *stack = malloc(sizeof(int) * stack_cap);
+    int sp = 0;
+    int end_symbol = cg->nt_count + cg->dollar;
+    stack[sp++] = end_symbol;
+    stack[sp++] = 0;
+    uint32_t step = 0, cursor = 0;
+    int status = 0;
+
+    while (sp > 0 && stack[sp - 1] != end_symbol) {
+        if (rd.overrun) { status = -1; break; }
+        int top = stack[--sp];
+        if (cg_is_terminal(cg, top)) {
+            if (cursor >= entry_count || decode_token(&rd, &m, top - cg->nt_count, &out[cursor]) != 0) {
+                status = -1;
+                break;
+            }
+            cursor++;
+            continue;
+        }
+        ChoiceModel *c = &m.choices[top];
+        if (c->count == 0 || step >= step_count) { status = -1; break; }
+        unsigned k = c->count > 1 ? tree_decode(&rd, c->tree, c->bits) : 0;
+        if (k >= (unsigned)c->count) { status = -1; break; }
+        int p = c->viable[k];
+        step++;
+        if (lt) lazy_tree_add_step(lt, p, (int)cursor);
+
+        int len = cg->prod_len[p];
+        if (sp + len > stack_cap) {
+            while (sp + len > stack_cap) stack_cap *= 2;
+            stack = realloc(stack, sizeof(int) * stack_cap);
+        }
+        for (int j = len - 1; j >= 0; j--) stack[sp++] = cg->prod_rhs[p][j];
+    }
+    if (rd.overrun || step != step_count || cursor != entry_count) status = -1;
+    free(stack);
+    if (status == 0) {
+        // The lexeme pool becomes the map's data
+        tokens->data = m.pool;
+        tokens->size = m.pool_len;
+        tokens->owned = 1;
+        tokens->entries = out;
+        tokens->count = (int)entry_count;
+        tokens->capacity = (int)entry_count;
+        m.pool = NULL;
+    }
+    models_free(&m);
+
+    if (status != 0) {
+        free(out);
+        if (lt) {
+            lazy_tree_free(lt);
+            lazy_tree_begin(lt, cg, stmt_symbol);
+        }
+        return -1;
+    }
+    return 0;
+}
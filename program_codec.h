@@ -0,0 +1,49 @@
+// program_codec.h
+// Grammar-aware compressed program encoding: a parsed program is stored as the
+// LL(1) choices the parse table leaves open plus references to its literals,
+// all entropy coded with adaptive models. The decoder replays the derivation
+// with the same grammar to rebuild both the PIF and the tree.
+
+#ifndef PROGRAM_CODEC_H
+#define PROGRAM_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "compiled_grammar.h"
+#include "lazy_tree.h"
+#include "pif_map.h"
+
+// Container (little endian):
+//   "FCPK", u16 version, u16 flags, u32 entry_count, u32 step_count,
+//   u32 grammar hash, then the range-coded payload to the end of the data
+#define PROGRAM_CODEC_MAGIC "FCPK"
+#define PROGRAM_CODEC_VERSION 1
+#define PROGRAM_CODEC_HEADER_SIZE 20
+
+// Payload models, in derivation order:
+//   nonterminal expansion  skipped if the table row allows one production,
+//                          else the choice among the row's productions
+//                          (adaptive bit tree per nonterminal)
+//   terminal               rank in the terminal's 8 most recent entries, or a
+//                          miss followed by an index into the terminal's entry
+//                          dictionary or a new entry (length, bytes, bucket, pos)
+
+// Encode the program whose derivation lt recorded (a successful parse of
+// entries). *out is malloc'd. Returns 0 on success, -1 on error.
+int program_encode(const CompiledGrammar *cg, const LazyTree *lt,
+                   const PIFEntry *entries, int count,
+                   unsigned char **out, size_t *out_size);
+
+// Decode with the same grammar. tokens receives one slice per entry, with the
+// terminal column set, pointing into a pool of the program's distinct lexemes
+// that the map owns (pif_map_close frees it; pif_map_to_entries expands it).
+// If lt is not NULL the derivation is recorded into it (lazy_tree_begin with
+// stmt_symbol); set lt->pif_entries before materializing.
+// Returns 0 on success, -1 on malformed data or a different grammar.
+int program_decode(const CompiledGrammar *cg, const unsigned char *data, size_t size,
+                   PIFMap *tokens, LazyTree *lt, const char *stmt_symbol);
+
+// Fingerprint of the productions and terminal names stored in the header
+uint32_t program_grammar_hash(const CompiledGrammar *cg);
+
+#endif // PROGRAM_CODEC_H
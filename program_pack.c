@@ -0,0 +1,264 @@
+// program_pack.c
+// Store parsed FlowCalc programs in the grammar-aware compressed encoding
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "first_follow.h"
+#include "parse_table.h"
+#include "pif_reader.h"
+#include "pif_map.h"
+#include "pif_generator.h"
+#include "compiled_grammar.h"
+#include "lazy_tree.h"
+#include "parse_tree.h"
+#include "program_codec.h"
+
+static double now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static unsigned char *read_binary_file(const char *filename, size_t *len) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (!data || fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return data;
+}
+
+static int write_binary_file(const char *filename, const unsigned char *data, size_t len) {
+    FILE *f = fopen(filename, "wb");
+    if (!f) return -1;
+    size_t written = fwrite(data, 1, len, f);
+    return fclose(f) == 0 && written == len ? 0 : -1;
+}
+
+static int same_entries(const PIFEntry *entries, int count, const PIFMap *tokens) {
+    if (tokens->count != count) return 0;
+    for (int i = 0; i < count; i++) {
+        const PIFSlice *s = &tokens->entries[i];
+        if (s->length != strlen(entries[i].lexeme) ||
+            memcmp(tokens->data + s->offset, entries[i].lexeme, s->length) != 0 ||
+            s->bucket != entries[i].bucket || s->pos != entries[i].pos) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void write_tree(LazyTree *lt, const char *tree_file) {
+    FILE *out = fopen(tree_file, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Failed to open output file %s\n", tree_file);
+        return;
+    }
+    fprintf(out, "Sequence accepted\n\n");
+    fprintf(out, "Parse Tree (Father/Sibling Relations):\n");
+    fprintf(out, "========================================\n\n");
+    ParseTreeNode *tree = lazy_tree_materialize(lt, 0);
+    if (tree) {
+        tree_print_table(tree, out);
+        tree_node_free(tree);
+    } else {
+        fprintf(out, "Error: Parse tree is NULL\n");
+    }
+    fclose(out);
+    printf("Parse tree table written to %s\n", tree_file);
+}
+
+// Parse the PIF, encode its derivation and check that it decodes back
+static int pack(const CompiledGrammar *cg, const char *input_file, const char *output_file) {
+    PIFEntry *entries = NULL;
+    int count = 0;
+    if (read_pif_from_file(input_file, &entries, &count) < 0) {
+        fprintf(stderr, "Error: failed to read PIF from %s\n", input_file);
+        return 1;
+    }
+    LazyTree lt;
+    if (lazy_tree_parse(&lt, cg, entries, count, "stmt") != PARSE_ACCEPT) {
+        fprintf(stderr, "Parse failed. Error: %s\n", lt.error_location ? lt.error_location : "unknown");
+        lazy_tree_free(&lt);
+        free_pif_entries(entries, count);
+        return 1;
+    }
+
+    unsigned char *packed = NULL;
+    size_t packed_size = 0;
+    double start = now_ms();
+    int res = program_encode(cg, &lt, entries, count, &packed, &packed_size);
+    double encode_ms = now_ms() - start;
+    if (res != 0 || write_binary_file(output_file, packed, packed_size) != 0) {
+        fprintf(stderr, "Error: failed to write %s\n", output_file);
+        free(packed);
+        lazy_tree_free(&lt);
+        free_pif_entries(entries, count);
+        return 1;
+    }
+
+    PIFMap decoded;
+    start = now_ms();
+    res = program_decode(cg, packed, packed_size, &decoded, NULL, NULL);
+    double decode_ms = now_ms() - start;
+    int ok = res == 0 && same_entries(entries, count, &decoded);
+
+    size_t input_size = 0;
+    unsigned char *input = read_binary_file(input_file, &input_size);
+    free(input);
+    printf("%d tokens, %d derivation steps\n", count, lt.step_count);
+    printf("PIF %zu bytes -> %zu bytes packed (%.1fx)\n", input_size, packed_size,
+           packed_size ? (double)input_size / packed_size : 0.0);
+    printf("Encoded in %.2f ms, decoded in %.2f ms, round trip %s\n", encode_ms, decode_ms, ok ? "ok" : "FAILED");
+
+    pif_map_close(&decoded);
+    free(packed);
+    lazy_tree_free(&lt);
+    free_pif_entries(entries, count);
+    return ok ? 0 : 1;
+}
+
+static int unpack(const CompiledGrammar *cg, const char *input_file, const char *output_file,
+                  int binary, const char *tree_file) {
+    size_t size = 0;
+    unsigned char *data = read_binary_file(input_file, &size);
+    if (!data) {
+        fprintf(stderr, "Error: failed to read %s\n", input_file);
+        return 1;
+    }
+    PIFMap tokens;
+    LazyTree lt;
+    double start = now_ms();
+    int res = program_decode(cg, data, size, &tokens, &lt, "stmt");
+    double decode_ms = now_ms() - start;
+    free(data);
+    if (res != 0) {
+        fprintf(stderr, "Error: %s is not a packed program for this grammar\n", input_file);
+        lazy_tree_free(&lt);
+        return 1;
+    }
+    printf("%d tokens, %d derivation steps decoded in %.2f ms\n", tokens.count, lt.step_count, decode_ms);
+
+    PIFEntry *entries = NULL;
+    int count = 0;
+    pif_map_to_entries(&tokens, &entries, &count);
+    pif_map_close(&tokens);
+    lt.pif_entries = entries;
+    lt.pif_count = count;
+
+    res = binary ? write_pif_binary_to_file(output_file, entries, count)
+                 : write_pif_to_file(output_file, entries, count);
+    if (res != 0) {
+        fprintf(stderr, "Error: failed to write PIF to %s\n", output_file);
+    } else {
+        printf("Wrote %d entries to %s (%s)\n", count, output_file, binary ? "binary" : "text");
+    }
+    if (tree_file) write_tree(&lt, tree_file);
+
+    lazy_tree_free(&lt);
+    free_pif_entries(entries, count);
+    return res == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *tree_file = NULL;
+    int binary = 0;
+    int argi = 1;
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0 &&
+           strcmp(argv[argi], "--pack") != 0 && strcmp(argv[argi], "--unpack") != 0) {
+        if (strcmp(argv[argi], "--tree") == 0 && argi + 1 < argc) {
+            tree_file = argv[++argi];
+        } else if (strcmp(argv[argi], "--binary") == 0) {
+            binary = 1;
+        } else {
+            break;
+        }
+        argi++;
+    }
+    int packing = argc - argi == 4 && strcmp(argv[argi + 1], "--pack") == 0;
+    int unpacking = argc - argi == 4 && strcmp(argv[argi + 1], "--unpack") == 0;
+    if (!packing && !unpacking) {
+        fprintf(stderr, "Usage: %s [--tree tree_file] [--binary] <grammar_file> --pack <input_pif> <output_fcpk>\n", argv[0]);
+        fprintf(stderr, "       %s [--tree tree_file] [--binary] <grammar_file> --unpack <input_fcpk> <output_pif>\n", argv[0]);
+        fprintf(stderr, "  --pack: parse the PIF and store it as its LL(1) choices and literal references\n");
+        fprintf(stderr, "  --unpack: rebuild the PIF (and with --tree, the parse tree table) from a packed program\n");
+        fprintf(stderr, "  --binary: write the unpacked PIF in the binary format\n");
+        return 1;
+    }
+    const char *grammar_file = argv[argi];
+    const char *input_file = argv[argi + 2];
+    const char *output_file = argv[argi + 3];
+
+    // Load grammar and build the parse table
+    StrList nonterms, terms;
+    ProdList prods;
+    sl_init(&nonterms);
+    sl_init(&terms);
+    pl_init(&prods);
+
+    load_grammar(grammar_file, &nonterms, &terms, &prods);
+    if (nonterms.count == 0 || terms.count == 0 || prods.count == 0) {
+        fprintf(stderr, "Error: Failed to load grammar\n");
+        return 1;
+    }
+    if (sl_index(&terms, "$") == -1) {
+        sl_add(&terms, "$");
+    }
+
+    FirstTable first;
+    first.sets = malloc(sizeof(StrList) * nonterms.count);
+    for (int i = 0; i < nonterms.count; i++) {
+        sl_init(&first.sets[i]);
+    }
+    compute_first(&nonterms, &terms, &prods, &first);
+
+    FollowTable follow;
+    follow.sets = malloc(sizeof(StrList) * nonterms.count);
+    for (int i = 0; i < nonterms.count; i++) {
+        sl_init(&follow.sets[i]);
+    }
+    compute_follow(&nonterms, &terms, &prods, &first, &follow);
+
+    int **table = build_parse_table(&nonterms, &terms, &prods, &first, &follow);
+    if (!table) {
+        fprintf(stderr, "Error: Failed to build parse table\n");
+        return 1;
+    }
+
+    CompiledGrammar cg;
+    if (cg_init(&cg, table, &nonterms, &terms, &prods) != 0) {
+        fprintf(stderr, "Error: Failed to compile grammar\n");
+        return 1;
+    }
+
+    int status = packing ? pack(&cg, input_file, output_file)
+                         : unpack(&cg, input_file, output_file, binary, tree_file);
+
+    // Cleanup
+    cg_free(&cg);
+    for (int i = 0; i < nonterms.count + terms.count; i++) {
+        free(table[i]);
+    }
+    free(table);
+    for (int i = 0; i < nonterms.count; i++) {
+        sl_free(&first.sets[i]);
+        sl_free(&follow.sets[i]);
+    }
+    free(first.sets);
+    free(follow.sets);
+    sl_free(&nonterms);
+    sl_free(&terms);
+    pl_free(&prods);
+
+    return status;
+}
@@ -0,0 +1,863 @@
+// regex_dfa.c
+// Regex parser, Thompson construction, subset construction and Hopcroft minimization
+
+#include "regex_dfa.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ALPHA 256
+#define NFA_MAX_STATES (1 << 22)
+
+typedef struct {
+    uint32_t w[ALPHA / 32];
+} ByteSet;
+
+static void set_add(ByteSet *s, int c) { s->w[c >> 5] |= 1u << (c & 31); }
+static int set_has(const ByteSet *s, int c) { return (int)((s->w[c >> 5] >> (c & 31)) & 1); }
+
+static void set_range(ByteSet *s, int lo, int hi) {
+    for (int c = lo; c <= hi; c++) set_add(s, c);
+}
+
+static void set_invert(ByteSet *s) {
+    for (int i = 0; i < ALPHA / 32; i++) s->w[i] = ~s->w[i];
+}
+
+static void set_union(ByteSet *s, const ByteSet *t) {
+    for (int i = 0; i < ALPHA / 32; i++) s->w[i] |= t->w[i];
+}
+
+// ---------------------------------------------------------------------------
+// Parser: recursive descent into an array of syntax nodes
+
+typedef enum { RX_SET, RX_EMPTY, RX_CAT, RX_ALT, RX_REPEAT } RxKind;
+
+typedef struct {
+    RxKind kind;
+    int a, b;               // operands: CAT and ALT use both, REPEAT only a
+    int min, max;           // REPEAT bounds, max -1 = unbounded
+    ByteSet set;            // SET
+} RxNode;
+
+typedef struct {
+    const char *re;
+    int pos;
+    int depth;              // groups open at pos
+    RxNode *nodes;
+    int count;
+    int cap;
+    int error;              // 0, -1 (memory) or -2 (syntax)
+    int err_pos;
+} Parser;
+
+static int new_node(Parser *ps, RxKind kind) {
+    if (ps->count == ps->cap) {
+        int cap = ps->cap ? ps->cap * 2 : 64;
+        RxNode *grown = realloc(ps->nodes, sizeof(RxNode) * (size_t)cap);
+        if (!grown) {
+            ps->error = -1;
+            return -1;
+        }
+        ps->nodes = grown;
+        ps->cap = cap;
+    }
+    RxNode *n = &ps->nodes[ps->count];
+    memset(n, 0, sizeof(*n));
+    n->kind = kind;
+    n->a = n->b = -1;
+    return ps->count++;
+}
+
+static int syntax_error(Parser *ps) {
+    if (!ps->error) {
+        ps->error = -2;
+        ps->err_pos = ps->pos;
+    }
+    return -1;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Escape at ps->pos ('\'). Returns the byte it stands for, or ALPHA for a class
+// escape (stored in *set), or -1 on a syntax error.
+static int parse_escape(Parser *ps, ByteSet *set) {
+    char c = ps->re[++ps->pos];
+    if (!c) return syntax_error(ps);
+    ps->pos++;
+    memset(set, 0, sizeof(*set));
+    switch (c) {
+    case 'd': case 'D':
+        set_range(set, '0', '9');
+        break;
+    case 'w': case 'W':
+        set_range(set, '0', '9');
+        set_range(set, 'A', 'Z');
+        set_range(set, 'a', 'z');
+        set_add(set, '_');
+        break;
+    case 's': case 'S':
+        set_add(set, ' ');
+        set_range(set, '\t', '\r');
+        break;
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case 'f': return '\f';
+    case 'v': return '\v';
+    case 'x': {
+        int hi = hex_value(ps->re[ps->pos]);
+        int lo = hi < 0 ? -1 : hex_value(ps->re[ps->pos + 1]);
+        if (lo < 0) return syntax_error(ps);
+        ps->pos += 2;
+        return hi * 16 + lo;
+    }
+    default:
+        return (unsigned char)c;
+    }
+    if (c == 'D' || c == 'W' || c == 'S') set_invert(set);
+    return ALPHA;
+}
+
+// Bracket expression at ps->pos ('[')
+static int parse_class(Parser *ps, ByteSet *set) {
+    memset(set, 0, sizeof(*set));
+    ps->pos++;
+    int negate = ps->re[ps->pos] == '^';
+    if (negate) ps->pos++;
+    for (int first = 1;; first = 0) {
+        char c = ps->re[ps->pos];
+        if (!c) return syntax_error(ps);
+        if (c == ']' && !first) {
+            ps->pos++;
+            break;
+        }
+        int lo;
+        if (c == '\\') {
+            ByteSet escaped;
+            lo = parse_escape(ps, &escaped);
+            if (lo < 0) return -1;
+            if (lo == ALPHA) {
+                set_union(set, &escaped);
+                continue;
+            }
+        } else {
+            lo = (unsigned char)c;
+            ps->pos++;
+        }
+        int hi = lo;
+        if (ps->re[ps->pos] == '-' && ps->re[ps->pos + 1] && ps->re[ps->pos + 1] != ']') {
+            ps->pos++;
+            if (ps->re[ps->pos] == '\\') {
+                ByteSet escaped;
+                hi = parse_escape(ps, &escaped);
+                if (hi < 0) return -1;
+                if (hi == ALPHA) return syntax_error(ps);
+            } else {
+                hi = (unsigned char)ps->re[ps->pos++];
+            }
+            if (hi < lo) return syntax_error(ps);
+        }
+        set_range(set, lo, hi);
+    }
+    if (negate) set_invert(set);
+    return 0;
+}
+
+static int parse_number(Parser *ps) {
+    const char *re = ps->re;
+    if (re[ps->pos] < '0' || re[ps->pos] > '9') return -1;
+    int v = 0;
+    while (re[ps->pos] >= '0' && re[ps->pos] <= '9') {
+        if (v <= REGEX_MAX_REPEAT) v = v * 10 + (re[ps->pos] - '0');
+        ps->pos++;
+    }
+    return v;
+}
+
+// {m}, {m,} or {m,n} at ps->pos
+static int parse_count(Parser *ps, int *min, int *max) {
+    ps->pos++;
+    *min = parse_number(ps);
+    if (*min < 0) return syntax_error(ps);
+    *max = *min;
+    if (ps->re[ps->pos] == ',') {
+        ps->pos++;
+        *max = ps->re[ps->pos] == '}' ? -1 : parse_number(ps);
+        if (*max == -1 && ps->re[ps->pos] != '}') return syntax_error(ps);
+    }
+    if (ps->re[ps->pos] != '}') return syntax_error(ps);
+    if (*min > REGEX_MAX_REPEAT || *max > REGEX_MAX_REPEAT || (*max >= 0 && *max < *min)) {
+        return syntax_error(ps);
+    }
+    ps->pos++;
+    return 0;
+}
+
+static int parse_alt(Parser *ps);
+
+static int parse_atom(Parser *ps) {
+    char c = ps->re[ps->pos];
+    ByteSet set;
+    memset(&set, 0, sizeof(set));
+    switch (c) {
+    case '(': {
+        // The parser recurses once per group, so nesting is capped before the stack is
+        if (ps->depth == REGEX_MAX_DEPTH) return syntax_error(ps);
+        ps->pos++;
+        ps->depth++;
+        int inner = parse_alt(ps);
+        if (inner < 0) return -1;
+        if (ps->re[ps->pos] != ')') return syntax_error(ps);
+        ps->pos++;
+        ps->depth--;
+        return inner;
+    }
+    case '*': case '+': case '?': case '{':
+        return syntax_error(ps);
+    case '[':
+        if (parse_class(ps, &set) != 0) return -1;
+        break;
+    case '.':
+        set_add(&set, '\n');
+        set_invert(&set);
+        ps->pos++;
+        break;
+    case '\\': {
+        int b = parse_escape(ps, &set);
+        if (b < 0) return -1;
+        if (b < ALPHA) set_add(&set, b);
+        break;
+    }
+    default:
+        set_add(&set, (unsigned char)c);
+        ps->pos++;
+        break;
+    }
+    int n = new_node(ps, RX_SET);
+    if (n >= 0) ps->nodes[n].set = set;
+    return n;
+}
+
+static int parse_repeat(Parser *ps) {
+    int a = parse_atom(ps);
+    while (a >= 0) {
+        int min, max;
+        char c = ps->re[ps->pos];
+        if (c == '*') { min = 0; max = -1; ps->pos++; }
+        else if (c == '+') { min = 1; max = -1; ps->pos++; }
+        else if (c == '?') { min = 0; max = 1; ps->pos++; }
+        else if (c == '{') { if (parse_count(ps, &min, &max) != 0) return -1; }
+        else break;
+        int n = new_node(ps, RX_REPEAT);
+        if (n < 0) return -1;
+        ps->nodes[n].a = a;
+        ps->nodes[n].min = min;
+        ps->nodes[n].max = max;
+        a = n;
+    }
+    return a;
+}
+
+static int parse_cat(Parser *ps) {
+    int left = -1;
+    for (char c; (c = ps->re[ps->pos]) != '\0' && c != '|' && c != ')';) {
+        int right = parse_repeat(ps);
+        if (right < 0) return -1;
+        if (left < 0) {
+            left = right;
+            continue;
+        }
+        int n = new_node(ps, RX_CAT);
+        if (n < 0) return -1;
+        ps->nodes[n].a = left;
+        ps->nodes[n].b = right;
+        left = n;
+    }
+    return left >= 0 ? left : new_node(ps, RX_EMPTY);
+}
+
+static int parse_alt(Parser *ps) {
+    int left = parse_cat(ps);
+    while (left >= 0 && ps->re[ps->pos] == '|') {
+        ps->pos++;
+        int right = parse_cat(ps);
+        if (right < 0) return -1;
+        int n = new_node(ps, RX_ALT);
+        if (n < 0) return -1;
+        ps->nodes[n].a = left;
+        ps->nodes[n].b = right;
+        left = n;
+    }
+    return left;
+}
+
+// ---------------------------------------------------------------------------
+// Thompson construction: one state per byte-set edge or pair of epsilon moves
+
+typedef struct {
+    int out1, out2;         // epsilon moves, or out1 on a byte of the set
+    int set;                // RX_SET node of the edge, -1 for epsilon states
+} NState;
+
+typedef struct {
+    NState *states;
+    int count;
+    int cap;
+    const RxNode *nodes;
+} Nfa;
+
+// Fragment: start state and the dangling end state (no moves yet)
+typedef struct {
+    int start, end;
+} Frag;
+
+static const Frag NO_FRAG = { -1, -1 };
+
+static int nfa_add(Nfa *n, int set) {
+    if (n->count == n->cap) {
+        if (n->cap >= NFA_MAX_STATES) return -1;
+        int cap = n->cap ? n->cap * 2 : 256;
+        NState *grown = realloc(n->states, sizeof(NState) * (size_t)cap);
+        if (!grown) return -1;
+        n->states = grown;
+        n->cap = cap;
+    }
+    NState *s = &n->states[n->count];
+    s->out1 = s->out2 = -1;
+    s->set = set;
+    return n->count++;
+}
+
+static Frag build_frag(Nfa *n, int node);
+
+// a* (min 0) or a+ (min 1)
+static Frag build_loop(Nfa *n, int a, int min) {
+    Frag f = build_frag(n, a);
+    if (f.start < 0) return NO_FRAG;
+    int e = nfa_add(n, -1);
+    if (e < 0) return NO_FRAG;
+    n->states[f.end].out1 = f.start;
+    n->states[f.end].out2 = e;
+    if (min == 1) return (Frag){ f.start, e };
+    int s = nfa_add(n, -1);
+    if (s < 0) return NO_FRAG;
+    n->states[s].out1 = f.start;
+    n->states[s].out2 = e;
+    return (Frag){ s, e };
+}
+
+// a{min,max}: min copies of a, then a* or (max - min) optional copies
+static Frag build_repeat(Nfa *n, const RxNode *r) {
+    if (r->max < 0 && r->min <= 1) return build_loop(n, r->a, r->min);
+    int s = nfa_add(n, -1);
+    if (s < 0) return NO_FRAG;
+    Frag acc = { s, s };
+    for (int k = 0; k < r->min; k++) {
+        Frag f = build_frag(n, r->a);
+        if (f.start < 0) return NO_FRAG;
+        n->states[acc.end].out1 = f.start;
+        acc.end = f.end;
+    }
+    if (r->max < 0) {
+        Frag f = build_loop(n, r->a, 0);
+        if (f.start < 0) return NO_FRAG;
+        n->states[acc.end].out1 = f.start;
+        acc.end = f.end;
+    }
+    for (int k = r->min; k < r->max; k++) {
+        Frag f = build_frag(n, r->a);
+        int opt = nfa_add(n, -1);
+        int e = nfa_add(n, -1);
+        if (f.start < 0 || opt < 0 || e < 0) return NO_FRAG;
+        n->states[opt].out1 = f.start;
+        n->states[opt].out2 = e;
+        n->states[f.end].out1 = e;
+        n->states[acc.end].out1 = opt;
+        acc.end = e;
+    }
+    return acc;
+}
+
+static Frag build_frag(Nfa *n, int node) {
+    const RxNode *r = &n->nodes[node];
+    switch (r->kind) {
+    case RX_SET: {
+        int s = nfa_add(n, node);
+        int e = nfa_add(n, -1);
+        if (s < 0 || e < 0) return NO_FRAG;
+        n->states[s].out1 = e;
+        return (Frag){ s, e };
+    }
+    case RX_EMPTY: {
+        int s = nfa_add(n, -1);
+        return (Frag){ s, s };
+    }
+    case RX_CAT: {
+        Frag f1 = build_frag(n, r->a);
+        if (f1.start < 0) return NO_FRAG;
+        Frag f2 = build_frag(n, r->b);
+        if (f2.start < 0) return NO_FRAG;
+        n->states[f1.end].out1 = f2.start;
+        return (Frag){ f1.start, f2.end };
+    }
+    case RX_ALT: {
+        Frag f1 = build_frag(n, r->a);
+        if (f1.start < 0) return NO_FRAG;
+        Frag f2 = build_frag(n, r->b);
+        int s = nfa_add(n, -1);
+        int e = nfa_add(n, -1);
+        if (f2.start < 0 || s < 0 || e < 0) return NO_FRAG;
+        n->states[s].out1 = f1.start;
+        n->states[s].out2 = f2.start;
+        n->states[f1.end].out1 = e;
+        n->states[f2.end].out1 = e;
+        return (Frag){ s, e };
+    }
+    case RX_REPEAT:
+        return build_repeat(n, r);
+    }
+    return NO_FRAG;
+}
+
+// ---------------------------------------------------------------------------
+// Subset construction. Only the byte classes of the NFA's sets are explored, and
+// a subset keeps just its edge states and the accepting state, sorted, so equal
+// closures compare equal.
+
+typedef struct {
+    const Nfa *nfa;
+    int accept;             // NFA accepting state
+    int nclasses;
+    int rep[ALPHA];         // first byte of each class
+    int count;              // subset states
+    int cap;
+    size_t *first;          // subset k is items[first[k] .. first[k + 1])
+    int *items;
+    size_t nitems;
+    size_t items_cap;
+    int *trans;             // count x nclasses, -1 = empty subset
+    uint8_t *accepting;
+    int *slots;             // open-addressing table of subset numbers
+    int slot_count;
+    int *stack;             // closure work space, one entry per NFA state
+    int *stamp;
+    int generation;
+} Subsets;
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Epsilon closure of the n states in buf; returns the kept states, sorted, in buf
+static int closure(Subsets *sb, int *buf, int n) {
+    const NState *st = sb->nfa->states;
+    int g = ++sb->generation;
+    int top = 0, kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (sb->stamp[buf[i]] != g) {
+            sb->stamp[buf[i]] = g;
+            sb->stack[top++] = buf[i];
+        }
+    }
+    while (top > 0) {
+        int s = sb->stack[--top];
+        if (st[s].set >= 0 || s == sb->accept) buf[kept++] = s;
+        if (st[s].set >= 0) continue;
+        int outs[2] = { st[s].out1, st[s].out2 };
+        for (int i = 0; i < 2; i++) {
+            if (outs[i] >= 0 && sb->stamp[outs[i]] != g) {
+                sb->stamp[outs[i]] = g;
+                sb->stack[top++] = outs[i];
+            }
+        }
+    }
+    qsort(buf, (size_t)kept, sizeof(int), cmp_int);
+    return kept;
+}
+
+static unsigned hash_items(const int *items, int n) {
+    unsigned h = 2166136261u;
+    for (int i = 0; i < n; i++) h = (h ^ (unsigned)items[i]) * 16777619u;
+    return h;
+}
+
+static int subsets_grow(Subsets *sb) {
+    int cap = sb->cap ? sb->cap * 2 : 64;
+    size_t *first = realloc(sb->first, sizeof(size_t) * ((size_t)cap + 1));
+    if (!first) return -1;
+    sb->first = first;
+    int *trans = realloc(sb->trans, sizeof(int) * (size_t)cap * (size_t)sb->nclasses);
+    if (!trans) return -1;
+    sb->trans = trans;
+    uint8_t *accepting = realloc(sb->accepting, (size_t)cap);
+    if (!accepting) return -1;
+    sb->accepting = accepting;
+    // Keep the hash table at most half full
+    int slot_count = 2 * cap;
+    int *slots = malloc(sizeof(int) * (size_t)slot_count);
+    if (!slots) return -1;
+    for (int i = 0; i < slot_count; i++) slots[i] = -1;
+    for (int k = 0; k < sb->count; k++) {
+        const int *items = sb->items + sb->first[k];
+        int n = (int)(sb->first[k + 1] - sb->first[k]);
+        unsigned h = hash_items(items, n) & (unsigned)(slot_count - 1);
+        while (slots[h] >= 0) h = (h + 1) & (unsigned)(slot_count - 1);
+        slots[h] = k;
+    }
+    free(sb->slots);
+    sb->slots = slots;
+    sb->slot_count = slot_count;
+    sb->cap = cap;
+    return 0;
+}
+
+// Number of the subset buf[0..n), added if new; -1 on failure
+static int subsets_intern(Subsets *sb, const int *buf, int n) {
+    unsigned mask = (unsigned)(sb->slot_count - 1);
+    unsigned h = hash_items(buf, n) & mask;
+    for (int k; (k = sb->slots[h]) >= 0; h = (h + 1) & mask) {
+        size_t len = sb->first[k + 1] - sb->first[k];
+        if (len == (size_t)n && memcmp(sb->items + sb->first[k], buf, sizeof(int) * (size_t)n) == 0) return k;
+    }
+    if (sb->count >= DFA_MAX_STATES) return -1;
+    if (sb->count + 1 >= sb->cap) {
+        if (subsets_grow(sb) != 0) return -1;
+        return subsets_intern(sb, buf, n);
+    }
+    if (sb->nitems + (size_t)n > sb->items_cap) {
+        size_t cap = sb->items_cap ? sb->items_cap : 1024;
+        while (cap < sb->nitems + (size_t)n) cap *= 2;
+        int *items = realloc(sb->items, sizeof(int) * cap);
+        if (!items) return -1;
+        sb->items = items;
+        sb->items_cap = cap;
+    }
+    int k = sb->count++;
+    memcpy(sb->items + sb->nitems, buf, sizeof(int) * (size_t)n);
+    sb->first[k] = sb->nitems;
+    sb->nitems += (size_t)n;
+    sb->first[k + 1] = sb->nitems;
+    sb->accepting[k] = 0;
+    for (int i = 0; i < n; i++) {
+        if (buf[i] == sb->accept) sb->accepting[k] = 1;
+    }
+    sb->slots[h] = k;
+    return k;
+}
+
+static int subset_construct(Subsets *sb, int start) {
+    int nstates = sb->nfa->count;
+    int *buf = malloc(sizeof(int) * (size_t)nstates);
+    sb->stack = malloc(sizeof(int) * (size_t)nstates);
+    sb->stamp = calloc((size_t)nstates, sizeof(int));
+    if (!buf || !sb->stack || !sb->stamp || subsets_grow(sb) != 0) {
+        free(buf);
+        return -1;
+    }
+    buf[0] = start;
+    int rc = subsets_intern(sb, buf, closure(sb, buf, 1)) == 0 ? 0 : -1;
+    const NState *st = sb->nfa->states;
+    const RxNode *nodes = sb->nfa->nodes;
+    for (int k = 0; rc == 0 && k < sb->count; k++) {
+        for (int c = 0; c < sb->nclasses; c++) {
+            int n = 0;
+            for (size_t i = sb->first[k]; i < sb->first[k + 1]; i++) {
+                int s = sb->items[i];
+                if (st[s].set >= 0 && set_has(&nodes[st[s].set].set, sb->rep[c])) buf[n++] = st[s].out1;
+            }
+            int to = -1;
+            if (n > 0) {
+                to = subsets_intern(sb, buf, closure(sb, buf, n));
+                if (to < 0) {
+                    rc = -1;
+                    break;
+                }
+            }
+            sb->trans[(size_t)k * sb->nclasses + c] = to;
+        }
+    }
+    free(buf);
+    return rc;
+}
+
+static void subsets_free(Subsets *sb) {
+    free(sb->first);
+    free(sb->items);
+    free(sb->trans);
+    free(sb->accepting);
+    free(sb->slots);
+    free(sb->stack);
+    free(sb->stamp);
+}
+
+// ---------------------------------------------------------------------------
+// Hopcroft minimization of the subset automaton, completed with a dead state.
+// Blocks are ranges of elems; a splitter block is refined against the states
+// that move into it on each class.
+
+typedef struct {
+    int n;                  // states, the dead one last
+    int *elems;
+    int *pos;               // index of each state in elems
+    int *block;
+    int *bstart, *bend;
+    int *marked;            // per block: marked states at the front of its range
+    uint8_t *waiting;
+    int *work;
+    int nwork;
+    int nblocks;
+} Partition;
+
+static int new_block(Partition *pt, int start, int end) {
+    int b = pt->nblocks++;
+    pt->bstart[b] = start;
+    pt->bend[b] = end;
+    pt->marked[b] = 0;
+    pt->waiting[b] = 0;
+    for (int i = start; i < end; i++) pt->block[pt->elems[i]] = b;
+    return b;
+}
+
+static void add_work(Partition *pt, int b) {
+    if (!pt->waiting[b]) {
+        pt->waiting[b] = 1;
+        pt->work[pt->nwork++] = b;
+    }
+}
+
+// Move of subset state s on class c in the completed automaton
+static int target(const Subsets *sb, int s, int c) {
+    if (s == sb->count) return s;
+    int t = sb->trans[(size_t)s * sb->nclasses + c];
+    return t < 0 ? sb->count : t;
+}
+
+// Leaves the block of every state in pt (the caller frees pt's arrays)
+static int hopcroft(Partition *pt, const Subsets *sb) {
+    int n = sb->count + 1;
+    int dead = sb->count;
+    int nc = sb->nclasses;
+    size_t edges = (size_t)n * (size_t)nc;
+    // Predecessors of state t on class c: pred[pred_first[t * nc + c] ..]
+    size_t *pred_first = calloc(edges + 1, sizeof(size_t));
+    int *pred = malloc(sizeof(int) * edges);
+    int *members = malloc(sizeof(int) * (size_t)n);
+    int *touched = malloc(sizeof(int) * (size_t)n);
+    pt->n = n;
+    pt->elems = malloc(sizeof(int) * (size_t)n);
+    pt->pos = malloc(sizeof(int) * (size_t)n);
+    pt->block = malloc(sizeof(int) * (size_t)n);
+    pt->bstart = malloc(sizeof(int) * (size_t)n);
+    pt->bend = malloc(sizeof(int) * (size_t)n);
+    pt->marked = malloc(sizeof(int) * (size_t)n);
+    pt->waiting = malloc((size_t)n);
+    pt->work = malloc(sizeof(int) * (size_t)n);
+    pt->nwork = pt->nblocks = 0;
+    int ok = pred_first && pred && members && touched && pt->elems && pt->pos && pt->block &&
+             pt->bstart && pt->bend && pt->marked && pt->waiting && pt->work;
+    if (ok) {
+        for (int s = 0; s < n; s++) {
+            for (int c = 0; c < nc; c++) pred_first[(size_t)target(sb, s, c) * nc + c + 1]++;
+        }
+        for (size_t i = 0; i < edges; i++) pred_first[i + 1] += pred_first[i];
+        size_t *fill = calloc(edges, sizeof(size_t));
+        if (!fill) ok = 0;
+        for (int s = 0; ok && s < n; s++) {
+            for (int c = 0; c < nc; c++) {
+                size_t t = (size_t)target(sb, s, c) * nc + c;
+                pred[pred_first[t] + fill[t]++] = s;
+            }
+        }
+        free(fill);
+    }
+    if (ok) {
+        // Initial partition: accepting states, then the rest
+        int na = 0;
+        for (int s = 0; s < n; s++) {
+            if (s < dead && sb->accepting[s]) pt->elems[na++] = s;
+        }
+        int i = na;
+        for (int s = 0; s < n; s++) {
+            if (s == dead || !sb->accepting[s]) pt->elems[i++] = s;
+        }
+        for (i = 0; i < n; i++) pt->pos[pt->elems[i]] = i;
+        if (na > 0) new_block(pt, 0, na);
+        int rest = new_block(pt, na, n);
+        add_work(pt, na > 0 && na <= n - na ? 0 : rest);
+
+        while (pt->nwork > 0) {
+            int a = pt->work[--pt->nwork];
+            pt->waiting[a] = 0;
+            int nmembers = pt->bend[a] - pt->bstart[a];
+            memcpy(members, pt->elems + pt->bstart[a], sizeof(int) * (size_t)nmembers);
+            for (int c = 0; c < nc; c++) {
+                int ntouched = 0;
+                // Move the predecessors to the front of their blocks
+                for (int m = 0; m < nmembers; m++) {
+                    size_t t = (size_t)members[m] * nc + c;
+                    for (size_t j = pred_first[t]; j < pred_first[t + 1]; j++) {
+                        int p = pred[j];
+                        int b = pt->block[p];
+                        int to = pt->bstart[b] + pt->marked[b]++;
+                        int other = pt->elems[to];
+                        pt->elems[pt->pos[p]] = other;
+                        pt->pos[other] = pt->pos[p];
+                        pt->elems[to] = p;
+                        pt->pos[p] = to;
+                        if (pt->marked[b] == 1) touched[ntouched++] = b;
+                    }
+                }
+                for (int j = 0; j < ntouched; j++) {
+                    int b = touched[j];
+                    int split = pt->bstart[b] + pt->marked[b];
+                    pt->marked[b] = 0;
+                    if (split == pt->bend[b]) continue;
+                    int z = new_block(pt, pt->bstart[b], split);
+                    pt->bstart[b] = split;
+                    if (pt->waiting[b] || split - pt->bstart[z] <= pt->bend[b] - split) add_work(pt, z);
+                    else add_work(pt, b);
+                }
+            }
+        }
+    }
+    free(pred_first);
+    free(pred);
+    free(members);
+    free(touched);
+    return ok ? 0 : -1;
+}
+
+static void partition_free(Partition *pt) {
+    free(pt->elems);
+    free(pt->pos);
+    free(pt->block);
+    free(pt->bstart);
+    free(pt->bend);
+    free(pt->marked);
+    free(pt->waiting);
+    free(pt->work);
+}
+
+// Number the live blocks breadth-first from the start block and build the DFA
+static int emit_dfa(DFA *d, const Subsets *sb, const Partition *pt, const int *cls, int *nstates) {
+    int dead_block = pt->block[sb->count];
+    int start_block = pt->block[0];
+    int *number = malloc(sizeof(int) * (size_t)pt->nblocks);
+    int *queue = malloc(sizeof(int) * (size_t)pt->nblocks);
+    if (!number || !queue) {
+        free(number);
+        free(queue);
+        return -1;
+    }
+    for (int b = 0; b < pt->nblocks; b++) number[b] = 0;
+    int m = 0;
+    if (start_block != dead_block) {
+        number[start_block] = ++m;
+        queue[0] = start_block;
+        for (int head = 0; head < m; head++) {
+            int r = pt->elems[pt->bstart[queue[head]]];
+            for (int c = 0; c < sb->nclasses; c++) {
+                int t = sb->trans[(size_t)r * sb->nclasses + c];
+                if (t < 0) continue;
+                int b = pt->block[t];
+                if (b != dead_block && !number[b]) {
+                    number[b] = ++m;
+                    queue[m - 1] = b;
+                }
+            }
+        }
+    }
+    // A language without words still gets its start state
+    int rows = (m > 0 ? m : 1) + 1;
+    int *dense = calloc((size_t)rows * ALPHA, sizeof(int));
+    uint8_t *finals = calloc((size_t)rows, 1);
+    int rc = -1;
+    if (dense && finals) {
+        for (int i = 1; i <= m; i++) {
+            int r = pt->elems[pt->bstart[queue[i - 1]]];
+            finals[i] = sb->accepting[r];
+            for (int c = 0; c < ALPHA; c++) {
+                int t = sb->trans[(size_t)r * sb->nclasses + cls[c]];
+                dense[(size_t)i * ALPHA + c] = t < 0 ? 0 : number[pt->block[t]];
+            }
+        }
+        rc = dfa_build(d, rows - 1, 1, finals, dense);
+    }
+    *nstates = m;
+    free(number);
+    free(queue);
+    free(dense);
+    free(finals);
+    return rc;
+}
+
+// ---------------------------------------------------------------------------
+
+int regex_to_dfa(const char *re, DFA *d, RegexStats *stats, int *err_pos) {
+    memset(d, 0, sizeof(*d));
+    if (stats) memset(stats, 0, sizeof(*stats));
+    Parser ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.re = re;
+    int root = parse_alt(&ps);
+    if (root >= 0 && re[ps.pos] != '\0') syntax_error(&ps);   // unmatched ')'
+    if (ps.error) {
+        if (ps.error == -2 && err_pos) *err_pos = ps.err_pos;
+        free(ps.nodes);
+        return ps.error;
+    }
+
+    Nfa nfa;
+    memset(&nfa, 0, sizeof(nfa));
+    nfa.nodes = ps.nodes;
+    Frag f = build_frag(&nfa, root);
+
+    // Byte classes: bytes that every set of the expression treats alike
+    Subsets sb;
+    memset(&sb, 0, sizeof(sb));
+    int cls[ALPHA] = { 0 };
+    sb.nclasses = 1;
+    for (int i = 0; i < ps.count; i++) {
+        if (ps.nodes[i].kind != RX_SET) continue;
+        int remap[2 * ALPHA];
+        for (int k = 0; k < 2 * sb.nclasses; k++) remap[k] = -1;
+        int count = 0;
+        for (int c = 0; c < ALPHA; c++) {
+            int key = 2 * cls[c] + set_has(&ps.nodes[i].set, c);
+            if (remap[key] < 0) remap[key] = count++;
+            cls[c] = remap[key];
+        }
+        sb.nclasses = count;
+    }
+    for (int c = ALPHA - 1; c >= 0; c--) sb.rep[cls[c]] = c;
+
+    int rc = -1;
+    Partition pt;
+    memset(&pt, 0, sizeof(pt));
+    if (f.start >= 0) {
+        sb.nfa = &nfa;
+        sb.accept = f.end;
+        int min_states = 0;
+        if (subset_construct(&sb, f.start) == 0 && hopcroft(&pt, &sb) == 0 &&
+            emit_dfa(d, &sb, &pt, cls, &min_states) == 0) {
+            rc = 0;
+        }
+        if (stats) {
+            stats->nfa_states = nfa.count;
+            stats->subset_states = sb.count;
+            stats->nclasses = sb.nclasses;
+            stats->min_states = min_states;
+        }
+    }
+    partition_free(&pt);
+    subsets_free(&sb);
+    free(nfa.states);
+    free(ps.nodes);
+    return rc;
+}
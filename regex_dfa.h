@@ -0,0 +1,34 @@
+// regex_dfa.h
+// Regular expressions to minimal DFAs: Thompson NFA, subset construction over
+// byte classes and Hopcroft minimization
+
+#ifndef REGEX_DFA_H
+#define REGEX_DFA_H
+
+#include "dfa.h"
+
+// Sizes of the intermediate automata, for reports
+typedef struct {
+    int nfa_states;
+    int subset_states;      // reachable subset-construction states
+    int nclasses;           // byte classes the NFA distinguishes
+    int min_states;         // states of the result (the dead state not counted)
+} RegexStats;
+
+// Syntax, over bytes:
+//   ab  a|b  (a)  a*  a+  a?  a{m}  a{m,}  a{m,n}  (counts up to REGEX_MAX_REPEAT)
+//   .          any byte but '\n'
+//   [a-z_]     class; [^...] its complement; ']' first and '-' first or last are literal
+//   \d \w \s   [0-9], [A-Za-z0-9_], [ \t\n\v\f\r]; \D \W \S their complements
+//   \n \t \r \f \v \xHH   control and hex bytes; '\' before any other byte quotes it
+// Groups nest at most REGEX_MAX_DEPTH deep; a deeper '(' is a syntax error.
+#define REGEX_MAX_REPEAT 255
+#define REGEX_MAX_DEPTH 1000
+
+// Compile re into a minimal DFA whose start state is 1 and whose other states are
+// numbered in breadth-first order. stats may be NULL. Returns 0 on success, -1 if
+// memory runs out or the automaton exceeds DFA_MAX_STATES, -2 on a syntax error
+// (*err_pos, if err_pos is not NULL, receives the offset in re).
+int regex_to_dfa(const char *re, DFA *d, RegexStats *stats, int *err_pos);
+
+#endif // REGEX_DFA_H
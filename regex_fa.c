@@ -0,0 +1,54 @@
+// regex_fa.c
+// Compile a regular expression into a minimal DFA and write it as a .fa file
+
+#include "regex_dfa.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]) {
+    const char *check[64];
+    int ncheck = 0;
+    int argi = 1;
+    while (argi + 1 < argc && strcmp(argv[argi], "--check") == 0 && ncheck < 64) {
+        check[ncheck++] = argv[argi + 1];
+        argi += 2;
+    }
+    if (argc - argi != 2) {
+        fprintf(stderr, "Usage: %s [--check text]... <regex> <output.fa>\n", argv[0]);
+        fprintf(stderr, "  --check prints the longest prefix of text the DFA accepts\n");
+        return 1;
+    }
+    const char *re = argv[argi];
+    const char *output_file = argv[argi + 1];
+
+    DFA d;
+    RegexStats stats;
+    int err_pos = 0;
+    int rc = regex_to_dfa(re, &d, &stats, &err_pos);
+    if (rc == -2) {
+        fprintf(stderr, "Error: syntax error in regex at offset %d\n  %s\n  %*s^\n", err_pos, re, err_pos, "");
+        return 1;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Error: out of memory or more than %d DFA states\n", DFA_MAX_STATES);
+        return 1;
+    }
+    if (dfa_save(output_file, &d) != 0) {
+        fprintf(stderr, "Error: failed to write %s\n", output_file);
+        dfa_free(&d);
+        return 1;
+    }
+
+    size_t entry = d.table.trans8 ? 1 : d.table.trans16 ? 2 : 4;
+    printf("NFA %d states -> subset DFA %d states -> minimal DFA %d states\n",
+           stats.nfa_states, stats.subset_states, stats.min_states);
+    printf("%d byte classes, table %zu bytes (%zu-bit entries)\n", d.table.nclasses,
+           ((size_t)d.table.nrows << d.table.shift) * entry, entry * 8);
+    printf("Wrote %s\n", output_file);
+    for (int i = 0; i < ncheck; i++) {
+        printf("  \"%s\": longest match %d\n", check[i], dfa_longest(&d, check[i]));
+    }
+    dfa_free(&d);
+    return 0;
+}
@@ -0,0 +1,92 @@
+// scan_bench.c
+// Micro-benchmark of the direct-coded identifier/number scanners that
+// fa_codegen generates against the table-driven dfa_longest
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dfa.h"
+#include "pif_reader.h"
+#include "identifier_scan.h"
+#include "number_scan.h"
+
+static double now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Edge cases of number.fa and identifier.fa that a program may not contain
+static const char *extra_cases[] = {
+    "", "0", "3.", "3.14", "3.14.15", "1..20", "12ab", "_", "_x9", "x.y", "9_", "A", "z"
+};
+
+int main(int argc, char *argv[]) {
+    const char *pif_file = argc > 1 ? argv[1] : "programB_right.pif";
+    int iterations = argc > 2 ? atoi(argv[2]) : 2000;
+
+    DFA id, num;
+    if (dfa_load("identifier.fa", &id) != 0 || dfa_load("number.fa", &num) != 0) {
+        fprintf(stderr, "Error: cannot load identifier.fa and number.fa from the current directory\n");
+        return 1;
+    }
+    PIFEntry *entries = NULL;
+    int count = 0;
+    if (read_pif_from_file(pif_file, &entries, &count) <= 0) {
+        fprintf(stderr, "Usage: %s [pif_file] [iterations]\n", argv[0]);
+        dfa_free(&id);
+        dfa_free(&num);
+        return 1;
+    }
+
+    // The words the {IDENT} and {NUMBER} rules of flowcalc.l hand to the DFAs
+    int nextra = (int)(sizeof(extra_cases) / sizeof(extra_cases[0]));
+    const char **words = malloc(sizeof(char *) * (size_t)(count + nextra));
+    size_t *lengths = malloc(sizeof(size_t) * (size_t)(count + nextra));
+    if (!words || !lengths) return 1;
+    int nwords = 0;
+    for (int i = 0; i < count; i++) {
+        unsigned char c = (unsigned char)entries[i].lexeme[0];
+        if (isalnum(c) || c == '_') words[nwords++] = entries[i].lexeme;
+    }
+    int ncorpus = nwords;
+    for (int i = 0; i < nextra; i++) words[nwords++] = extra_cases[i];
+    for (int i = 0; i < nwords; i++) lengths[i] = strlen(words[i]);
+
+    int mismatches = 0;
+    for (int i = 0; i < nwords; i++) {
+        int ti = dfa_longest(&id, words[i]), tn = dfa_longest(&num, words[i]);
+        int gi = identifier_longest(words[i], lengths[i]), gn = number_longest(words[i], lengths[i]);
+        if (ti != gi || tn != gn) {
+            fprintf(stderr, "mismatch for '%s': table %d/%d, generated %d/%d\n", words[i], ti, tn, gi, gn);
+            mismatches++;
+        }
+    }
+
+    volatile long sink = 0;
+    double t0 = now_ms();
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < ncorpus; i++) sink += dfa_longest(&id, words[i]) + dfa_longest(&num, words[i]);
+    }
+    double t1 = now_ms();
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < ncorpus; i++) {
+            sink += identifier_longest(words[i], lengths[i]) + number_longest(words[i], lengths[i]);
+        }
+    }
+    double t2 = now_ms();
+
+    double n = (double)ncorpus * iterations;
+    printf("%d words x %d iterations, %d mismatches\n", ncorpus, iterations, mismatches);
+    printf("dfa_longest (tables):  %8.2f ns/word\n", (t1 - t0) * 1e6 / n);
+    printf("direct-coded:          %8.2f ns/word\n", (t2 - t1) * 1e6 / n);
+
+    free(words);
+    free(lengths);
+    free_pif_entries(entries, count);
+    dfa_free(&id);
+    dfa_free(&num);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,619 @@
+// scanner_dfa.c
+// Product construction, minimization and the longest-match loop of the scanner DFA
+
+#include "scanner_dfa.h"
+#include "simd_scan.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALPHA 256
+
+// longest_match has to stay inlined into scanner_dfa_next, which compilers stop
+// doing once it calls the long-token path
+#if defined(__GNUC__) || defined(__clang__)
+#define SCAN_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define SCAN_INLINE __forceinline
+#else
+#define SCAN_INLINE inline
+#endif
+
+// One component automaton over bytes, with a tag per state
+typedef struct {
+    int nstates;
+    int cap;
+    int start;
+    int *trans;             // nstates x ALPHA, -1 = no move
+    int16_t *tags;
+} Machine;
+
+static int machine_add_state(Machine *m, int tag) {
+    if (m->nstates == m->cap) {
+        int cap = m->cap ? m->cap * 2 : 16;
+        int *trans = realloc(m->trans, sizeof(int) * ALPHA * cap);
+        if (!trans) return -1;
+        m->trans = trans;
+        int16_t *tags = realloc(m->tags, sizeof(int16_t) * cap);
+        if (!tags) return -1;
+        m->tags = tags;
+        m->cap = cap;
+    }
+    int s = m->nstates++;
+    for (int c = 0; c < ALPHA; c++) m->trans[s * ALPHA + c] = -1;
+    m->tags[s] = (int16_t)tag;
+    return s;
+}
+
+static void machine_free(Machine *m) {
+    free(m->trans);
+    free(m->tags);
+    memset(m, 0, sizeof(*m));
+}
+
+static int has_terminal(const StrList *terms, int terminal) {
+    if (!terms) return 1;
+    for (int i = 0; i < terms->count; i++) {
+        if (strcmp(terms->items[i], lexeme_terminal_names[terminal]) == 0) return 1;
+    }
+    return 0;
+}
+
+// Trie of the keywords; a letter moves on both cases, as lexeme_terminal_id folds them
+static int build_keywords(Machine *m, const StrList *terms) {
+    m->start = machine_add_state(m, SCAN_TAG_NONE);
+    if (m->start < 0) return -1;
+    for (int k = 0; k < LEXEME_KEYWORD_COUNT; k++) {
+        const LexemeKeyword *kw = &lexeme_keywords[k];
+        if (!has_terminal(terms, kw->terminal)) continue;
+        int s = m->start;
+        for (int i = 0; i < kw->len; i++) {
+            unsigned char c = (unsigned char)kw->key[i];
+            int next = m->trans[s * ALPHA + c];
+            if (next < 0) {
+                next = machine_add_state(m, SCAN_TAG_NONE);
+                if (next < 0) return -1;
+                m->trans[s * ALPHA + c] = next;
+                m->trans[s * ALPHA + toupper(c)] = next;
+            }
+            s = next;
+        }
+        if (m->tags[s] == SCAN_TAG_NONE) m->tags[s] = kw->terminal;
+    }
+    return 0;
+}
+
+// .fa states are numbered from 1 with 0 as "no move"; the machine numbers from 0
+static int build_from_dfa(Machine *m, const DFA *d, int tag) {
+    for (int s = 1; s <= d->nstates; s++) {
+        if (machine_add_state(m, d->finals[s] ? tag : SCAN_TAG_NONE) < 0) return -1;
+        for (int c = 0; c < ALPHA; c++) m->trans[(s - 1) * ALPHA + c] = dfa_next(d, s, (unsigned char)c) - 1;
+    }
+    m->start = d->start - 1;
+    return d->nstates > 0 ? 0 : -1;
+}
+
+// States that read the rest of a sequence after a mixed lead byte and go to
+// target on the letters among its code points; lead_state[lead] receives the
+// state after each lead. Rows of third bytes that spell the same letters are
+// shared.
+static int utf8_mixed_states(Machine *m, int target, int *lead_state) {
+    int third[ALPHA], nthird = 0;       // states reading a third byte
+    for (int lead = 0xC2; lead < 0xF0; lead++) {
+        if (!simd_utf8_mixed_lead((unsigned char)lead)) continue;
+        int x = machine_add_state(m, SCAN_TAG_NONE);
+        if (x < 0) return -1;
+        lead_state[lead] = x;
+        int lo = lead == 0xE0 ? 0xA0 : 0x80, hi = lead == 0xED ? 0x9F : 0xBF;
+        for (int b2 = lo; b2 <= hi; b2++) {
+            if (lead < 0xE0) {
+                if (dfa_utf8_letter(((uint32_t)(lead & 0x1F) << 6) | (uint32_t)(b2 & 0x3F))) {
+                    m->trans[x * ALPHA + b2] = target;
+                }
+                continue;
+            }
+            int row[64], any = 0;
+            for (int b3 = 0x80; b3 <= 0xBF; b3++) {
+                uint32_t cp = ((uint32_t)(lead & 0x0F) << 12) | ((uint32_t)(b2 & 0x3F) << 6) | (uint32_t)(b3 & 0x3F);
+                row[b3 - 0x80] = dfa_utf8_letter(cp) ? target : -1;
+                any |= row[b3 - 0x80] >= 0;
+            }
+            if (!any) continue;
+            int k = 0;
+            while (k < nthird && memcmp(&m->trans[third[k] * ALPHA + 0x80], row, sizeof(row)) != 0) k++;
+            if (k == nthird) {
+                if (nthird == ALPHA) return -1;
+                third[nthird] = machine_add_state(m, SCAN_TAG_NONE);
+                if (third[nthird] < 0) return -1;
+                memcpy(&m->trans[third[nthird++] * ALPHA + 0x80], row, sizeof(row));
+            }
+            m->trans[x * ALPHA + b2] = third[k];
+        }
+    }
+    return 0;
+}
+
+// UTF-8 mode: lead bytes go where 'a' goes, as letters of identifiers, and the
+// continuation bytes after them leave the state as it is. The
+// simd_utf8_mixed_lead bytes enter utf8_mixed_states instead, so that only
+// letters (dfa_utf8_letter) continue the identifier. Continuation bytes need no
+// check of their own: scanner_dfa_next_utf8 scans validated text only.
+static int utf8_letters(Machine *m) {
+    int n = m->nstates;
+    int *leads = malloc(sizeof(int) * ALPHA * (size_t)n);
+    unsigned char *letter_target = calloc((size_t)n, 1);   // some state moves here on 'a'
+    unsigned char *built = calloc((size_t)n, 1);            // leads[t] is filled in
+    int ok = leads && letter_target && built;
+    for (int i = 0; ok && i < ALPHA * n; i++) leads[i] = -1;
+    for (int s = 0; ok && s < n; s++) {
+        int t = m->trans[s * ALPHA + 'a'];
+        if (t >= 0 && t < n) letter_target[t] = 1;
+    }
+    for (int s = 0; ok && s < n; s++) {
+        for (int c = 0x80; c < 0xC0; c++) m->trans[s * ALPHA + c] = letter_target[s] ? s : -1;
+        int t = m->trans[s * ALPHA + 'a'];
+        if (t < 0 || t >= n) continue;
+        int *lead_state = &leads[t * ALPHA];
+        if (!built[t]) {
+            built[t] = 1;
+            ok = utf8_mixed_states(m, t, lead_state) == 0;
+        }
+        for (int c = 0xC0; ok && c < ALPHA; c++) {
+            m->trans[s * ALPHA + c] = simd_utf8_mixed_lead((unsigned char)c) ? lead_state[c] : t;
+        }
+    }
+    free(leads);
+    free(letter_target);
+    free(built);
+    return ok ? 0 : -1;
+}
+
+// "[^"]*"? : every state after the opening quote accepts
+static int build_strings(Machine *m) {
+    int start = machine_add_state(m, SCAN_TAG_NONE);
+    int body = machine_add_state(m, LT_STRING);
+    int closed = machine_add_state(m, LT_STRING);
+    if (closed < 0) return -1;
+    m->start = start;
+    m->trans[start * ALPHA + '"'] = body;
+    for (int c = 0; c < ALPHA; c++) m->trans[body * ALPHA + c] = c == '"' ? closed : body;
+    return 0;
+}
+
+static int build_blanks(Machine *m) {
+    static const char blanks[] = " \t\v\f\r";
+    int start = machine_add_state(m, SCAN_TAG_NONE);
+    int run = machine_add_state(m, SCAN_TAG_BLANK);
+    if (run < 0) return -1;
+    m->start = start;
+    for (const char *b = blanks; *b; b++) {
+        m->trans[start * ALPHA + (unsigned char)*b] = run;
+        m->trans[run * ALPHA + (unsigned char)*b] = run;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Product construction: a state is the tuple of component states (-1 = dead)
+
+#define COMPONENTS 5
+
+typedef struct {
+    int nstates;
+    int cap;
+    int *tuples;            // nstates x COMPONENTS
+    int *trans;             // nstates x ALPHA
+    int16_t *tags;
+    int *slots;             // open addressing: state id or -1
+    int slot_count;
+} Product;
+
+static unsigned tuple_hash(const int *t) {
+    unsigned h = 2166136261u;
+    for (int i = 0; i < COMPONENTS; i++) h = (h ^ (unsigned)t[i]) * 16777619u;
+    return h;
+}
+
+static int product_rehash(Product *p, int slot_count) {
+    int *slots = malloc(sizeof(int) * slot_count);
+    if (!slots) return -1;
+    for (int i = 0; i < slot_count; i++) slots[i] = -1;
+    for (int s = 0; s < p->nstates; s++) {
+        unsigned h = tuple_hash(p->tuples + s * COMPONENTS) & (unsigned)(slot_count - 1);
+        while (slots[h] >= 0) h = (h + 1) & (unsigned)(slot_count - 1);
+        slots[h] = s;
+    }
+    free(p->slots);
+    p->slots = slots;
+    p->slot_count = slot_count;
+    return 0;
+}
+
+// State id of tuple t, adding it if new. Returns -1 on allocation failure.
+static int product_state(Product *p, const Machine *m, const int *t) {
+    unsigned mask = (unsigned)(p->slot_count - 1);
+    unsigned h = tuple_hash(t) & mask;
+    while (p->slots[h] >= 0) {
+        if (memcmp(p->tuples + p->slots[h] * COMPONENTS, t, sizeof(int) * COMPONENTS) == 0) {
+            return p->slots[h];
+        }
+        h = (h + 1) & mask;
+    }
+    if (p->nstates == p->cap) {
+        int cap = p->cap * 2;
+        int *tuples = realloc(p->tuples, sizeof(int) * COMPONENTS * cap);
+        if (!tuples) return -1;
+        p->tuples = tuples;
+        int *trans = realloc(p->trans, sizeof(int) * ALPHA * cap);
+        if (!trans) return -1;
+        p->trans = trans;
+        int16_t *tags = realloc(p->tags, sizeof(int16_t) * cap);
+        if (!tags) return -1;
+        p->tags = tags;
+        p->cap = cap;
+    }
+    int s = p->nstates++;
+    memcpy(p->tuples + s * COMPONENTS, t, sizeof(int) * COMPONENTS);
+    // The first component that accepts names the token
+    p->tags[s] = SCAN_TAG_NONE;
+    for (int i = 0; i < COMPONENTS; i++) {
+        if (t[i] >= 0 && m[i].tags[t[i]] != SCAN_TAG_NONE) {
+            p->tags[s] = m[i].tags[t[i]];
+            break;
+        }
+    }
+    p->slots[h] = s;
+    if (p->nstates * 2 > p->slot_count && product_rehash(p, p->slot_count * 2) != 0) return -1;
+    return s;
+}
+
+static void product_free(Product *p) {
+    free(p->tuples);
+    free(p->trans);
+    free(p->tags);
+    free(p->slots);
+}
+
+static int build_product(Product *p, const Machine *m) {
+    memset(p, 0, sizeof(*p));
+    p->cap = 64;
+    p->tuples = malloc(sizeof(int) * COMPONENTS * p->cap);
+    p->trans = malloc(sizeof(int) * ALPHA * p->cap);
+    p->tags = malloc(sizeof(int16_t) * p->cap);
+    if (!p->tuples || !p->trans || !p->tags || product_rehash(p, 128) != 0) return -1;
+
+    int t[COMPONENTS];
+    for (int i = 0; i < COMPONENTS; i++) t[i] = m[i].start;
+    if (product_state(p, m, t) < 0) return -1;
+
+    // States are numbered in discovery order, so the worklist is the state array itself
+    for (int s = 0; s < p->nstates; s++) {
+        for (int c = 0; c < ALPHA; c++) {
+            int live = 0;
+            for (int i = 0; i < COMPONENTS; i++) {
+                int from = p->tuples[s * COMPONENTS + i];
+                t[i] = from >= 0 ? m[i].trans[from * ALPHA + c] : -1;
+                live |= t[i] >= 0;
+            }
+            int next = -1;
+            if (live) {
+                next = product_state(p, m, t);
+                if (next < 0) return -1;
+            }
+            p->trans[s * ALPHA + c] = next;
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Minimization: refine the partition by tag until no class splits (Moore)
+
+// Renumber so that rows with a run class come last; longest_match then finds
+// them with one compare against accel_off instead of a lookup per byte
+static int run_rows_last(int *dense, int16_t *tags, int rows, int *start) {
+    int *order = malloc(sizeof(int) * rows);
+    int *copy = malloc(sizeof(int) * ALPHA * rows);
+    int16_t *copy_tags = malloc(sizeof(int16_t) * rows);
+    if (!order || !copy || !copy_tags) {
+        free(order); free(copy); free(copy_tags);
+        return -1;
+    }
+    int next = 1;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int s = 1; s < rows; s++) {
+            if ((dfa_row_run(dense, s) != SCAN_RUN_NONE) == pass) order[s] = next++;
+        }
+    }
+    order[0] = 0;
+    memcpy(copy, dense, sizeof(int) * ALPHA * rows);
+    memcpy(copy_tags, tags, sizeof(int16_t) * rows);
+    for (int s = 0; s < rows; s++) {
+        tags[order[s]] = copy_tags[s];
+        for (int c = 0; c < ALPHA; c++) dense[order[s] * ALPHA + c] = order[copy[s * ALPHA + c]];
+    }
+    *start = order[*start];
+    free(order);
+    free(copy);
+    free(copy_tags);
+    return 0;
+}
+
+static int minimize(const Product *p, ScannerDFA *sd) {
+    int n = p->nstates;
+    int width = ALPHA + 1;
+    int *cls = malloc(sizeof(int) * n);
+    int *sig = malloc(sizeof(int) * width * n);
+    int slot_count = 1;
+    while (slot_count < 2 * n) slot_count *= 2;
+    int *slots = malloc(sizeof(int) * slot_count);
+    int *next_cls = malloc(sizeof(int) * n);
+    if (!cls || !sig || !slots || !next_cls) {
+        free(cls); free(sig); free(slots); free(next_cls);
+        return -1;
+    }
+    for (int s = 0; s < n; s++) cls[s] = p->tags[s] + 1;
+
+    int classes = -1;
+    for (;;) {
+        for (int s = 0; s < n; s++) {
+            int *row = sig + s * width;
+            row[0] = cls[s];
+            for (int c = 0; c < ALPHA; c++) {
+                int to = p->trans[s * ALPHA + c];
+                row[c + 1] = to >= 0 ? cls[to] : -1;
+            }
+        }
+        for (int i = 0; i < slot_count; i++) slots[i] = -1;
+        int count = 0;
+        for (int s = 0; s < n; s++) {
+            const int *row = sig + s * width;
+            unsigned h = 2166136261u;
+            for (int i = 0; i < width; i++) h = (h ^ (unsigned)row[i]) * 16777619u;
+            h &= (unsigned)(slot_count - 1);
+            while (slots[h] >= 0 && memcmp(sig + slots[h] * width, row, sizeof(int) * width) != 0) {
+                h = (h + 1) & (unsigned)(slot_count - 1);
+            }
+            if (slots[h] < 0) {
+                slots[h] = s;
+                next_cls[s] = count++;
+            } else {
+                next_cls[s] = next_cls[slots[h]];
+            }
+        }
+        memcpy(cls, next_cls, sizeof(int) * n);
+        if (count == classes) break;
+        classes = count;
+    }
+
+    // Class k becomes state k + 1, leaving row 0 as the dead state of the table
+    int rows = classes + 1;
+    int *dense = malloc(sizeof(int) * ALPHA * rows);
+    sd->tags = malloc(sizeof(int16_t) * rows);
+    int ok = dense && sd->tags;
+    if (ok) {
+        for (int c = 0; c < ALPHA; c++) dense[c] = 0;
+        sd->tags[0] = SCAN_TAG_NONE;
+        // States of one class agree on every move, so any member can stand for it
+        for (int s = 0; s < n; s++) {
+            int k = cls[s] + 1;
+            sd->tags[k] = p->tags[s];
+            for (int c = 0; c < ALPHA; c++) {
+                int to = p->trans[s * ALPHA + c];
+                dense[k * ALPHA + c] = to >= 0 ? cls[to] + 1 : 0;
+            }
+        }
+        sd->start = cls[0] + 1;
+        ok = run_rows_last(dense, sd->tags, rows, &sd->start) == 0 &&
+             dfa_table_build(&sd->table, rows, dense) == 0;
+    }
+    sd->nstates = classes;
+    free(dense);
+    free(cls);
+    free(sig);
+    free(slots);
+    free(next_cls);
+    return ok ? 0 : -1;
+}
+
+int scanner_dfa_build(ScannerDFA *sd, const StrList *terms, const DFA *ident, const DFA *number, int utf8) {
+    memset(sd, 0, sizeof(*sd));
+    Machine m[COMPONENTS];
+    memset(m, 0, sizeof(m));
+    Product p;
+    memset(&p, 0, sizeof(p));
+    int ok = build_keywords(&m[0], terms) == 0 &&
+             build_from_dfa(&m[1], ident, LT_IDENTIFIER) == 0 &&
+             build_from_dfa(&m[2], number, LT_NUMBER) == 0 &&
+             build_strings(&m[3]) == 0 &&
+             build_blanks(&m[4]) == 0;
+    if (ok && utf8) ok = utf8_letters(&m[1]) == 0;
+    ok = ok && build_product(&p, m) == 0 && minimize(&p, sd) == 0;
+    sd->utf8 = utf8 != 0;
+    product_free(&p);
+    for (int i = 0; i < COMPONENTS; i++) machine_free(&m[i]);
+    if (!ok) scanner_dfa_free(sd);
+    return ok ? 0 : -1;
+}
+
+void scanner_dfa_free(ScannerDFA *sd) {
+    dfa_table_free(&sd->table);
+    free(sd->tags);
+    memset(sd, 0, sizeof(*sd));
+}
+
+// Walk row offsets up to limit, remembering the last accepting state without a
+// second branch; STOP is tested after each move
+#define SCAN_WALK(TRANS, STOP) \
+    while (q < limit) { \
+        off = (TRANS)[off | classes[(unsigned char)*q++]]; \
+        if (!off) break; \
+        int t = tags[off >> shift]; \
+        int accepts = t != SCAN_TAG_NONE; \
+        len = accepts ? (size_t)(q - p) : len; \
+        best = accepts ? t : best; \
+        if (STOP) break; \
+    }
+
+#define SCAN_WALK_WIDTH(STOP) \
+    if (sd->table.trans16) { \
+        SCAN_WALK(sd->table.trans16, STOP) \
+    } else if (sd->table.trans8) { \
+        SCAN_WALK(sd->table.trans8, STOP) \
+    } else { \
+        SCAN_WALK(sd->table.trans32, STOP) \
+    }
+
+// Rest of a token longer than SCAN_PLAIN_BYTES, from row offset off at q. Rows
+// from accel_off on (blanks, identifier tails, string bodies) skip the rest of
+// their run with simd_scan_run, which leaves the state as it is.
+static size_t longest_match_long(const ScannerDFA *sd, const char *p, const char *q, const char *end,
+                                 size_t off, size_t len, int *tag) {
+    const uint8_t *classes = sd->table.classes;
+    int shift = sd->table.shift;
+    const int16_t *tags = sd->tags;
+    size_t accel_off = sd->table.accel_off;
+    const char *limit = end;
+    int best = *tag;
+    for (;;) {
+        if (off >= accel_off) {
+            q = simd_scan_run((ScanRunKind)sd->table.accel[off >> shift], q, end);
+            if (tags[off >> shift] != SCAN_TAG_NONE) len = (size_t)(q - p);
+        }
+        SCAN_WALK_WIDTH(off >= accel_off)
+        if (!off || q >= end) break;
+    }
+    *tag = best;
+    return len;
+}
+
+// Most tokens are short: the first SCAN_PLAIN_BYTES bytes are walked plainly
+#define SCAN_PLAIN_BYTES 8
+
+static SCAN_INLINE size_t longest_match(const ScannerDFA *sd, const char *p, const char *end, int *tag) {
+    const uint8_t *classes = sd->table.classes;
+    int shift = sd->table.shift;
+    const int16_t *tags = sd->tags;
+    size_t off = (size_t)sd->start << shift;
+    size_t len = 0;
+    int best = SCAN_TAG_NONE;
+    const char *q = p;
+    const char *limit = end - p > SCAN_PLAIN_BYTES ? p + SCAN_PLAIN_BYTES : end;
+    SCAN_WALK_WIDTH(0)
+    *tag = best;
+    if (off && q < end) return longest_match_long(sd, p, q, end, off, len, tag);
+    return len;
+}
+
+size_t scanner_dfa_match(const ScannerDFA *sd, const char *p, const char *end, int *tag) {
+    return longest_match(sd, p, end, tag);
+}
+
+// Length cap for a token at q; in UTF-8 mode it backs off to a character start
+static size_t token_cap(const ScannerDFA *sd, const char *q, size_t cap) {
+    if (sd->utf8) {
+        while (cap > 1 && ((unsigned char)q[cap] & 0xC0) == 0x80) cap--;
+    }
+    return cap;
+}
+
+int scanner_dfa_next(const ScannerDFA *sd, const char **p, const char *end, ScanToken *tok) {
+    const char *q = *p;
+    for (;;) {
+        if (q >= end) {
+            *p = q;
+            return 0;
+        }
+        int tag;
+        size_t len = longest_match(sd, q, end, &tag);
+        if (len == 0) {
+            len = 1;
+        } else if (tag == SCAN_TAG_BLANK) {
+            q += len;
+            continue;
+        } else if (tag == LT_STRING && len > SCAN_MAX_STRING) {
+            len = scanner_dfa_match(sd, q, q + token_cap(sd, q, SCAN_MAX_STRING), &tag);
+        } else if (len > SCAN_MAX_WORD && tag != LT_STRING) {
+            len = scanner_dfa_match(sd, q, q + token_cap(sd, q, SCAN_MAX_WORD), &tag);
+        }
+        tok->start = q;
+        tok->length = len;
+        tok->tag = tag;
+        *p = q + len;
+        return 1;
+    }
+}
+
+int scanner_dfa_next_utf8(const ScannerDFA *sd, const char **p, const char *end,
+                          const char **valid_end, ScanToken *tok) {
+    for (;;) {
+        const char *q = *p;
+        if (q >= end) return 0;
+        if (q >= *valid_end) {
+            *valid_end = simd_utf8_validate(q, end);
+            if (*valid_end == q) {
+                tok->start = q;
+                tok->length = 1;
+                tok->tag = SCAN_TAG_NONE;
+                *p = q + 1;
+                return 1;
+            }
+        }
+        if (!scanner_dfa_next(sd, p, end, tok)) return 0;
+        if (tok->start >= *valid_end) {
+            // Blanks ran up to the invalid sequence; it is reported first
+            *p = tok->start;
+            continue;
+        }
+        if (tok->start + tok->length > *valid_end && tok->tag != LT_STRING) {
+            int tag;
+            size_t len = scanner_dfa_match(sd, tok->start, *valid_end, &tag);
+            tok->length = len ? len : 1;
+            tok->tag = len ? tag : SCAN_TAG_NONE;
+            *p = tok->start + tok->length;
+        }
+        return 1;
+    }
+}
+
+// Built-in copies of identifier.fa and number.fa
+static int builtin_dfa(DFA *d, int number) {
+    int trans[5 * DFA_ALPHA] = { 0 };
+    uint8_t finals[5] = { 0 };
+    if (!number) {
+        // [A-Za-z_][A-Za-z0-9_]*
+        finals[2] = 1;
+        for (int c = 0; c < 128; c++) {
+            if (isalpha(c) || c == '_') trans[1 * DFA_ALPHA + c] = 2;
+            if (isalnum(c) || c == '_') trans[2 * DFA_ALPHA + c] = 2;
+        }
+        return dfa_build(d, 2, 1, finals, trans);
+    }
+    // [0-9]+(\.[0-9]+)?
+    finals[2] = finals[4] = 1;
+    for (int c = '0'; c <= '9'; c++) {
+        trans[1 * DFA_ALPHA + c] = trans[2 * DFA_ALPHA + c] = 2;
+        trans[3 * DFA_ALPHA + c] = trans[4 * DFA_ALPHA + c] = 4;
+    }
+    trans[2 * DFA_ALPHA + '.'] = 3;
+    return dfa_build(d, 4, 1, finals, trans);
+}
+
+const ScannerDFA *scanner_dfa_default_utf8(void) {
+    static ScannerDFA sd;
+    static int built = 0;
+    if (!built) {
+        DFA ident, number;
+        if (dfa_load("identifier.fa", &ident) != 0 && builtin_dfa(&ident, 0) != 0) return NULL;
+        if (dfa_load("number.fa", &number) != 0 && builtin_dfa(&number, 1) != 0) {
+            dfa_free(&ident);
+            return NULL;
+        }
+        int rc = scanner_dfa_build(&sd, NULL, &ident, &number, 1);
+        dfa_free(&ident);
+        dfa_free(&number);
+        if (rc != 0) return NULL;
+        built = 1;
+    }
+    return &sd;
+}
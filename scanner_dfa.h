@@ -0,0 +1,80 @@
+// scanner_dfa.h
+// Combined longest-match scanner: the keyword/operator terminals, the identifier
+// and number DFAs, string literals, newlines and blanks merged into one minimized
+// DFA whose states are tagged with the token they accept
+
+#ifndef SCANNER_DFA_H
+#define SCANNER_DFA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dfa.h"
+#include "first_follow.h"
+#include "lexer_pif_export.h"
+
+// State tags: a LexemeTerminal, blanks between tokens, or not accepting
+#define SCAN_TAG_BLANK LT_NUM_TERMINALS
+#define SCAN_TAG_NONE (-1)
+
+// Token length caps of the string tokenizer (generate_pif_from_string buffers)
+#define SCAN_MAX_WORD 255
+#define SCAN_MAX_STRING 511
+
+// States are numbered 1..nstates; row 0 of the table is the dead state
+typedef struct {
+    int nstates;
+    int start;
+    DFATable table;         // byte classes and row offsets (dfa.h)
+    int16_t *tags;          // nstates + 1, see SCAN_TAG_*
+    int utf8;               // built in UTF-8 mode
+} ScannerDFA;
+
+// Component machines, highest priority first when two accept the same prefix:
+//   keywords/operators  lexeme_keywords whose terminal is in terms (all of them
+//                       if terms is NULL), letters matched case-insensitively
+//   ident               tagged LT_IDENTIFIER
+//   number              tagged LT_NUMBER
+//   strings             "[^"]*"?  (an unterminated string runs to the end)
+//   blanks              [ \t\v\f\r]+
+// The product automaton is minimized by partition refinement on the tags.
+// In UTF-8 mode (utf8 nonzero) every non-ASCII letter (dfa_utf8_letter) moves
+// the ident machine like 'a'. Bytes >= 0x80 other than the simd_utf8_mixed_lead
+// bytes only start or continue letters, so they join the identifier byte class
+// and identifier rows skip them with the SCAN_RUN_IDENT_UTF8 kernels; a mixed
+// lead goes through a few states that accept only the letters it starts.
+// Returns 0 on success, -1 on allocation failure.
+int scanner_dfa_build(ScannerDFA *sd, const StrList *terms, const DFA *ident, const DFA *number, int utf8);
+
+void scanner_dfa_free(ScannerDFA *sd);
+
+// Longest prefix of [p, end) that the scanner accepts; *tag receives its tag.
+// Returns 0 (tag SCAN_TAG_NONE) if no prefix is a token.
+size_t scanner_dfa_match(const ScannerDFA *sd, const char *p, const char *end, int *tag);
+
+typedef struct {
+    const char *start;
+    size_t length;
+    int tag;                // LexemeTerminal, or SCAN_TAG_NONE for an unknown byte
+} ScanToken;
+
+// Skip blanks and read the token at *p, advancing *p past it. Bytes no token
+// starts with are returned as one-byte tokens, and words and strings are cut at
+// SCAN_MAX_WORD / SCAN_MAX_STRING bytes. Returns 0 at end of input.
+int scanner_dfa_next(const ScannerDFA *sd, const char **p, const char *end, ScanToken *tok);
+
+// scanner_dfa_next for a UTF-8 mode scanner over text that may not be valid
+// UTF-8. [*p, *valid_end) is the part known to be valid; start valid_end at the
+// beginning of the text, and it is advanced with simd_utf8_validate as the scan
+// reaches it. Tokens other than strings end before an invalid sequence, whose
+// bytes come back as one-byte tokens tagged SCAN_TAG_NONE; string literals keep
+// their bytes as in byte mode. Length caps never split a character.
+int scanner_dfa_next_utf8(const ScannerDFA *sd, const char **p, const char *end,
+                          const char **valid_end, ScanToken *tok);
+
+// UTF-8 mode scanner over every terminal, for scanner_dfa_next_utf8, built on
+// first use from identifier.fa and number.fa in the current directory, or from
+// built-in copies of them if they cannot be loaded. The first call is not
+// thread-safe.
+const ScannerDFA *scanner_dfa_default_utf8(void);
+
+#endif // SCANNER_DFA_H
@@ -0,0 +1,380 @@
+// simd_scan.c
+// Scalar, SSE2 and AVX2 run finders with run-time dispatch
+
+#include "simd_scan.h"
+#include <stddef.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define SIMD_X86 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define SIMD_X86 1
+#define TARGET_AVX2
+#include <intrin.h>
+#endif
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+typedef const char *(*RunFn)(const char *p, const char *end);
+
+int simd_scan_in_run(ScanRunKind kind, unsigned char c) {
+    switch (kind) {
+    case SCAN_RUN_BLANK:
+        return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+    case SCAN_RUN_DIGIT:
+        return c >= '0' && c <= '9';
+    case SCAN_RUN_IDENT:
+        return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '_';
+    case SCAN_RUN_STRING:
+        return c != '"' && c != '\\';
+    case SCAN_RUN_IDENT_UTF8:
+        return (c >= 0x80 && !simd_utf8_mixed_lead(c)) || simd_scan_in_run(SCAN_RUN_IDENT, c);
+    default:
+        return 0;
+    }
+}
+
+static const char *run_none(const char *p, const char *end) {
+    (void)end;
+    return p;
+}
+
+#define SCALAR_RUN(NAME, KIND) \
+    static const char *NAME(const char *p, const char *end) { \
+        while (p < end && simd_scan_in_run(KIND, (unsigned char)*p)) p++; \
+        return p; \
+    }
+
+SCALAR_RUN(blank_scalar, SCAN_RUN_BLANK)
+SCALAR_RUN(digit_scalar, SCAN_RUN_DIGIT)
+SCALAR_RUN(ident_scalar, SCAN_RUN_IDENT)
+SCALAR_RUN(string_scalar, SCAN_RUN_STRING)
+SCALAR_RUN(ident_utf8_scalar, SCAN_RUN_IDENT_UTF8)
+
+static const RunFn scalar_fns[SCAN_RUN_KINDS] = {
+    run_none, blank_scalar, digit_scalar, ident_scalar, string_scalar, ident_utf8_scalar
+};
+
+static const char *utf8_scalar(const char *p, const char *end) {
+    while (p < end) {
+        if ((unsigned char)*p < 0x80) {
+            p++;
+            continue;
+        }
+        size_t n = simd_utf8_sequence(p, end);
+        if (!n) return p;
+        p += n;
+    }
+    return p;
+}
+
+#ifdef SIMD_X86
+
+static inline unsigned first_bit(unsigned m) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return (unsigned)i;
+#else
+    return (unsigned)__builtin_ctz(m);
+#endif
+}
+
+// Each STOP macro yields 0xFF in the bytes that end the run. Bytes >= 0x80 are
+// negative in the signed compares, so they fall outside every range.
+#define SSE_RANGE(x, lo, hi) \
+    _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8((char)((lo) - 1))), \
+                  _mm_cmplt_epi8(x, _mm_set1_epi8((char)((hi) + 1))))
+#define SSE_NOT(v) _mm_xor_si128(v, _mm_set1_epi8(-1))
+
+#define SSE_STOP_BLANK(x) SSE_NOT(_mm_or_si128( \
+    _mm_andnot_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')), SSE_RANGE(x, '\t', '\r')), \
+    _mm_cmpeq_epi8(x, _mm_set1_epi8(' '))))
+#define SSE_STOP_DIGIT(x) SSE_NOT(SSE_RANGE(x, '0', '9'))
+#define SSE_STOP_IDENT(x) SSE_NOT(_mm_or_si128(_mm_or_si128( \
+    SSE_RANGE(x, '0', '9'), \
+    SSE_RANGE(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z')), \
+    _mm_cmpeq_epi8(x, _mm_set1_epi8('_'))))
+#define SSE_STOP_STRING(x) _mm_or_si128( \
+    _mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\')))
+#define SSE_MIXED_LEAD(x) _mm_or_si128(_mm_or_si128(_mm_or_si128( \
+    _mm_cmpeq_epi8(x, _mm_set1_epi8((char)0xC2)), _mm_cmpeq_epi8(x, _mm_set1_epi8((char)0xC3))), \
+    _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8((char)0xE2)), _mm_cmpeq_epi8(x, _mm_set1_epi8((char)0xE3)))), \
+    _mm_cmpeq_epi8(x, _mm_set1_epi8((char)0xEF)))
+#define SSE_STOP_IDENT_UTF8(x) _mm_or_si128(_mm_andnot_si128( \
+    _mm_cmplt_epi8(x, _mm_setzero_si128()), SSE_STOP_IDENT(x)), SSE_MIXED_LEAD(x))
+
+#define SSE2_RUN(NAME, STOP, TAIL) \
+    static const char *NAME(const char *p, const char *end) { \
+        while (end - p >= 16) { \
+            __m128i x = _mm_loadu_si128((const __m128i *)p); \
+            unsigned m = (unsigned)_mm_movemask_epi8(STOP(x)); \
+            if (m) return p + first_bit(m); \
+            p += 16; \
+        } \
+        return TAIL(p, end); \
+    }
+
+SSE2_RUN(blank_sse2, SSE_STOP_BLANK, blank_scalar)
+SSE2_RUN(digit_sse2, SSE_STOP_DIGIT, digit_scalar)
+SSE2_RUN(ident_sse2, SSE_STOP_IDENT, ident_scalar)
+SSE2_RUN(string_sse2, SSE_STOP_STRING, string_scalar)
+SSE2_RUN(ident_utf8_sse2, SSE_STOP_IDENT_UTF8, ident_utf8_scalar)
+
+static const RunFn sse2_fns[SCAN_RUN_KINDS] = {
+    run_none, blank_sse2, digit_sse2, ident_sse2, string_sse2, ident_utf8_sse2
+};
+
+// ASCII blocks are skipped whole; a block with a high bit set is checked one
+// sequence at a time, which may run up to 3 bytes into the next block
+static const char *utf8_sse2(const char *p, const char *end) {
+    while (end - p >= 16) {
+        if (!_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p))) {
+            p += 16;
+            continue;
+        }
+        const char *stop = p + 16;
+        while (p < stop) {
+            size_t n = simd_utf8_sequence(p, end);
+            if (!n) return p;
+            p += n;
+        }
+    }
+    return utf8_scalar(p, end);
+}
+
+#define AVX_RANGE(x, lo, hi) \
+    _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8((char)((lo) - 1))), \
+                     _mm256_cmpgt_epi8(_mm256_set1_epi8((char)((hi) + 1)), x))
+#define AVX_NOT(v) _mm256_xor_si256(v, _mm256_set1_epi8(-1))
+
+#define AVX_STOP_BLANK(x) AVX_NOT(_mm256_or_si256( \
+    _mm256_andnot_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')), AVX_RANGE(x, '\t', '\r')), \
+    _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' '))))
+#define AVX_STOP_DIGIT(x) AVX_NOT(AVX_RANGE(x, '0', '9'))
+#define AVX_STOP_IDENT(x) AVX_NOT(_mm256_or_si256(_mm256_or_si256( \
+    AVX_RANGE(x, '0', '9'), \
+    AVX_RANGE(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z')), \
+    _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'))))
+#define AVX_STOP_STRING(x) _mm256_or_si256( \
+    _mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\')))
+#define AVX_MIXED_LEAD(x) _mm256_or_si256(_mm256_or_si256(_mm256_or_si256( \
+    _mm256_cmpeq_epi8(x, _mm256_set1_epi8((char)0xC2)), _mm256_cmpeq_epi8(x, _mm256_set1_epi8((char)0xC3))), \
+    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8((char)0xE2)), _mm256_cmpeq_epi8(x, _mm256_set1_epi8((char)0xE3)))), \
+    _mm256_cmpeq_epi8(x, _mm256_set1_epi8((char)0xEF)))
+#define AVX_STOP_IDENT_UTF8(x) _mm256_or_si256(_mm256_andnot_si256( \
+    _mm256_cmpgt_epi8(_mm256_setzero_si256(), x), AVX_STOP_IDENT(x)), AVX_MIXED_LEAD(x))
+
+// The last partial block goes through the SSE2 kernel
+#define AVX2_RUN(NAME, STOP, TAIL) \
+    TARGET_AVX2 static const char *NAME(const char *p, const char *end) { \
+        while (end - p >= 32) { \
+            __m256i x = _mm256_loadu_si256((const __m256i *)p); \
+            unsigned m = (unsigned)_mm256_movemask_epi8(STOP(x)); \
+            if (m) return p + first_bit(m); \
+            p += 32; \
+        } \
+        return TAIL(p, end); \
+    }
+
+AVX2_RUN(blank_avx2, AVX_STOP_BLANK, blank_sse2)
+AVX2_RUN(digit_avx2, AVX_STOP_DIGIT, digit_sse2)
+AVX2_RUN(ident_avx2, AVX_STOP_IDENT, ident_sse2)
+AVX2_RUN(string_avx2, AVX_STOP_STRING, string_sse2)
+AVX2_RUN(ident_utf8_avx2, AVX_STOP_IDENT_UTF8, ident_utf8_sse2)
+
+static const RunFn avx2_fns[SCAN_RUN_KINDS] = {
+    run_none, blank_avx2, digit_avx2, ident_avx2, string_avx2, ident_utf8_avx2
+};
+
+// UTF-8 validation by nibble lookups (Keiser and Lemire, "Validating UTF-8 in
+// less than one instruction per byte"). Each error class gets a bit; a byte pair
+// is invalid when the classes of the first byte's high and low nibble and the
+// second byte's high nibble share a bit, or when a third or fourth byte of a
+// sequence is not where the lead byte put it.
+#define U8_TOO_SHORT      (1 << 0)
+#define U8_TOO_LONG       (1 << 1)
+#define U8_OVERLONG_3     (1 << 2)
+#define U8_TOO_LARGE      (1 << 3)
+#define U8_SURROGATE      (1 << 4)
+#define U8_OVERLONG_2     (1 << 5)
+#define U8_TOO_LARGE_1000 (1 << 6)
+#define U8_OVERLONG_4     (1 << 6)
+#define U8_TWO_CONTS      (1 << 7)
+#define U8_CARRY          (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+static const unsigned char u8_byte1_high[16] = {
+    // 0xxx ASCII
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    // 10xx continuation
+    U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+    // 1100, 1101 two-byte lead
+    U8_TOO_SHORT | U8_OVERLONG_2,
+    U8_TOO_SHORT,
+    // 1110 three-byte lead
+    U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+    // 1111 four-byte lead
+    U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4
+};
+
+static const unsigned char u8_byte1_low[16] = {
+    U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+    U8_CARRY | U8_OVERLONG_2,
+    U8_CARRY,
+    U8_CARRY,
+    U8_CARRY | U8_TOO_LARGE,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000
+};
+
+static const unsigned char u8_byte2_high[16] = {
+    // 0xxx ASCII
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    // 1000, 1001, 101x continuation
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+    // 11xx lead
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT
+};
+
+// The block x shifted right by n bytes, with the last bytes of prev shifted in
+#define AVX_PREV(x, prev, n) \
+    _mm256_alignr_epi8(x, _mm256_permute2x128_si256(prev, x, 0x21), 16 - (n))
+
+TARGET_AVX2 static __m256i avx_lookup16(const unsigned char *table, __m256i nibbles) {
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table)), nibbles);
+}
+
+// Nonzero bytes where x, following prev, breaks a rule; a sequence cut off at
+// the end of x is not an error yet
+TARGET_AVX2 static __m256i utf8_block_errors(__m256i x, __m256i prev) {
+    __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i prev1 = AVX_PREV(x, prev, 1);
+    __m256i special = _mm256_and_si256(_mm256_and_si256(
+        avx_lookup16(u8_byte1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+        avx_lookup16(u8_byte1_low, _mm256_and_si256(prev1, nibble))),
+        avx_lookup16(u8_byte2_high, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+    // Bytes 2 and 3 after a lead of 0xE0 or 0xF0 and up must be continuations
+    __m256i third = _mm256_subs_epu8(AVX_PREV(x, prev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(AVX_PREV(x, prev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must_cont = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must_cont, special);
+}
+
+// Start of the sequence a block boundary at p may cut: the lead byte among the
+// last 3 bytes before p, or p itself
+static const char *utf8_resume(const char *begin, const char *p) {
+    for (int back = 1; back <= 3 && p - back >= begin; back++) {
+        unsigned char c = (unsigned char)p[-back];
+        if ((c & 0xC0) != 0x80) return c >= 0xC0 ? p - back : p;
+    }
+    return p;
+}
+
+// Blocks are checked until one holds an error; the SSE2 path then finds its
+// exact position, starting at the sequence that may straddle the block boundary,
+// and also checks the tail
+TARGET_AVX2 static const char *utf8_avx2(const char *p, const char *end) {
+    const char *begin = p;
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    // A lead byte in the last 3 positions needs bytes from the next block
+    __m256i max_complete = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    while (end - p >= 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+        if (!_mm256_movemask_epi8(x)) {
+            if (!_mm256_testz_si256(incomplete, incomplete)) break;
+        } else {
+            __m256i errors = utf8_block_errors(x, prev);
+            if (!_mm256_testz_si256(errors, errors)) break;
+            incomplete = _mm256_subs_epu8(x, max_complete);
+        }
+        prev = x;
+        p += 32;
+    }
+    return utf8_sse2(utf8_resume(begin, p), end);
+}
+
+static int cpu_has_avx2(void) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return 0;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, and the OS saves the YMM state
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return 0;
+    if ((_xgetbv(0) & 6) != 6) return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // SIMD_X86
+
+static SimdLevel active_level = SIMD_LEVEL_SCALAR;
+static const RunFn *active_fns = NULL;
+static RunFn active_utf8 = utf8_scalar;
+
+static SimdLevel best_level(void) {
+#ifdef SIMD_X86
+    return cpu_has_avx2() ? SIMD_LEVEL_AVX2 : SIMD_LEVEL_SSE2;
+#else
+    return SIMD_LEVEL_SCALAR;
+#endif
+}
+
+void simd_scan_set_level(SimdLevel level) {
+    SimdLevel best = best_level();
+    if (level > best) level = best;
+    active_level = level;
+#ifdef SIMD_X86
+    active_fns = level == SIMD_LEVEL_AVX2 ? avx2_fns : level == SIMD_LEVEL_SSE2 ? sse2_fns : scalar_fns;
+    active_utf8 = level == SIMD_LEVEL_AVX2 ? utf8_avx2 : level == SIMD_LEVEL_SSE2 ? utf8_sse2 : utf8_scalar;
+#else
+    active_fns = scalar_fns;
+#endif
+}
+
+SimdLevel simd_scan_level(void) {
+    if (!active_fns) simd_scan_set_level(SIMD_LEVEL_AVX2);
+    return active_level;
+}
+
+const char *simd_scan_level_name(SimdLevel level) {
+    switch (level) {
+    case SIMD_LEVEL_AVX2: return "avx2";
+    case SIMD_LEVEL_SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+const char *simd_scan_run(ScanRunKind kind, const char *p, const char *end) {
+    if (!active_fns) simd_scan_set_level(SIMD_LEVEL_AVX2);
+    return active_fns[kind](p, end);
+}
+
+const char *simd_utf8_validate(const char *p, const char *end) {
+    if (!active_fns) simd_scan_set_level(SIMD_LEVEL_AVX2);
+    return active_utf8(p, end);
+}
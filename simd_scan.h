@@ -0,0 +1,79 @@
+// simd_scan.h
+// Run finders for the lexer's byte classes: SSE2/AVX2 kernels test 16 or 32
+// bytes per step, chosen at run time, with a scalar fallback
+
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+#include <stddef.h>
+
+// Byte sets a run is made of
+typedef enum {
+    SCAN_RUN_NONE,
+    SCAN_RUN_BLANK,         // [ \t\v\f\r]
+    SCAN_RUN_DIGIT,         // [0-9]
+    SCAN_RUN_IDENT,         // [A-Za-z0-9_]
+    SCAN_RUN_STRING,        // string body: anything but '"' and '\\'
+    SCAN_RUN_IDENT_UTF8,    // [A-Za-z0-9_] and bytes >= 0x80 but simd_utf8_mixed_lead
+                            // (UTF-8 identifiers)
+    SCAN_RUN_KINDS
+} ScanRunKind;
+
+typedef enum {
+    SIMD_LEVEL_SCALAR,
+    SIMD_LEVEL_SSE2,
+    SIMD_LEVEL_AVX2
+} SimdLevel;
+
+// First byte in [p, end) that is not in the kind's set, or end
+const char *simd_scan_run(ScanRunKind kind, const char *p, const char *end);
+
+// Scalar membership test of the same sets
+int simd_scan_in_run(ScanRunKind kind, unsigned char c);
+
+// Lead bytes whose sequences include code points that are not identifier
+// letters (dfa_utf8_letter in dfa.h); every other sequence is a letter
+static inline int simd_utf8_mixed_lead(unsigned char c) {
+    return c == 0xC2 || c == 0xC3 || c == 0xE2 || c == 0xE3 || c == 0xEF;
+}
+
+// Length of the well-formed UTF-8 sequence at s, 0 if it is invalid or cut off
+// by end (Unicode table 3-7)
+static inline size_t simd_utf8_sequence(const char *s, const char *end) {
+    const unsigned char *p = (const unsigned char *)s;
+    unsigned char c = p[0], lo = 0x80, hi = 0xBF;
+    size_t n;
+    if (c < 0x80) return 1;
+    if (c >= 0xC2 && c <= 0xDF) {
+        n = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        n = 3;
+        if (c == 0xE0) lo = 0xA0;       // overlong
+        if (c == 0xED) hi = 0x9F;       // surrogates
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        n = 4;
+        if (c == 0xF0) lo = 0x90;       // overlong
+        if (c == 0xF4) hi = 0x8F;       // above U+10FFFF
+    } else {
+        return 0;
+    }
+    if ((size_t)(end - s) < n || p[1] < lo || p[1] > hi) return 0;
+    for (size_t i = 2; i < n; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+    }
+    return n;
+}
+
+// Start of the first invalid or truncated UTF-8 sequence in [p, end), or end.
+// Overlong forms, surrogates and code points above U+10FFFF are invalid. AVX2
+// checks 32 bytes per step with nibble lookups; SSE2 skips ASCII blocks and
+// checks the others sequence by sequence.
+const char *simd_utf8_validate(const char *p, const char *end);
+
+// Level in use: the best the CPU supports unless overridden. simd_scan_set_level
+// caps it (for testing and benchmarks); the first call is not thread-safe.
+SimdLevel simd_scan_level(void);
+void simd_scan_set_level(SimdLevel level);
+const char *simd_scan_level_name(SimdLevel level);
+
+#endif // SIMD_SCAN_H
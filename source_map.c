@@ -0,0 +1,91 @@
+// source_map.c
+// Private file mappings with a NUL-padded tail
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#endif
+
+#include "source_map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+#ifdef _WIN32
+// No private file mapping with a writable zero tail here: read into memory
+int source_map_open(SourceMap *map, const char *filename) {
+    memset(map, 0, sizeof(*map));
+    FILE *f = fopen(filename, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = size >= 0 ? malloc((size_t)size + 2) : NULL;
+    if (!data || fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    data[size] = data[size + 1] = '\0';
+    map->data = data;
+    map->size = (size_t)size;
+    return 0;
+}
+#else
+int source_map_open(SourceMap *map, const char *filename) {
+    memset(map, 0, sizeof(*map));
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t map_size = (size + 2 + page - 1) / page * page;
+
+    // Reserve zeroed pages, then lay the file over the front. Bytes past EOF in
+    // the file's last page read as zero, and if the file ends on a page boundary
+    // the next (anonymous) page supplies the terminating NULs.
+    char *base = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    if (size > 0 &&
+        mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, map_size);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    map->data = base;
+    map->size = size;
+    map->map_size = map_size;
+    return 0;
+}
+#endif
+
+void source_map_close(SourceMap *map) {
+#ifndef _WIN32
+    if (map->map_size) {
+        munmap(map->data, map->map_size);
+    } else
+#endif
+    {
+        free(map->data);
+    }
+    memset(map, 0, sizeof(*map));
+}
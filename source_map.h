@@ -0,0 +1,21 @@
+// source_map.h
+// Source files mapped for in-place scanning: the mapping is private (writes are
+// copy-on-write) and always followed by two NUL bytes, as yy_scan_buffer requires
+
+#ifndef SOURCE_MAP_H
+#define SOURCE_MAP_H
+
+#include <stddef.h>
+
+typedef struct {
+    char *data;             // size bytes of the file, then data[size] == data[size + 1] == '\0'
+    size_t size;
+    size_t map_size;        // bytes reserved (0 if data was allocated)
+} SourceMap;
+
+// Returns 0 on success, -1 on error
+int source_map_open(SourceMap *map, const char *filename);
+
+void source_map_close(SourceMap *map);
+
+#endif // SOURCE_MAP_H
@@ -0,0 +1,259 @@
+// source_parser.c
+// One-pass tokenizer feeding the lazy LL(1) parse loop directly
+
+#include "source_parser.h"
+#include "lexer_pif_export.h"
+#include "scanner_dfa.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED_LOC -1
+#define LOCAL_ST_CAPACITY 16    // same as generate_pif_from_tokens
+
+// Token before range folding
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} RawToken;
+
+typedef struct {
+    const ScannerDFA *dfa;
+    const char *text;
+    const char *p;
+    const char *end;
+    const char *valid_end;      // [p, valid_end) is known to be valid UTF-8
+    SymbolTable *st;
+    NumTable *nums;             // NULL unless the caller wants literal values
+    RawToken queue[3];          // lookahead for NUMBER .. NUMBER folding
+    int queued;
+    char lexeme[2 * SCAN_MAX_STRING + 4];
+    size_t lexeme_len;
+} SourceScanner;
+
+static void scanner_init(SourceScanner *sc, const char *text, size_t len, SymbolTable *st, NumTable *nums) {
+    memset(sc, 0, sizeof(*sc));
+    // The string tokenizer stopped at the first NUL
+    const char *nul = memchr(text, '\0', len);
+    sc->text = text;
+    sc->p = text;
+    sc->end = nul ? nul : text + len;
+    sc->valid_end = text;
+    sc->st = st;
+    sc->nums = nums;
+    sc->dfa = scanner_dfa_default_utf8();
+}
+
+static int scan_raw(SourceScanner *sc, RawToken *tok) {
+    ScanToken t;
+    if (!scanner_dfa_next_utf8(sc->dfa, &sc->p, sc->end, &sc->valid_end, &t)) return 0;
+    tok->offset = (uint32_t)(t.start - sc->text);
+    tok->length = (uint32_t)t.length;
+    return 1;
+}
+
+static int is_numeric(const char *s, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (!isdigit((unsigned char)s[i]) && s[i] != '.') return 0;
+    }
+    return 1;
+}
+
+// Same decision as the generator's needs_symbol_table
+static int needs_location(const char *lex, size_t len) {
+    int all_upper = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (!(isupper((unsigned char)lex[i]) || lex[i] == '_')) { all_upper = 0; break; }
+    }
+    if (all_upper) return 0;
+
+    int id = lexeme_terminal_id(lex, len);
+    if (id >= 0) return id == LT_IDENTIFIER || id == LT_NUMBER || id == LT_STRING;
+    return lex[0] == '"' && lex[len - 1] == '"';
+}
+
+// Next token after range folding, with its symbol table location; the
+// lexeme is left in sc->lexeme. Returns 0 at end of input.
+static int next_token(SourceScanner *sc, PIFSlice *slice) {
+    while (sc->queued < 3 && scan_raw(sc, &sc->queue[sc->queued])) sc->queued++;
+    if (sc->queued == 0) return 0;
+
+    const RawToken *q = sc->queue;
+    const char *t = sc->text;
+    int take = 1;
+    if (sc->queued == 3 && is_numeric(t + q[0].offset, q[0].length) &&
+        q[1].length == 2 && memcmp(t + q[1].offset, "..", 2) == 0 &&
+        is_numeric(t + q[2].offset, q[2].length)) {
+        take = 3;
+    }
+
+    // Folded ranges are glued back together as "a..b"
+    size_t n = 0;
+    for (int k = 0; k < take; k++) {
+        memcpy(sc->lexeme + n, t + q[k].offset, q[k].length);
+        n += q[k].length;
+    }
+    sc->lexeme[n] = '\0';
+    sc->lexeme_len = n;
+
+    uint32_t last = q[take - 1].offset + q[take - 1].length;
+    slice->offset = q[0].offset;
+    slice->length = last - q[0].offset;
+    slice->terminal = -1;
+    slice->bucket = UNUSED_LOC;
+    slice->pos = UNUSED_LOC;
+
+    if (needs_location(sc->lexeme, n)) {
+        int idx = st_put(sc->st, sc->lexeme);
+        if (st_get_location_by_index(sc->st, idx, &slice->bucket, &slice->pos) != 0) {
+            slice->bucket = UNUSED_LOC;
+            slice->pos = UNUSED_LOC;
+        } else if (sc->nums && isdigit((unsigned char)sc->lexeme[0])) {
+            num_table_put(sc->nums, idx, slice->bucket, slice->pos, sc->lexeme, n);
+        }
+    }
+
+    sc->queued -= take;
+    memmove(sc->queue, sc->queue + take, sizeof(RawToken) * sc->queued);
+    return 1;
+}
+
+// Ranges are entered in st after every other token, as the generator does, so
+// they never move the location of an identifier or number; a range's value is
+// built from its two bounds
+static void place_ranges(PIFMap *tokens, SymbolTable *st, NumTable *nums) {
+    char lexeme[2 * SCAN_MAX_STRING + 4];
+    for (int i = 0; i < tokens->count; i++) {
+        PIFSlice *slice = &tokens->entries[i];
+        const char *s = tokens->data + slice->offset;
+        if (slice->bucket != UNUSED_LOC || !isdigit((unsigned char)*s)) continue;
+
+        size_t n = 0;
+        for (uint32_t k = 0; k < slice->length && n < sizeof(lexeme) - 1; k++) {
+            if (!isspace((unsigned char)s[k])) lexeme[n++] = s[k];
+        }
+        lexeme[n] = '\0';
+        const char *dots = strstr(lexeme, "..");
+        if (!dots || lexeme_terminal_id(lexeme, n) != LT_RANGE) continue;
+
+        int idx = st_put(st, lexeme);
+        if (st_get_location_by_index(st, idx, &slice->bucket, &slice->pos) != 0) {
+            slice->bucket = UNUSED_LOC;
+            slice->pos = UNUSED_LOC;
+            continue;
+        }
+        NumLiteral lo, hi, range;
+        if (nums && !num_table_at(nums, idx) &&
+            num_literal_parse(lexeme, (size_t)(dots - lexeme), &lo) == 0 &&
+            num_literal_parse(dots + 2, strlen(dots + 2), &hi) == 0 &&
+            num_literal_range(&lo, &hi, &range) == 0) {
+            num_table_set(nums, idx, slice->bucket, slice->pos, &range);
+        }
+    }
+}
+
+static void add_token(PIFMap *tokens, const PIFSlice *slice) {
+    if (tokens->count == tokens->capacity) {
+        tokens->capacity = tokens->capacity ? tokens->capacity * 2 : 1024;
+        tokens->entries = realloc(tokens->entries, sizeof(PIFSlice) * tokens->capacity);
+    }
+    tokens->entries[tokens->count++] = *slice;
+}
+
+static void tokens_init(PIFMap *tokens, const char *text, size_t len) {
+    memset(tokens, 0, sizeof(*tokens));
+    tokens->data = text;
+    tokens->size = len;
+}
+
+int source_tokenize(const char *text, size_t len, SymbolTable *st, NumTable *nums, PIFMap *tokens) {
+    tokens_init(tokens, text, len);
+    if (len > 0xFFFFFFFFu || !scanner_dfa_default_utf8()) return -1;
+
+    SymbolTable local_st;
+    if (!st) {
+        st_init(&local_st, LOCAL_ST_CAPACITY);
+        st = &local_st;
+    }
+    SourceScanner sc;
+    scanner_init(&sc, text, len, st, nums);
+    PIFSlice slice;
+    while (next_token(&sc, &slice)) add_token(tokens, &slice);
+    place_ranges(tokens, st, nums);
+
+    if (st == &local_st) st_free(&local_st);
+    return tokens->count;
+}
+
+typedef struct {
+    SourceScanner scanner;
+    const CompiledGrammar *cg;
+    PIFMap *tokens;
+} SourceTokens;
+
+static int next_source_token(void *ctx) {
+    SourceTokens *src = ctx;
+    PIFSlice slice;
+    if (!next_token(&src->scanner, &slice)) return src->cg->dollar;
+
+    // Classified from the lexeme a PIF entry would hold (at most 255 bytes)
+    size_t n = src->scanner.lexeme_len < 255 ? src->scanner.lexeme_len : 255;
+    int column = cg_lexeme_column(src->cg, src->scanner.lexeme, n, slice.bucket);
+    slice.terminal = (int16_t)column;
+    add_token(src->tokens, &slice);
+    return column;
+}
+
+ParseResult parse_source(const char *text, size_t len, const CompiledGrammar *cg,
+                         SymbolTable *st, NumTable *nums, const char *stmt_symbol,
+                         LazyTree *lt, PIFMap *tokens) {
+    tokens_init(tokens, text, len);
+    if (len > 0xFFFFFFFFu || !scanner_dfa_default_utf8()) {
+        memset(lt, 0, sizeof(*lt));
+        return PARSE_ERROR;
+    }
+
+    SymbolTable local_st;
+    if (!st) {
+        st_init(&local_st, LOCAL_ST_CAPACITY);
+        st = &local_st;
+    }
+    SourceTokens src;
+    scanner_init(&src.scanner, text, len, st, nums);
+    src.cg = cg;
+    src.tokens = tokens;
+
+    ParseResult result = lazy_tree_parse_stream(lt, cg, next_source_token, &src, stmt_symbol);
+    place_ranges(tokens, st, nums);
+
+    if (st == &local_st) st_free(&local_st);
+    return result;
+}
+
+int source_tokens_to_entries(const PIFMap *tokens, PIFEntry **entries, int *count) {
+    int capacity = tokens->count > 0 ? tokens->count : 1;
+    *entries = malloc(sizeof(PIFEntry) * capacity);
+    *count = 0;
+    if (!*entries) return -1;
+
+    for (int i = 0; i < tokens->count; i++) {
+        const PIFSlice *slice = &tokens->entries[i];
+        const char *s = tokens->data + slice->offset;
+        PIFEntry *e = &(*entries)[i];
+        size_t n = 0;
+        if (*s == '\n' || *s == '\r') {
+            strcpy(e->lexeme, "NL");
+        } else {
+            int range = isdigit((unsigned char)*s) || *s == '.';
+            for (uint32_t k = 0; k < slice->length && n < sizeof(e->lexeme) - 1; k++) {
+                if (range && isspace((unsigned char)s[k])) continue;
+                e->lexeme[n++] = s[k];
+            }
+            e->lexeme[n] = '\0';
+        }
+        e->bucket = slice->bucket;
+        e->pos = slice->pos;
+    }
+    *count = tokens->count;
+    return *count;
+}
@@ -0,0 +1,38 @@
+// source_parser.h
+// Fused tokenize-and-parse of FlowCalc source text: tokens are scanned on demand
+// by the parse loop, classified in place and kept as slices of the source
+
+#ifndef SOURCE_PARSER_H
+#define SOURCE_PARSER_H
+
+#include <stddef.h>
+#include "compiled_grammar.h"
+#include "lazy_tree.h"
+#include "num_literal.h"
+#include "pif_map.h"
+#include "st.h"
+
+// Tokenize and parse text[0..len) in one pass (same tokens as
+// generate_pif_from_string, without its strdup'd token array: no allocation
+// per token).
+// Identifiers, numbers, ranges and strings are entered in st, ranges after
+// every other token; a local table with the generator's capacity is used if st
+// is NULL. If nums is not NULL,
+// NUMBER and RANGE values are parsed into it once per st index (a range from
+// its two bounds). tokens receives one slice per token read, borrowing text,
+// with terminal set to the grammar column; on a
+// syntax error it stops at the offending token. The caller sets
+// lt->pif_entries (see source_tokens_to_entries) before materializing, and
+// frees with lazy_tree_free / pif_map_close.
+ParseResult parse_source(const char *text, size_t len, const CompiledGrammar *cg,
+                         SymbolTable *st, NumTable *nums, const char *stmt_symbol,
+                         LazyTree *lt, PIFMap *tokens);
+
+// Tokenize only; terminal is left at -1. Returns the token count or -1 on error.
+int source_tokenize(const char *text, size_t len, SymbolTable *st, NumTable *nums, PIFMap *tokens);
+
+// Expand token slices into PIFEntry records with the generator's lexemes
+// (newlines become "NL", ranges lose inner blanks)
+int source_tokens_to_entries(const PIFMap *tokens, PIFEntry **entries, int *count);
+
+#endif // SOURCE_PARSER_H
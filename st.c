@@ -1,136 +1,576 @@
+// st.c
+// Symbol table: SwissTable-style open addressing with stable (bucket,pos) locations,
+// and read-only memory-mapped snapshots
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "st.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
-static uint64_t st_hash(const char *s) {
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || (defined(_MSC_VER) && defined(_M_X64))
+#define ST_SSE2 1
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Control byte of a free slot; used slots hold the top 7 bits of the hash
+#define ST_EMPTY 0x80
+
+// Smallest arena block; later blocks double, so n lexemes take O(log n) blocks
+#define ST_ARENA_MIN 4096
+
+// Snapshot layout, all integers little-endian, all offsets from the file start:
+//   header (ST_SNAP_HEADER bytes)
+//     0 "FCST"  4 version  8 capacity  12 count  16 nslots  20 reserved
+//     24 buckets_off  32 entries_off  40 ctrl_off  48 slots_off  56 strings_off
+//     64 file_size                                        (u32 then u64 fields)
+//   buckets: capacity x u32, the lexemes of each bucket
+//   entries: count x ST_SNAP_ENTRY bytes, by index:
+//     0 hash (u64)  8 string offset (u32)  12 length  16 bucket  20 pos
+//   ctrl:    nslots + ST_GROUP - 1 control bytes, as in the in-memory table
+//   slots:   nslots x u32 entry indices
+//   strings: the lexemes, each followed by a NUL
+#define ST_SNAP_MAGIC "FCST"
+#define ST_SNAP_VERSION 1
+#define ST_SNAP_HEADER 72
+#define ST_SNAP_ENTRY 24
+
+struct STSnapshot {
+    const unsigned char *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file_handle;
+    HANDLE mapping_handle;
+#endif
+    int capacity;
+    int count;
+    int nslots;
+    const unsigned char *entries;
+    const uint8_t *ctrl;
+    const unsigned char *slots;
+    const char *strings;
+    uint64_t strings_size;
+};
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+// FNV-1a of s; *length gets strlen(s) from the same pass
+static uint64_t st_hash(const char *s, uint32_t *length) {
     uint64_t h = 1469598103934665603ULL;
-    while (*s) {
-        h ^= (uint8_t)(*s++);
+    const char *p = s;
+    while (*p) {
+        h ^= (uint8_t)(*p++);
         h *= 1099511628211ULL;
     }
+    *length = (uint32_t)(p - s);
     return h;
 }
 
-static char *dupstr(const char *s) {
-    size_t n = strlen(s);
-    char *p = (char*)malloc(n+1);
-    memcpy(p, s, n+1);
+// Copy of s[0..n] (with its NUL) in the arena, NULL if out of memory
+static const char *arena_copy(SymbolTable *st, const char *s, size_t n) {
+    STArenaBlock *b = st->arena;
+    if (!b || b->size - b->used < n + 1) {
+        size_t size = b ? b->size * 2 : ST_ARENA_MIN;
+        while (size < n + 1) size *= 2;
+        b = (STArenaBlock*)malloc(sizeof(STArenaBlock) + size);
+        if (!b) return NULL;
+        b->next = st->arena;
+        b->used = 0;
+        b->size = size;
+        st->arena = b;
+    }
+    char *p = b->data + b->used;
+    memcpy(p, s, n + 1);
+    b->used += n + 1;
     return p;
 }
 
-void st_init(SymbolTable *st, int capacity) {
-    st->capacity = capacity;
-    st->size = 0;
-    st->buckets = (STNode**)calloc(capacity, sizeof(STNode*));
-    st->index_map_capacity = capacity > 0 ? capacity : 16;
-    st->index_map = (STNode**)calloc(st->index_map_capacity, sizeof(STNode*));
+static inline uint8_t hash_tag(uint64_t h) {
+    return (uint8_t)(h >> 57);
 }
 
-void st_free(SymbolTable *st) {
-    for (int i=0;i<st->capacity;i++) {
-        STNode *cur = st->buckets[i];
-        while (cur) { STNode *nx = cur->next; free(cur->lexeme); free(cur); cur = nx; }
+static inline unsigned first_bit(unsigned m) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return (unsigned)i;
+#else
+    return (unsigned)__builtin_ctz(m);
+#endif
+}
+
+// Bit i set where ctrl[i] == tag; *empty gets the bits of free slots
+static inline unsigned group_match(const uint8_t *ctrl, uint8_t tag, unsigned *empty) {
+#ifdef ST_SSE2
+    __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+    *empty = (unsigned)_mm_movemask_epi8(g);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)tag)));
+#else
+    unsigned m = 0, e = 0;
+    for (int i = 0; i < ST_GROUP; i++) {
+        m |= (unsigned)(ctrl[i] == tag) << i;
+        e |= (unsigned)(ctrl[i] == ST_EMPTY) << i;
     }
-    free(st->buckets);
-    st->buckets = NULL;
-    free(st->index_map);
-    st->index_map = NULL;
+    *empty = e;
+    return m;
+#endif
 }
 
-static inline int bucket_index(SymbolTable *st, const char *lexeme) {
-    uint64_t h1 = st_hash(lexeme);
-    int h = (int)(h1 % (uint64_t)st->capacity);
-    return h;
+// Slots are never freed, so a probe ends at the first group with an empty slot.
+// Steps of 1, 2, 3... groups visit every group of a power-of-two table.
+// Candidates are checked on the cached hash and length before the bytes.
+// Returns the slot holding lexeme, or -1 with *free_slot set to where it would go.
+static int find_slot(const SymbolTable *st, const char *lexeme, uint32_t length, uint64_t h,
+                     int *free_slot) {
+    uint8_t tag = hash_tag(h);
+    int mask = st->nslots - 1;
+    int pos = (int)(h & (uint64_t)mask);
+    for (int step = ST_GROUP;; step += ST_GROUP) {
+        unsigned empty;
+        unsigned m = group_match(st->ctrl + pos, tag, &empty);
+        while (m) {
+            int slot = (pos + (int)first_bit(m)) & mask;
+            const STEntry *e = &st->entries[st->slots[slot]];
+            if (e->hash == h && e->length == length && memcmp(e->lexeme, lexeme, length) == 0) return slot;
+            m &= m - 1;
+        }
+        if (empty) {
+            if (free_slot) *free_slot = (pos + (int)first_bit(empty)) & mask;
+            return -1;
+        }
+        pos = (pos + step) & mask;
+    }
 }
 
-int st_get(SymbolTable *st, const char *lexeme) {
-    int b = bucket_index(st, lexeme);
-    STNode *cur = st->buckets[b];
-    while (cur) {
-        if (strcmp(cur->lexeme, lexeme)==0) return cur->index;
-        cur = cur->next;
+// The same probe over a mapped snapshot; returns the index of lexeme or -1.
+// Indices and string offsets come from the file, so they are bounds-checked.
+static int snapshot_find(const STSnapshot *snap, const char *lexeme, uint32_t length, uint64_t h) {
+    uint8_t tag = hash_tag(h);
+    int mask = snap->nslots - 1;
+    int pos = (int)(h & (uint64_t)mask);
+    for (int step = ST_GROUP; step <= snap->nslots; step += ST_GROUP) {
+        unsigned empty;
+        unsigned m = group_match(snap->ctrl + pos, tag, &empty);
+        while (m) {
+            uint32_t idx = get_u32(snap->slots + 4 * (size_t)((pos + (int)first_bit(m)) & mask));
+            const unsigned char *e = snap->entries + (size_t)ST_SNAP_ENTRY * idx;
+            if (idx < (uint32_t)snap->count && get_u64(e) == h && get_u32(e + 12) == length &&
+                (uint64_t)get_u32(e + 8) + length < snap->strings_size &&
+                memcmp(snap->strings + get_u32(e + 8), lexeme, length) == 0) {
+                return (int)idx;
+            }
+            m &= m - 1;
+        }
+        if (empty) return -1;
+        pos = (pos + step) & mask;
     }
     return -1;
 }
 
+// Lexeme, hash, length and location of index (snapshot or overlay)
+static void entry_at(const SymbolTable *st, int index, STEntry *out) {
+    if (index >= st->base_count) {
+        *out = st->entries[index - st->base_count];
+        return;
+    }
+    const unsigned char *e = st->base->entries + (size_t)ST_SNAP_ENTRY * (size_t)index;
+    uint32_t off = get_u32(e + 8);
+    out->hash = get_u64(e);
+    out->length = get_u32(e + 12);
+    out->lexeme = (uint64_t)off + out->length < st->base->strings_size ? st->base->strings + off : "";
+    out->bucket = (int)get_u32(e + 16);
+    out->pos = (int)get_u32(e + 20);
+}
+
+static void set_ctrl(uint8_t *ctrl, int nslots, int slot, uint8_t c) {
+    ctrl[slot] = c;
+    if (slot < ST_GROUP - 1) ctrl[nslots + slot] = c;
+}
+
+static int alloc_slots(SymbolTable *st, int nslots) {
+    uint8_t *ctrl = (uint8_t*)malloc((size_t)nslots + ST_GROUP - 1);
+    int32_t *slots = (int32_t*)malloc(sizeof(int32_t) * (size_t)nslots);
+    if (!ctrl || !slots) {
+        free(ctrl);
+        free(slots);
+        return -1;
+    }
+    memset(ctrl, ST_EMPTY, (size_t)nslots + ST_GROUP - 1);
+    free(st->ctrl);
+    free(st->slots);
+    st->ctrl = ctrl;
+    st->slots = slots;
+    st->nslots = nslots;
+    return 0;
+}
+
+// Doubles the slot array and reinserts every entry; indices and locations stay
+static int grow_slots(SymbolTable *st) {
+    if (st->nslots > INT32_MAX / 2) return -1;
+    if (alloc_slots(st, st->nslots * 2) != 0) return -1;
+    for (int i = 0; i < st->size - st->base_count; i++) {
+        const STEntry *e = &st->entries[i];
+        int slot;
+        find_slot(st, e->lexeme, e->length, e->hash, &slot);
+        set_ctrl(st->ctrl, st->nslots, slot, hash_tag(e->hash));
+        st->slots[slot] = i;
+    }
+    return 0;
+}
+
+// Slots for n entries at 7/8 load
+static int slots_for(int n) {
+    int nslots = ST_GROUP;
+    while (nslots / 8 * 7 < n && nslots <= INT32_MAX / 2) nslots *= 2;
+    return nslots;
+}
+
+void st_init(SymbolTable *st, int capacity) {
+    memset(st, 0, sizeof(*st));
+    st->capacity = capacity > 0 ? capacity : 1;
+    st->bucket_sizes = (int*)calloc((size_t)st->capacity, sizeof(int));
+    st->entries_capacity = capacity > 16 ? capacity : 16;
+    st->entries = (STEntry*)malloc(sizeof(STEntry) * (size_t)st->entries_capacity);
+    if (!st->entries) st->entries_capacity = 0;
+    alloc_slots(st, slots_for(capacity));
+}
+
+static void snapshot_close(STSnapshot *snap) {
+#ifdef _WIN32
+    UnmapViewOfFile(snap->data);
+    CloseHandle(snap->mapping_handle);
+    CloseHandle(snap->file_handle);
+#else
+    munmap((void *)snap->data, snap->size);
+#endif
+    free(snap);
+}
+
+void st_free(SymbolTable *st) {
+    while (st->arena) {
+        STArenaBlock *next = st->arena->next;
+        free(st->arena);
+        st->arena = next;
+    }
+    free(st->entries);
+    free(st->bucket_sizes);
+    free(st->ctrl);
+    free(st->slots);
+    if (st->base) snapshot_close(st->base);
+    memset(st, 0, sizeof(*st));
+}
+
+int st_get(SymbolTable *st, const char *lexeme) {
+    if (!st->ctrl) return -1;
+    uint32_t length;
+    uint64_t h = st_hash(lexeme, &length);
+    if (st->base) {
+        int idx = snapshot_find(st->base, lexeme, length, h);
+        if (idx >= 0) return idx;
+    }
+    int slot = find_slot(st, lexeme, length, h, NULL);
+    return slot < 0 ? -1 : st->base_count + st->slots[slot];
+}
+
 int st_put(SymbolTable *st, const char *lexeme) {
-    int idx = st_get(st, lexeme);
-    if (idx != -1) return idx;
-    int h = bucket_index(st, lexeme);
-
-    STNode *node = (STNode*)malloc(sizeof(STNode));
-    node->lexeme = dupstr(lexeme);
-    node->index = st->size;
-    node->bucket = h;
-    node->next = NULL;
-
-    STNode *cur = st->buckets[h];
-    int pos = 0;
-    if (!cur) {
-        st->buckets[h] = node;
-        pos = 0;
-    } else {
-        pos = 0;
-        while (cur->next) { cur = cur->next; pos++; }
-        
-        cur->next = node;
-        pos++;
-    }
-    node->pos = pos;
-
-    if (st->size >= st->index_map_capacity) {
-        int newcap = st->index_map_capacity * 2;
-        if (newcap <= st->size) newcap = st->size + 16;
-        STNode **m = (STNode**)realloc(st->index_map, sizeof(STNode*) * newcap);
-        if (m) {
-            for (int i = st->index_map_capacity; i < newcap; ++i) m[i] = NULL;
-            st->index_map = m;
-            st->index_map_capacity = newcap;
-        }
+    if (!st->ctrl || !st->bucket_sizes) return -1;
+    uint32_t length;
+    uint64_t h = st_hash(lexeme, &length);
+    if (st->base) {
+        int idx = snapshot_find(st->base, lexeme, length, h);
+        if (idx >= 0) return idx;
     }
+    int slot;
+    int found = find_slot(st, lexeme, length, h, &slot);
+    if (found >= 0) return st->base_count + st->slots[found];
 
-    if (st->index_map && st->size < st->index_map_capacity) st->index_map[st->size] = node;
+    int local = st->size - st->base_count;
+    if (local + 1 > st->nslots / 8 * 7) {
+        if (grow_slots(st) != 0) return -1;
+        find_slot(st, lexeme, length, h, &slot);
+    }
+    if (local >= st->entries_capacity) {
+        int newcap = st->entries_capacity ? st->entries_capacity * 2 : 16;
+        STEntry *e = (STEntry*)realloc(st->entries, sizeof(STEntry) * (size_t)newcap);
+        if (!e) return -1;
+        st->entries = e;
+        st->entries_capacity = newcap;
+    }
+    const char *copy = arena_copy(st, lexeme, length);
+    if (!copy) return -1;
 
-    st->size++;
-    return node->index;
+    STEntry *e = &st->entries[local];
+    e->lexeme = copy;
+    e->hash = h;
+    e->length = length;
+    e->bucket = (int)(h % (uint64_t)st->capacity);
+    e->pos = st->bucket_sizes[e->bucket]++;
+    set_ctrl(st->ctrl, st->nslots, slot, hash_tag(h));
+    st->slots[slot] = local;
+    return st->size++;
 }
 
 int st_get_location_by_index(SymbolTable *st, int index, int *bucket, int *pos) {
     if (index < 0 || index >= st->size) return -1;
-    if (!st->index_map) {
-        
-        for (int b = 0; b < st->capacity; ++b) {
-            STNode *cur = st->buckets[b];
-            int p = 0;
-            while (cur) {
-                if (cur->index == index) {
-                    if (bucket) *bucket = b;
-                    if (pos) *pos = p;
-                    return 0;
-                }
-                cur = cur->next; p++;
+    STEntry e;
+    entry_at(st, index, &e);
+    if (bucket) *bucket = e.bucket;
+    if (pos) *pos = e.pos;
+    return 0;
+}
+
+void st_dump(SymbolTable *st) {
+    printf("~~~~ Symbol Table (hash) size=%d cap=%d ~~~~\n", st->size, st->capacity);
+    // Indices sorted by (bucket,pos): a counting sort on the bucket sizes
+    int *first = (int*)malloc(sizeof(int) * ((size_t)st->capacity + 1));
+    int *order = (int*)calloc((size_t)st->size + 1, sizeof(int));
+    if (first && order && st->bucket_sizes) {
+        first[0] = 0;
+        for (int b = 0; b < st->capacity; b++) first[b + 1] = first[b] + st->bucket_sizes[b];
+        for (int i = 0; i < st->size; i++) {
+            STEntry e;
+            entry_at(st, i, &e);
+            if (e.bucket >= 0 && e.bucket < st->capacity && e.pos >= 0 && e.pos < st->bucket_sizes[e.bucket]) {
+                order[first[e.bucket] + e.pos] = i;
             }
         }
+        for (int b = 0; b < st->capacity; b++) {
+            if (first[b] == first[b + 1]) continue;
+            printf("[%d] -> ", b);
+            for (int k = first[b]; k < first[b + 1]; k++) {
+                STEntry e;
+                entry_at(st, order[k], &e);
+                printf("(\"%s\", idx=%d, bucket=%d, pos=%d) ", e.lexeme, order[k], e.bucket, e.pos);
+            }
+            printf("\n");
+        }
+    }
+    free(first);
+    free(order);
+    printf("~~~~~~~~ End ST ~~~~~~~~\n\n");
+}
+
+int st_save(SymbolTable *st, const char *path) {
+    if (!st->bucket_sizes) return -1;
+    int count = st->size;
+    int nslots = slots_for(count);
+    uint64_t strings_size = 0;
+    for (int i = 0; i < count; i++) {
+        STEntry e;
+        entry_at(st, i, &e);
+        strings_size += (uint64_t)e.length + 1;
+    }
+    uint64_t buckets_off = ST_SNAP_HEADER;
+    uint64_t entries_off = buckets_off + 4 * (uint64_t)st->capacity;
+    uint64_t ctrl_off = entries_off + (uint64_t)ST_SNAP_ENTRY * (uint64_t)count;
+    uint64_t slots_off = ctrl_off + (uint64_t)nslots + ST_GROUP - 1;
+    uint64_t strings_off = slots_off + 4 * (uint64_t)nslots;
+    uint64_t file_size = strings_off + strings_size;
+    if (strings_size > UINT32_MAX || file_size > SIZE_MAX) return -1;
+
+    unsigned char *img = (unsigned char*)calloc(1, (size_t)file_size);
+    if (!img) return -1;
+    memcpy(img, ST_SNAP_MAGIC, 4);
+    put_u32(img + 4, ST_SNAP_VERSION);
+    put_u32(img + 8, (uint32_t)st->capacity);
+    put_u32(img + 12, (uint32_t)count);
+    put_u32(img + 16, (uint32_t)nslots);
+    put_u64(img + 24, buckets_off);
+    put_u64(img + 32, entries_off);
+    put_u64(img + 40, ctrl_off);
+    put_u64(img + 48, slots_off);
+    put_u64(img + 56, strings_off);
+    put_u64(img + 64, file_size);
+    for (int b = 0; b < st->capacity; b++) put_u32(img + buckets_off + 4 * (uint64_t)b, (uint32_t)st->bucket_sizes[b]);
+
+    uint8_t *ctrl = img + ctrl_off;
+    memset(ctrl, ST_EMPTY, (size_t)nslots + ST_GROUP - 1);
+    uint64_t str = 0;
+    for (int i = 0; i < count; i++) {
+        STEntry e;
+        entry_at(st, i, &e);
+        unsigned char *rec = img + entries_off + (uint64_t)ST_SNAP_ENTRY * (uint64_t)i;
+        put_u64(rec, e.hash);
+        put_u32(rec + 8, (uint32_t)str);
+        put_u32(rec + 12, e.length);
+        put_u32(rec + 16, (uint32_t)e.bucket);
+        put_u32(rec + 20, (uint32_t)e.pos);
+        memcpy(img + strings_off + str, e.lexeme, e.length);
+        str += (uint64_t)e.length + 1;
+
+        // Lexemes are distinct, so the first group with a free slot takes it
+        int mask = nslots - 1;
+        int pos = (int)(e.hash & (uint64_t)mask);
+        for (int step = ST_GROUP;; step += ST_GROUP) {
+            unsigned empty;
+            group_match(ctrl + pos, 0, &empty);
+            if (empty) {
+                int slot = (pos + (int)first_bit(empty)) & mask;
+                set_ctrl(ctrl, nslots, slot, hash_tag(e.hash));
+                put_u32(img + slots_off + 4 * (uint64_t)slot, (uint32_t)i);
+                break;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    // Written beside the target and renamed over it, so a mapped copy stays intact
+    size_t len = strlen(path);
+    char *tmp = (char*)malloc(len + 5);
+    if (!tmp) {
+        free(img);
+        return -1;
+    }
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".tmp", 5);
+    FILE *f = fopen(tmp, "wb");
+    int bad = !f || fwrite(img, 1, (size_t)file_size, f) != (size_t)file_size;
+    if (f && fclose(f) != 0) bad = 1;
+    free(img);
+#ifdef _WIN32
+    if (!bad) remove(path);
+#endif
+    if (!bad && rename(tmp, path) != 0) bad = 1;
+    if (bad) remove(tmp);
+    free(tmp);
+    return bad ? -1 : 0;
+}
+
+// Checks the header and section bounds of a mapped snapshot (not every entry)
+static int snapshot_parse(STSnapshot *snap) {
+    const unsigned char *d = snap->data;
+    if (snap->size < ST_SNAP_HEADER || memcmp(d, ST_SNAP_MAGIC, 4) != 0 ||
+        get_u32(d + 4) != ST_SNAP_VERSION || get_u64(d + 64) != snap->size) {
         return -1;
     }
-    STNode *n = st->index_map[index];
-    if (!n) return -1;
-    if (bucket) *bucket = n->bucket;
-    if (pos) *pos = n->pos;
+    uint32_t capacity = get_u32(d + 8), count = get_u32(d + 12), nslots = get_u32(d + 16);
+    uint64_t buckets_off = get_u64(d + 24), entries_off = get_u64(d + 32), ctrl_off = get_u64(d + 40);
+    uint64_t slots_off = get_u64(d + 48), strings_off = get_u64(d + 56);
+    if (capacity == 0 || capacity > INT32_MAX || nslots < ST_GROUP || nslots > INT32_MAX ||
+        (nslots & (nslots - 1)) != 0 || count >= nslots ||
+        buckets_off != ST_SNAP_HEADER ||
+        entries_off != buckets_off + 4 * (uint64_t)capacity ||
+        ctrl_off != entries_off + (uint64_t)ST_SNAP_ENTRY * count ||
+        slots_off != ctrl_off + nslots + ST_GROUP - 1 ||
+        strings_off != slots_off + 4 * (uint64_t)nslots ||
+        strings_off > snap->size || (strings_off < snap->size && d[snap->size - 1] != '\0')) {
+        return -1;
+    }
+    uint64_t total = 0;
+    for (uint32_t b = 0; b < capacity; b++) total += get_u32(d + buckets_off + 4 * (uint64_t)b);
+    if (total != count) return -1;
+    snap->capacity = (int)capacity;
+    snap->count = (int)count;
+    snap->nslots = (int)nslots;
+    snap->entries = d + entries_off;
+    snap->ctrl = d + ctrl_off;
+    snap->slots = d + slots_off;
+    snap->strings = (const char *)d + strings_off;
+    snap->strings_size = snap->size - strings_off;
     return 0;
 }
 
-void st_dump(SymbolTable *st) {
-    printf("~~~~ Symbol Table (hash) size=%d cap=%d ~~~~\n", st->size, st->capacity);
-    for (int i=0;i<st->capacity;i++) {
-        STNode *cur = st->buckets[i];
-        if (!cur) continue;
-        printf("[%d] -> ", i);
-        
-        while (cur) { printf("(\"%s\", idx=%d, bucket=%d, pos=%d) ", cur->lexeme, cur->index, cur->bucket, cur->pos); cur = cur->next; }
-        printf("\n");
+static STSnapshot *snapshot_open(const char *path) {
+    STSnapshot *snap = (STSnapshot*)calloc(1, sizeof(STSnapshot));
+    if (!snap) return NULL;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE) {
+        free(snap);
+        return NULL;
     }
-    printf("~~~~~~~~ End ST ~~~~~~~~\n\n");
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < ST_SNAP_HEADER || (unsigned long long)size.QuadPart > SIZE_MAX) {
+        CloseHandle(file);
+        free(snap);
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const unsigned char *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        free(snap);
+        return NULL;
+    }
+    snap->file_handle = file;
+    snap->mapping_handle = mapping;
+    snap->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        free(snap);
+        return NULL;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < ST_SNAP_HEADER || (unsigned long long)sb.st_size > SIZE_MAX) {
+        close(fd);
+        free(snap);
+        return NULL;
+    }
+    const unsigned char *data = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        free(snap);
+        return NULL;
+    }
+    snap->size = (size_t)sb.st_size;
+#endif
+    snap->data = data;
+    if (snapshot_parse(snap) != 0) {
+        snapshot_close(snap);
+        return NULL;
+    }
+    return snap;
+}
+
+int st_load(SymbolTable *st, const char *path) {
+    STSnapshot *snap = snapshot_open(path);
+    if (!snap) return -1;
+    memset(st, 0, sizeof(*st));
+    st->base = snap;
+    st->base_count = snap->count;
+    st->size = snap->count;
+    st->capacity = snap->capacity;
+    st->bucket_sizes = (int*)malloc(sizeof(int) * (size_t)st->capacity);
+    st->entries_capacity = 16;
+    st->entries = (STEntry*)malloc(sizeof(STEntry) * (size_t)st->entries_capacity);
+    if (!st->bucket_sizes || !st->entries || alloc_slots(st, ST_GROUP) != 0) {
+        st_free(st);
+        return -1;
+    }
+    const unsigned char *buckets = snap->data + ST_SNAP_HEADER;
+    for (int b = 0; b < st->capacity; b++) st->bucket_sizes[b] = (int)get_u32(buckets + 4 * (size_t)b);
+    return st->base_count;
 }
@@ -2,28 +2,62 @@
 #define ST_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-typedef struct STNode {
-    char *lexeme;
-    int index;
-    
-    int bucket;
-    int pos;
-    struct STNode *next;
-} STNode;
+// Slots probed per step; the control bytes are read 16 at a time
+#define ST_GROUP 16
 
 typedef struct {
-    STNode **buckets;
-    int capacity;
-    int size;
-    
-    STNode **index_map;
-    int index_map_capacity;
+    const char *lexeme;     // in the table's string arena
+    uint64_t hash;          // FNV-1a of lexeme
+    uint32_t length;
+    int bucket;             // location reported to the PIF: hash % capacity
+    int pos;                // insertion order among the lexemes of that bucket
+} STEntry;
+
+// Snapshot file written by st_save and mapped read-only by st_load (st.c)
+typedef struct STSnapshot STSnapshot;
+
+// Lexemes are copied into blocks that are never moved or freed one by one
+typedef struct STArenaBlock {
+    struct STArenaBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} STArenaBlock;
+
+// Open-addressing hash table in the SwissTable layout: one control byte per slot
+// holds 7 bits of the hash (or ST_EMPTY), a probe compares a whole group of
+// control bytes at once, and the slots hold indices into the dense entry array.
+// The slot array doubles at 7/8 load. The (bucket,pos) locations are assigned
+// once, from the fixed capacity given to st_init, so they never depend on the
+// current number of slots. After st_load the table is an overlay on a mapped
+// snapshot: indices below base_count are looked up there, and only lexemes the
+// snapshot lacks are added to entries.
+typedef struct {
+    STEntry *entries;       // index base_count + i is entries[i]
+    int size;               // snapshot and overlay entries
+    int entries_capacity;
+
+    STSnapshot *base;       // NULL unless loaded with st_load
+    int base_count;
+
+    int capacity;           // buckets of the (bucket,pos) locations
+    int *bucket_sizes;      // lexemes per bucket, the next pos of each
+
+    uint8_t *ctrl;          // nslots + ST_GROUP - 1 control bytes, the tail mirrors the head
+    int32_t *slots;         // index into entries per slot
+    int nslots;             // power of two, at least ST_GROUP
+
+    STArenaBlock *arena;    // newest block first
 } SymbolTable;
 
 void st_init(SymbolTable *st, int capacity);
+// Frees the arrays and the arena blocks, not each lexeme
 void st_free(SymbolTable *st);
 
+// Index of lexeme, added with the next index if new; -1 on allocation failure
 int st_put(SymbolTable *st, const char *lexeme);
 
 int st_get(SymbolTable *st, const char *lexeme);
@@ -32,4 +66,16 @@ int st_get_location_by_index(SymbolTable *st, int index, int *bucket, int *pos);
 
 void st_dump(SymbolTable *st);
 
+// Writes all entries, with their indices and (bucket,pos) locations, as a
+// snapshot that st_load can map. The file is written beside path and renamed
+// over it, so on POSIX systems a table may be saved over its own snapshot.
+// Returns 0 on success.
+int st_save(SymbolTable *st, const char *path);
+
+// Maps a snapshot read-only as the base of an empty overlay and returns its
+// entry count, or -1 (st left uninitialized) if the file is missing or not a
+// snapshot. Lookups, st_put, locations and st_dump then behave as in the table
+// that was saved; st_free unmaps the file.
+int st_load(SymbolTable *st, const char *path);
+
 #endif
@@ -0,0 +1,167 @@
+// st_bench.c
+// Checks the concurrent symbol table against st.h and times read-mostly
+// put/get streams on 1..N threads
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "st.h"
+#include "st_concurrent.h"
+
+#define BENCH_CAPACITY 199
+
+static double now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+typedef struct {
+    ConcurrentST *cst;
+    char **stream;
+    int begin, end;
+    int put;                // cst_put instead of cst_get
+    int *out;               // index per stream position, or NULL
+    long sink;
+} Worker;
+
+static void *run_worker(void *arg) {
+    Worker *w = arg;
+    long sink = 0;
+    for (int i = w->begin; i < w->end; i++) {
+        int idx = w->put ? cst_put(w->cst, w->stream[i]) : cst_get(w->cst, w->stream[i]);
+        if (w->out) w->out[i] = idx;
+        sink += idx;
+    }
+    w->sink = sink;
+    return NULL;
+}
+
+// Runs the stream split into nthreads contiguous parts; returns elapsed ms
+static double run_threads(ConcurrentST *cst, char **stream, int n, int nthreads, int put, int *out) {
+    pthread_t threads[64];
+    Worker workers[64];
+    double t0 = now_ms();
+    for (int t = 0; t < nthreads; t++) {
+        workers[t] = (Worker){ cst, stream, (int)((long)n * t / nthreads), (int)((long)n * (t + 1) / nthreads),
+                               put, out, 0 };
+        if (t > 0) pthread_create(&threads[t], NULL, run_worker, &workers[t]);
+    }
+    run_worker(&workers[0]);
+    for (int t = 1; t < nthreads; t++) pthread_join(threads[t], NULL);
+    return now_ms() - t0;
+}
+
+int main(int argc, char *argv[]) {
+    int nwords = argc > 1 ? atoi(argv[1]) : 100000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+    int repeats = argc > 3 ? atoi(argv[3]) : 16;
+    if (nwords <= 0 || max_threads <= 0 || max_threads > 64 || repeats <= 0) {
+        fprintf(stderr, "Usage: %s [distinct_words] [max_threads<=64] [uses_per_word]\n", argv[0]);
+        return 1;
+    }
+
+    // Identifiers of a large program: each used repeats times, in random order
+    int n = nwords * repeats;
+    char **words = malloc(sizeof(char *) * (size_t)nwords);
+    char **stream = malloc(sizeof(char *) * (size_t)n);
+    int *ref = malloc(sizeof(int) * (size_t)n);
+    int *got = malloc(sizeof(int) * (size_t)n);
+    if (!words || !stream || !ref || !got) return 1;
+    static const char *stems[] = { "total", "count", "x", "rate", "item", "sum", "tmp", "value" };
+    for (int i = 0; i < nwords; i++) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%s_%d", stems[i % 8], i);
+        words[i] = malloc(strlen(buf) + 1);
+        strcpy(words[i], buf);
+    }
+    srand(12345);
+    for (int i = 0; i < n; i++) stream[i] = words[i % nwords];
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)(((unsigned long)rand() * ((unsigned long)RAND_MAX + 1) + (unsigned long)rand()) % (unsigned long)(i + 1));
+        char *tmp = stream[i];
+        stream[i] = stream[j];
+        stream[j] = tmp;
+    }
+
+    int failures = 0;
+
+    // One thread: the same indices and (bucket,pos) locations as st_put
+    SymbolTable st;
+    st_init(&st, BENCH_CAPACITY);
+    double t0 = now_ms();
+    for (int i = 0; i < n; i++) ref[i] = st_put(&st, stream[i]);
+    double st_ms = now_ms() - t0;
+    ConcurrentST cst;
+    if (cst_init(&cst, BENCH_CAPACITY) != 0) return 1;
+    double cst_ms = run_threads(&cst, stream, n, 1, 1, got);
+    for (int i = 0; i < n; i++) {
+        int b1, p1, b2, p2;
+        if (got[i] != ref[i] || st_get_location_by_index(&st, ref[i], &b1, &p1) != 0 ||
+            cst_get_location_by_index(&cst, got[i], &b2, &p2) != 0 || b1 != b2 || p1 != p2) {
+            if (failures++ < 5) fprintf(stderr, "single thread: '%s' st %d, concurrent %d\n", stream[i], ref[i], got[i]);
+        }
+    }
+    cst_free(&cst);
+    printf("%d distinct words, %d uses\n", nwords, n);
+    printf("st_put:                 %8.2f ns/op\n", st_ms * 1e6 / n);
+    printf("cst_put, 1 thread:      %8.2f ns/op\n", cst_ms * 1e6 / n);
+
+    // N threads inserting at once: one index per word, indices 0..nwords-1, and
+    // per bucket the positions 0..k-1 in index order
+    if (cst_init(&cst, BENCH_CAPACITY) != 0) return 1;
+    run_threads(&cst, stream, n, max_threads, 1, got);
+    int *word_index = malloc(sizeof(int) * (size_t)nwords);
+    int *by_index = calloc((size_t)nwords, sizeof(int));
+    int *last_pos = malloc(sizeof(int) * BENCH_CAPACITY);
+    if (!word_index || !by_index || !last_pos) return 1;
+    for (int i = 0; i < nwords; i++) word_index[i] = -1;
+    for (int i = 0; i < BENCH_CAPACITY; i++) last_pos[i] = -1;
+    for (int i = 0; i < n; i++) {
+        int w = st_get(&st, stream[i]);
+        if (got[i] < 0 || got[i] >= nwords || (word_index[w] != -1 && word_index[w] != got[i])) {
+            if (failures++ < 5) fprintf(stderr, "%d threads: '%s' got index %d\n", max_threads, stream[i], got[i]);
+        }
+        if (word_index[w] == -1 && got[i] >= 0 && got[i] < nwords) {
+            word_index[w] = got[i];
+            by_index[got[i]]++;
+        }
+    }
+    for (int k = 0; k < nwords; k++) {
+        int b, p;
+        if (by_index[k] != 1 || cst_get_location_by_index(&cst, k, &b, &p) != 0 || p != last_pos[b] + 1) {
+            if (failures++ < 5) fprintf(stderr, "%d threads: index %d taken %d times\n", max_threads, k, by_index[k]);
+            continue;
+        }
+        last_pos[b] = p;
+    }
+    if (cst_size(&cst) != nwords) failures++;
+    printf("%d threads inserting: %s\n", max_threads, failures ? "MISMATCH" : "one index per word, no gaps");
+
+    // Read-mostly: the vocabulary is known, every thread looks words up
+    double base = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double ms = run_threads(&cst, stream, n, threads, 0, NULL);
+        if (threads == 1) base = ms;
+        printf("cst_get, %2d thread%s:    %8.2f ns/op, speedup %.2fx\n", threads, threads == 1 ? " " : "s",
+               ms * 1e6 / n, base / ms);
+    }
+
+    cst_free(&cst);
+    st_free(&st);
+    for (int i = 0; i < nwords; i++) free(words[i]);
+    free(words);
+    free(stream);
+    free(ref);
+    free(got);
+    free(word_index);
+    free(by_index);
+    free(last_pos);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,334 @@
+// st_concurrent.c
+// Striped concurrent symbol table with lock-free lookups
+
+#include "st_concurrent.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define cst_yield() SwitchToThread()
+#else
+#include <sched.h>
+#define cst_yield() sched_yield()
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define CST_SPINS 64
+
+// Slots of a stripe's first table; tables double at 3/4 load
+#define CST_TABLE_MIN 16
+
+#define CST_ARENA_MIN 4096
+
+// CSTEntry.index of an insert that could not take an index
+#define CST_FAILED (-2)
+
+static uint64_t cst_hash(const char *s, uint32_t *length) {
+    uint64_t h = 1469598103934665603ULL;
+    const char *p = s;
+    while (*p) {
+        h ^= (uint8_t)(*p++);
+        h *= 1099511628211ULL;
+    }
+    *length = (uint32_t)(p - s);
+    return h;
+}
+
+static inline unsigned high_bit(unsigned m) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse(&i, m);
+    return (unsigned)i;
+#else
+    return 31u - (unsigned)__builtin_clz(m);
+#endif
+}
+
+static void stripe_lock(CSTStripe *s) {
+    int spins = 0;
+    while (atomic_flag_test_and_set_explicit(&s->lock, memory_order_acquire)) {
+        if (++spins > CST_SPINS) cst_yield();
+    }
+}
+
+static void stripe_unlock(CSTStripe *s) {
+    atomic_flag_clear_explicit(&s->lock, memory_order_release);
+}
+
+// n bytes from the stripe's arena, aligned for a CSTEntry; under the lock
+static void *arena_alloc(CSTStripe *s, size_t n) {
+    const size_t align = _Alignof(CSTEntry);
+    n = (n + align - 1) & ~(align - 1);
+    STArenaBlock *b = s->arena;
+    if (!b || b->size - b->used < n) {
+        size_t size = b ? b->size * 2 : CST_ARENA_MIN;
+        while (size < n) size *= 2;
+        b = (STArenaBlock*)malloc(sizeof(STArenaBlock) + size + align);
+        if (!b) return NULL;
+        b->next = s->arena;
+        b->used = (size_t)(-(uintptr_t)b->data & (align - 1));
+        b->size = size + b->used;
+        s->arena = b;
+    }
+    void *p = b->data + b->used;
+    b->used += n;
+    return p;
+}
+
+static CSTTable *table_new(size_t nslots) {
+    CSTTable *t = (CSTTable*)malloc(sizeof(CSTTable) + sizeof(CSTSlot) * nslots);
+    if (!t) return NULL;
+    t->retired = NULL;
+    t->mask = nslots - 1;
+    for (size_t i = 0; i < nslots; i++) atomic_init(&t->slots[i], NULL);
+    return t;
+}
+
+// Stripes are picked by the bucket, so slots use the hash's upper half
+static inline size_t slot_of(uint64_t h, size_t mask) {
+    return (size_t)(h >> 32) & mask;
+}
+
+static const CSTEntry *table_find(const CSTTable *t, const char *lexeme, uint32_t length, uint64_t h) {
+    for (size_t i = slot_of(h, t->mask);; i = (i + 1) & t->mask) {
+        const CSTEntry *e = atomic_load_explicit(&t->slots[i], memory_order_acquire);
+        if (!e) return NULL;
+        if (e->hash == h && e->length == length && memcmp(e->lexeme, lexeme, length) == 0) return e;
+    }
+}
+
+static void table_insert(CSTTable *t, CSTEntry *e) {
+    size_t i = slot_of(e->hash, t->mask);
+    while (atomic_load_explicit(&t->slots[i], memory_order_relaxed)) i = (i + 1) & t->mask;
+    atomic_store_explicit(&t->slots[i], e, memory_order_release);
+}
+
+// Copies the stripe's entries into a table twice the size and publishes it.
+// Readers still probing the old one find every entry it had; it is kept until
+// cst_free, which at most doubles the memory of the tables.
+static int stripe_grow(CSTStripe *s) {
+    CSTTable *old = atomic_load_explicit(&s->table, memory_order_relaxed);
+    CSTTable *t = table_new((old->mask + 1) * 2);
+    if (!t) return -1;
+    for (size_t i = 0; i <= old->mask; i++) {
+        CSTEntry *e = atomic_load_explicit(&old->slots[i], memory_order_relaxed);
+        if (e) table_insert(t, e);
+    }
+    t->retired = old;
+    atomic_store_explicit(&s->table, t, memory_order_release);
+    return 0;
+}
+
+// The directory slot of index, allocating its chunk if needed
+static CSTSlot *dir_slot(ConcurrentST *st, int index, int create) {
+    unsigned k = (unsigned)index + CST_DIR_FIRST;
+    unsigned c = high_bit(k) - high_bit(CST_DIR_FIRST);
+    CSTSlot *chunk = atomic_load_explicit(&st->dir[c], memory_order_acquire);
+    if (!chunk) {
+        if (!create) return NULL;
+        size_t n = (size_t)CST_DIR_FIRST << c;
+        CSTSlot *fresh = (CSTSlot*)malloc(sizeof(CSTSlot) * n);
+        if (!fresh) return NULL;
+        for (size_t i = 0; i < n; i++) atomic_init(&fresh[i], NULL);
+        CSTSlot *expected = NULL;
+        if (atomic_compare_exchange_strong_explicit(&st->dir[c], &expected, fresh,
+                                                    memory_order_acq_rel, memory_order_acquire)) {
+            chunk = fresh;
+        } else {
+            free(fresh);
+            chunk = expected;
+        }
+    }
+    return &chunk[k - ((unsigned)CST_DIR_FIRST << c)];
+}
+
+// An entry found in a table may still be waiting for its index (see cst_put);
+// -1 if its insert failed
+static int entry_index(const CSTEntry *e) {
+    int spins = 0;
+    int idx;
+    while ((idx = atomic_load_explicit(&((CSTEntry *)e)->index, memory_order_acquire)) == -1) {
+        if (++spins > CST_SPINS) cst_yield();
+    }
+    return idx == CST_FAILED ? -1 : idx;
+}
+
+// Buckets below CST_STRIPES have a stripe each, so bucket & mask stays below
+// stripe_count
+static inline CSTStripe *stripe_of(ConcurrentST *st, int bucket) {
+    return &st->stripes[bucket & (CST_STRIPES - 1)];
+}
+
+int cst_init(ConcurrentST *st, int capacity) {
+    memset(st, 0, sizeof(*st));
+    st->capacity = capacity > 0 ? capacity : 1;
+    st->stripe_count = st->capacity < CST_STRIPES ? st->capacity : CST_STRIPES;
+    atomic_init(&st->size, 0);
+    for (int c = 0; c < CST_DIR_CHUNKS; c++) atomic_init(&st->dir[c], NULL);
+    st->bucket_sizes = (int*)calloc((size_t)st->capacity, sizeof(int));
+    int ok = st->bucket_sizes != NULL;
+    for (int i = 0; i < st->stripe_count; i++) {
+        CSTStripe *s = &st->stripes[i];
+        atomic_flag_clear(&s->lock);
+        CSTTable *t = ok ? table_new(CST_TABLE_MIN) : NULL;
+        atomic_init(&s->table, t);
+        ok = ok && t;
+    }
+    if (!ok) {
+        cst_free(st);
+        return -1;
+    }
+    return 0;
+}
+
+void cst_free(ConcurrentST *st) {
+    for (int i = 0; i < st->stripe_count; i++) {
+        CSTStripe *s = &st->stripes[i];
+        CSTTable *t = atomic_load_explicit(&s->table, memory_order_relaxed);
+        while (t) {
+            CSTTable *older = t->retired;
+            free(t);
+            t = older;
+        }
+        atomic_store_explicit(&s->table, NULL, memory_order_relaxed);
+        while (s->arena) {
+            STArenaBlock *next = s->arena->next;
+            free(s->arena);
+            s->arena = next;
+        }
+    }
+    for (int c = 0; c < CST_DIR_CHUNKS; c++) {
+        free((void *)atomic_load_explicit(&st->dir[c], memory_order_relaxed));
+        atomic_store_explicit(&st->dir[c], NULL, memory_order_relaxed);
+    }
+    free(st->bucket_sizes);
+    st->bucket_sizes = NULL;
+}
+
+int cst_get(ConcurrentST *st, const char *lexeme) {
+    uint32_t length;
+    uint64_t h = cst_hash(lexeme, &length);
+    CSTStripe *s = stripe_of(st, (int)(h % (uint64_t)st->capacity));
+    const CSTTable *t = atomic_load_explicit(&s->table, memory_order_acquire);
+    const CSTEntry *e = t ? table_find(t, lexeme, length, h) : NULL;
+    return e ? entry_index(e) : -1;
+}
+
+// A new lexeme is published in its stripe's table with index -1 before the
+// index is taken from st->size. The compare-exchange that takes it is the
+// insert's linearization point: a lookup that misses the entry ran before it,
+// and one that finds the entry waits for the index, which follows it. The
+// directory slot of an index is allocated before the index is taken, so a
+// failed allocation leaves no gap: the entry is marked CST_FAILED instead, reads
+// as absent, and the next cst_put of the lexeme reuses it. Everything under the
+// stripe lock also keeps pos in index order within a bucket.
+int cst_put(ConcurrentST *st, const char *lexeme) {
+    uint32_t length;
+    uint64_t h = cst_hash(lexeme, &length);
+    int bucket = (int)(h % (uint64_t)st->capacity);
+    CSTStripe *s = stripe_of(st, bucket);
+    const CSTTable *t = atomic_load_explicit(&s->table, memory_order_acquire);
+    if (!t) return -1;
+    const CSTEntry *found = table_find(t, lexeme, length, h);
+    int idx = found ? entry_index(found) : -1;
+    if (idx >= 0) return idx;
+
+    stripe_lock(s);
+    t = atomic_load_explicit(&s->table, memory_order_relaxed);
+    CSTEntry *e = (CSTEntry *)table_find(t, lexeme, length, h);
+    idx = e ? entry_index(e) : -1;
+    if (idx >= 0) {
+        stripe_unlock(s);
+        return idx;
+    }
+    if (e) {
+        atomic_store_explicit(&e->index, -1, memory_order_relaxed);
+    } else {
+        if ((size_t)(s->count + 1) * 4 > (t->mask + 1) * 3 && stripe_grow(s) != 0) {
+            stripe_unlock(s);
+            return -1;
+        }
+        e = arena_alloc(s, sizeof(CSTEntry) + length + 1);
+        if (!e) {
+            stripe_unlock(s);
+            return -1;
+        }
+        char *copy = (char *)(e + 1);
+        memcpy(copy, lexeme, length + 1);
+        e->lexeme = copy;
+        e->hash = h;
+        e->length = length;
+        e->bucket = bucket;
+        atomic_init(&e->index, -1);
+        table_insert(atomic_load_explicit(&s->table, memory_order_relaxed), e);
+        s->count++;
+    }
+    e->pos = st->bucket_sizes[bucket]++;
+
+    idx = atomic_load_explicit(&st->size, memory_order_acquire);
+    CSTSlot *slot;
+    do {
+        slot = idx < INT32_MAX ? dir_slot(st, idx, 1) : NULL;
+    } while (slot && !atomic_compare_exchange_weak_explicit(&st->size, &idx, idx + 1,
+                                                            memory_order_acq_rel, memory_order_acquire));
+    if (!slot) {
+        st->bucket_sizes[bucket]--;
+        atomic_store_explicit(&e->index, CST_FAILED, memory_order_release);
+        stripe_unlock(s);
+        return -1;
+    }
+    atomic_store_explicit(slot, e, memory_order_release);
+    atomic_store_explicit(&e->index, idx, memory_order_release);
+    stripe_unlock(s);
+    return idx;
+}
+
+int cst_size(ConcurrentST *st) {
+    return atomic_load_explicit(&st->size, memory_order_acquire);
+}
+
+int cst_get_location_by_index(ConcurrentST *st, int index, int *bucket, int *pos) {
+    if (index < 0 || index >= cst_size(st)) return -1;
+    CSTSlot *slot = dir_slot(st, index, 0);
+    if (!slot) return -1;
+    const CSTEntry *e = atomic_load_explicit(slot, memory_order_acquire);
+    if (!e) return -1;
+    if (bucket) *bucket = e->bucket;
+    if (pos) *pos = e->pos;
+    return 0;
+}
+
+void cst_dump(ConcurrentST *st) {
+    int size = cst_size(st);
+    printf("~~~~ Symbol Table (hash) size=%d cap=%d ~~~~\n", size, st->capacity);
+    // Indices sorted by (bucket,pos): a counting sort on the bucket sizes
+    int *first = (int*)malloc(sizeof(int) * ((size_t)st->capacity + 1));
+    const CSTEntry **order = (const CSTEntry**)calloc((size_t)size + 1, sizeof(CSTEntry *));
+    if (first && order && st->bucket_sizes) {
+        first[0] = 0;
+        for (int b = 0; b < st->capacity; b++) first[b + 1] = first[b] + st->bucket_sizes[b];
+        for (int i = 0; i < size; i++) {
+            CSTSlot *slot = dir_slot(st, i, 0);
+            const CSTEntry *e = slot ? atomic_load_explicit(slot, memory_order_acquire) : NULL;
+            if (e) order[first[e->bucket] + e->pos] = e;
+        }
+        for (int b = 0; b < st->capacity; b++) {
+            if (first[b] == first[b + 1]) continue;
+            printf("[%d] -> ", b);
+            for (int k = first[b]; k < first[b + 1]; k++) {
+                const CSTEntry *e = order[k];
+                if (!e) continue;
+                printf("(\"%s\", idx=%d, bucket=%d, pos=%d) ", e->lexeme,
+                       atomic_load_explicit(&((CSTEntry *)e)->index, memory_order_relaxed), e->bucket, e->pos);
+            }
+            printf("\n");
+        }
+    }
+    free(first);
+    free(order);
+    printf("~~~~~~~~ End ST ~~~~~~~~\n\n");
+}
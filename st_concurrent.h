@@ -0,0 +1,86 @@
+// st_concurrent.h
+// Symbol table that several lexer threads can share: lock-free lookups, inserts
+// serialized per stripe, and the same indices and (bucket,pos) locations as st.h
+
+#ifndef ST_CONCURRENT_H
+#define ST_CONCURRENT_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "st.h"
+
+#define CST_LINE 64
+
+// Most stripes a table uses; a power of two. All lexemes of a bucket share a
+// stripe, since their positions follow index order, so a table has
+// min(capacity, CST_STRIPES) stripes and inserts into it run at most that many
+// at a time: give cst_init a capacity of CST_STRIPES or more when many threads
+// insert.
+#define CST_STRIPES 64
+
+// Index directory: chunk c holds CST_DIR_FIRST << c entries, never moved
+#define CST_DIR_FIRST 64
+#define CST_DIR_CHUNKS 26
+
+typedef struct {
+    const char *lexeme;
+    uint64_t hash;          // FNV-1a of lexeme
+    uint32_t length;
+    int bucket;
+    int pos;
+    atomic_int index;       // -1 while the insert that published this entry runs,
+                            // -2 if it ran out of memory (the lexeme is absent)
+} CSTEntry;
+
+typedef _Atomic(CSTEntry *) CSTSlot;
+
+// Linear-probing table of one stripe; replaced, never modified, when it grows
+typedef struct CSTTable {
+    struct CSTTable *retired;   // older tables, freed with the symbol table
+    size_t mask;
+    CSTSlot slots[];
+} CSTTable;
+
+// Lexemes whose bucket is congruent to the stripe's number modulo CST_STRIPES.
+// The lock is taken only to insert; readers load the table and probe it.
+typedef struct {
+    _Alignas(CST_LINE) atomic_flag lock;
+    _Atomic(CSTTable *) table;
+    int count;                  // entries in table (under lock)
+    STArenaBlock *arena;        // entries and lexemes (under lock)
+} CSTStripe;
+
+typedef struct {
+    CSTStripe stripes[CST_STRIPES];
+    int stripe_count;           // min(capacity, CST_STRIPES); the others are unused
+    int capacity;               // buckets of the (bucket,pos) locations
+    int *bucket_sizes;          // next pos of each bucket, under its stripe's lock
+    _Alignas(CST_LINE) atomic_int size;
+    _Atomic(CSTSlot *) dir[CST_DIR_CHUNKS];    // entry by index
+} ConcurrentST;
+
+// capacity plays the same part as in st_init. Returns 0 on success.
+int cst_init(ConcurrentST *st, int capacity);
+void cst_free(ConcurrentST *st);
+
+// Index of lexeme, adding it if new; -1 on allocation failure. Safe to call from
+// any number of threads at once. Each new lexeme takes its index at one point
+// between call and return, so every thread sees one index per lexeme, indices
+// 0..size-1 with no gaps, and a lexeme added before another started gets the
+// lower index. A single thread gets exactly the indices st_put would return.
+int cst_put(ConcurrentST *st, const char *lexeme);
+
+// Index of lexeme, -1 if absent. Never takes a lock; it only waits when it finds
+// the lexeme published by an insert that has not taken its index yet.
+int cst_get(ConcurrentST *st, const char *lexeme);
+
+int cst_size(ConcurrentST *st);
+
+// Location of an index that cst_put or cst_get has returned; -1 otherwise
+int cst_get_location_by_index(ConcurrentST *st, int index, int *bucket, int *pos);
+
+// Same format as st_dump; call when no thread is inserting
+void cst_dump(ConcurrentST *st);
+
+#endif // ST_CONCURRENT_H
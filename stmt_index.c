@@ -0,0 +1,316 @@
+// stmt_index.c
+// Streaming statement indexer and constant-time statement lookup for text PIFs
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "stmt_index.h"
+#include "lexer_pif_export.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define SCAN_CHUNK (1 << 20)
+
+static int seek64(FILE *f, uint64_t offset, int whence) {
+#ifdef _WIN32
+    return _fseeki64(f, (long long)offset, whence);
+#else
+    return fseeko(f, (off_t)offset, whence);
+#endif
+}
+
+static int64_t tell64(FILE *f) {
+#ifdef _WIN32
+    return _ftelli64(f);
+#else
+    return (int64_t)ftello(f);
+#endif
+}
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME  1099511628211ULL
+
+// What an index records about its PIF: size, modification time and a checksum
+// of sampled blocks (see stmt_index.h)
+typedef struct {
+    uint64_t size;
+    int64_t mtime;
+    uint64_t checksum;
+} PifStamp;
+
+static int pif_stamp(const char *filename, PifStamp *stamp) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(filename, &st) != 0) return -1;
+#else
+    struct stat st;
+    if (stat(filename, &st) != 0) return -1;
+#endif
+    if (st.st_size < 0) return -1;
+    stamp->size = (uint64_t)st.st_size;
+    stamp->mtime = (int64_t)st.st_mtime;
+
+    FILE *f = fopen(filename, "rb");
+    if (!f) return -1;
+    unsigned char block[STMT_INDEX_SAMPLE_SIZE];
+    uint64_t h = FNV_OFFSET;
+    uint64_t span = stamp->size > STMT_INDEX_SAMPLE_SIZE ? stamp->size - STMT_INDEX_SAMPLE_SIZE : 0;
+    int ok = 1;
+    for (int i = 0; ok && i < STMT_INDEX_SAMPLES; i++) {
+        uint64_t offset = span / (STMT_INDEX_SAMPLES - 1) * (uint64_t)i;
+        if (i == STMT_INDEX_SAMPLES - 1) offset = span;
+        size_t want = stamp->size - offset < sizeof(block) ? (size_t)(stamp->size - offset) : sizeof(block);
+        ok = seek64(f, offset, SEEK_SET) == 0 && fread(block, 1, want, f) == want;
+        for (size_t j = 0; ok && j < want; j++) {
+            h ^= block[j];
+            h *= FNV_PRIME;
+        }
+    }
+    fclose(f);
+    stamp->checksum = h;
+    return ok ? 0 : -1;
+}
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+// Same line rules as pif_map's scanner, so token numbers agree with the readers
+static inline int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static int line_contains(const char *p, const char *end, const char *pat, size_t len) {
+    while ((size_t)(end - p) >= len) {
+        const char *hit = memchr(p, pat[0], (size_t)(end - p) - len + 1);
+        if (!hit) return 0;
+        if (memcmp(hit, pat, len) == 0) return 1;
+        p = hit + 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    FILE *out;
+    uint32_t stmt_count;
+    uint64_t token_count;
+    int in_stmt;
+    int depth;
+    int prev;               // LexemeTerminal of the previous entry
+    StmtRange current;
+    int failed;
+} IndexBuilder;
+
+static void close_statement(IndexBuilder *b, uint64_t end_offset) {
+    uint64_t length = end_offset - b->current.offset;
+    uint64_t count = b->token_count - b->current.first_token;
+    if (length > 0xFFFFFFFFu || count > 0xFFFFFFFFu || b->stmt_count == 0xFFFFFFFFu) {
+        b->failed = 1;
+        return;
+    }
+    unsigned char rec[STMT_INDEX_RECORD_SIZE];
+    put_u64(rec, b->current.offset);
+    put_u64(rec + 8, b->current.first_token);
+    put_u32(rec + 16, (uint32_t)length);
+    put_u32(rec + 20, (uint32_t)count);
+    if (fwrite(rec, 1, sizeof(rec), b->out) != sizeof(rec)) b->failed = 1;
+    b->stmt_count++;
+    b->in_stmt = 0;
+}
+
+// One PIF line starting at byte offset line_offset
+static void index_line(IndexBuilder *b, const char *line, const char *eol, uint64_t line_offset) {
+    if (line_contains(line, eol, "~~~~", 4) || line_contains(line, eol, "End PIF", 7)) return;
+    const char *s = line;
+    while (s < eol && is_space(*s)) s++;
+    if (s == eol) return;
+    const char *lex = s;
+    while (s < eol && !is_space(*s)) s++;
+    int t = lexeme_terminal_id(lex, (size_t)(s - lex));
+
+    if (!b->in_stmt && t != LT_NL) {
+        b->in_stmt = 1;
+        b->depth = 0;
+        b->current.offset = line_offset;
+        b->current.first_token = b->token_count;
+    }
+    if (b->in_stmt) {
+        if (t == LT_NL && b->depth == 0) {
+            close_statement(b, line_offset);
+        } else if (t == LT_DO && b->prev != LT_OTHERWISE) {
+            b->depth++;
+        } else if (t == LT_END && b->depth > 0) {
+            b->depth--;
+        }
+    }
+    b->prev = t;
+    b->token_count++;
+}
+
+int stmt_index_build(const char *pif_file, const char *index_file) {
+    FILE *in = fopen(pif_file, "rb");
+    if (!in) return -1;
+    FILE *out = fopen(index_file, "wb");
+    if (!out) {
+        fclose(in);
+        return -1;
+    }
+    unsigned char header[STMT_INDEX_HEADER_SIZE] = { 0 };
+    fwrite(header, 1, sizeof(header), out);
+
+    IndexBuilder b;
+    memset(&b, 0, sizeof(b));
+    b.out = out;
+    b.prev = -1;
+
+    // Lines are scanned in chunks; a partial last line is carried to the front
+    size_t cap = SCAN_CHUNK;
+    char *buf = malloc(cap);
+    size_t have = 0;
+    uint64_t buf_offset = 0;        // file offset of buf[0]
+    uint64_t entries_end = 0;       // end of the last line read
+    int eof = 0;
+    while (!eof && buf && !b.failed) {
+        if (have == cap) {
+            cap *= 2;
+            char *grown = realloc(buf, cap);
+            if (!grown) break;
+            buf = grown;
+        }
+        size_t n = fread(buf + have, 1, cap - have, in);
+        have += n;
+        eof = n == 0;
+
+        const char *p = buf;
+        const char *end = buf + have;
+        while (p < end) {
+            const char *eol = memchr(p, '\n', (size_t)(end - p));
+            if (!eol) {
+                if (!eof) break;
+                eol = end;
+            }
+            index_line(&b, p, eol, buf_offset + (uint64_t)(p - buf));
+            p = eol < end ? eol + 1 : end;
+            entries_end = buf_offset + (uint64_t)(p - buf);
+        }
+        size_t used = (size_t)(p - buf);
+        memmove(buf, p, have - used);
+        have -= used;
+        buf_offset += used;
+    }
+    int ok = buf && eof && !ferror(in) && !b.failed;
+    free(buf);
+    if (ok && b.in_stmt) close_statement(&b, entries_end);
+    int64_t pif_size = tell64(in);
+    fclose(in);
+    PifStamp stamp = { 0, 0, 0 };
+    ok = ok && pif_stamp(pif_file, &stamp) == 0 && pif_size >= 0 && stamp.size == (uint64_t)pif_size;
+
+    memcpy(header, STMT_INDEX_MAGIC, 4);
+    header[4] = STMT_INDEX_VERSION & 0xFF;
+    header[5] = STMT_INDEX_VERSION >> 8;
+    put_u32(header + 8, b.stmt_count);
+    put_u64(header + 16, (uint64_t)pif_size);
+    put_u64(header + 24, b.token_count);
+    put_u64(header + 32, ok ? (uint64_t)stamp.mtime : 0);
+    put_u64(header + 40, ok ? stamp.checksum : 0);
+    ok = ok && !b.failed && seek64(out, 0, SEEK_SET) == 0 &&
+         fwrite(header, 1, sizeof(header), out) == sizeof(header);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        remove(index_file);
+        return -1;
+    }
+    return (int)(b.stmt_count > 0x7FFFFFFFu ? 0x7FFFFFFF : b.stmt_count);
+}
+
+int stmt_index_open(StmtIndex *idx, const char *index_file, const char *pif_file) {
+    memset(idx, 0, sizeof(*idx));
+    FILE *f = fopen(index_file, "rb");
+    if (!f) return -1;
+    unsigned char header[STMT_INDEX_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) ||
+        memcmp(header, STMT_INDEX_MAGIC, 4) != 0 ||
+        (header[4] | (header[5] << 8)) != STMT_INDEX_VERSION) {
+        fclose(f);
+        return -1;
+    }
+    idx->stmt_count = get_u32(header + 8);
+    idx->pif_size = get_u64(header + 16);
+    idx->token_count = get_u64(header + 24);
+    idx->pif_mtime = (int64_t)get_u64(header + 32);
+    idx->pif_checksum = get_u64(header + 40);
+
+    // The PIF must be unchanged since indexing, and every record must be there
+    PifStamp stamp;
+    int64_t index_size = seek64(f, 0, SEEK_END) == 0 ? tell64(f) : -1;
+    if (pif_stamp(pif_file, &stamp) != 0 || stamp.size != idx->pif_size ||
+        stamp.mtime != idx->pif_mtime || stamp.checksum != idx->pif_checksum ||
+        index_size != STMT_INDEX_HEADER_SIZE + (int64_t)idx->stmt_count * STMT_INDEX_RECORD_SIZE) {
+        fclose(f);
+        memset(idx, 0, sizeof(*idx));
+        return -1;
+    }
+    idx->file = f;
+    return 0;
+}
+
+int stmt_index_get(StmtIndex *idx, uint32_t k, StmtRange *range) {
+    if (!idx->file || k >= idx->stmt_count) return -1;
+    unsigned char rec[STMT_INDEX_RECORD_SIZE];
+    uint64_t offset = STMT_INDEX_HEADER_SIZE + (uint64_t)k * STMT_INDEX_RECORD_SIZE;
+    if (seek64(idx->file, offset, SEEK_SET) != 0 || fread(rec, 1, sizeof(rec), idx->file) != sizeof(rec)) {
+        return -1;
+    }
+    range->offset = get_u64(rec);
+    range->first_token = get_u64(rec + 8);
+    range->length = get_u32(rec + 16);
+    range->token_count = get_u32(rec + 20);
+    return 0;
+}
+
+int stmt_index_read(const char *pif_file, uint64_t offset, uint64_t length, PIFMap *tokens) {
+    memset(tokens, 0, sizeof(*tokens));
+    if (length > 0xFFFFFFFFu) return -1;
+    FILE *f = fopen(pif_file, "rb");
+    if (!f) return -1;
+    char *data = malloc(length > 0 ? (size_t)length : 1);
+    if (!data || seek64(f, offset, SEEK_SET) != 0 || fread(data, 1, (size_t)length, f) != (size_t)length) {
+        free(data);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    int count = pif_map_from_buffer(tokens, data, (size_t)length);
+    tokens->owned = 1;
+    return count;
+}
+
+void stmt_index_close(StmtIndex *idx) {
+    if (idx->file) fclose(idx->file);
+    memset(idx, 0, sizeof(*idx));
+}
+
+char *stmt_index_path(const char *pif_file) {
+    size_t len = strlen(pif_file);
+    char *path = malloc(len + 5);
+    memcpy(path, pif_file, len);
+    memcpy(path + len, ".idx", 5);
+    return path;
+}
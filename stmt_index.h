@@ -0,0 +1,67 @@
+// stmt_index.h
+// Statement offset index for text PIF files: top-level statement k maps to its
+// byte range and token range, so a statement can be read without scanning the
+// rest of the file
+
+#ifndef STMT_INDEX_H
+#define STMT_INDEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "pif_map.h"
+
+// Index file (little endian):
+//   header  "PIFX", u16 version, u16 flags, u32 stmt_count, u64 pif_size,
+//           u64 token_count, i64 pif_mtime, u64 pif_checksum
+//   records stmt_count x { u64 offset, u64 first_token, u32 length, u32 token_count }
+// A statement runs from its first entry up to the NL entry that ends it at
+// DO/END depth zero (OTHERWISE DO does not open a level). NLs between
+// statements belong to none. Token numbers count every PIF entry, as the
+// readers do. pif_checksum is FNV-1a over STMT_INDEX_SAMPLES blocks of
+// STMT_INDEX_SAMPLE_SIZE bytes spread evenly over the PIF (the first and last
+// included), so checking it reads at most 64 KiB whatever the PIF's size.
+#define STMT_INDEX_MAGIC "PIFX"
+#define STMT_INDEX_VERSION 2
+#define STMT_INDEX_HEADER_SIZE 48
+#define STMT_INDEX_SAMPLES 16
+#define STMT_INDEX_SAMPLE_SIZE 4096
+#define STMT_INDEX_RECORD_SIZE 24
+
+typedef struct {
+    uint64_t offset;        // byte offset of the statement's first PIF line
+    uint64_t first_token;   // index of its first PIF entry
+    uint32_t length;        // bytes up to the line of the terminating NL
+    uint32_t token_count;   // entries, without the terminating NL
+} StmtRange;
+
+typedef struct {
+    FILE *file;
+    uint32_t stmt_count;
+    uint64_t pif_size;
+    uint64_t token_count;
+    int64_t pif_mtime;
+    uint64_t pif_checksum;
+} StmtIndex;
+
+// Scan a text PIF once (streaming, any size) and write its index.
+// Returns the statement count, or -1 on error.
+int stmt_index_build(const char *pif_file, const char *index_file);
+
+// Open an index and check that it was built for the PIF as it is now: same
+// size, modification time and sampled checksum.
+// Returns 0 on success, -1 if missing, malformed or stale.
+int stmt_index_open(StmtIndex *idx, const char *index_file, const char *pif_file);
+
+// Record of statement k: one seek and one read. Returns 0, or -1 if k is out of range.
+int stmt_index_get(StmtIndex *idx, uint32_t k, StmtRange *range);
+
+// Read bytes [offset, offset + length) of the PIF and index the entries they
+// hold; the map owns the bytes. Returns the entry count or -1 on error.
+int stmt_index_read(const char *pif_file, uint64_t offset, uint64_t length, PIFMap *tokens);
+
+void stmt_index_close(StmtIndex *idx);
+
+// Default index file next to the PIF: pif_file + ".idx" (malloc'd)
+char *stmt_index_path(const char *pif_file);
+
+#endif // STMT_INDEX_H
@@ -0,0 +1,58 @@
+// token_ring.c
+// Lock-free SPSC token ring
+
+#include "token_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define ring_yield() SwitchToThread()
+#else
+#include <sched.h>
+#define ring_yield() sched_yield()
+#endif
+
+#define RING_SPINS 64
+
+int token_ring_init(TokenRing *ring, size_t capacity) {
+    memset(ring, 0, sizeof(*ring));
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+    ring->slots = malloc(sizeof(TokenRecord) * size);
+    if (!ring->slots) return -1;
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 0;
+}
+
+void token_ring_push(TokenRing *ring, const TokenRecord *rec) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    int spins = 0;
+    while (head - ring->tail_cache > ring->mask) {
+        ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->tail_cache <= ring->mask) break;
+        if (++spins > RING_SPINS) ring_yield();
+    }
+    ring->slots[head & ring->mask] = *rec;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void token_ring_pop(TokenRing *ring, TokenRecord *rec) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    int spins = 0;
+    while (tail == ring->head_cache) {
+        ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail != ring->head_cache) break;
+        if (++spins > RING_SPINS) ring_yield();
+    }
+    *rec = ring->slots[tail & ring->mask];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+void token_ring_free(TokenRing *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+    ring->mask = 0;
+}
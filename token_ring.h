@@ -0,0 +1,43 @@
+// token_ring.h
+// Bounded single-producer/single-consumer ring of token records, used to hand
+// tokens from a lexer thread to a parser thread without locks
+
+#ifndef TOKEN_RING_H
+#define TOKEN_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "pif_reader.h"
+
+#define TOKEN_RING_LINE 64
+
+// Terminal value of the record that ends the stream
+#define TOKEN_RING_EOF (-2)
+
+typedef struct {
+    PIFEntry entry;
+    int terminal;               // terminal column, -1 if unknown, TOKEN_RING_EOF at end
+} TokenRecord;
+
+// head and tail live on separate cache lines, each next to the owning side's
+// cached copy of the other index, so a push or pop touches the shared line of
+// the other thread only when the ring looks full or empty
+typedef struct {
+    _Alignas(TOKEN_RING_LINE) atomic_size_t head;   // next slot to write (producer)
+    size_t tail_cache;
+    _Alignas(TOKEN_RING_LINE) atomic_size_t tail;   // next slot to read (consumer)
+    size_t head_cache;
+    _Alignas(TOKEN_RING_LINE) TokenRecord *slots;
+    size_t mask;
+} TokenRing;
+
+// capacity is rounded up to a power of two. Returns 0 on success.
+int token_ring_init(TokenRing *ring, size_t capacity);
+
+// Blocking push/pop: spin briefly, then yield until there is room / a record
+void token_ring_push(TokenRing *ring, const TokenRecord *rec);
+void token_ring_pop(TokenRing *ring, TokenRecord *rec);
+
+void token_ring_free(TokenRing *ring);
+
+#endif // TOKEN_RING_H
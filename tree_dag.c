@@ -0,0 +1,302 @@
+// tree_dag.c
+// Hash-consing tree builder and DAG export
+
+#include "tree_dag.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME  1099511628211ULL
+
+static uint64_t hash_mix(uint64_t h, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        h ^= (v >> (8 * i)) & 0xFF;
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+static uint64_t hash_str(uint64_t h, const char *s) {
+    while (*s) {
+        h ^= (uint8_t)(*s++);
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+// Exact structural equality against a candidate key
+static int same_node(const TreeDag *dag, const DagNode *n, const DagNode *key, const int *kids) {
+    if (n->hash != key->hash || n->symbol != key->symbol || n->production != key->production ||
+        n->child_count != key->child_count) return 0;
+    if (key->lexeme) {
+        if (!n->lexeme || strcmp(n->lexeme, key->lexeme) != 0) return 0;
+        if (n->bucket != key->bucket || n->pos != key->pos) return 0;
+    } else if (n->lexeme) {
+        return 0;
+    }
+    return key->child_count == 0 ||
+           memcmp(dag->children + n->first_child, kids, sizeof(int) * key->child_count) == 0;
+}
+
+static void grow_slots(TreeDag *dag) {
+    int cap = dag->slot_cap ? dag->slot_cap * 2 : 1024;
+    int *slots = malloc(sizeof(int) * cap);
+    for (int i = 0; i < cap; i++) slots[i] = -1;
+    for (int id = 0; id < dag->node_count; id++) {
+        size_t s = dag->nodes[id].hash & (cap - 1);
+        while (slots[s] != -1) s = (s + 1) & (cap - 1);
+        slots[s] = id;
+    }
+    free(dag->slots);
+    dag->slots = slots;
+    dag->slot_cap = cap;
+}
+
+// Return the id of an identical existing node or add a new one
+static int intern_node(TreeDag *dag, DagNode *key, const int *kids) {
+    if ((dag->node_count + 1) * 10 >= dag->slot_cap * 7) grow_slots(dag);
+
+    size_t s = key->hash & (dag->slot_cap - 1);
+    while (dag->slots[s] != -1) {
+        int id = dag->slots[s];
+        if (same_node(dag, &dag->nodes[id], key, kids)) return id;
+        s = (s + 1) & (dag->slot_cap - 1);
+    }
+
+    if (dag->node_count == dag->node_cap) {
+        dag->node_cap = dag->node_cap ? dag->node_cap * 2 : 1024;
+        dag->nodes = realloc(dag->nodes, sizeof(DagNode) * dag->node_cap);
+    }
+    if (dag->child_count + key->child_count > dag->child_cap) {
+        while (dag->child_count + key->child_count > dag->child_cap) {
+            dag->child_cap = dag->child_cap ? dag->child_cap * 2 : 1024;
+        }
+        dag->children = realloc(dag->children, sizeof(int) * dag->child_cap);
+    }
+
+    int id = dag->node_count++;
+    DagNode *n = &dag->nodes[id];
+    *n = *key;
+    n->first_child = dag->child_count;
+    if (key->child_count > 0) memcpy(dag->children + dag->child_count, kids, sizeof(int) * key->child_count);
+    dag->child_count += key->child_count;
+    n->size = 1;
+    n->tokens = key->lexeme ? 1 : 0;
+    for (int k = 0; k < key->child_count; k++) {
+        n->size += dag->nodes[kids[k]].size;
+        n->tokens += dag->nodes[kids[k]].tokens;
+    }
+    if (key->lexeme) {
+        n->lexeme = malloc(strlen(key->lexeme) + 1);
+        strcpy(n->lexeme, key->lexeme);
+    }
+    dag->slots[s] = id;
+    return id;
+}
+
+// Scratch stack holding the child ids of subtrees under construction
+typedef struct {
+    int *items;
+    int count;
+    int cap;
+} IdStack;
+
+static void ids_push(IdStack *st, int id) {
+    if (st->count == st->cap) {
+        st->cap = st->cap ? st->cap * 2 : 256;
+        st->items = realloc(st->items, sizeof(int) * st->cap);
+    }
+    st->items[st->count++] = id;
+}
+
+// Production being assembled: children so far live on the scratch stack from base
+typedef struct {
+    int production;
+    int next;
+    int base;
+} BuildFrame;
+
+// Bottom-up construction over the recorded derivation; iterative because
+// right-recursive tails make the tree as deep as the statement list is long
+static int build_nodes(TreeDag *dag, const LazyTree *lt, IdStack *scratch) {
+    const CompiledGrammar *cg = dag->cg;
+    int step = 0;
+    int token = 0;
+    int p = lazy_tree_production(lt, step++);
+    if (p < 0) return -1;
+
+    int cap = 256, fp = 0;
+    BuildFrame *frames = malloc(sizeof(BuildFrame) * cap);
+    frames[fp++] = (BuildFrame){ p, 0, 0 };
+    int root = -1;
+    while (fp > 0) {
+        BuildFrame *f = &frames[fp - 1];
+        if (f->next < cg->prod_len[f->production]) {
+            int sym = cg->prod_rhs[f->production][f->next++];
+            if (!cg_is_terminal(cg, sym)) {
+                int q = lazy_tree_production(lt, step++);
+                if (q < 0) break;
+                if (fp == cap) {
+                    cap *= 2;
+                    frames = realloc(frames, sizeof(BuildFrame) * cap);
+                }
+                frames[fp++] = (BuildFrame){ q, 0, scratch->count };
+                continue;
+            }
+            DagNode leaf;
+            memset(&leaf, 0, sizeof(leaf));
+            leaf.symbol = sym;
+            leaf.production = -1;
+            leaf.bucket = -1;
+            leaf.pos = -1;
+            leaf.lexeme = "";
+            if (token < lt->pif_count) {
+                PIFEntry *entry = &lt->pif_entries[token];
+                leaf.lexeme = entry->lexeme;
+                leaf.bucket = entry->bucket;
+                leaf.pos = entry->pos;
+            }
+            leaf.hash = hash_str(hash_mix(FNV_OFFSET, (uint64_t)sym), leaf.lexeme);
+            ids_push(scratch, intern_node(dag, &leaf, NULL));
+            token++;
+            continue;
+        }
+
+        DagNode key;
+        memset(&key, 0, sizeof(key));
+        key.symbol = cg->prod_lhs[f->production];
+        key.production = f->production;
+        key.child_count = scratch->count - f->base;
+        key.bucket = -1;
+        key.pos = -1;
+        uint64_t h = hash_mix(hash_mix(FNV_OFFSET, (uint64_t)key.symbol), (uint64_t)f->production);
+        for (int k = 0; k < key.child_count; k++) h = hash_mix(h, dag->nodes[scratch->items[f->base + k]].hash);
+        key.hash = h;
+
+        int id = intern_node(dag, &key, scratch->items + f->base);
+        scratch->count = f->base;
+        fp--;
+        if (fp > 0) ids_push(scratch, id); else root = id;
+    }
+    free(frames);
+    return root;
+}
+
+// Build the father side table: one entry per distinct (child, father) pair
+static void build_fathers(TreeDag *dag) {
+    int n = dag->node_count;
+    dag->father_offsets = calloc(n + 1, sizeof(int));
+    int *last = malloc(sizeof(int) * (n > 0 ? n : 1));
+    for (int i = 0; i < n; i++) last[i] = -1;
+
+    for (int f = 0; f < n; f++) {
+        DagNode *node = &dag->nodes[f];
+        for (int k = 0; k < node->child_count; k++) {
+            int c = dag->children[node->first_child + k];
+            if (last[c] != f) { last[c] = f; dag->father_offsets[c + 1]++; }
+        }
+    }
+    for (int i = 0; i < n; i++) dag->father_offsets[i + 1] += dag->father_offsets[i];
+
+    dag->father_ids = malloc(sizeof(int) * (dag->father_offsets[n] > 0 ? dag->father_offsets[n] : 1));
+    int *fill = malloc(sizeof(int) * (n > 0 ? n : 1));
+    for (int i = 0; i < n; i++) { fill[i] = dag->father_offsets[i]; last[i] = -1; }
+    for (int f = 0; f < n; f++) {
+        DagNode *node = &dag->nodes[f];
+        for (int k = 0; k < node->child_count; k++) {
+            int c = dag->children[node->first_child + k];
+            if (last[c] != f) { last[c] = f; dag->father_ids[fill[c]++] = f; }
+        }
+    }
+    free(fill);
+    free(last);
+}
+
+int tree_dag_build(TreeDag *dag, const LazyTree *lt) {
+    memset(dag, 0, sizeof(*dag));
+    dag->cg = lt->cg;
+    dag->root = -1;
+    if (lt->step_count == 0) return -1;
+
+    grow_slots(dag);
+    IdStack scratch = { NULL, 0, 0 };
+    dag->root = build_nodes(dag, lt, &scratch);
+    free(scratch.items);
+
+    build_fathers(dag);
+    return dag->root;
+}
+
+const int *tree_dag_fathers(const TreeDag *dag, int id, int *count) {
+    if (id < 0 || id >= dag->node_count || !dag->father_offsets) { *count = 0; return NULL; }
+    *count = dag->father_offsets[id + 1] - dag->father_offsets[id];
+    return dag->father_ids + dag->father_offsets[id];
+}
+
+// Expansion frame: unique node plus the indices it gets in the expanded table
+typedef struct {
+    int id;
+    int index;
+    int father;
+    int sibling;
+} DagFrame;
+
+void tree_dag_print_table(const TreeDag *dag, FILE *out) {
+    if (dag->root < 0) return;
+
+    fprintf(out, "Index | Symbol | Type | Production | Father | Sibling | Lexeme | ST Location\n");
+    fprintf(out, "------|--------|------|------------|--------|---------|--------|------------\n");
+
+    int cap = 256, sp = 0;
+    DagFrame *stack = malloc(sizeof(DagFrame) * cap);
+    stack[sp++] = (DagFrame){ dag->root, 0, -1, -1 };
+    while (sp > 0) {
+        DagFrame f = stack[--sp];
+        const DagNode *node = &dag->nodes[f.id];
+        int is_terminal = cg_is_terminal(dag->cg, node->symbol);
+
+        fprintf(out, "%5d | %-6s | %-4s | %10d | %6d | %7d | %-6s | ",
+                f.index,
+                cg_symbol_name(dag->cg, node->symbol),
+                is_terminal ? "TERM" : "NTERM",
+                node->production,
+                f.father,
+                f.sibling,
+                node->lexeme ? node->lexeme : "-");
+        if (node->bucket >= 0 && node->pos >= 0) {
+            fprintf(out, "%d,%d", node->bucket, node->pos);
+        } else {
+            fprintf(out, "-");
+        }
+        fprintf(out, "\n");
+
+        if (sp + node->child_count > cap) {
+            while (sp + node->child_count > cap) cap *= 2;
+            stack = realloc(stack, sizeof(DagFrame) * cap);
+        }
+        // Children occupy consecutive preorder ranges; push in reverse so the first is printed next
+        int total = 1;
+        for (int k = 0; k < node->child_count; k++) total += dag->nodes[dag->children[node->first_child + k]].size;
+        int next_index = -1;
+        int end = f.index + total;
+        for (int k = node->child_count - 1; k >= 0; k--) {
+            int c = dag->children[node->first_child + k];
+            int index = end - dag->nodes[c].size;
+            stack[sp++] = (DagFrame){ c, index, f.index, next_index };
+            next_index = index;
+            end = index;
+        }
+    }
+    free(stack);
+}
+
+void tree_dag_free(TreeDag *dag) {
+    for (int i = 0; i < dag->node_count; i++) free(dag->nodes[i].lexeme);
+    free(dag->nodes);
+    free(dag->children);
+    free(dag->slots);
+    free(dag->father_offsets);
+    free(dag->father_ids);
+    memset(dag, 0, sizeof(*dag));
+    dag->root = -1;
+}
@@ -0,0 +1,58 @@
+// tree_dag.h
+// Hash-consed parse trees: identical subtrees are shared, giving a DAG
+
+#ifndef TREE_DAG_H
+#define TREE_DAG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "compiled_grammar.h"
+#include "lazy_tree.h"
+
+// One unique subtree. Children are ids of other unique subtrees.
+typedef struct {
+    int symbol;             // CompiledGrammar symbol id
+    int production;         // production index (-1 for terminals)
+    int first_child;        // offset into TreeDag.children
+    int child_count;
+    char *lexeme;           // terminals only
+    int bucket;
+    int pos;
+    int size;               // nodes in the expanded subtree
+    int tokens;             // terminals (PIF entries) covered by the subtree
+    uint64_t hash;          // structural hash (independent of ids, comparable across trees)
+} DagNode;
+
+typedef struct {
+    const CompiledGrammar *cg;  // borrowed
+
+    DagNode *nodes;
+    int node_count;
+    int node_cap;
+
+    int *children;
+    int child_count;
+    int child_cap;
+
+    int *slots;             // open-addressing intern table of node ids (-1 = empty)
+    int slot_cap;
+
+    int root;               // id of the root subtree (-1 if empty)
+
+    // Father side table (CSR): fathers of node i are father_ids[father_offsets[i] .. father_offsets[i+1])
+    int *father_offsets;
+    int *father_ids;
+} TreeDag;
+
+// Build the DAG bottom-up from a recorded derivation. Returns the root id or -1.
+int tree_dag_build(TreeDag *dag, const LazyTree *lt);
+
+// Distinct fathers of a unique node
+const int *tree_dag_fathers(const TreeDag *dag, int id, int *count);
+
+// Write the expanded tree in the tree_print_table format
+void tree_dag_print_table(const TreeDag *dag, FILE *out);
+
+void tree_dag_free(TreeDag *dag);
+
+#endif // TREE_DAG_H
@@ -0,0 +1,304 @@
+// tree_diff.c
+// Statement-level tree diff: hash-matched anchors, then pairwise gaps
+
+#include "tree_diff.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A top-level statement of one tree
+typedef struct {
+    int node;
+    int token;
+    uint64_t hash;
+    int size;
+    int tokens;
+} StmtItem;
+
+typedef struct {
+    StmtItem *items;
+    int count;
+} StmtSeq;
+
+// Sort key used to find statements whose hash is unique on both sides
+typedef struct {
+    uint64_t hash;
+    int side;
+    int index;
+} HashKey;
+
+typedef struct {
+    int a;
+    int b;
+} Anchor;
+
+typedef struct {
+    TreeDiff *diff;
+    const StmtSeq *old_seq;
+    const StmtSeq *new_seq;
+} DiffContext;
+
+// Collect the outermost stmt nodes in order, tracking their first token
+static void collect_statements(const TreeDag *dag, int stmt_sym, StmtSeq *seq) {
+    seq->items = NULL;
+    seq->count = 0;
+    if (dag->root < 0) return;
+
+    int cap = 0;
+    int stack_cap = 256, sp = 0;
+    int *ids = malloc(sizeof(int) * stack_cap);
+    int *toks = malloc(sizeof(int) * stack_cap);
+    ids[sp] = dag->root;
+    toks[sp++] = 0;
+    while (sp > 0) {
+        sp--;
+        const DagNode *node = &dag->nodes[ids[sp]];
+        int token = toks[sp];
+
+        if (node->symbol == stmt_sym) {
+            if (seq->count == cap) {
+                cap = cap ? cap * 2 : 256;
+                seq->items = realloc(seq->items, sizeof(StmtItem) * cap);
+            }
+            StmtItem *it = &seq->items[seq->count++];
+            it->node = ids[sp];
+            it->token = token;
+            it->hash = node->hash;
+            it->size = node->size;
+            it->tokens = node->tokens;
+            continue;
+        }
+
+        if (sp + node->child_count > stack_cap) {
+            while (sp + node->child_count > stack_cap) stack_cap *= 2;
+            ids = realloc(ids, sizeof(int) * stack_cap);
+            toks = realloc(toks, sizeof(int) * stack_cap);
+        }
+        // Push in reverse so the leftmost child is visited first
+        int end = token + node->tokens;
+        for (int k = node->child_count - 1; k >= 0; k--) {
+            int c = dag->children[node->first_child + k];
+            end -= dag->nodes[c].tokens;
+            ids[sp] = c;
+            toks[sp++] = end;
+        }
+    }
+    free(ids);
+    free(toks);
+}
+
+static int same_stmt(const StmtItem *a, const StmtItem *b) {
+    return a->hash == b->hash && a->size == b->size && a->tokens == b->tokens;
+}
+
+static void emit(DiffContext *ctx, DiffKind kind, int a, int b) {
+    TreeDiff *diff = ctx->diff;
+    if (diff->count == diff->cap) {
+        diff->cap = diff->cap ? diff->cap * 2 : 64;
+        diff->ops = realloc(diff->ops, sizeof(DiffOp) * diff->cap);
+    }
+    DiffOp *op = &diff->ops[diff->count++];
+    op->kind = kind;
+    op->old_stmt = a;
+    op->new_stmt = b;
+    op->old_node = op->old_token = op->old_tokens = -1;
+    op->new_node = op->new_token = op->new_tokens = -1;
+    if (a >= 0) {
+        const StmtItem *it = &ctx->old_seq->items[a];
+        op->old_node = it->node;
+        op->old_token = it->token;
+        op->old_tokens = it->tokens;
+    }
+    if (b >= 0) {
+        const StmtItem *it = &ctx->new_seq->items[b];
+        op->new_node = it->node;
+        op->new_token = it->token;
+        op->new_tokens = it->tokens;
+    }
+    if (kind == DIFF_INSERTED) diff->inserted++;
+    else if (kind == DIFF_DELETED) diff->deleted++;
+    else diff->changed++;
+}
+
+// No common statement left in the gap: pair up as changed, the rest is inserted/deleted
+static void emit_gap(DiffContext *ctx, int a0, int a1, int b0, int b1) {
+    while (a0 < a1 && b0 < b1) {
+        if (same_stmt(&ctx->old_seq->items[a0], &ctx->new_seq->items[b0])) {
+            ctx->diff->identical++;
+            a0++;
+            b0++;
+        } else {
+            emit(ctx, DIFF_CHANGED, a0++, b0++);
+        }
+    }
+    while (a0 < a1) emit(ctx, DIFF_DELETED, a0++, -1);
+    while (b0 < b1) emit(ctx, DIFF_INSERTED, -1, b0++);
+}
+
+static int compare_keys(const void *x, const void *y) {
+    const HashKey *a = x, *b = y;
+    if (a->hash != b->hash) return a->hash < b->hash ? -1 : 1;
+    if (a->side != b->side) return a->side - b->side;
+    return a->index - b->index;
+}
+
+static int compare_anchors(const void *x, const void *y) {
+    return ((const Anchor *)x)->a - ((const Anchor *)y)->a;
+}
+
+// Statements occurring exactly once on each side of the range, longest increasing chain
+static int find_anchors(DiffContext *ctx, int a0, int a1, int b0, int b1, Anchor **out) {
+    int n = (a1 - a0) + (b1 - b0);
+    HashKey *keys = malloc(sizeof(HashKey) * n);
+    int k = 0;
+    for (int i = a0; i < a1; i++) keys[k++] = (HashKey){ ctx->old_seq->items[i].hash, 0, i };
+    for (int j = b0; j < b1; j++) keys[k++] = (HashKey){ ctx->new_seq->items[j].hash, 1, j };
+    qsort(keys, n, sizeof(HashKey), compare_keys);
+
+    Anchor *pairs = malloc(sizeof(Anchor) * (n / 2 + 1));
+    int pair_count = 0;
+    for (int i = 0; i < n; ) {
+        int j = i;
+        while (j < n && keys[j].hash == keys[i].hash) j++;
+        if (j - i == 2 && keys[i].side == 0 && keys[i + 1].side == 1 &&
+            same_stmt(&ctx->old_seq->items[keys[i].index], &ctx->new_seq->items[keys[i + 1].index])) {
+            pairs[pair_count++] = (Anchor){ keys[i].index, keys[i + 1].index };
+        }
+        i = j;
+    }
+    free(keys);
+    qsort(pairs, pair_count, sizeof(Anchor), compare_anchors);
+
+    // Longest increasing subsequence on b (patience sorting)
+    int *tails = malloc(sizeof(int) * (pair_count + 1));
+    int *prev = malloc(sizeof(int) * (pair_count + 1));
+    int len = 0;
+    for (int i = 0; i < pair_count; i++) {
+        int lo = 0, hi = len;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (pairs[tails[mid]].b < pairs[i].b) lo = mid + 1; else hi = mid;
+        }
+        prev[i] = lo > 0 ? tails[lo - 1] : -1;
+        tails[lo] = i;
+        if (lo == len) len++;
+    }
+
+    *out = malloc(sizeof(Anchor) * (len > 0 ? len : 1));
+    for (int i = len > 0 ? tails[len - 1] : -1, pos = len - 1; i >= 0; i = prev[i], pos--) {
+        (*out)[pos] = pairs[i];
+    }
+    free(tails);
+    free(prev);
+    free(pairs);
+    return len;
+}
+
+static void diff_range(DiffContext *ctx, int a0, int a1, int b0, int b1) {
+    const StmtItem *A = ctx->old_seq->items;
+    const StmtItem *B = ctx->new_seq->items;
+
+    while (a0 < a1 && b0 < b1 && same_stmt(&A[a0], &B[b0])) { a0++; b0++; ctx->diff->identical++; }
+    int suffix = 0;
+    while (a0 < a1 && b0 < b1 && same_stmt(&A[a1 - 1], &B[b1 - 1])) { a1--; b1--; suffix++; }
+
+    if (a0 < a1 && b0 < b1) {
+        Anchor *anchors;
+        int count = find_anchors(ctx, a0, a1, b0, b1, &anchors);
+        if (count == 0) {
+            emit_gap(ctx, a0, a1, b0, b1);
+        } else {
+            int pa = a0, pb = b0;
+            for (int i = 0; i < count; i++) {
+                diff_range(ctx, pa, anchors[i].a, pb, anchors[i].b);
+                ctx->diff->identical++;
+                pa = anchors[i].a + 1;
+                pb = anchors[i].b + 1;
+            }
+            diff_range(ctx, pa, a1, pb, b1);
+        }
+        free(anchors);
+    } else {
+        emit_gap(ctx, a0, a1, b0, b1);
+    }
+    ctx->diff->identical += suffix;
+}
+
+int tree_diff(TreeDiff *diff, const TreeDag *old_dag, const TreeDag *new_dag, const char *stmt_symbol) {
+    memset(diff, 0, sizeof(*diff));
+    if (!old_dag->cg || !new_dag->cg) return -1;
+    int old_sym = cg_symbol_id(old_dag->cg, stmt_symbol);
+    int new_sym = cg_symbol_id(new_dag->cg, stmt_symbol);
+    if (old_sym < 0 || new_sym < 0) return -1;
+
+    StmtSeq old_seq, new_seq;
+    if (old_dag->root >= 0 && new_dag->root >= 0 &&
+        old_dag->nodes[old_dag->root].hash == new_dag->nodes[new_dag->root].hash &&
+        old_dag->nodes[old_dag->root].size == new_dag->nodes[new_dag->root].size) {
+        // Identical trees: nothing to walk
+        collect_statements(old_dag, old_sym, &old_seq);
+        diff->old_stmts = diff->new_stmts = diff->identical = old_seq.count;
+        free(old_seq.items);
+        return 0;
+    }
+
+    collect_statements(old_dag, old_sym, &old_seq);
+    collect_statements(new_dag, new_sym, &new_seq);
+    diff->old_stmts = old_seq.count;
+    diff->new_stmts = new_seq.count;
+
+    DiffContext ctx = { diff, &old_seq, &new_seq };
+    diff_range(&ctx, 0, old_seq.count, 0, new_seq.count);
+
+    free(old_seq.items);
+    free(new_seq.items);
+    return 0;
+}
+
+static void print_preview(PIFEntry *entries, int token, int tokens, char sign, FILE *out) {
+    char line[96];
+    int len = 0;
+    int truncated = 0;
+    for (int t = token; t < token + tokens; t++) {
+        const char *lex = entries[t].lexeme;
+        int n = (int)strlen(lex);
+        if (len + n + 1 > 72) {
+            truncated = 1;
+            break;
+        }
+        if (len > 0) line[len++] = ' ';
+        memcpy(line + len, lex, n);
+        len += n;
+    }
+    line[len] = '\0';
+    fprintf(out, "  %c %s%s\n", sign, line, truncated ? " ..." : "");
+}
+
+void tree_diff_print(const TreeDiff *diff, PIFEntry *old_entries, PIFEntry *new_entries, FILE *out) {
+    for (int i = 0; i < diff->count; i++) {
+        const DiffOp *op = &diff->ops[i];
+        switch (op->kind) {
+        case DIFF_CHANGED:
+            fprintf(out, "CHANGED  old #%d [%d,%d) -> new #%d [%d,%d)\n",
+                    op->old_stmt, op->old_token, op->old_token + op->old_tokens,
+                    op->new_stmt, op->new_token, op->new_token + op->new_tokens);
+            break;
+        case DIFF_DELETED:
+            fprintf(out, "DELETED  old #%d [%d,%d)\n",
+                    op->old_stmt, op->old_token, op->old_token + op->old_tokens);
+            break;
+        case DIFF_INSERTED:
+            fprintf(out, "INSERTED new #%d [%d,%d)\n",
+                    op->new_stmt, op->new_token, op->new_token + op->new_tokens);
+            break;
+        }
+        if (op->old_stmt >= 0 && old_entries) print_preview(old_entries, op->old_token, op->old_tokens, '-', out);
+        if (op->new_stmt >= 0 && new_entries) print_preview(new_entries, op->new_token, op->new_tokens, '+', out);
+    }
+    fprintf(out, "Statements: %d old, %d new; %d identical, %d changed, %d inserted, %d deleted\n",
+            diff->old_stmts, diff->new_stmts, diff->identical, diff->changed, diff->inserted, diff->deleted);
+}
+
+void tree_diff_free(TreeDiff *diff) {
+    free(diff->ops);
+    memset(diff, 0, sizeof(*diff));
+}
@@ -0,0 +1,53 @@
+// tree_diff.h
+// Structural diff of two parses at statement granularity, driven by subtree hashes
+
+#ifndef TREE_DIFF_H
+#define TREE_DIFF_H
+
+#include <stdio.h>
+#include "tree_dag.h"
+#include "pif_reader.h"
+
+typedef enum {
+    DIFF_INSERTED,
+    DIFF_DELETED,
+    DIFF_CHANGED
+} DiffKind;
+
+// One reported statement; old_* or new_* fields are -1 when that side is absent
+typedef struct {
+    DiffKind kind;
+    int old_stmt;           // ordinal among the top-level statements of the old tree
+    int new_stmt;
+    int old_node;           // DAG node id of the statement
+    int new_node;
+    int old_token;          // first PIF entry of the statement
+    int new_token;
+    int old_tokens;         // PIF entries covered
+    int new_tokens;
+} DiffOp;
+
+typedef struct {
+    DiffOp *ops;            // in statement order
+    int count;
+    int cap;
+
+    int old_stmts;          // top-level statements in each tree
+    int new_stmts;
+    int identical;          // statements matched by hash (never walked)
+    int inserted;
+    int deleted;
+    int changed;
+} TreeDiff;
+
+// Compare two DAGs built with the same grammar. Statements are the outermost
+// nodes of stmt_symbol; they are matched by structural hash, so identical
+// statements cost O(1) each. Returns 0 on success, -1 on error.
+int tree_diff(TreeDiff *diff, const TreeDag *old_dag, const TreeDag *new_dag, const char *stmt_symbol);
+
+// Write the edit script with a one-line lexeme preview of every statement
+void tree_diff_print(const TreeDiff *diff, PIFEntry *old_entries, PIFEntry *new_entries, FILE *out);
+
+void tree_diff_free(TreeDiff *diff);
+
+#endif // TREE_DIFF_H
@@ -0,0 +1,169 @@
+// tree_index.c
+// Node index construction and queries
+
+#include "tree_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int count_nodes(ParseTreeNode *root) {
+    int n = 0;
+    int cap = 256, sp = 0;
+    ParseTreeNode **stack = malloc(sizeof(ParseTreeNode*) * cap);
+    stack[sp++] = root;
+    while (sp > 0) {
+        ParseTreeNode *node = stack[--sp];
+        n++;
+        for (ParseTreeNode *c = node->child; c; c = c->sibling) {
+            if (sp == cap) { cap *= 2; stack = realloc(stack, sizeof(ParseTreeNode*) * cap); }
+            stack[sp++] = c;
+        }
+    }
+    free(stack);
+    return n;
+}
+
+// Turn per-key counts into CSR offsets and scatter ids (ids visited in ascending order)
+static void build_postings(int keys, const int *key_of, int n, int **offsets_out, int **postings_out) {
+    int *offsets = calloc(keys + 1, sizeof(int));
+    int *postings = malloc(sizeof(int) * (n > 0 ? n : 1));
+    for (int i = 0; i < n; i++) if (key_of[i] >= 0) offsets[key_of[i] + 1]++;
+    for (int k = 0; k < keys; k++) offsets[k + 1] += offsets[k];
+    int *fill = malloc(sizeof(int) * (keys > 0 ? keys : 1));
+    memcpy(fill, offsets, sizeof(int) * keys);
+    for (int i = 0; i < n; i++) if (key_of[i] >= 0) postings[fill[key_of[i]]++] = i;
+    free(fill);
+    *offsets_out = offsets;
+    *postings_out = postings;
+}
+
+int tree_index_build(TreeIndex *idx, ParseTreeNode *root, const CompiledGrammar *cg) {
+    memset(idx, 0, sizeof(*idx));
+    if (!root) return -1;
+
+    int n = count_nodes(root);
+    idx->node_count = n;
+    idx->nodes = malloc(sizeof(ParseTreeNode*) * n);
+    idx->father = malloc(sizeof(int) * n);
+    idx->subtree_size = malloc(sizeof(int) * n);
+    int *sym_of = malloc(sizeof(int) * n);
+    int *prod_of = malloc(sizeof(int) * n);
+
+    // Iterative preorder; children pushed in reverse so the leftmost is visited first.
+    // Each stack entry remembers its father id.
+    int cap = 256, sp = 0;
+    ParseTreeNode **stack = malloc(sizeof(ParseTreeNode*) * cap);
+    int *stack_father = malloc(sizeof(int) * cap);
+    stack[sp] = root;
+    stack_father[sp++] = -1;
+    int id = 0;
+    while (sp > 0) {
+        sp--;
+        ParseTreeNode *node = stack[sp];
+        int f = stack_father[sp];
+        idx->nodes[id] = node;
+        idx->father[id] = f;
+        idx->subtree_size[id] = 1;
+        sym_of[id] = cg_symbol_id(cg, node->symbol);
+        prod_of[id] = (!node->is_terminal && node->production_index >= 0 &&
+                       node->production_index < cg->prod_count) ? node->production_index : -1;
+
+        int nk = 0;
+        for (ParseTreeNode *c = node->child; c; c = c->sibling) nk++;
+        if (sp + nk > cap) {
+            while (sp + nk > cap) cap *= 2;
+            stack = realloc(stack, sizeof(ParseTreeNode*) * cap);
+            stack_father = realloc(stack_father, sizeof(int) * cap);
+        }
+        // Filled from the top down, so the leftmost child ends up on top
+        int k = sp + nk;
+        for (ParseTreeNode *c = node->child; c; c = c->sibling) {
+            k--;
+            stack[k] = c;
+            stack_father[k] = id;
+        }
+        sp += nk;
+        id++;
+    }
+    free(stack);
+    free(stack_father);
+
+    // Subtree sizes: fathers precede their descendants in preorder
+    for (int i = n - 1; i > 0; i--) idx->subtree_size[idx->father[i]] += idx->subtree_size[i];
+
+    idx->symbol_count = cg->nt_count + cg->t_count;
+    idx->prod_count = cg->prod_count;
+    build_postings(idx->symbol_count, sym_of, n, &idx->sym_offsets, &idx->sym_postings);
+    build_postings(idx->prod_count, prod_of, n, &idx->prod_offsets, &idx->prod_postings);
+
+    free(sym_of);
+    free(prod_of);
+    return 0;
+}
+
+void tree_index_free(TreeIndex *idx) {
+    free(idx->nodes);
+    free(idx->father);
+    free(idx->subtree_size);
+    free(idx->sym_offsets);
+    free(idx->sym_postings);
+    free(idx->prod_offsets);
+    free(idx->prod_postings);
+    memset(idx, 0, sizeof(*idx));
+}
+
+const int *tree_index_symbol(const TreeIndex *idx, int symbol, int *count) {
+    if (symbol < 0 || symbol >= idx->symbol_count) { *count = 0; return NULL; }
+    *count = idx->sym_offsets[symbol + 1] - idx->sym_offsets[symbol];
+    return idx->sym_postings + idx->sym_offsets[symbol];
+}
+
+const int *tree_index_production(const TreeIndex *idx, int prod, int *count) {
+    if (prod < 0 || prod >= idx->prod_count) { *count = 0; return NULL; }
+    *count = idx->prod_offsets[prod + 1] - idx->prod_offsets[prod];
+    return idx->prod_postings + idx->prod_offsets[prod];
+}
+
+// First position in a sorted list with value >= key
+static int lower_bound(const int *a, int n, int key) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (a[mid] < key) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+int tree_index_find_under(const TreeIndex *idx, int symbol, int ancestor, int *out, int max) {
+    if (ancestor < 0 || ancestor >= idx->node_count) return 0;
+    int n = 0;
+    const int *list = tree_index_symbol(idx, symbol, &n);
+    int from = lower_bound(list, n, ancestor);
+    int to = lower_bound(list, n, ancestor + idx->subtree_size[ancestor]);
+    for (int i = from; i < to && out && i - from < max; i++) out[i - from] = list[i];
+    return to - from;
+}
+
+int tree_index_find_nested(const TreeIndex *idx, int symbol, int ancestor_symbol, int *out, int max) {
+    int nd = 0, na = 0;
+    const int *desc = tree_index_symbol(idx, symbol, &nd);
+    const int *anc = tree_index_symbol(idx, ancestor_symbol, &na);
+
+    // Sweep both lists in preorder, tracking the furthest end of the open ancestor intervals
+    int found = 0;
+    int ai = 0;
+    int open_end = -1;
+    for (int i = 0; i < nd; i++) {
+        int d = desc[i];
+        while (ai < na && anc[ai] < d) {
+            int end = anc[ai] + idx->subtree_size[anc[ai]];
+            if (end > open_end) open_end = end;
+            ai++;
+        }
+        if (d < open_end) {
+            if (out && found < max) out[found] = d;
+            found++;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,48 @@
+// tree_index.h
+// Per-symbol / per-production node index over a parse tree for fast queries
+
+#ifndef TREE_INDEX_H
+#define TREE_INDEX_H
+
+#include "compiled_grammar.h"
+#include "parse_tree.h"
+
+// Node ids are preorder positions, identical to the indices printed by tree_print_table.
+// Postings lists are stored in CSR form and are sorted by node id.
+typedef struct {
+    int node_count;
+    ParseTreeNode **nodes;      // id -> node
+    int *father;                // id -> father id (-1 for root)
+    int *subtree_size;          // id -> number of nodes in its subtree (itself included)
+
+    int symbol_count;           // nonterminals + terminals (CompiledGrammar ids)
+    int *sym_offsets;           // symbol_count + 1 entries
+    int *sym_postings;
+
+    int prod_count;
+    int *prod_offsets;          // prod_count + 1 entries
+    int *prod_postings;
+} TreeIndex;
+
+// Build the index in one preorder pass. Returns 0 on success.
+int tree_index_build(TreeIndex *idx, ParseTreeNode *root, const CompiledGrammar *cg);
+void tree_index_free(TreeIndex *idx);
+
+// Sorted node ids carrying a grammar symbol / production
+const int *tree_index_symbol(const TreeIndex *idx, int symbol, int *count);
+const int *tree_index_production(const TreeIndex *idx, int prod, int *count);
+
+// O(1): 1 if node a is an ancestor of (or equal to) node d
+static inline int tree_index_is_ancestor(const TreeIndex *idx, int a, int d) {
+    return d >= a && d < a + idx->subtree_size[a];
+}
+
+// Nodes with symbol inside the subtree of node `ancestor` (O(log n + result)).
+// Writes up to max ids to out; returns the total number of matches.
+int tree_index_find_under(const TreeIndex *idx, int symbol, int ancestor, int *out, int max);
+
+// Nodes with symbol that have at least one ancestor carrying ancestor_symbol
+// (e.g. all lambda nodes under stage_keyword). Linear in both postings lists.
+int tree_index_find_nested(const TreeIndex *idx, int symbol, int ancestor_symbol, int *out, int max);
+
+#endif // TREE_INDEX_H